@@ -94,6 +94,29 @@ LOCAL_MODULE:= recordvideo
 
 include $(BUILD_EXECUTABLE)
 
+################################################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:=         \
+	writerbench.cpp
+
+LOCAL_SHARED_LIBRARIES := \
+	libstagefright libmedia liblog libutils libstagefright_foundation
+
+LOCAL_C_INCLUDES:= \
+	frameworks/av/media/libstagefright \
+	$(TOP)/frameworks/native/include/media/openmax
+
+LOCAL_CFLAGS += -Wno-multichar -Werror -Wall
+LOCAL_CLANG := true
+
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_MODULE:= writerbench
+
+include $(BUILD_EXECUTABLE)
+
 
 ################################################################################
 
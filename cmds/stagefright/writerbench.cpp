@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "writerbench"
+#include <inttypes.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <utils/Log.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/MediaBufferGroup.h>
+#include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MediaSource.h>
+#include <media/stagefright/MetaData.h>
+#include <media/stagefright/MPEG4Writer.h>
+#include <utils/String16.h>
+#include <utils/Timers.h>
+#include <utils/Vector.h>
+
+using namespace android;
+
+static void usage(const char *me) {
+    fprintf(stderr, "usage: %s\n", me);
+    fprintf(stderr, "       -h(elp)\n");
+    fprintf(stderr, "       -d duration of the recording in seconds (default: 60)\n");
+    fprintf(stderr, "       -b video bit rate in bits per second (default: 12000000)\n");
+    fprintf(stderr, "       -f video frame rate in frames per second (default: 30)\n");
+    fprintf(stderr, "       -s slices (NAL units) per video frame (default: 4)\n");
+    fprintf(stderr, "       -n(o audio)\n");
+    fprintf(stderr, "       -l limit the file duration to the recording duration\n");
+    fprintf(stderr, "       -o filename: output file (default: /sdcard/writerbench.mp4)\n");
+    exit(1);
+}
+
+// Produces AVC access units of a constant size, made up of start code
+// prefixed NAL units, as fast as they are read.
+struct SyntheticVideoSource : public MediaSource {
+    SyntheticVideoSource(int64_t durationUs, int32_t bitRate, int32_t frameRate,
+            int32_t numSlices)
+        : mNumFrames(durationUs * frameRate / 1000000),
+          mFrameRate(frameRate),
+          mNumSlices(numSlices),
+          mFrameSize(bitRate / 8 / frameRate),
+          mNumFramesOutput(0) {
+        CHECK_GT(mFrameSize, (size_t)(mNumSlices * 8));
+        mGroup.add_buffer(new MediaBuffer(mFrameSize));
+    }
+
+    virtual sp<MetaData> getFormat() {
+        // Baseline profile, 4 byte NAL unit lengths, and one SPS and PPS.
+        static const uint8_t kAVCC[] = {
+            0x01, 0x42, 0x00, 0x1f, 0xff,
+            0xe1, 0x00, 0x08, 0x67, 0x42, 0x00, 0x1f, 0xe9, 0x02, 0xc1, 0x2c,
+            0x01, 0x00, 0x04, 0x68, 0xce, 0x06, 0xe2,
+        };
+
+        sp<MetaData> meta = new MetaData;
+        meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_VIDEO_AVC);
+        meta->setInt32(kKeyWidth, 1920);
+        meta->setInt32(kKeyHeight, 1080);
+        meta->setInt32(kKeyFrameRate, mFrameRate);
+        meta->setData(kKeyAVCC, kTypeAVCC, kAVCC, sizeof(kAVCC));
+        return meta;
+    }
+
+    virtual status_t start(MetaData * /* params */) {
+        mNumFramesOutput = 0;
+        return OK;
+    }
+
+    virtual status_t stop() {
+        return OK;
+    }
+
+    virtual status_t read(
+            MediaBuffer **buffer, const MediaSource::ReadOptions * /* options */) {
+        if (mNumFramesOutput == mNumFrames) {
+            return ERROR_END_OF_STREAM;
+        }
+
+        status_t err = mGroup.acquire_buffer(buffer);
+        if (err != OK) {
+            return err;
+        }
+
+        bool isSync = (mNumFramesOutput % mFrameRate) == 0;
+        uint8_t *data = (uint8_t *)(*buffer)->data();
+        size_t sliceSize = mFrameSize / mNumSlices;
+        for (int32_t i = 0; i < mNumSlices; ++i) {
+            uint8_t *slice = data + i * sliceSize;
+            memset(slice, 0xa5, sliceSize);
+            memcpy(slice, "\x00\x00\x00\x01", 4);
+            slice[4] = isSync ? 0x65 : 0x41;
+        }
+
+        int64_t timeUs = mNumFramesOutput * 1000000ll / mFrameRate;
+        (*buffer)->set_range(0, sliceSize * mNumSlices);
+        (*buffer)->meta_data()->clear();
+        (*buffer)->meta_data()->setInt64(kKeyTime, timeUs);
+        (*buffer)->meta_data()->setInt64(kKeyDecodingTime, timeUs);
+        (*buffer)->meta_data()->setInt32(kKeyIsSyncFrame, isSync);
+        ++mNumFramesOutput;
+
+        return OK;
+    }
+
+protected:
+    virtual ~SyntheticVideoSource() {}
+
+private:
+    MediaBufferGroup mGroup;
+    int64_t mNumFrames;
+    int32_t mFrameRate;
+    int32_t mNumSlices;
+    size_t mFrameSize;
+    int64_t mNumFramesOutput;
+
+    SyntheticVideoSource(const SyntheticVideoSource &);
+    SyntheticVideoSource &operator=(const SyntheticVideoSource &);
+};
+
+// Produces 20 ms AMR-NB frames at 12.2 kbps.
+struct SyntheticAudioSource : public MediaSource {
+    SyntheticAudioSource(int64_t durationUs)
+        : mNumFrames(durationUs / 20000),
+          mNumFramesOutput(0) {
+        mGroup.add_buffer(new MediaBuffer(kFrameSize));
+    }
+
+    virtual sp<MetaData> getFormat() {
+        sp<MetaData> meta = new MetaData;
+        meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_AUDIO_AMR_NB);
+        meta->setInt32(kKeyChannelCount, 1);
+        meta->setInt32(kKeySampleRate, 8000);
+        return meta;
+    }
+
+    virtual status_t start(MetaData * /* params */) {
+        mNumFramesOutput = 0;
+        return OK;
+    }
+
+    virtual status_t stop() {
+        return OK;
+    }
+
+    virtual status_t read(
+            MediaBuffer **buffer, const MediaSource::ReadOptions * /* options */) {
+        if (mNumFramesOutput == mNumFrames) {
+            return ERROR_END_OF_STREAM;
+        }
+
+        status_t err = mGroup.acquire_buffer(buffer);
+        if (err != OK) {
+            return err;
+        }
+
+        uint8_t *data = (uint8_t *)(*buffer)->data();
+        memset(data, 0, kFrameSize);
+        data[0] = 0x3c;  // 12.2 kbps mode
+
+        (*buffer)->set_range(0, kFrameSize);
+        (*buffer)->meta_data()->clear();
+        (*buffer)->meta_data()->setInt64(kKeyTime, mNumFramesOutput * 20000ll);
+        (*buffer)->meta_data()->setInt32(kKeyIsSyncFrame, true);
+        ++mNumFramesOutput;
+
+        return OK;
+    }
+
+protected:
+    virtual ~SyntheticAudioSource() {}
+
+private:
+    enum {
+        kFrameSize = 32,
+    };
+
+    MediaBufferGroup mGroup;
+    int64_t mNumFrames;
+    int64_t mNumFramesOutput;
+
+    SyntheticAudioSource(const SyntheticAudioSource &);
+    SyntheticAudioSource &operator=(const SyntheticAudioSource &);
+};
+
+int main(int argc, char **argv) {
+    int64_t durationUs = 60000000ll;
+    int32_t bitRate = 12000000;
+    int32_t frameRate = 30;
+    int32_t numSlices = 4;
+    bool useAudio = true;
+    bool limitDuration = false;
+    const char *fileName = "/sdcard/writerbench.mp4";
+
+    int res;
+    while ((res = getopt(argc, argv, "d:b:f:s:nlo:h")) >= 0) {
+        switch (res) {
+            case 'd':
+            {
+                durationUs = atoi(optarg) * 1000000ll;
+                break;
+            }
+
+            case 'b':
+            {
+                bitRate = atoi(optarg);
+                break;
+            }
+
+            case 'f':
+            {
+                frameRate = atoi(optarg);
+                break;
+            }
+
+            case 's':
+            {
+                numSlices = atoi(optarg);
+                break;
+            }
+
+            case 'n':
+            {
+                useAudio = false;
+                break;
+            }
+
+            case 'l':
+            {
+                limitDuration = true;
+                break;
+            }
+
+            case 'o':
+            {
+                fileName = optarg;
+                break;
+            }
+
+            case 'h':
+            default:
+            {
+                usage(argv[0]);
+                break;
+            }
+        }
+    }
+
+    if (durationUs <= 0 || bitRate <= 0 || frameRate <= 0 || numSlices <= 0) {
+        usage(argv[0]);
+    }
+
+    int fd = open(fileName, O_CREAT | O_LARGEFILE | O_TRUNC | O_RDWR, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        fprintf(stderr, "couldn't open file %s: %s\n", fileName, strerror(errno));
+        return 1;
+    }
+
+    sp<MPEG4Writer> writer = new MPEG4Writer(fd);
+    close(fd);
+
+    if (limitDuration) {
+        writer->setMaxFileDuration(durationUs);
+    }
+    CHECK_EQ((status_t)OK, writer->addSource(
+            new SyntheticVideoSource(durationUs, bitRate, frameRate, numSlices)));
+    if (useAudio) {
+        CHECK_EQ((status_t)OK, writer->addSource(new SyntheticAudioSource(durationUs)));
+    }
+
+    sp<MetaData> params = new MetaData;
+    params->setInt32(kKeyRealTimeRecording, false);
+    params->setInt32(kKeyBitRate, bitRate);
+
+    int64_t startTimeUs = systemTime() / 1000;
+    CHECK_EQ((status_t)OK, writer->start(params.get()));
+    while (!writer->reachedEOS()) {
+        usleep(10000);
+    }
+    int64_t stopTimeUs = systemTime() / 1000;
+    writer->stop();
+    int64_t endTimeUs = systemTime() / 1000;
+    writer->dump(STDOUT_FILENO, Vector<String16>());
+
+    struct stat st;
+    CHECK_EQ(0, stat(fileName, &st));
+
+    printf("wrote %" PRId64 " bytes in %.2f secs (%.2f MB/s), finalized in %.2f ms\n",
+            (int64_t)st.st_size, (endTimeUs - startTimeUs) / 1E6,
+            st.st_size / ((endTimeUs - startTimeUs) / 1E6) / 1E6,
+            (endTimeUs - stopTimeUs) / 1E3);
+
+    return 0;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_EFFECTLOUDNESSENHANCERAPI_H_
+#define ANDROID_EFFECTLOUDNESSENHANCERAPI_H_
+
+#include <audio_effects/effect_loudnessenhancer.h>
+
+#if __cplusplus
+extern "C" {
+#endif
+
+/////////////////////////////////////////////////
+//      Loudness enhancer block processing
+/////////////////////////////////////////////////
+
+// Longest look-ahead accepted by LOUDNESS_ENHANCER_PARAM_LOOKAHEAD_MS. The look-ahead delays
+// the output of the effect by the same amount.
+#define LOUDNESS_ENHANCER_MAX_LOOKAHEAD_MS 10
+
+// Parameters, after the ones of audio_effects/effect_loudnessenhancer.h
+enum {
+    // int32_t: 1 (default) to update the compressor gain once per block of 16 frames and apply
+    // it to the whole block, 0 to update it on every frame
+    LOUDNESS_ENHANCER_PARAM_BLOCK_PROCESSING = 0x100,
+    // int32_t: look-ahead of the block processing in ms, 0 (default) to
+    // LOUDNESS_ENHANCER_MAX_LOOKAHEAD_MS. It is not used when updating the gain on every frame.
+    LOUDNESS_ENHANCER_PARAM_LOOKAHEAD_MS,
+};
+
+#if __cplusplus
+}  // extern "C"
+#endif
+
+#endif /*ANDROID_EFFECTLOUDNESSENHANCERAPI_H_*/
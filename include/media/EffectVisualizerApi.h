@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_EFFECTVISUALIZERAPI_H_
+#define ANDROID_EFFECTVISUALIZERAPI_H_
+
+#include <stdint.h>
+#include <audio_effects/effect_visualizer.h>
+
+#if __cplusplus
+extern "C" {
+#endif
+
+/////////////////////////////////////////////////
+//      Visualizer float capture and analysis
+/////////////////////////////////////////////////
+
+// The float capture is independent of the 8 bit capture of VISUALIZER_CMD_CAPTURE.
+// Its size is a power of 2 in the range below, or 0 when it is disabled (the default).
+#define VISUALIZER_FLOAT_CAPTURE_SIZE_MAX 16384
+#define VISUALIZER_FLOAT_CAPTURE_SIZE_MIN 128
+
+// Number of octave bands returned by VISUALIZER_CMD_MEASURE_BANDS, centered on
+// 31.25 Hz, 62.5 Hz, ... 16 kHz. Bands above half the sampling rate read as silent.
+#define VISUALIZER_BAND_COUNT 10
+
+// Parameters, after the ones of audio_effects/effect_visualizer.h
+enum {
+    // uint32_t: float capture size in samples
+    VISUALIZER_PARAM_FLOAT_CAPTURE_SIZE = 0x100,
+    // uint32_t: window applied before the FFT, one of visualizer_window_t
+    VISUALIZER_PARAM_WINDOW,
+};
+
+// Commands, after the ones of audio_effects/effect_visualizer.h
+enum {
+    // Returns the magnitudes of the float capture spectrum as VISUALIZER_PARAM_FLOAT_CAPTURE_SIZE
+    // / 2 + 1 floats, from DC to half the sampling rate. A full scale sine on a bin returns 1.0.
+    VISUALIZER_CMD_CAPTURE_FFT_FLOAT = EFFECT_CMD_FIRST_PROPRIETARY + 2,
+    // Returns a visualizer_band_measurement_t computed on the float capture.
+    VISUALIZER_CMD_MEASURE_BANDS,
+};
+
+typedef enum {
+    VISUALIZER_WINDOW_RECTANGULAR,
+    VISUALIZER_WINDOW_HANN,         // default
+    VISUALIZER_WINDOW_HAMMING,
+    VISUALIZER_WINDOW_BLACKMAN,
+} visualizer_window_t;
+
+// Levels in millibels, relative to a full scale square wave like the VISUALIZER_CMD_MEASURE
+// ones, and -9600 for silence. All are measured on the same float capture, so one command
+// replaces polling the waveform, the FFT and the peak and RMS measurements.
+typedef struct visualizer_band_measurement_s {
+    int32_t peakMb;
+    int32_t rmsMb;
+    int32_t bandMb[VISUALIZER_BAND_COUNT];
+} visualizer_band_measurement_t;
+
+#if __cplusplus
+}  // extern "C"
+#endif
+
+#endif /*ANDROID_EFFECTVISUALIZERAPI_H_*/
@@ -19,6 +19,7 @@
 
 #include <media/AudioEffect.h>
 #include <audio_effects/effect_visualizer.h>
+#include <media/EffectVisualizerApi.h>
 #include <utils/Thread.h>
 
 /**
@@ -43,6 +44,9 @@
  * In addition to the polling capture mode, a callback mode is also available by installing a
  * callback function by use of the setCaptureCallBack() method. The rate at which the callback
  * is called as well as the type of data returned is specified.
+ * For analysis, a float capture of up to getMaxFloatCaptureSize() samples can be enabled with
+ * setFloatCaptureSize(). Its windowed spectrum is returned in full resolution by getFloatFft(),
+ * and getBandMeasurements() returns its peak, RMS and octave band levels in a single call.
  * Before capturing data, the Visualizer must be enabled by calling the setEnabled() method.
  * When data capture is not needed any more, the Visualizer should be disabled.
  */
@@ -132,6 +136,28 @@ public:
     // are returned
     status_t getFft(uint8_t *fft);
 
+    // maximum float capture size in samples
+    static uint32_t getMaxFloatCaptureSize() { return VISUALIZER_FLOAT_CAPTURE_SIZE_MAX; }
+    // minimum float capture size in samples
+    static uint32_t getMinFloatCaptureSize() { return VISUALIZER_FLOAT_CAPTURE_SIZE_MIN; }
+
+    // set the float capture size, a power of two in the range
+    // [getMinFloatCaptureSize(), getMaxFloatCaptureSize()], or 0 to disable the float capture.
+    // Unlike setCaptureSize(), it can be called while the visualizer is enabled.
+    status_t setFloatCaptureSize(uint32_t size);
+    uint32_t getFloatCaptureSize() { return mFloatCaptureSize; }
+
+    // set the window applied to the float capture before the FFT, one of visualizer_window_t
+    status_t setWindow(uint32_t window);
+    uint32_t getWindow() { return mWindow; }
+
+    // return the magnitudes of the float capture spectrum, getFloatCaptureSize() / 2 + 1 values
+    // from DC to half the sampling rate. A full scale sine on a bin reads 1.0.
+    status_t getFloatFft(float *magnitudes);
+
+    // return the peak, RMS and octave band levels of the float capture
+    status_t getBandMeasurements(visualizer_band_measurement_t *measurement);
+
 protected:
     // from IEffectClient
     virtual void controlStatusChanged(bool controlGranted);
@@ -157,6 +183,7 @@ private:
     };
 
     status_t doFft(uint8_t *fft, uint8_t *waveform);
+    status_t setUint32Parameter(int32_t param, uint32_t value);
     void periodicCapture();
     uint32_t initCaptureSize();
 
@@ -166,6 +193,8 @@ private:
     uint32_t mSampleRate;
     uint32_t mScalingMode;
     uint32_t mMeasurementMode;
+    uint32_t mFloatCaptureSize;
+    uint32_t mWindow;
     capture_cbk_t mCaptureCallBack;
     void *mCaptureCbkUser;
     sp<CaptureThread> mCaptureThread;
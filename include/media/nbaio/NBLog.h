@@ -34,14 +34,35 @@ public:
 class Writer;
 class Reader;
 
+// Identifiers of the binary events logged by Writer::logEvent().
+// Reader decodes these by name, other values are shown numerically.
+enum EventId {
+    EVENT_ID_NONE,
+    // times in ns are clamped to INT32_MAX, about 2.1 seconds
+    EVENT_ID_UNDERRUN,          // fast thread cycle too long, arg0 = cycle time in ns
+    EVENT_ID_OVERRUN,           // fast thread cycle too short, arg0 = cycle time in ns
+    EVENT_ID_WARMUP,            // fast thread warmup complete, arg0 = cycles, arg1 = time in ns
+    EVENT_ID_USER = 0x100,      // first identifier available for other clients
+};
+
+static const size_t kMaxEventArgs = 4;  // maximum number of int32_t arguments of an event
+
 private:
 
 enum Event {
     EVENT_RESERVED,
     EVENT_STRING,               // ASCII string, not NUL-terminated
     EVENT_TIMESTAMP,            // clock_gettime(CLOCK_MONOTONIC)
+    EVENT_BINARY,               // binary event, see below
 };
 
+// layout of the data of an EVENT_BINARY entry, all fields in native byte order
+//  byte[0..7]          timestamp as int64_t nanoseconds of CLOCK_MONOTONIC
+//  byte[8..9]          event identifier as uint16_t
+//  byte[10..11]        argument count as uint16_t, 0 <= count <= kMaxEventArgs
+//  byte[12+4*i]        argument i as int32_t
+static const size_t kBinaryHeaderSize = 12;
+
 // ---------------------------------------------------------------------------
 
 // representation of a single log entry in private memory
@@ -50,7 +71,9 @@ struct Entry {
         : mEvent(event), mLength(length), mData(data) { }
     /*virtual*/ ~Entry() { }
 
-    int     readAt(size_t offset) const;
+    // Copies the shared memory representation of this entry to 'buffer',
+    // which must have room for mLength + 3 bytes.  Returns the number of bytes copied.
+    size_t  copyTo(uint8_t *buffer) const;
 
 private:
     friend class Writer;
@@ -128,6 +151,13 @@ public:
     virtual void    logTimestamp();
     virtual void    logTimestamp(const struct timespec& ts);
 
+    // Log a binary event with up to kMaxEventArgs arguments.  Unlike logf(), nothing is
+    // formatted by the caller; the Reader decodes the event when the log is dumped.
+    // The timestamp is taken now, or is the CLOCK_MONOTONIC time 'ts' the caller already has.
+    virtual void    logEvent(int id, const int32_t *args = NULL, size_t argc = 0);
+    virtual void    logEvent(int id, const struct timespec& ts,
+                             const int32_t *args = NULL, size_t argc = 0);
+
     virtual bool    isEnabled() const;
 
     // return value for all of these is the previous isEnabled()
@@ -137,6 +167,11 @@ public:
 
     sp<IMemory>     getIMemory() const  { return mIMemory; }
 
+protected:
+    // Copies a complete entry to shared memory; all logging funnels through here
+    // after any formatting, so this is the only part LockedWriter needs to serialize.
+    virtual void    logEntry(const Entry *entry);
+
 private:
     void    log(Event event, const void *data, size_t length);
     void    log(const Entry *entry, bool trusted = false);
@@ -150,21 +185,20 @@ private:
 
 // ---------------------------------------------------------------------------
 
-// Similar to Writer, but safe for multiple threads to call concurrently
+// Similar to Writer, but safe for multiple threads to call concurrently.
+// Formatting and clock_gettime() are done before taking the lock, which is only held
+// while the finished entry is copied to shared memory.
 class LockedWriter : public Writer {
 public:
     LockedWriter();
     LockedWriter(size_t size, void *shared);
 
-    virtual void    log(const char *string);
-    virtual void    logf(const char *fmt, ...) __attribute__ ((format (printf, 2, 3)));
-    virtual void    logvf(const char *fmt, va_list ap);
-    virtual void    logTimestamp();
-    virtual void    logTimestamp(const struct timespec& ts);
-
     virtual bool    isEnabled() const;
     virtual bool    setEnabled(bool enabled);
 
+protected:
+    virtual void    logEntry(const Entry *entry);
+
 private:
     mutable Mutex   mLock;
 };
@@ -194,6 +228,28 @@ private:
 
     void    dumpLine(const String8& timestamp, String8& body);
 
+    // Statistics of the binary events with one identifier, for the summary after the dump
+    struct EventStats {
+        EventStats();
+        void    add(int64_t timestampNs, const int32_t *args, size_t argc);
+        void    dump(String8& body, int id) const;
+
+        static const size_t kHistogramBuckets = 32;   // log2 buckets of microseconds
+
+        size_t  mCount;
+        int64_t mLastNs;        // timestamp of the previous event
+        int64_t mIntervalMinNs; // intervals between events
+        int64_t mIntervalMaxNs;
+        int64_t mIntervalTotalNs;
+        uint32_t mIntervalHistogram[kHistogramBuckets];
+        size_t  mArgCount;      // events with at least one argument
+        int32_t mArgMin;        // first argument, typically a duration
+        int32_t mArgMax;
+        int64_t mArgTotal;
+    };
+
+    static const char *eventIdName(int id);
+
     static const size_t kSquashTimestamp = 5; // squash this many or more adjacent timestamps
 };
 
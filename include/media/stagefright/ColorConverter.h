@@ -33,6 +33,16 @@ struct ColorConverter {
 
     bool isValid() const;
 
+    // Conversions of large frames are split into row bands that are
+    // converted on up to |numThreads| threads, including the calling thread.
+    // The default is 1, which converts on the calling thread only.
+    static const size_t kMaxThreads = 4;
+    void setNumThreads(size_t numThreads);
+
+    // Selects between the vectorized and the scalar conversion code, which
+    // produce identical results. Vectorized code is used by default.
+    void setUseSimd(bool useSimd);
+
     status_t convert(
             const void *srcBits,
             size_t srcWidth, size_t srcHeight,
@@ -61,6 +71,8 @@ private:
 
     OMX_COLOR_FORMATTYPE mSrcFormat, mDstFormat;
     uint8_t *mClip;
+    size_t mNumThreads;
+    bool mUseSimd;
 
     uint8_t *initClip();
 
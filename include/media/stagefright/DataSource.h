@@ -30,6 +30,7 @@
 
 namespace android {
 
+struct ABuffer;
 struct AMessage;
 struct AString;
 class  IDataSource;
@@ -100,6 +101,26 @@ public:
         return ERROR_UNSUPPORTED;
     }
 
+    enum AccessPattern {
+        kAccessPatternNormal,
+        kAccessPatternSequential,
+        kAccessPatternRandom,
+    };
+
+    // Hints how the source is going to be read from now on. May be ignored.
+    virtual void setAccessPattern(AccessPattern /* pattern */) {}
+
+    // Returns a read-only buffer referencing "size" bytes at "offset" without
+    // copying them: writing to it faults, callers that edit the data must copy
+    // it. The data stays valid for as long as the buffer is referenced, even
+    // after the source is gone. Returns ERROR_UNSUPPORTED if the source cannot
+    // do this, in which case readAt() should be used, and ERROR_END_OF_STREAM
+    // if the range is not entirely within the source.
+    virtual status_t getBufferAt(
+            off64_t /* offset */, size_t /* size */, sp<ABuffer> * /* buffer */) {
+        return ERROR_UNSUPPORTED;
+    }
+
     ////////////////////////////////////////////////////////////////////////////
 
     bool sniff(String8 *mimeType, float *confidence, sp<AMessage> *meta);
@@ -39,6 +39,21 @@ public:
 
     virtual status_t getSize(off64_t *size);
 
+    virtual void setAccessPattern(AccessPattern pattern);
+
+    virtual status_t getBufferAt(off64_t offset, size_t size, sp<ABuffer> *buffer);
+
+    // Maps the file into memory, after which reads are served from the
+    // mapping without system calls and getBufferAt() is supported. Returns
+    // false if the file cannot be mapped, e.g. because it is DRM protected or
+    // too large for the address space. Done automatically on construction if
+    // media.stagefright.mmap-source is set.
+    //
+    // Truncating a file while it is mapped raises SIGBUS on access, so files
+    // that another user could truncate, e.g. the app that passed the
+    // descriptor, are not mapped.
+    bool mapFile();
+
     virtual sp<DecryptHandle> DrmInitialization(const char *mime);
 
     virtual void getDrmInfo(sp<DecryptHandle> &handle, DrmManagerClient **client);
@@ -51,12 +66,18 @@ protected:
     virtual ~FileSource();
 
 private:
+    struct Mapping;
+
     int mFd;
     int64_t mOffset;
     int64_t mLength;
     Mutex mLock;
     String8 mName;
 
+    sp<Mapping> mMapping;
+    const uint8_t *mMappedData;    // mOffset within the mapping
+    AccessPattern mAccessPattern;
+
     /*for DRM*/
     sp<DecryptHandle> mDecryptHandle;
     DrmManagerClient *mDrmManagerClient;
@@ -65,6 +86,7 @@ private:
     unsigned char *mDrmBuf;
 
     ssize_t readAtDRM(off64_t offset, void *data, size_t size);
+    void adviseAccessPattern_l();
 
     FileSource(const FileSource &);
     FileSource &operator=(const FileSource &);
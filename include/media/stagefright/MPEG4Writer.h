@@ -92,6 +92,7 @@ private:
     off_t mMdatOffset;
     uint8_t *mMoovBoxBuffer;
     off64_t mMoovBoxBufferOffset;
+    off64_t mMoovBoxBufferSize;
     bool  mWriteMoovBoxToMemory;
     off64_t mFreeBoxOffset;
     bool mStreamableFile;
@@ -113,11 +114,23 @@ private:
 
     sp<AMessage> mMetaKeys;
 
+    // File data is coalesced in mWriteBuffer, which holds the bytes at
+    // [mWriteBufferOffset, mWriteBufferOffset + mWriteBufferSize) of the
+    // file, and is written out in page aligned blocks.
+    uint8_t *mWriteBuffer;
+    size_t mWriteBufferSize;
+    off64_t mWriteBufferOffset;
+    bool mPreallocate;
+    off64_t mPreallocatedEnd;
+    int64_t mNumFileWrites;
+    int64_t mFileBytesWritten;
+
     void setStartTimestampUs(int64_t timeUs);
     int64_t getStartTimestampUs();  // Not const
     status_t startTracks(MetaData *params);
     size_t numTracks();
     int64_t estimateMoovBoxSize(int32_t bitRate);
+    int64_t estimateSampleTableSizeBytes(int64_t durationUs);
 
     struct Chunk {
         Track               *mTrack;        // Owner
@@ -194,6 +207,16 @@ private:
 
     // Acquire lock before calling these methods
     off64_t addSample_l(MediaBuffer *buffer);
+
+    // Appends data at mOffset through the write buffer.
+    void writeBuffered_l(const void *data, size_t size);
+    // Overwrites data that has already been written at |offset|.
+    void writeAt_l(off64_t offset, const void *data, size_t size);
+    // Writes out the buffered data. Unless |all| is set, data after the
+    // last page boundary is kept in the buffer.
+    void flushWriteBuffer_l(bool all);
+    void writeToFile_l(off64_t offset, const void *data, size_t size);
+    void preallocate_l(off64_t end);
 protected:
     static void StripStartcode(MediaBuffer *buffer);
     virtual off64_t addLengthPrefixedSample_l(MediaBuffer *buffer);
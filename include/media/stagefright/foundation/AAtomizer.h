@@ -31,6 +31,23 @@ namespace android {
 struct AAtomizer {
     static const char *Atomize(const char *name);
 
+    // Returns the hash of the NUL-terminated string |s|. If |len| is not NULL,
+    // it receives the length of |s|, so that callers need not call strlen().
+    // The hash relies on unsigned wraparound.
+    __attribute__((no_sanitize("integer")))
+    static inline uint32_t Hash(const char *s, size_t *len = NULL) {
+        const char *p = s;
+        uint32_t sum = 0;
+        while (*p != '\0') {
+            sum = (sum * 31) + *p;
+            ++p;
+        }
+        if (len != NULL) {
+            *len = p - s;
+        }
+        return sum;
+    }
+
 private:
     static AAtomizer gAtomizer;
 
@@ -41,8 +58,6 @@ private:
 
     const char *atomize(const char *name);
 
-    static uint32_t Hash(const char *s);
-
     DISALLOW_EVIL_CONSTRUCTORS(AAtomizer);
 };
 
@@ -22,6 +22,7 @@
 #include <stdint.h>
 
 #include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/foundation/AObjectPool.h>
 #include <utils/RefBase.h>
 
 namespace android {
@@ -33,6 +34,8 @@ struct ABuffer : public RefBase {
     ABuffer(size_t capacity);
     ABuffer(void *data, size_t capacity);
 
+    A_OBJECT_POOL_DECLARE();
+
     uint8_t *base() { return (uint8_t *)mData; }
     uint8_t *data() { return (uint8_t *)mData + mRangeOffset; }
     size_t capacity() const { return mCapacity; }
@@ -24,8 +24,11 @@
 #include <utils/KeyedVector.h>
 #include <utils/List.h>
 #include <utils/RefBase.h>
+#include <utils/Vector.h>
 #include <utils/threads.h>
 
+#include <atomic>
+
 namespace android {
 
 struct AHandler;
@@ -66,15 +69,29 @@ private:
 
     struct Event {
         int64_t mWhenUs;
+        uint32_t mSeq;  // post order, breaks ties between events with the same mWhenUs
         sp<AMessage> mMessage;
     };
 
+    // events posted without delay, pushed without taking mLock
+    struct PendingEvent {
+        Event mEvent;
+        PendingEvent *mNext;
+    };
+
     Mutex mLock;
     Condition mQueueChangedCondition;
 
     AString mName;
 
-    List<Event> mEventQueue;
+    // binary min-heap ordered by (mWhenUs, mSeq), so events with the same
+    // delivery time are delivered in the order they were posted.
+    Vector<Event> mEventQueue;
+
+    // lock-free stack of events posted with no delay, most recent first;
+    // moved into mEventQueue by the looper thread.
+    std::atomic<PendingEvent *> mPendingEvents;
+    std::atomic<uint32_t> mNextEventSeq;
 
     struct LooperThread;
     sp<LooperThread> mThread;
@@ -103,6 +120,11 @@ private:
 
     bool loop();
 
+    static bool EventLater(const Event &a, const Event &b);
+    void pushEvent_l(const Event &event);
+    void popEvent_l(Event *event);
+    void drainPendingEvents_l();
+
     DISALLOW_EVIL_CONSTRUCTORS(ALooper);
 };
 
@@ -20,6 +20,7 @@
 
 #include <media/stagefright/foundation/ABase.h>
 #include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AObjectPool.h>
 #include <utils/KeyedVector.h>
 #include <utils/RefBase.h>
 
@@ -36,6 +37,8 @@ struct AReplyToken : public RefBase {
           mReplied(false) {
     }
 
+    A_OBJECT_POOL_DECLARE();
+
 private:
     friend struct AMessage;
     friend struct ALooper;
@@ -62,6 +65,8 @@ struct AMessage : public RefBase {
     AMessage();
     AMessage(uint32_t what, const sp<const AHandler> &handler);
 
+    A_OBJECT_POOL_DECLARE();
+
     // Construct an AMessage from a parcel.
     // nestingAllowed determines how many levels AMessage can be nested inside
     // AMessage. The default value here is arbitrarily set to 255.
@@ -212,8 +217,9 @@ private:
         } u;
         const char *mName;
         size_t      mNameLength;
+        uint32_t    mNameHash;  // AAtomizer::Hash() of mName
         Type mType;
-        void setName(const char *name, size_t len);
+        void setName(const char *name, size_t len, uint32_t hash);
     };
 
     enum {
@@ -229,7 +235,10 @@ private:
     void setObjectInternal(
             const char *name, const sp<RefBase> &obj, Type type);
 
-    size_t findItemIndex(const char *name, size_t len) const;
+    // returns the index of the item named |name|, or mNumItems if not found.
+    // |len| and |hash| are the length and AAtomizer::Hash() of |name|.
+    size_t findItemIndex(const char *name, size_t len, uint32_t hash) const;
+    size_t findItemIndex(const char *name) const;
 
     void deliver();
 
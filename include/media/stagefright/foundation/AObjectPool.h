@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef A_OBJECT_POOL_H_
+
+#define A_OBJECT_POOL_H_
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/foundation/AString.h>
+#include <utils/threads.h>
+
+namespace android {
+
+// Pooling recycles blocks that AddressSanitizer would otherwise keep in
+// quarantine, hiding use-after-free bugs; ASan builds use the heap directly.
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define A_OBJECT_POOL_BYPASS 1
+#endif
+#elif defined(__SANITIZE_ADDRESS__)
+#define A_OBJECT_POOL_BYPASS 1
+#endif
+#ifndef A_OBJECT_POOL_BYPASS
+#define A_OBJECT_POOL_BYPASS 0
+#endif
+
+// A process-wide free list of fixed size memory blocks, used as the class
+// specific allocator of objects that are created and destroyed for every
+// buffer exchanged by MediaCodec and ACodec (AMessage, AReplyToken, ABuffer).
+// Freed blocks are kept for reuse, up to |maxFreeBlocks|; requests larger than
+// the block size (e.g. from a derived class) fall through to the heap.
+//
+// Each thread keeps a small cache of free blocks in front of the shared list,
+// so that loopers do not serialize on one lock per message. Blocks move
+// between a cache and the shared list in batches, and a cache is returned to
+// the shared list when its thread exits.
+struct AObjectPool {
+    AObjectPool(const char *name, size_t blockSize, size_t maxFreeBlocks);
+
+    void *allocate(size_t size);
+    void release(void *ptr, size_t size);
+
+    // Appends the allocation counters of all pools in the process to |s|.
+    // Counters kept by a thread are added when it next exchanges blocks with
+    // the shared list, so they may lag behind by a few blocks per thread.
+    static void DumpAll(AString *s);
+
+private:
+    enum {
+        kThreadCacheBlocks = 32,  // blocks a thread keeps before giving back
+        kBatchBlocks = 16,        // blocks moved to or from the shared list
+    };
+
+    struct FreeBlock {
+        FreeBlock *mNext;
+    };
+
+    struct ThreadCache {
+        AObjectPool *mPool;
+        FreeBlock *mFreeBlocks;
+        size_t mNumFreeBlocks;
+
+        // counters not yet added to the pool
+        uint64_t mNumAllocations;
+        uint64_t mNumReused;
+        uint64_t mNumReleases;
+        uint64_t mNumOversized;
+    };
+
+    const char *mName;
+    const size_t mBlockSize;
+    const size_t mMaxFreeBlocks;
+    pthread_key_t mThreadCacheKey;
+
+    Mutex mLock;
+    FreeBlock *mFreeBlocks;
+    size_t mNumFreeBlocks;
+
+    // counters, protected by mLock
+    uint64_t mNumAllocations;   // blocks handed out
+    uint64_t mNumReused;        // ... of which came from a free list
+    uint64_t mNumReleases;      // blocks given back
+    uint64_t mNumOversized;     // requests larger than the block size
+
+    AObjectPool *mNextPool;     // in the list of all pools, see DumpAll()
+
+    ThreadCache *getThreadCache();
+    void refill_l(ThreadCache *cache);
+    void flush(ThreadCache *cache, size_t count);
+    void addCounters_l(ThreadCache *cache);
+    void dump(AString *s);
+
+    static void OnThreadExit(void *cache);
+
+    DISALLOW_EVIL_CONSTRUCTORS(AObjectPool);
+};
+
+// Declares the class specific operator new and delete that allocate instances
+// of a class from an AObjectPool. Use in the class declaration, and use
+// A_OBJECT_POOL_IMPLEMENT in the class implementation.
+#define A_OBJECT_POOL_DECLARE()                                               \
+    static void *operator new(size_t size);                                   \
+    static void operator delete(void *ptr, size_t size);                      \
+    static AObjectPool &Pool()
+
+// The pool is never destroyed: objects may still be released by other threads
+// while static destructors run at exit.
+#define A_OBJECT_POOL_IMPLEMENT(CLASS, MAX_FREE_BLOCKS)                       \
+AObjectPool &CLASS::Pool() {                                                  \
+    static AObjectPool *sPool =                                               \
+            new AObjectPool(#CLASS, sizeof(CLASS), MAX_FREE_BLOCKS);          \
+    return *sPool;                                                            \
+}                                                                             \
+                                                                              \
+void *CLASS::operator new(size_t size) {                                      \
+    return Pool().allocate(size);                                             \
+}                                                                             \
+                                                                              \
+void CLASS::operator delete(void *ptr, size_t size) {                         \
+    Pool().release(ptr, size);                                                \
+}
+
+}  // namespace android
+
+#endif  // A_OBJECT_POOL_H_
@@ -23,7 +23,7 @@
 #include <new>
 #include <time.h>
 #include <math.h>
-#include <audio_effects/effect_loudnessenhancer.h>
+#include <media/EffectLoudnessEnhancerApi.h>
 #include "dsp/core/dynamic_range_compression.h"
 
 extern "C" {
@@ -43,6 +43,9 @@ const effect_descriptor_t gLEDescriptor = {
         "The Android Open Source Project",
 };
 
+// frames converted to float at a time by the block processing
+#define LE_WORK_BUFFER_FRAMES 256
+
 enum le_state_e {
     LOUDNESS_ENHANCER_STATE_UNINITIALIZED,
     LOUDNESS_ENHANCER_STATE_INITIALIZED,
@@ -54,9 +57,12 @@ struct LoudnessEnhancerContext {
     effect_config_t mConfig;
     uint8_t mState;
     int32_t mTargetGainmB;// target gain in mB
+    bool mBlockProcessing;// compressor gain updated per block instead of per frame
+    int32_t mLookaheadMs;// look-ahead of the block processing in ms
     // in this implementation, there is no coupling between the compression on the left and right
     // channels
     le_fx::AdaptiveDynamicRangeCompression* mCompressor;
+    float mWorkBuffer[LE_WORK_BUFFER_FRAMES * 2];
 };
 
 //
@@ -70,6 +76,7 @@ void LE_reset(LoudnessEnhancerContext *pContext)
     if (pContext->mCompressor != NULL) {
         float targetAmp = pow(10, pContext->mTargetGainmB/2000.0f); // mB to linear amplification
         ALOGV("LE_reset(): Target gain=%dmB <=> factor=%.2fX", pContext->mTargetGainmB, targetAmp);
+        pContext->mCompressor->set_lookahead_in_ms(pContext->mLookaheadMs);
         pContext->mCompressor->Initialize(targetAmp, pContext->mConfig.inputCfg.samplingRate);
     } else {
         ALOGE("LE_reset(%p): null compressors, can't apply target gain", pContext);
@@ -171,6 +178,8 @@ int LE_init(LoudnessEnhancerContext *pContext)
     pContext->mConfig.outputCfg.mask = EFFECT_CONFIG_ALL;
 
     pContext->mTargetGainmB = LOUDNESS_ENHANCER_DEFAULT_TARGET_GAIN_MB;
+    pContext->mBlockProcessing = true;
+    pContext->mLookaheadMs = 0;
     float targetAmp = pow(10, pContext->mTargetGainmB/2000.0f); // mB to linear amplification
     ALOGV("LE_init(): Target gain=%dmB <=> factor=%.2fX", pContext->mTargetGainmB, targetAmp);
 
@@ -280,16 +289,36 @@ int LE_process(
     }
 
     //ALOGV("LE about to process %d samples", inBuffer->frameCount);
-    uint16_t inIdx;
     float inputAmp = pow(10, pContext->mTargetGainmB/2000.0f);
-    float leftSample, rightSample;
-    for (inIdx = 0 ; inIdx < inBuffer->frameCount ; inIdx++) {
-        // makeup gain is applied on the input of the compressor
-        leftSample  = inputAmp * (float)inBuffer->s16[2*inIdx];
-        rightSample = inputAmp * (float)inBuffer->s16[2*inIdx +1];
-        pContext->mCompressor->Compress(&leftSample, &rightSample);
-        inBuffer->s16[2*inIdx]    = (int16_t) leftSample;
-        inBuffer->s16[2*inIdx +1] = (int16_t) rightSample;
+    if (pContext->mBlockProcessing) {
+        float *work = pContext->mWorkBuffer;
+        for (size_t frame = 0; frame < inBuffer->frameCount; ) {
+            size_t frames = inBuffer->frameCount - frame;
+            if (frames > LE_WORK_BUFFER_FRAMES) {
+                frames = LE_WORK_BUFFER_FRAMES;
+            }
+            int16_t *samples = inBuffer->s16 + 2 * frame;
+            // makeup gain is applied on the input of the compressor
+            for (size_t i = 0; i < frames * 2; i++) {
+                work[i] = inputAmp * (float)samples[i];
+            }
+            pContext->mCompressor->CompressBlock(work, frames);
+            for (size_t i = 0; i < frames * 2; i++) {
+                samples[i] = (int16_t) work[i];
+            }
+            frame += frames;
+        }
+    } else {
+        uint16_t inIdx;
+        float leftSample, rightSample;
+        for (inIdx = 0 ; inIdx < inBuffer->frameCount ; inIdx++) {
+            // makeup gain is applied on the input of the compressor
+            leftSample  = inputAmp * (float)inBuffer->s16[2*inIdx];
+            rightSample = inputAmp * (float)inBuffer->s16[2*inIdx +1];
+            pContext->mCompressor->Compress(&leftSample, &rightSample);
+            inBuffer->s16[2*inIdx]    = (int16_t) leftSample;
+            inBuffer->s16[2*inIdx +1] = (int16_t) rightSample;
+        }
     }
 
     if (inBuffer->raw != outBuffer->raw) {
@@ -387,6 +416,16 @@ int LE_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
             p->vsize = sizeof(int32_t);
             *replySize += sizeof(int32_t);
             break;
+        case LOUDNESS_ENHANCER_PARAM_BLOCK_PROCESSING:
+            *((int32_t *)p->data + 1) = pContext->mBlockProcessing ? 1 : 0;
+            p->vsize = sizeof(int32_t);
+            *replySize += sizeof(int32_t);
+            break;
+        case LOUDNESS_ENHANCER_PARAM_LOOKAHEAD_MS:
+            *((int32_t *)p->data + 1) = pContext->mLookaheadMs;
+            p->vsize = sizeof(int32_t);
+            *replySize += sizeof(int32_t);
+            break;
         default:
             p->status = -EINVAL;
         }
@@ -409,6 +448,21 @@ int LE_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
             ALOGV("set target gain(mB) = %d", pContext->mTargetGainmB);
             LE_reset(pContext); // apply parameter update
             break;
+        case LOUDNESS_ENHANCER_PARAM_BLOCK_PROCESSING:
+            pContext->mBlockProcessing = *((int32_t *)p->data + 1) != 0;
+            ALOGV("set block processing = %d", pContext->mBlockProcessing);
+            LE_reset(pContext); // flush the look-ahead delay line
+            break;
+        case LOUDNESS_ENHANCER_PARAM_LOOKAHEAD_MS: {
+            int32_t lookaheadMs = *((int32_t *)p->data + 1);
+            if (lookaheadMs < 0 || lookaheadMs > LOUDNESS_ENHANCER_MAX_LOOKAHEAD_MS) {
+                *(int32_t *)pReplyData = -EINVAL;
+                break;
+            }
+            pContext->mLookaheadMs = lookaheadMs;
+            ALOGV("set look-ahead(ms) = %d", pContext->mLookaheadMs);
+            LE_reset(pContext); // apply parameter update
+            } break;
         default:
             *(int32_t *)pReplyData = -EINVAL;
         }
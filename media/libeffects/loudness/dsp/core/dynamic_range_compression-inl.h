@@ -39,6 +39,11 @@ inline void AdaptiveDynamicRangeCompression::set_knee_threshold_via_target_gain(
   set_knee_threshold(decibel);
 }
 
+
+inline int AdaptiveDynamicRangeCompression::lookahead_frames() const {
+  return lookahead_frames_;
+}
+
 }  // namespace le_fx
 
 
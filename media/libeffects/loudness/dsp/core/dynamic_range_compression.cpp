@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <cmath>
 
 #include "common/core/math.h"
@@ -25,9 +26,88 @@
 //#define LOG_NDEBUG 0
 #include <cutils/log.h>
 
+#if defined(__aarch64__) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define LE_FX_NEON
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define LE_FX_SSE
+#endif
+
 
 namespace le_fx {
 
+namespace {
+
+// Returns the largest absolute value of x[0..count-1], and at least <floor>.
+float PeakAbs(const float *x, int count, float floor) {
+  int i = 0;
+  float peak = floor;
+#if defined(LE_FX_NEON)
+  float32x4_t peak4 = vdupq_n_f32(floor);
+  for (; i + 4 <= count; i += 4) {
+    peak4 = vmaxq_f32(peak4, vabsq_f32(vld1q_f32(x + i)));
+  }
+  float32x2_t peak2 = vpmax_f32(vget_low_f32(peak4), vget_high_f32(peak4));
+  peak2 = vpmax_f32(peak2, peak2);
+  peak = vget_lane_f32(peak2, 0);
+#elif defined(LE_FX_SSE)
+  const __m128 sign_mask = _mm_set1_ps(-0.0f);
+  __m128 peak4 = _mm_set1_ps(floor);
+  for (; i + 4 <= count; i += 4) {
+    peak4 = _mm_max_ps(peak4, _mm_andnot_ps(sign_mask, _mm_loadu_ps(x + i)));
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, peak4);
+  peak = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#endif
+  for (; i < count; ++i) {
+    peak = std::max(peak, std::fabs(x[i]));
+  }
+  return peak;
+}
+
+// Multiplies <frame_count> interleaved stereo frames by a gain that starts at
+// gain + gain_step and grows by gain_step every frame, and clamps the result
+// to +/-limit.
+void ApplyGainRamp(float *x, int frame_count, float gain, float gain_step,
+                   float limit) {
+  int i = 0;
+#if defined(LE_FX_NEON)
+  const float start[4] = { gain + gain_step, gain + gain_step,
+                           gain + 2.0f * gain_step, gain + 2.0f * gain_step };
+  float32x4_t gain4 = vld1q_f32(start);
+  const float32x4_t step4 = vdupq_n_f32(2.0f * gain_step);
+  const float32x4_t high = vdupq_n_f32(limit);
+  const float32x4_t low = vdupq_n_f32(-limit);
+  for (; i + 2 <= frame_count; i += 2) {
+    float32x4_t y = vmulq_f32(vld1q_f32(x + 2 * i), gain4);
+    y = vmaxq_f32(vminq_f32(y, high), low);
+    vst1q_f32(x + 2 * i, y);
+    gain4 = vaddq_f32(gain4, step4);
+  }
+#elif defined(LE_FX_SSE)
+  __m128 gain4 = _mm_setr_ps(gain + gain_step, gain + gain_step,
+                             gain + 2.0f * gain_step, gain + 2.0f * gain_step);
+  const __m128 step4 = _mm_set1_ps(2.0f * gain_step);
+  const __m128 high = _mm_set1_ps(limit);
+  const __m128 low = _mm_set1_ps(-limit);
+  for (; i + 2 <= frame_count; i += 2) {
+    __m128 y = _mm_mul_ps(_mm_loadu_ps(x + 2 * i), gain4);
+    y = _mm_max_ps(_mm_min_ps(y, high), low);
+    _mm_storeu_ps(x + 2 * i, y);
+    gain4 = _mm_add_ps(gain4, step4);
+  }
+#endif
+  for (; i < frame_count; ++i) {
+    const float g = gain + (i + 1) * gain_step;
+    x[2 * i] = std::max(std::min(x[2 * i] * g, limit), -limit);
+    x[2 * i + 1] = std::max(std::min(x[2 * i + 1] * g, limit), -limit);
+  }
+}
+
+}  // namespace
+
 // Definitions for static const class members declared in
 // dynamic_range_compression.h.
 const float AdaptiveDynamicRangeCompression::kMinAbsValue = 0.000001f;
@@ -41,8 +121,14 @@ const float AdaptiveDynamicRangeCompression::kDefaultKneeThresholdInDecibel =
 const float AdaptiveDynamicRangeCompression::kCompressionRatio = 7.0f;
 const float AdaptiveDynamicRangeCompression::kTauAttack = 0.001f;
 const float AdaptiveDynamicRangeCompression::kTauRelease = 0.015f;
+const float AdaptiveDynamicRangeCompression::kMaxLookaheadInMs = 10.0f;
 
-AdaptiveDynamicRangeCompression::AdaptiveDynamicRangeCompression() {
+AdaptiveDynamicRangeCompression::AdaptiveDynamicRangeCompression()
+    : lookahead_in_ms_(0.0f),
+      lookahead_frames_(0),
+      lookahead_blocks_(0),
+      delay_line_position_(0),
+      block_peak_position_(0) {
   static const float kTargetGain[] = {
       1.0f, 2.0f, 3.0f, 4.0f, 5.0f };
   static const float kKneeThreshold[] = {
@@ -70,11 +156,27 @@ bool AdaptiveDynamicRangeCompression::Initialize(
   } else {
     alpha_release_ = 0.0f;
   }
+  alpha_attack_block_ = std::pow(alpha_attack_, kControlBlockSize);
+  alpha_release_block_ = std::pow(alpha_release_, kControlBlockSize);
   // Feed-forward topology
   slope_ = 1.0f / kCompressionRatio - 1.0f;
+  // The peaks are held for enough control blocks to cover the look-ahead and
+  // the block being processed.
+  lookahead_frames_ =
+      static_cast<int>(lookahead_in_ms_ * 0.001f * sampling_rate_ + 0.5f);
+  lookahead_blocks_ =
+      (lookahead_frames_ + kControlBlockSize - 1) / kControlBlockSize;
+  delay_line_.assign(2 * lookahead_frames_, 0.0f);
+  delay_line_position_ = 0;
+  block_peaks_.assign(lookahead_blocks_ + 1, 0.0f);
+  block_peak_position_ = 0;
   return true;
 }
 
+void AdaptiveDynamicRangeCompression::set_lookahead_in_ms(float ms) {
+  lookahead_in_ms_ = std::max(0.0f, std::min(ms, kMaxLookaheadInMs));
+}
+
 float AdaptiveDynamicRangeCompression::Compress(float x) {
   const float max_abs_x = std::max(std::fabs(x), kMinLogAbsValue);
   const float max_abs_x_dB = math::fast_log(max_abs_x);
@@ -137,5 +239,64 @@ void AdaptiveDynamicRangeCompression::Compress(float *x1, float *x2) {
   }
 }
 
-}  // namespace le_fx
+float AdaptiveDynamicRangeCompression::UpdateBlockGain(float max_abs_x,
+                                                      int frame_count) {
+  const float max_abs_x_dB = math::fast_log(max_abs_x);
+  const float overshoot = max_abs_x_dB - knee_threshold_;
+  const float rect = std::max(overshoot, 0.0f);
+  const float cv = rect * slope_;
+  // One step of the detector for the whole block, as if every frame of the
+  // block had its peak value.
+  float alpha;
+  if (cv <= state_) {
+    alpha = frame_count == kControlBlockSize ?
+        alpha_attack_block_ : std::pow(alpha_attack_, frame_count);
+  } else {
+    alpha = frame_count == kControlBlockSize ?
+        alpha_release_block_ : std::pow(alpha_release_, frame_count);
+  }
+  state_ = alpha * state_ + (1.0f - alpha) * cv;
+  // A single exp(.) per block, so the gain does not drift from the state.
+  return std::exp(state_);
+}
 
+void AdaptiveDynamicRangeCompression::CompressBlock(float *x,
+                                                    int frame_count) {
+  while (frame_count > 0) {
+    const int n = std::min(frame_count, kControlBlockSize);
+    float max_abs_x = PeakAbs(x, 2 * n, kMinLogAbsValue);
+    if (lookahead_frames_ > 0) {
+      // The window is counted in control blocks, so it is exact as long as
+      // the frame counts passed in are multiples of kControlBlockSize.
+      block_peaks_[block_peak_position_] = max_abs_x;
+      if (++block_peak_position_ == static_cast<int>(block_peaks_.size())) {
+        block_peak_position_ = 0;
+      }
+      max_abs_x = *std::max_element(block_peaks_.begin(), block_peaks_.end());
+      // Swaps the block with the oldest frames of the delay line.
+      float *samples = x;
+      int remaining = 2 * n;
+      while (remaining > 0) {
+        const int count = std::min(
+            remaining,
+            static_cast<int>(delay_line_.size()) - delay_line_position_);
+        std::swap_ranges(samples, samples + count,
+                         &delay_line_[delay_line_position_]);
+        samples += count;
+        remaining -= count;
+        delay_line_position_ += count;
+        if (delay_line_position_ == static_cast<int>(delay_line_.size())) {
+          delay_line_position_ = 0;
+        }
+      }
+    }
+    const float gain = UpdateBlockGain(max_abs_x, n);
+    ApplyGainRamp(x, n, compressor_gain_, (gain - compressor_gain_) / n,
+                  kFixedPointLimit);
+    compressor_gain_ = gain;
+    x += 2 * n;
+    frame_count -= n;
+  }
+}
+
+}  // namespace le_fx
@@ -21,6 +21,8 @@
 #include "dsp/core/basic.h"
 #include "dsp/core/interpolation.h"
 
+#include <vector>
+
 //#define LOG_NDEBUG 0
 #include <cutils/log.h>
 
@@ -58,6 +60,21 @@ class AdaptiveDynamicRangeCompression {
   // Stereo channel version of the compressor
   void Compress(float *x1, float *x2);
 
+  // Block version of the stereo compressor, in place on <frame_count>
+  // interleaved frames. The envelope is updated once per control block of
+  // kControlBlockSize frames from the peak of the block, and the gain is ramped
+  // linearly across the block. With a look-ahead, the output is delayed by
+  // lookahead_frames() and the gain follows the peak of the frames to come, so
+  // that it is already reduced when a transient reaches the output.
+  void CompressBlock(float *x, int frame_count);
+
+  // Sets the look-ahead of CompressBlock(), clamped to kMaxLookaheadInMs.
+  // Takes effect on the next call to Initialize().
+  void set_lookahead_in_ms(float ms);
+
+  // The delay added by CompressBlock(), in frames
+  int lookahead_frames() const;
+
   // This version is slower than Compress(.) but faster than CompressSlow(.)
   float CompressNormalSpeed(float x);
 
@@ -65,6 +82,11 @@ class AdaptiveDynamicRangeCompression {
   // tuning and debugging
   float CompressSlow(float x);
 
+  // Number of frames between two updates of the envelope in CompressBlock()
+  static const int kControlBlockSize = 16;
+  // The longest accepted look-ahead
+  static const float kMaxLookaheadInMs;
+
   // Sets knee threshold (in decibel).
   void set_knee_threshold(float decibel);
 
@@ -92,6 +114,10 @@ class AdaptiveDynamicRangeCompression {
   // The release time of the envelope detector
   static const float kTauRelease;
 
+  // Updates the envelope detector with the peak absolute value of a control
+  // block of <frame_count> frames and returns the new gain.
+  float UpdateBlockGain(float max_abs_x, int frame_count);
+
   float sampling_rate_;
   // the internal state of the envelope detector
   float state_;
@@ -102,6 +128,19 @@ class AdaptiveDynamicRangeCompression {
   // release constant for exponential dumping
   float alpha_release_;
   float slope_;
+  // attack and release constants of a whole control block
+  float alpha_attack_block_;
+  float alpha_release_block_;
+  // the requested look-ahead and its length in frames and in control blocks
+  float lookahead_in_ms_;
+  int lookahead_frames_;
+  int lookahead_blocks_;
+  // delay line of lookahead_frames_ interleaved frames
+  std::vector<float> delay_line_;
+  int delay_line_position_;
+  // peaks of the control blocks in the look-ahead window
+  std::vector<float> block_peaks_;
+  int block_peak_position_;
   // The knee threshold
   float knee_threshold_;
   float knee_threshold_in_decibel_;
@@ -0,0 +1,24 @@
+# Build the unit tests for the loudness enhancer
+LOCAL_PATH:= $(call my-dir)
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+	loudness_enhancer_tests.cpp \
+	../EffectLoudnessEnhancer.cpp \
+	../dsp/core/dynamic_range_compression.cpp
+
+LOCAL_SHARED_LIBRARIES := \
+	liblog \
+	libcutils
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/.. \
+	$(call include-path-for, audio-effects) \
+	frameworks/av/include
+
+LOCAL_MODULE := loudness_enhancer_tests
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_CFLAGS := -O2 -Werror -Wall
+
+include $(BUILD_NATIVE_TEST)
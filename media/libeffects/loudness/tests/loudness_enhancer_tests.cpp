@@ -0,0 +1,315 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "loudness_enhancer_tests"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <hardware/audio_effect.h>
+#include <media/EffectLoudnessEnhancerApi.h>
+
+#include "dsp/core/dynamic_range_compression.h"
+
+using le_fx::AdaptiveDynamicRangeCompression;
+
+// The loudness enhancer effect is compiled into this test.
+extern "C" audio_effect_library_t AUDIO_EFFECT_LIBRARY_INFO_SYM;
+
+static const int kSampleRate = 48000;
+static const float kLimit = 32767.0f;
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Interleaved stereo test signal going over the knee of the compressor: two sines whose level
+// steps between quiet, loud and very loud every 100 ms.
+static std::vector<float> makeSignal(int frameCount) {
+    static const float kLevels[] = { 2000.0f, 30000.0f, 8000.0f, 120000.0f };
+    std::vector<float> signal(2 * frameCount);
+    for (int i = 0; i < frameCount; i++) {
+        const float level = kLevels[(i / (kSampleRate / 10)) % 4];
+        signal[2 * i] = level * sin(2 * M_PI * 440 * i / kSampleRate);
+        signal[2 * i + 1] = level * sin(2 * M_PI * 1250 * i / kSampleRate);
+    }
+    return signal;
+}
+
+// Largest level difference between two interleaved stereo signals over segments of 50 ms, in dB.
+template <typename T>
+static double maxLevelDifferenceDb(const T *expected, const T *actual, size_t frameCount) {
+    static const size_t kSegmentFrames = kSampleRate / 20;
+    double maxDifference = 0;
+    for (size_t frame = 0; frame + kSegmentFrames <= frameCount; frame += kSegmentFrames) {
+        double expectedEnergy = 0;
+        double actualEnergy = 0;
+        for (size_t i = 2 * frame; i < 2 * (frame + kSegmentFrames); i++) {
+            expectedEnergy += (double)expected[i] * expected[i];
+            actualEnergy += (double)actual[i] * actual[i];
+        }
+        maxDifference = fmax(maxDifference, fabs(10 * log10(actualEnergy / expectedEnergy)));
+    }
+    return maxDifference;
+}
+
+static void compressPerFrame(AdaptiveDynamicRangeCompression *compressor, float *x,
+        int frameCount) {
+    for (int i = 0; i < frameCount; i++) {
+        compressor->Compress(&x[2 * i], &x[2 * i + 1]);
+    }
+}
+
+// The block gain follows the per frame gain closely. Taking the peak of a control block makes
+// it slightly lower on loud passages.
+TEST(compressor, block_matches_per_frame) {
+    const int frameCount = kSampleRate;
+    const std::vector<float> signal = makeSignal(frameCount);
+
+    AdaptiveDynamicRangeCompression perFrame;
+    perFrame.Initialize(2.0f, kSampleRate);
+    std::vector<float> expected = signal;
+    compressPerFrame(&perFrame, &expected[0], frameCount);
+
+    AdaptiveDynamicRangeCompression block;
+    block.Initialize(2.0f, kSampleRate);
+    ASSERT_EQ(0, block.lookahead_frames());
+    std::vector<float> actual = signal;
+    // an odd call size, to have partial control blocks
+    static const int kCallFrames = 250;
+    for (int i = 0; i < frameCount; i += kCallFrames) {
+        block.CompressBlock(&actual[2 * i], kCallFrames);
+    }
+
+    for (size_t i = 0; i < actual.size(); i++) {
+        ASSERT_LE(fabs(actual[i]), kLimit);
+    }
+    const double difference = maxLevelDifferenceDb(&expected[0], &actual[0], frameCount);
+    printf("block vs per frame: %.2f dB\n", difference);
+    EXPECT_LT(difference, 1.);
+}
+
+// The look-ahead delays the signal by a whole number of frames.
+TEST(compressor, lookahead_delay) {
+    AdaptiveDynamicRangeCompression compressor;
+    compressor.set_lookahead_in_ms(5.0f);
+    compressor.Initialize(1.0f, kSampleRate);
+    const int delay = compressor.lookahead_frames();
+    ASSERT_EQ(kSampleRate * 5 / 1000, delay);
+
+    // below the knee, the compressor is transparent
+    std::vector<float> x(2 * 1024, 0.0f);
+    x[2 * 10] = 1000.0f;
+    x[2 * 10 + 1] = -1000.0f;
+    compressor.CompressBlock(&x[0], 1024);
+    for (int i = 0; i < 1024; i++) {
+        const float left = i == 10 + delay ? 1000.0f : 0.0f;
+        ASSERT_NEAR(left, x[2 * i], 0.5f) << "frame " << i;
+        ASSERT_NEAR(-left, x[2 * i + 1], 0.5f) << "frame " << i;
+    }
+
+    // the look-ahead is limited
+    compressor.set_lookahead_in_ms(1000.0f);
+    compressor.Initialize(1.0f, kSampleRate);
+    EXPECT_EQ(kSampleRate * (int)AdaptiveDynamicRangeCompression::kMaxLookaheadInMs / 1000,
+            compressor.lookahead_frames());
+}
+
+// A loud onset after silence is clipped without look-ahead, and not with it.
+TEST(compressor, lookahead_limits) {
+    static const int kFrames = kSampleRate / 10;
+    std::vector<float> burst(2 * kFrames, 0.0f);
+    for (int i = kFrames / 2; i < kFrames; i++) {
+        burst[2 * i] = burst[2 * i + 1] = 4 * kLimit * sin(2 * M_PI * 1000 * i / kSampleRate);
+    }
+    for (int lookaheadMs = 0; lookaheadMs <= 5; lookaheadMs += 5) {
+        AdaptiveDynamicRangeCompression compressor;
+        compressor.set_lookahead_in_ms(lookaheadMs);
+        compressor.Initialize(1.0f, kSampleRate);
+        std::vector<float> x = burst;
+        compressor.CompressBlock(&x[0], kFrames);
+        int clipped = 0;
+        for (size_t i = 0; i < x.size(); i++) {
+            if (fabs(x[i]) >= kLimit) {
+                clipped++;
+            }
+        }
+        printf("look-ahead %d ms: %d clipped samples\n", lookaheadMs, clipped);
+        if (lookaheadMs == 0) {
+            EXPECT_GT(clipped, 0);
+        } else {
+            EXPECT_EQ(0, clipped);
+        }
+    }
+}
+
+static int command(effect_handle_t handle, uint32_t cmdCode, uint32_t cmdSize, void *cmdData,
+        uint32_t replySize, void *replyData) {
+    return (*handle)->command(handle, cmdCode, cmdSize, cmdData, &replySize, replyData);
+}
+
+static int setParam(effect_handle_t handle, uint32_t param, int32_t value) {
+    uint32_t buf32[sizeof(effect_param_t) / sizeof(uint32_t) + 2];
+    effect_param_t *p = (effect_param_t *)buf32;
+    p->psize = sizeof(uint32_t);
+    p->vsize = sizeof(int32_t);
+    *(uint32_t *)p->data = param;
+    *((int32_t *)p->data + 1) = value;
+    int reply = 0;
+    int status = command(handle, EFFECT_CMD_SET_PARAM, sizeof(buf32), p, sizeof(reply), &reply);
+    return status != 0 ? status : reply;
+}
+
+static int getParam(effect_handle_t handle, uint32_t param, int32_t *value) {
+    uint32_t buf32[sizeof(effect_param_t) / sizeof(uint32_t) + 2];
+    effect_param_t *p = (effect_param_t *)buf32;
+    p->psize = sizeof(uint32_t);
+    p->vsize = sizeof(int32_t);
+    *(uint32_t *)p->data = param;
+    int status = command(handle, EFFECT_CMD_GET_PARAM, sizeof(effect_param_t) + sizeof(uint32_t),
+            p, sizeof(buf32), p);
+    if (status != 0) {
+        return status;
+    }
+    *value = *((int32_t *)p->data + 1);
+    return p->status;
+}
+
+class LoudnessEnhancerTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        static const effect_uuid_t kLoudnessEnhancerUuid =
+            { 0xfa415329, 0x2034, 0x4bea, 0xb5dc, { 0x5b, 0x38, 0x1c, 0x8d, 0x1e, 0x2c } };
+        ASSERT_EQ(0, AUDIO_EFFECT_LIBRARY_INFO_SYM.create_effect(&kLoudnessEnhancerUuid, 0, 0,
+                &mHandle));
+
+        effect_config_t config;
+        memset(&config, 0, sizeof(config));
+        config.inputCfg.samplingRate = config.outputCfg.samplingRate = kSampleRate;
+        config.inputCfg.channels = config.outputCfg.channels = AUDIO_CHANNEL_OUT_STEREO;
+        config.inputCfg.format = config.outputCfg.format = AUDIO_FORMAT_PCM_16_BIT;
+        config.inputCfg.accessMode = EFFECT_BUFFER_ACCESS_READ;
+        config.outputCfg.accessMode = EFFECT_BUFFER_ACCESS_WRITE;
+        int reply = -1;
+        ASSERT_EQ(0, command(mHandle, EFFECT_CMD_SET_CONFIG, sizeof(config), &config,
+                sizeof(reply), &reply));
+        ASSERT_EQ(0, reply);
+        ASSERT_EQ(0, command(mHandle, EFFECT_CMD_ENABLE, 0, NULL, sizeof(reply), &reply));
+        ASSERT_EQ(0, reply);
+    }
+
+    virtual void TearDown() {
+        EXPECT_EQ(0, AUDIO_EFFECT_LIBRARY_INFO_SYM.release_effect(mHandle));
+    }
+
+    // Processes a 16 bit version of makeSignal() in place, in buffers of frameCount frames.
+    void process(std::vector<int16_t> *out, size_t frameCount) {
+        const std::vector<float> signal = makeSignal(kSampleRate / 2);
+        out->resize(signal.size());
+        for (size_t i = 0; i < signal.size(); i++) {
+            (*out)[i] = (int16_t)fmax(-32768, fmin(32767, signal[i] / 4));
+        }
+        for (size_t i = 0; i + 2 * frameCount <= out->size(); i += 2 * frameCount) {
+            audio_buffer_t buffer;
+            buffer.frameCount = frameCount;
+            buffer.s16 = &(*out)[i];
+            ASSERT_EQ(0, (*mHandle)->process(mHandle, &buffer, &buffer));
+        }
+    }
+
+    effect_handle_t mHandle;
+};
+
+TEST_F(LoudnessEnhancerTest, params) {
+    int32_t value = -1;
+    EXPECT_EQ(0, getParam(mHandle, LOUDNESS_ENHANCER_PARAM_BLOCK_PROCESSING, &value));
+    EXPECT_EQ(1, value);
+    EXPECT_EQ(0, getParam(mHandle, LOUDNESS_ENHANCER_PARAM_LOOKAHEAD_MS, &value));
+    EXPECT_EQ(0, value);
+
+    EXPECT_NE(0, setParam(mHandle, LOUDNESS_ENHANCER_PARAM_LOOKAHEAD_MS, -1));
+    EXPECT_NE(0, setParam(mHandle, LOUDNESS_ENHANCER_PARAM_LOOKAHEAD_MS,
+            LOUDNESS_ENHANCER_MAX_LOOKAHEAD_MS + 1));
+    EXPECT_EQ(0, setParam(mHandle, LOUDNESS_ENHANCER_PARAM_LOOKAHEAD_MS,
+            LOUDNESS_ENHANCER_MAX_LOOKAHEAD_MS));
+    EXPECT_EQ(0, getParam(mHandle, LOUDNESS_ENHANCER_PARAM_LOOKAHEAD_MS, &value));
+    EXPECT_EQ(LOUDNESS_ENHANCER_MAX_LOOKAHEAD_MS, value);
+    EXPECT_EQ(0, setParam(mHandle, LOUDNESS_ENHANCER_PARAM_BLOCK_PROCESSING, 0));
+    EXPECT_EQ(0, getParam(mHandle, LOUDNESS_ENHANCER_PARAM_BLOCK_PROCESSING, &value));
+    EXPECT_EQ(0, value);
+}
+
+// Both modes give close results through the effect, for any buffer size.
+TEST_F(LoudnessEnhancerTest, process) {
+    ASSERT_EQ(0, setParam(mHandle, LOUDNESS_ENHANCER_PARAM_TARGET_GAIN_MB, 1200));
+    ASSERT_EQ(0, setParam(mHandle, LOUDNESS_ENHANCER_PARAM_BLOCK_PROCESSING, 0));
+    std::vector<int16_t> expected;
+    process(&expected, 240);
+
+    static const size_t kFrameCounts[] = { 240, 441, 1024 };
+    for (size_t f = 0; f < sizeof(kFrameCounts) / sizeof(kFrameCounts[0]); f++) {
+        ASSERT_EQ(0, setParam(mHandle, LOUDNESS_ENHANCER_PARAM_BLOCK_PROCESSING, 1));
+        std::vector<int16_t> actual;
+        process(&actual, kFrameCounts[f]);
+        const size_t processed = actual.size() / (2 * kFrameCounts[f]) * kFrameCounts[f];
+        EXPECT_LT(maxLevelDifferenceDb(&expected[0], &actual[0], processed), 1.)
+                << "frame count " << kFrameCounts[f];
+    }
+}
+
+/* Benchmark
+ *
+ * Reports the CPU load of the compressor per channel of 48 kHz audio, in percent of one core,
+ * for the per frame and block processing.
+ */
+TEST(compressor, benchmark) {
+    static const int kFrames = kSampleRate;
+    static const int kCallFrames = 240;
+    static const int kIterations = 10;
+    const std::vector<float> signal = makeSignal(kFrames);
+    std::vector<float> x(signal.size());
+
+    printf("%-24s %14s\n", "48 kHz", "% CPU/channel");
+    for (int mode = 0; mode < 3; mode++) {
+        AdaptiveDynamicRangeCompression compressor;
+        compressor.set_lookahead_in_ms(mode == 2 ? 5.0f : 0.0f);
+        compressor.Initialize(2.0f, kSampleRate);
+        double best = 1e9;
+        for (int iteration = 0; iteration < kIterations; iteration++) {
+            x = signal;
+            const double start = nowSeconds();
+            for (int i = 0; i < kFrames; i += kCallFrames) {
+                if (mode == 0) {
+                    compressPerFrame(&compressor, &x[2 * i], kCallFrames);
+                } else {
+                    compressor.CompressBlock(&x[2 * i], kCallFrames);
+                }
+            }
+            best = fmin(best, nowSeconds() - start);
+        }
+        static const char *kNames[] = { "per frame", "block", "block, 5 ms look-ahead" };
+        // one second of stereo audio was processed
+        printf("%-24s %14.3f\n", kNames[mode], best * 100 / 2);
+    }
+}
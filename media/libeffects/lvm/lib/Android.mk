@@ -101,7 +101,8 @@ LOCAL_SRC_FILES:= \
     Common/src/LVC_MixInSoft_D16C31_SAT.c \
     Common/src/AGC_MIX_VOL_2St1Mon_D32_WRA.c \
     Common/src/LVM_Timer.c \
-    Common/src/LVM_Timer_Init.c
+    Common/src/LVM_Timer_Init.c \
+    Common/src/LVM_Simd.c
 
 LOCAL_MODULE:= libmusicbundle
 
@@ -30,7 +30,7 @@ extern "C" {
 
 typedef struct
 {
-    LVM_INT32 Storage[6];
+    uintptr_t Storage[6];   /* pointer sized, the private filter state starts with a pointer */
 
 } Biquad_Instance_t;
 
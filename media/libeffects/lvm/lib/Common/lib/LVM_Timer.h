@@ -44,7 +44,7 @@ extern "C" {
 
 typedef struct
 {
-    LVM_INT32 Storage[6];
+    uintptr_t Storage[6];   /* pointer sized, the private instance holds three pointers */
 
 } LVM_Timer_Instance_t;
 
@@ -169,6 +169,13 @@ void Int32RShiftToInt16_Sat_32x16(const  LVM_INT32  *src,
                                     LVM_INT16 n,
                                     LVM_INT16 shift );
 
+/*********************************************************************************
+ * note: The vector functions and the stereo biquads have NEON or SSE2 versions  *
+ *       which give bit-exact results and are used by default. LVM_SetUseSimd()  *
+ *       selects the C versions instead, for testing and benchmarking.           *
+ *********************************************************************************/
+void LVM_SetUseSimd(                LVM_INT16 useSimd);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -20,6 +20,7 @@
 ***********************************************************************************/
 
 #include "VectorArithmetic.h"
+#include "LVM_Simd.h"
 
 /**********************************************************************************
    FUNCTION ADD2_SAT_16X16
@@ -31,6 +32,26 @@ void Add2_Sat_16x16( const LVM_INT16 *src,
 {
     LVM_INT32 Temp;
     LVM_INT16 ii;
+
+#ifdef LVM_SIMD
+    if (LVM_SimdEnabled && LVM_SIMD_BUFFERS_OK(src, n * sizeof(LVM_INT16),
+                                               dst, n * sizeof(LVM_INT16)))
+    {
+        for (; n >= 8; n -= 8)
+        {
+#if defined(USE_LVM_NEON)
+            vst1q_s16(dst, vqaddq_s16(vld1q_s16(src), vld1q_s16(dst)));
+#else
+            _mm_storeu_si128((__m128i *)dst,
+                             _mm_adds_epi16(_mm_loadu_si128((const __m128i *)src),
+                                            _mm_loadu_si128((const __m128i *)dst)));
+#endif
+            src += 8;
+            dst += 8;
+        }
+    }
+#endif
+
     for (ii = n; ii != 0; ii--)
     {
         Temp = ((LVM_INT32) *src) + ((LVM_INT32) *dst);
@@ -18,6 +18,7 @@
 #include "BIQUAD.h"
 #include "BQ_2I_D16F32Css_TRC_WRA_01_Private.h"
 #include "LVM_Macros.h"
+#include "LVM_Simd.h"
 
 
 /**************************************************************************
@@ -47,6 +48,55 @@ void BQ_2I_D16F32C13_TRC_WRA_01 (           Biquad_Instance_t       *pInstance,
         LVM_INT16 ii;
         PFilter_State pBiquadState = (PFilter_State) pInstance;
 
+#ifdef LVM_SIMD
+        if (LVM_SimdEnabled)
+        {
+            /* both channels at once, with the delays kept in registers */
+            LVM_INT32 *pDelays = pBiquadState->pDelays;
+            LVM_Simd_2x32_t a2 = LVM_Simd_Dup_2x32(pBiquadState->coefs[0]);
+            LVM_Simd_2x32_t a1 = LVM_Simd_Dup_2x32(pBiquadState->coefs[1]);
+            LVM_Simd_2x32_t a0 = LVM_Simd_Dup_2x32(pBiquadState->coefs[2]);
+            LVM_Simd_2x32_t b2 = LVM_Simd_Dup_2x32(pBiquadState->coefs[3]);
+            LVM_Simd_2x32_t b1 = LVM_Simd_Dup_2x32(pBiquadState->coefs[4]);
+            LVM_Simd_2x32_t x1 = LVM_Simd_Set_2x32(pDelays[0], pDelays[1]);
+            LVM_Simd_2x32_t x2 = LVM_Simd_Set_2x32(pDelays[2], pDelays[3]);
+            LVM_Simd_2x32_t y1 = LVM_Simd_Set_2x32(pDelays[4], pDelays[5]);
+            LVM_Simd_2x32_t y2 = LVM_Simd_Set_2x32(pDelays[6], pDelays[7]);
+            LVM_Simd_2x32_t x0, yn, out;
+
+            for (ii = NrSamples; ii != 0; ii--)
+            {
+                x0 = LVM_Simd_Set_2x32(pDataIn[0], pDataIn[1]);
+                yn = LVM_Simd_Mul_2x32(a2, x2);
+                yn = LVM_Simd_Add_2x32(yn, LVM_Simd_Mul_2x32(a1, x1));
+                yn = LVM_Simd_Add_2x32(yn, LVM_Simd_Mul_2x32(a0, x0));
+                yn = LVM_Simd_Add_2x32(yn, LVM_Simd_MulShr_2x32(y2, b2, 16));
+                yn = LVM_Simd_Add_2x32(yn, LVM_Simd_MulShr_2x32(y1, b1, 16));
+
+                x2 = x1;
+                x1 = x0;
+                y2 = y1;
+                y1 = LVM_Simd_Shl_2x32(yn, 3);  /* in Q16 */
+
+                out = LVM_Simd_Shr_2x32(yn, 13);
+                pDataOut[0] = (LVM_INT16)LVM_Simd_Left_2x32(out);
+                pDataOut[1] = (LVM_INT16)LVM_Simd_Right_2x32(out);
+                pDataIn += 2;
+                pDataOut += 2;
+            }
+
+            pDelays[0] = LVM_Simd_Left_2x32(x1);
+            pDelays[1] = LVM_Simd_Right_2x32(x1);
+            pDelays[2] = LVM_Simd_Left_2x32(x2);
+            pDelays[3] = LVM_Simd_Right_2x32(x2);
+            pDelays[4] = LVM_Simd_Left_2x32(y1);
+            pDelays[5] = LVM_Simd_Right_2x32(y1);
+            pDelays[6] = LVM_Simd_Left_2x32(y2);
+            pDelays[7] = LVM_Simd_Right_2x32(y2);
+            return;
+        }
+#endif
+
          for (ii = NrSamples; ii != 0; ii--)
          {
 
@@ -19,6 +19,8 @@
    INCLUDE FILES
 ***********************************************************************************/
 
+#include <string.h>
+
 #include "VectorArithmetic.h"
 
 /**********************************************************************************
@@ -29,27 +31,10 @@ void Copy_16( const LVM_INT16 *src,
                     LVM_INT16 *dst,
                     LVM_INT16  n )
 {
-    LVM_INT16 ii;
-
-    if (src > dst)
-    {
-        for (ii = n; ii != 0; ii--)
-        {
-            *dst = *src;
-            dst++;
-            src++;
-        }
-    }
-    else
+    /* memmove() handles overlapping buffers in either direction */
+    if (n > 0)
     {
-        src += n - 1;
-        dst += n - 1;
-        for (ii = n; ii != 0; ii--)
-        {
-            *dst = *src;
-            dst--;
-            src--;
-        }
+        memmove(dst, src, (size_t)n * sizeof(LVM_INT16));
     }
 
     return;
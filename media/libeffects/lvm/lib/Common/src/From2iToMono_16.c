@@ -20,6 +20,7 @@
 ***********************************************************************************/
 
 #include "VectorArithmetic.h"
+#include "LVM_Simd.h"
 
 /**********************************************************************************
    FUNCTION From2iToMono_16
@@ -31,6 +32,35 @@ void From2iToMono_16( const LVM_INT16 *src,
 {
     LVM_INT16 ii;
     LVM_INT32 Temp;
+
+#ifdef LVM_SIMD
+    if (LVM_SimdEnabled && LVM_SIMD_BUFFERS_OK(src, n * 2 * sizeof(LVM_INT16),
+                                               dst, n * sizeof(LVM_INT16)))
+    {
+#if defined(USE_LVM_NEON)
+        for (; n >= 8; n -= 8)
+        {
+            int16x8x2_t in = vld2q_s16(src);
+            vst1q_s16(dst, vhaddq_s16(in.val[0], in.val[1]));
+            src += 16;
+            dst += 8;
+        }
+#else
+        __m128i ones = _mm_set1_epi16(1);
+        for (; n >= 8; n -= 8)
+        {
+            /* L + R of each frame in 32 bits */
+            __m128i lo = _mm_madd_epi16(_mm_loadu_si128((const __m128i *)src), ones);
+            __m128i hi = _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(src + 8)), ones);
+            _mm_storeu_si128((__m128i *)dst,
+                             _mm_packs_epi32(_mm_srai_epi32(lo, 1), _mm_srai_epi32(hi, 1)));
+            src += 16;
+            dst += 8;
+        }
+#endif
+    }
+#endif
+
     for (ii = n; ii != 0; ii--)
     {
         Temp = (LVM_INT32)*src;
@@ -20,6 +20,7 @@
 ***********************************************************************************/
 
 #include "VectorArithmetic.h"
+#include "LVM_Simd.h"
 
 /**********************************************************************************
    FUNCTION INT16LSHIFTTOINT32_16X32
@@ -32,6 +33,38 @@ void Int16LShiftToInt32_16x32(const LVM_INT16   *src,
 {
     LVM_INT16 ii;
 
+#ifdef LVM_SIMD
+    /* the C code works backwards so that it can widen in place, the SIMD code cannot */
+    if (LVM_SimdEnabled && LVM_SIMD_BUFFERS_OK(src, n * sizeof(LVM_INT16),
+                                               dst, n * sizeof(LVM_INT32)) &&
+            (const void *)src != (const void *)dst)
+    {
+#if defined(USE_LVM_NEON)
+        int32x4_t vshift = vdupq_n_s32(shift);
+        for (; n >= 8; n -= 8)
+        {
+            int16x8_t in = vld1q_s16(src);
+            vst1q_s32(dst, vshlq_s32(vmovl_s16(vget_low_s16(in)), vshift));
+            vst1q_s32(dst + 4, vshlq_s32(vmovl_s16(vget_high_s16(in)), vshift));
+            src += 8;
+            dst += 8;
+        }
+#else
+        __m128i vshift = _mm_cvtsi32_si128(shift);
+        for (; n >= 8; n -= 8)
+        {
+            __m128i in = _mm_loadu_si128((const __m128i *)src);
+            __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(in, in), 16);
+            __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(in, in), 16);
+            _mm_storeu_si128((__m128i *)dst, _mm_sll_epi32(lo, vshift));
+            _mm_storeu_si128((__m128i *)(dst + 4), _mm_sll_epi32(hi, vshift));
+            src += 8;
+            dst += 8;
+        }
+#endif
+    }
+#endif
+
     src += n-1;
     dst += n-1;
 
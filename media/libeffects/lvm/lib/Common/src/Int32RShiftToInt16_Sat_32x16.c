@@ -20,6 +20,7 @@
 ***********************************************************************************/
 
 #include "VectorArithmetic.h"
+#include "LVM_Simd.h"
 
 /**********************************************************************************
    FUNCTION INT32RSHIFTTOINT16_SAT_32X16
@@ -33,6 +34,34 @@ void Int32RShiftToInt16_Sat_32x16(const LVM_INT32  *src,
     LVM_INT32 temp;
     LVM_INT16 ii;
 
+#ifdef LVM_SIMD
+    if (LVM_SimdEnabled && LVM_SIMD_BUFFERS_OK(src, n * sizeof(LVM_INT32),
+                                               dst, n * sizeof(LVM_INT16)))
+    {
+#if defined(USE_LVM_NEON)
+        int32x4_t vshift = vdupq_n_s32(-shift);
+        for (; n >= 8; n -= 8)
+        {
+            int16x4_t lo = vqmovn_s32(vshlq_s32(vld1q_s32(src), vshift));
+            int16x4_t hi = vqmovn_s32(vshlq_s32(vld1q_s32(src + 4), vshift));
+            vst1q_s16(dst, vcombine_s16(lo, hi));
+            src += 8;
+            dst += 8;
+        }
+#else
+        __m128i vshift = _mm_cvtsi32_si128(shift);
+        for (; n >= 8; n -= 8)
+        {
+            __m128i lo = _mm_sra_epi32(_mm_loadu_si128((const __m128i *)src), vshift);
+            __m128i hi = _mm_sra_epi32(_mm_loadu_si128((const __m128i *)(src + 4)), vshift);
+            _mm_storeu_si128((__m128i *)dst, _mm_packs_epi32(lo, hi));
+            src += 8;
+            dst += 8;
+        }
+#endif
+    }
+#endif
+
     for (ii = n; ii != 0; ii--)
     {
         temp = *src >> shift;
@@ -20,6 +20,7 @@
 ***********************************************************************************/
 
 #include "LVC_Mixer_Private.h"
+#include "LVM_Simd.h"
 
 /**********************************************************************************
    FUNCTION LVCore_MIXHARD_2ST_D16C31_SAT
@@ -43,6 +44,53 @@ void LVC_Core_MixHard_2St_D16C31_SAT( LVMixer3_st *ptrInstance1,
     Current1Short = (LVM_INT16)(pInstance1->Current >> 16);
     Current2Short = (LVM_INT16)(pInstance2->Current >> 16);
 
+#ifdef LVM_SIMD
+    if (LVM_SimdEnabled &&
+            LVM_SIMD_BUFFERS_OK(src1, n * sizeof(LVM_INT16), dst, n * sizeof(LVM_INT16)) &&
+            LVM_SIMD_BUFFERS_OK(src2, n * sizeof(LVM_INT16), dst, n * sizeof(LVM_INT16)))
+    {
+#if defined(USE_LVM_NEON)
+        int16x4_t gain1 = vdup_n_s16(Current1Short);
+        int16x4_t gain2 = vdup_n_s16(Current2Short);
+        for (; n >= 8; n -= 8)
+        {
+            int16x8_t in1 = vld1q_s16(src1);
+            int16x8_t in2 = vld1q_s16(src2);
+            int32x4_t lo = vaddq_s32(vshrq_n_s32(vmull_s16(vget_low_s16(in1), gain1), 15),
+                                     vshrq_n_s32(vmull_s16(vget_low_s16(in2), gain2), 15));
+            int32x4_t hi = vaddq_s32(vshrq_n_s32(vmull_s16(vget_high_s16(in1), gain1), 15),
+                                     vshrq_n_s32(vmull_s16(vget_high_s16(in2), gain2), 15));
+            vst1q_s16(dst, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+            src1 += 8;
+            src2 += 8;
+            dst += 8;
+        }
+#else
+        __m128i gain1 = _mm_set1_epi16(Current1Short);
+        __m128i gain2 = _mm_set1_epi16(Current2Short);
+        for (; n >= 8; n -= 8)
+        {
+            __m128i in1 = _mm_loadu_si128((const __m128i *)src1);
+            __m128i in2 = _mm_loadu_si128((const __m128i *)src2);
+            __m128i prodHi1 = _mm_mulhi_epi16(in1, gain1);
+            __m128i prodLo1 = _mm_mullo_epi16(in1, gain1);
+            __m128i prodHi2 = _mm_mulhi_epi16(in2, gain2);
+            __m128i prodLo2 = _mm_mullo_epi16(in2, gain2);
+            __m128i lo = _mm_add_epi32(
+                    _mm_srai_epi32(_mm_unpacklo_epi16(prodLo1, prodHi1), 15),
+                    _mm_srai_epi32(_mm_unpacklo_epi16(prodLo2, prodHi2), 15));
+            __m128i hi = _mm_add_epi32(
+                    _mm_srai_epi32(_mm_unpackhi_epi16(prodLo1, prodHi1), 15),
+                    _mm_srai_epi32(_mm_unpackhi_epi16(prodLo2, prodHi2), 15));
+            _mm_storeu_si128((__m128i *)dst, _mm_packs_epi32(lo, hi));
+            src1 += 8;
+            src2 += 8;
+            dst += 8;
+        }
+#endif
+    }
+#endif
+
     for (ii = n; ii != 0; ii--){
         Temp = (((LVM_INT32)*(src1++) * (LVM_INT32)Current1Short)>>15) +
                (((LVM_INT32)*(src2++) * (LVM_INT32)Current2Short)>>15);
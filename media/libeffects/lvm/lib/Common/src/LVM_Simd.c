@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**********************************************************************************
+   INCLUDE FILES
+***********************************************************************************/
+
+#include "VectorArithmetic.h"
+#include "LVM_Simd.h"
+
+#ifdef LVM_SIMD
+LVM_INT16 LVM_SimdEnabled = LVM_TRUE;
+#endif
+
+/**********************************************************************************
+   FUNCTION LVM_SetUseSimd
+***********************************************************************************/
+
+void LVM_SetUseSimd(LVM_INT16 useSimd)
+{
+#ifdef LVM_SIMD
+    LVM_SimdEnabled = useSimd;
+#else
+    (void)useSimd;
+#endif
+}
+
+/**********************************************************************************/
@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _LVM_SIMD_H_
+#define _LVM_SIMD_H_
+
+/**********************************************************************************
+   INCLUDE FILES
+***********************************************************************************/
+
+#include "LVM_Types.h"
+
+/*
+ * The vector and biquad functions have NEON and SSE2 versions next to the reference
+ * C code. The SIMD versions are bit-exact with the C code, which is still used for
+ * short tails, overlapping buffers and when LVM_SetUseSimd(LVM_FALSE) has been called.
+ */
+#if defined(__aarch64__) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define USE_LVM_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#define USE_LVM_SSE
+#endif
+
+#if defined(USE_LVM_NEON) || defined(USE_LVM_SSE)
+#define LVM_SIMD
+
+/* Set by LVM_SetUseSimd(), LVM_TRUE by default */
+extern LVM_INT16 LVM_SimdEnabled;
+
+/* The SIMD code may be used when src and dst are the same buffer or do not overlap */
+#define LVM_SIMD_BUFFERS_OK(src, srcBytes, dst, dstBytes)                            \
+        ((const void *)(src) == (const void *)(dst) ||                               \
+         (const LVM_INT8 *)(src) + (srcBytes) <= (const LVM_INT8 *)(dst) ||          \
+         (const LVM_INT8 *)(dst) + (dstBytes) <= (const LVM_INT8 *)(src))
+
+/**********************************************************************************
+   STEREO 32-BIT OPERATIONS
+
+   The stereo biquads keep the left and right channel of a 32-bit state variable in
+   one register so both channels are processed with the same instructions.
+   LVM_Simd_MulShr_2x32() returns the low 32 bits of the 64-bit product shifted right,
+   which is what the MUL32x32INTO32 macro and, for 16-bit coefficients and a shift of
+   at most 16, the MUL32x16INTO32 macro compute.
+***********************************************************************************/
+
+#if defined(USE_LVM_NEON)
+
+typedef int32x2_t LVM_Simd_2x32_t;
+
+static inline LVM_Simd_2x32_t LVM_Simd_Set_2x32(LVM_INT32 left, LVM_INT32 right)
+{
+    return vset_lane_s32(right, vdup_n_s32(left), 1);
+}
+
+static inline LVM_Simd_2x32_t LVM_Simd_Dup_2x32(LVM_INT32 val)
+{
+    return vdup_n_s32(val);
+}
+
+static inline LVM_Simd_2x32_t LVM_Simd_Load_2x32(const LVM_INT32 *src)
+{
+    return vld1_s32(src);
+}
+
+static inline void LVM_Simd_Store_2x32(LVM_INT32 *dst, LVM_Simd_2x32_t val)
+{
+    vst1_s32(dst, val);
+}
+
+static inline LVM_INT32 LVM_Simd_Left_2x32(LVM_Simd_2x32_t val)
+{
+    return vget_lane_s32(val, 0);
+}
+
+static inline LVM_INT32 LVM_Simd_Right_2x32(LVM_Simd_2x32_t val)
+{
+    return vget_lane_s32(val, 1);
+}
+
+static inline LVM_Simd_2x32_t LVM_Simd_Add_2x32(LVM_Simd_2x32_t a, LVM_Simd_2x32_t b)
+{
+    return vadd_s32(a, b);
+}
+
+static inline LVM_Simd_2x32_t LVM_Simd_Sub_2x32(LVM_Simd_2x32_t a, LVM_Simd_2x32_t b)
+{
+    return vsub_s32(a, b);
+}
+
+static inline LVM_Simd_2x32_t LVM_Simd_Shl_2x32(LVM_Simd_2x32_t val, LVM_INT32 shift)
+{
+    return vshl_s32(val, vdup_n_s32(shift));
+}
+
+static inline LVM_Simd_2x32_t LVM_Simd_Shr_2x32(LVM_Simd_2x32_t val, LVM_INT32 shift)
+{
+    return vshl_s32(val, vdup_n_s32(-shift));
+}
+
+/* Low 32 bits of the product */
+static inline LVM_Simd_2x32_t LVM_Simd_Mul_2x32(LVM_Simd_2x32_t a, LVM_Simd_2x32_t b)
+{
+    return vmul_s32(a, b);
+}
+
+/* Low 32 bits of (64-bit product >> shift) */
+static inline LVM_Simd_2x32_t LVM_Simd_MulShr_2x32(LVM_Simd_2x32_t a, LVM_Simd_2x32_t b,
+                                                   LVM_INT32 shift)
+{
+    return vmovn_s64(vshlq_s64(vmull_s32(a, b), vdupq_n_s64(-shift)));
+}
+
+#else /* USE_LVM_SSE */
+
+/* left channel in lane 0, right channel in lane 2 */
+typedef __m128i LVM_Simd_2x32_t;
+
+static inline LVM_Simd_2x32_t LVM_Simd_Set_2x32(LVM_INT32 left, LVM_INT32 right)
+{
+    return _mm_set_epi32(0, right, 0, left);
+}
+
+static inline LVM_Simd_2x32_t LVM_Simd_Dup_2x32(LVM_INT32 val)
+{
+    return _mm_set1_epi32(val);
+}
+
+static inline LVM_Simd_2x32_t LVM_Simd_Load_2x32(const LVM_INT32 *src)
+{
+    return _mm_shuffle_epi32(_mm_loadl_epi64((const __m128i *)src), _MM_SHUFFLE(1, 1, 0, 0));
+}
+
+static inline void LVM_Simd_Store_2x32(LVM_INT32 *dst, LVM_Simd_2x32_t val)
+{
+    _mm_storel_epi64((__m128i *)dst, _mm_shuffle_epi32(val, _MM_SHUFFLE(3, 3, 2, 0)));
+}
+
+static inline LVM_INT32 LVM_Simd_Left_2x32(LVM_Simd_2x32_t val)
+{
+    return _mm_cvtsi128_si32(val);
+}
+
+static inline LVM_INT32 LVM_Simd_Right_2x32(LVM_Simd_2x32_t val)
+{
+    return _mm_cvtsi128_si32(_mm_unpackhi_epi64(val, val));
+}
+
+static inline LVM_Simd_2x32_t LVM_Simd_Add_2x32(LVM_Simd_2x32_t a, LVM_Simd_2x32_t b)
+{
+    return _mm_add_epi32(a, b);
+}
+
+static inline LVM_Simd_2x32_t LVM_Simd_Sub_2x32(LVM_Simd_2x32_t a, LVM_Simd_2x32_t b)
+{
+    return _mm_sub_epi32(a, b);
+}
+
+static inline LVM_Simd_2x32_t LVM_Simd_Shl_2x32(LVM_Simd_2x32_t val, LVM_INT32 shift)
+{
+    return _mm_sll_epi32(val, _mm_cvtsi32_si128(shift));
+}
+
+static inline LVM_Simd_2x32_t LVM_Simd_Shr_2x32(LVM_Simd_2x32_t val, LVM_INT32 shift)
+{
+    return _mm_sra_epi32(val, _mm_cvtsi32_si128(shift));
+}
+
+/* Low 32 bits of the product; the unsigned product has the same low 32 bits */
+static inline LVM_Simd_2x32_t LVM_Simd_Mul_2x32(LVM_Simd_2x32_t a, LVM_Simd_2x32_t b)
+{
+    return _mm_mul_epu32(a, b);
+}
+
+/* Low 32 bits of (64-bit product >> shift) */
+static inline LVM_Simd_2x32_t LVM_Simd_MulShr_2x32(LVM_Simd_2x32_t a, LVM_Simd_2x32_t b,
+                                                   LVM_INT32 shift)
+{
+#if defined(__SSE4_1__)
+    __m128i product = _mm_mul_epi32(a, b);
+#else
+    /* signed product = unsigned product - ((a < 0 ? b : 0) + (b < 0 ? a : 0)) << 32 */
+    __m128i correction = _mm_add_epi32(_mm_and_si128(_mm_srai_epi32(a, 31), b),
+                                       _mm_and_si128(_mm_srai_epi32(b, 31), a));
+    __m128i product = _mm_sub_epi64(_mm_mul_epu32(a, b), _mm_slli_epi64(correction, 32));
+#endif
+    /* a logical shift leaves the same low 32 bits as an arithmetic one */
+    return _mm_srl_epi64(product, _mm_cvtsi32_si128(shift));
+}
+
+#endif /* USE_LVM_NEON */
+
+#endif /* USE_LVM_NEON || USE_LVM_SSE */
+
+#endif /* _LVM_SIMD_H_ */
+
+/**********************************************************************************/
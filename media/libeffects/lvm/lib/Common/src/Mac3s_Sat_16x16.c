@@ -30,6 +30,7 @@
 
 #include "VectorArithmetic.h"
 #include "LVM_Macros.h"
+#include "LVM_Simd.h"
 
 /**********************************************************************************
    FUNCTION Mac3S_16X16
@@ -44,6 +45,44 @@ void Mac3s_Sat_16x16( const LVM_INT16 *src,
     LVM_INT16 srcval;
     LVM_INT32 Temp,dInVal;
 
+#ifdef LVM_SIMD
+    if (LVM_SimdEnabled && LVM_SIMD_BUFFERS_OK(src, n * sizeof(LVM_INT16),
+                                               dst, n * sizeof(LVM_INT16)))
+    {
+#if defined(USE_LVM_NEON)
+        int16x4_t vval = vdup_n_s16(val);
+        for (; n >= 8; n -= 8)
+        {
+            int16x8_t in = vld1q_s16(src);
+            int16x8_t out = vld1q_s16(dst);
+            int32x4_t lo = vshrq_n_s32(vmull_s16(vget_low_s16(in), vval), 15);
+            int32x4_t hi = vshrq_n_s32(vmull_s16(vget_high_s16(in), vval), 15);
+            lo = vaddw_s16(lo, vget_low_s16(out));
+            hi = vaddw_s16(hi, vget_high_s16(out));
+            vst1q_s16(dst, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+            src += 8;
+            dst += 8;
+        }
+#else
+        __m128i vval = _mm_set1_epi16(val);
+        for (; n >= 8; n -= 8)
+        {
+            __m128i in = _mm_loadu_si128((const __m128i *)src);
+            __m128i out = _mm_loadu_si128((const __m128i *)dst);
+            __m128i prodHi = _mm_mulhi_epi16(in, vval);
+            __m128i prodLo = _mm_mullo_epi16(in, vval);
+            __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(prodLo, prodHi), 15);
+            __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(prodLo, prodHi), 15);
+            lo = _mm_add_epi32(lo, _mm_srai_epi32(_mm_unpacklo_epi16(out, out), 16));
+            hi = _mm_add_epi32(hi, _mm_srai_epi32(_mm_unpackhi_epi16(out, out), 16));
+            _mm_storeu_si128((__m128i *)dst, _mm_packs_epi32(lo, hi));
+            src += 8;
+            dst += 8;
+        }
+#endif
+    }
+#endif
+
 
     for (ii = n; ii != 0; ii--)
     {
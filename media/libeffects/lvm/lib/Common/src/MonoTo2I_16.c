@@ -20,6 +20,7 @@
 ***********************************************************************************/
 
 #include "VectorArithmetic.h"
+#include "LVM_Simd.h"
 
 /**********************************************************************************
    FUNCTION MonoTo2I_16
@@ -30,6 +31,28 @@ void MonoTo2I_16( const LVM_INT16 *src,
                  LVM_INT16 n)
 {
     LVM_INT16 ii;
+
+#ifdef LVM_SIMD
+    /* works backwards from the end of the buffers like the C code, so src may be dst */
+    if (LVM_SimdEnabled && LVM_SIMD_BUFFERS_OK(src, n * sizeof(LVM_INT16),
+                                               dst, n * 2 * sizeof(LVM_INT16)))
+    {
+        for (; n >= 8; n -= 8)
+        {
+#if defined(USE_LVM_NEON)
+            int16x8x2_t out;
+            out.val[0] = vld1q_s16(src + n - 8);
+            out.val[1] = out.val[0];
+            vst2q_s16(dst + (n - 8) * 2, out);
+#else
+            __m128i in = _mm_loadu_si128((const __m128i *)(src + n - 8));
+            _mm_storeu_si128((__m128i *)(dst + (n - 8) * 2), _mm_unpacklo_epi16(in, in));
+            _mm_storeu_si128((__m128i *)(dst + (n - 4) * 2), _mm_unpackhi_epi16(in, in));
+#endif
+        }
+    }
+#endif
+
     src += (n-1);
     dst += ((n*2)-1);
 
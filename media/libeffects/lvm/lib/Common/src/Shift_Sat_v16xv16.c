@@ -20,6 +20,7 @@
 ***********************************************************************************/
 
 #include "VectorArithmetic.h"
+#include "LVM_Simd.h"
 
 /**********************************************************************************
    FUNCTION Shift_Sat_v16xv16
@@ -33,6 +34,44 @@ void Shift_Sat_v16xv16 (const   LVM_INT16   val,
     LVM_INT32   temp;
     LVM_INT32   ii;
     LVM_INT16   RShift;
+
+#ifdef LVM_SIMD
+    if (LVM_SimdEnabled && val != 0 && val >= -15 && val <= 15 &&
+            LVM_SIMD_BUFFERS_OK(src, n * sizeof(LVM_INT16), dst, n * sizeof(LVM_INT16)))
+    {
+#if defined(USE_LVM_NEON)
+        /* a negative shift is an arithmetic right shift, which never saturates */
+        int16x8_t vshift = vdupq_n_s16(val);
+        for (; n >= 8; n -= 8)
+        {
+            vst1q_s16(dst, vqshlq_s16(vld1q_s16(src), vshift));
+            src += 8;
+            dst += 8;
+        }
+#else
+        __m128i vshift = _mm_cvtsi32_si128(val > 0 ? val : -val);
+        for (; n >= 8; n -= 8)
+        {
+            __m128i in = _mm_loadu_si128((const __m128i *)src);
+            __m128i out;
+            if (val > 0)
+            {
+                __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(in, in), 16);
+                __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(in, in), 16);
+                out = _mm_packs_epi32(_mm_sll_epi32(lo, vshift), _mm_sll_epi32(hi, vshift));
+            }
+            else
+            {
+                out = _mm_sra_epi16(in, vshift);
+            }
+            _mm_storeu_si128((__m128i *)dst, out);
+            src += 8;
+            dst += 8;
+        }
+#endif
+    }
+#endif
+
     if(val>0)
     {
         for (ii = n; ii != 0; ii--)
@@ -20,6 +20,7 @@
 ***********************************************************************************/
 
 #include "VectorArithmetic.h"
+#include "LVM_Simd.h"
 
 /**********************************************************************************
    FUNCTION MULT3S_16X16
@@ -33,6 +34,38 @@ void Mult3s_16x16( const LVM_INT16 *src,
     LVM_INT16 ii;
     LVM_INT32 temp;
 
+#ifdef LVM_SIMD
+    if (LVM_SimdEnabled && LVM_SIMD_BUFFERS_OK(src, n * sizeof(LVM_INT16),
+                                               dst, n * sizeof(LVM_INT16)))
+    {
+#if defined(USE_LVM_NEON)
+        int16x4_t vval = vdup_n_s16(val);
+        for (; n >= 8; n -= 8)
+        {
+            int16x8_t in = vld1q_s16(src);
+            int16x4_t lo = vshrn_n_s32(vmull_s16(vget_low_s16(in), vval), 15);
+            int16x4_t hi = vshrn_n_s32(vmull_s16(vget_high_s16(in), vval), 15);
+            vst1q_s16(dst, vcombine_s16(lo, hi));
+            src += 8;
+            dst += 8;
+        }
+#else
+        __m128i vval = _mm_set1_epi16(val);
+        for (; n >= 8; n -= 8)
+        {
+            __m128i in = _mm_loadu_si128((const __m128i *)src);
+            /* the low 16 bits of (product >> 15) */
+            __m128i hi = _mm_mulhi_epi16(in, vval);
+            __m128i lo = _mm_mullo_epi16(in, vval);
+            _mm_storeu_si128((__m128i *)dst,
+                             _mm_or_si128(_mm_slli_epi16(hi, 1), _mm_srli_epi16(lo, 15)));
+            src += 8;
+            dst += 8;
+        }
+#endif
+    }
+#endif
+
     for (ii = n; ii != 0; ii--)
     {
         temp = (LVM_INT32)(*src) * (LVM_INT32)val;
@@ -0,0 +1,93 @@
+# Build the unit tests for the music bundle and reverb wrappers
+
+#
+# bit-exactness test of the SIMD code paths
+#
+LOCAL_PATH:= $(call my-dir)
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+	lvm_simd_tests.cpp \
+	../wrapper/Bundle/EffectBundle.cpp
+
+LOCAL_STATIC_LIBRARIES := \
+	libmusicbundle
+
+LOCAL_SHARED_LIBRARIES := \
+	liblog \
+	libcutils \
+	libdl
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/../wrapper/Bundle \
+	$(LOCAL_PATH)/../lib/Common/lib \
+	$(LOCAL_PATH)/../lib/Common/src \
+	$(LOCAL_PATH)/../lib/Bundle/lib \
+	$(call include-path-for, audio-effects)
+
+LOCAL_MODULE := lvm_simd_tests
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_CFLAGS := -Werror -Wall
+
+include $(BUILD_NATIVE_TEST)
+
+#
+# float mode of the bundle wrapper
+#
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+	bundle_float_tests.cpp \
+	../wrapper/Bundle/EffectBundle.cpp
+
+LOCAL_STATIC_LIBRARIES := \
+	libmusicbundle
+
+LOCAL_SHARED_LIBRARIES := \
+	liblog \
+	libcutils \
+	libdl
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/../wrapper/Bundle \
+	$(LOCAL_PATH)/../lib/Common/lib \
+	$(LOCAL_PATH)/../lib/Bundle/lib \
+	$(call include-path-for, audio-effects)
+
+LOCAL_MODULE := bundle_float_tests
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_CFLAGS := -Werror -Wall
+
+include $(BUILD_NATIVE_TEST)
+
+#
+# float mode of the reverb wrapper
+#
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+	reverb_float_tests.cpp \
+	../wrapper/Reverb/EffectReverb.cpp
+
+LOCAL_STATIC_LIBRARIES := \
+	libreverb
+
+LOCAL_SHARED_LIBRARIES := \
+	liblog \
+	libcutils \
+	libdl
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/../wrapper/Reverb \
+	$(LOCAL_PATH)/../lib/Common/lib \
+	$(LOCAL_PATH)/../lib/Reverb/lib \
+	$(call include-path-for, audio-effects)
+
+LOCAL_MODULE := reverb_float_tests
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_CFLAGS := -Werror -Wall
+
+include $(BUILD_NATIVE_TEST)
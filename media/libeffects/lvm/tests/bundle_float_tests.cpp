@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "bundle_float_tests"
+
+#include <stdio.h>
+#include <vector>
+
+#include <cutils/log.h>
+#include <gtest/gtest.h>
+#include <hardware/audio_effect.h>
+#include <audio_effects/effect_bassboost.h>
+#include <audio_effects/effect_equalizer.h>
+#include <audio_effects/effect_virtualizer.h>
+
+#include "lvm_test_utils.h"
+
+// The effect bundle wrapper is compiled into this test.
+extern "C" audio_effect_library_t AUDIO_EFFECT_LIBRARY_INFO_SYM;
+
+static const uint32_t kSampleRate = 48000;
+static const size_t kBlockFrames = 256;
+
+// Runs the equalizer, bass boost and virtualizer of one session over input, with the
+// samples in the given format. Returns the processing time in seconds.
+template <typename T>
+static double runBundle(audio_format_t format, uint8_t accessMode, const std::vector<T> &input,
+        std::vector<T> *output) {
+    static const effect_uuid_t kUuids[] = {
+        // same order as gEqualizerDescriptor, gBassBoostDescriptor, gVirtualizerDescriptor
+        { 0xce772f20, 0x847d, 0x11df, 0xbb17, { 0x00, 0x02, 0xa5, 0xd5, 0xc5, 0x1b } },
+        { 0x8631f300, 0x72e2, 0x11df, 0xb57e, { 0x00, 0x02, 0xa5, 0xd5, 0xc5, 0x1b } },
+        { 0x1d4033c0, 0x8557, 0x11df, 0x9f2d, { 0x00, 0x02, 0xa5, 0xd5, 0xc5, 0x1b } },
+    };
+    // equalizer preset, bass boost and virtualizer strength
+    static const int32_t kParamIds[] =
+            { EQ_PARAM_CUR_PRESET, BASSBOOST_PARAM_STRENGTH, VIRTUALIZER_PARAM_STRENGTH };
+    static const int16_t kValues[] = { 2 /* Dance */, 800, 800 };
+    static const int kSessionId = 1234;
+
+    std::vector<effect_handle_t> handles(ARRAY_SIZE(kUuids));
+    for (size_t i = 0; i < handles.size(); ++i) {
+        EXPECT_EQ(0, AUDIO_EFFECT_LIBRARY_INFO_SYM.create_effect(&kUuids[i], kSessionId, 0,
+                &handles[i]));
+        EXPECT_EQ(0, configureEffect(handles[i], kSampleRate, AUDIO_CHANNEL_OUT_STEREO, format,
+                accessMode));
+        uint32_t device = AUDIO_DEVICE_OUT_WIRED_HEADPHONE;
+        (*handles[i])->command(handles[i], EFFECT_CMD_SET_DEVICE, sizeof(device), &device,
+                NULL, NULL);
+        EXPECT_EQ(0, setEffectParam(handles[i], kParamIds[i], &kValues[i], sizeof(int16_t)));
+        EXPECT_EQ(0, enableEffect(handles[i]));
+    }
+
+    double elapsed = processEffects(handles, input, 2, output, kBlockFrames);
+
+    for (size_t i = 0; i < handles.size(); ++i) {
+        EXPECT_EQ(0, AUDIO_EFFECT_LIBRARY_INFO_SYM.release_effect(handles[i]));
+    }
+    return elapsed;
+}
+
+TEST(bundle_float, config) {
+    static const effect_uuid_t kBassBoostUuid =
+        { 0x8631f300, 0x72e2, 0x11df, 0xb57e, { 0x00, 0x02, 0xa5, 0xd5, 0xc5, 0x1b } };
+    effect_handle_t handle;
+    ASSERT_EQ(0, AUDIO_EFFECT_LIBRARY_INFO_SYM.create_effect(&kBassBoostUuid, 1, 0, &handle));
+    EXPECT_EQ(0, configureEffect(handle, kSampleRate, AUDIO_CHANNEL_OUT_STEREO,
+            AUDIO_FORMAT_PCM_FLOAT, EFFECT_BUFFER_ACCESS_ACCUMULATE));
+    EXPECT_EQ(0, configureEffect(handle, kSampleRate, AUDIO_CHANNEL_OUT_STEREO,
+            AUDIO_FORMAT_PCM_16_BIT, EFFECT_BUFFER_ACCESS_ACCUMULATE));
+    EXPECT_NE(0, configureEffect(handle, kSampleRate, AUDIO_CHANNEL_OUT_STEREO,
+            AUDIO_FORMAT_PCM_32_BIT, EFFECT_BUFFER_ACCESS_ACCUMULATE));
+    EXPECT_EQ(0, AUDIO_EFFECT_LIBRARY_INFO_SYM.release_effect(handle));
+}
+
+// The bundle core processes 16 bit samples, so for input with 16 bit resolution the float
+// mode must give the same results as the 16 bit mode.
+TEST(bundle_float, accuracy) {
+    const std::vector<int16_t> input16 = makeInput(kSampleRate, kSampleRate * 2);
+    const std::vector<float> input = toFloat(input16);
+
+    std::vector<int16_t> output16(input16.size());
+    runBundle(AUDIO_FORMAT_PCM_16_BIT, EFFECT_BUFFER_ACCESS_WRITE, input16, &output16);
+    const std::vector<float> expected = toFloat(output16);
+
+    std::vector<float> output(input.size());
+    runBundle(AUDIO_FORMAT_PCM_FLOAT, EFFECT_BUFFER_ACCESS_WRITE, input, &output);
+    EXPECT_EQ(INFINITY, signalToError(expected, output));
+
+    // Accumulating float output is not clamped. Like in 16 bit mode, the effects called before
+    // the last one accumulate their input, and the last one the bundle output.
+    std::vector<float> accumulated(input.size(), 1.0f);
+    runBundle(AUDIO_FORMAT_PCM_FLOAT, EFFECT_BUFFER_ACCESS_ACCUMULATE, input, &accumulated);
+    for (size_t i = 0; i < accumulated.size(); ++i) {
+        ASSERT_EQ(1.0f + input[i] + input[i] + expected[i], accumulated[i]) << "i=" << i;
+    }
+}
+
+/* Throughput test
+ *
+ * Reports how many times faster than real time the bundle processes in 16 bit and
+ * float mode, the difference being the cost of the conversions in the wrapper.
+ */
+TEST(bundle_float, throughput) {
+    const std::vector<int16_t> input16 = makeInput(kSampleRate, kSampleRate * 10);
+    const std::vector<float> input = toFloat(input16);
+    std::vector<int16_t> output16(input16.size());
+    std::vector<float> output(input.size());
+    const double seconds = input16.size() / 2 / (double)kSampleRate;
+
+    // best of 3 runs
+    double best16 = 0.;
+    double bestFloat = 0.;
+    for (int i = 0; i < 3; ++i) {
+        best16 = std::max(best16, seconds / runBundle(AUDIO_FORMAT_PCM_16_BIT,
+                EFFECT_BUFFER_ACCESS_ACCUMULATE, input16, &output16));
+        bestFloat = std::max(bestFloat, seconds / runBundle(AUDIO_FORMAT_PCM_FLOAT,
+                EFFECT_BUFFER_ACCESS_ACCUMULATE, input, &output));
+    }
+    printf("%-18s %14s %14s\n", "times real time", "int16", "float");
+    printf("%-18s %14.1f %14.1f\n", "bundle", best16, bestFloat);
+    EXPECT_GT(best16, 1.);
+    EXPECT_GT(bestFloat, 1.);
+}
@@ -0,0 +1,358 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "lvm_simd_tests"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include <cutils/log.h>
+#include <gtest/gtest.h>
+#include <hardware/audio_effect.h>
+#include <audio_effects/effect_bassboost.h>
+#include <audio_effects/effect_equalizer.h>
+#include <audio_effects/effect_virtualizer.h>
+
+extern "C" {
+#include "BIQUAD.h"
+#include "LVC_Mixer_Private.h"
+#include "VectorArithmetic.h"
+}
+
+#include "lvm_test_utils.h"
+
+// The effect bundle wrapper is compiled into this test.
+extern "C" audio_effect_library_t AUDIO_EFFECT_LIBRARY_INFO_SYM;
+
+// Every test runs the C code with LVM_SetUseSimd(LVM_FALSE) as the reference and
+// expects the SIMD code to give the same bits.
+
+static const LVM_INT16 kSizes[] = { 0, 1, 3, 7, 8, 9, 15, 16, 17, 31, 64, 255, 480 };
+
+static std::vector<LVM_INT16> randomSamples(size_t count) {
+    std::vector<LVM_INT16> samples(count);
+    for (size_t i = 0; i < count; ++i) {
+        // include the extremes, which exercise the saturation
+        switch (rand() % 16) {
+        case 0:
+            samples[i] = 32767;
+            break;
+        case 1:
+            samples[i] = -32768;
+            break;
+        default:
+            samples[i] = (LVM_INT16)rand();
+            break;
+        }
+    }
+    return samples;
+}
+
+template <typename T>
+static void expectSame(const std::vector<T> &expected, const std::vector<T> &actual,
+        const char *what, int n) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQ(expected[i], actual[i]) << what << " n=" << n << " i=" << i;
+    }
+}
+
+// Runs op on copies of the same buffers with the C and the SIMD code.
+template <typename T, typename Op>
+static void compareC(std::vector<T> buffer, const char *what, int n, Op op) {
+    std::vector<T> expected = buffer;
+    LVM_SetUseSimd(LVM_FALSE);
+    op(expected.data());
+    LVM_SetUseSimd(LVM_TRUE);
+    op(buffer.data());
+    expectSame(expected, buffer, what, n);
+}
+
+TEST(lvm_simd, vector_functions) {
+    srand(42);
+    for (LVM_INT16 n : kSizes) {
+        // src in the first half of the buffer, dst in the second, or both at the start
+        std::vector<LVM_INT16> buffer = randomSamples(4 * (n + 8));
+        const LVM_INT16 offset = 2 * (n + 8);
+        const LVM_INT16 val = (LVM_INT16)rand();
+
+        compareC(buffer, "Mult3s_16x16", n, [&](LVM_INT16 *b) {
+            Mult3s_16x16(b, val, b + offset, n);
+            Mult3s_16x16(b + 1, val, b + 1, n);
+        });
+        compareC(buffer, "Mac3s_Sat_16x16", n, [&](LVM_INT16 *b) {
+            Mac3s_Sat_16x16(b, val, b + offset, n);
+            Mac3s_Sat_16x16(b + offset, val, b + offset, n);
+        });
+        compareC(buffer, "Add2_Sat_16x16", n, [&](LVM_INT16 *b) {
+            Add2_Sat_16x16(b, b + offset, n);
+            Add2_Sat_16x16(b + 1, b + 1, n);
+        });
+        compareC(buffer, "Copy_16", n, [&](LVM_INT16 *b) {
+            Copy_16(b, b + offset, n);
+            Copy_16(b + 3, b + 5, n);
+            Copy_16(b + 5, b + 2, n);
+        });
+        for (LVM_INT16 shift = -16; shift <= 16; ++shift) {
+            compareC(buffer, "Shift_Sat_v16xv16", n, [&](LVM_INT16 *b) {
+                Shift_Sat_v16xv16(shift, b, b + offset, n);
+                Shift_Sat_v16xv16(shift, b + 1, b + 1, n);
+            });
+        }
+        compareC(buffer, "MonoTo2I_16", n, [&](LVM_INT16 *b) {
+            MonoTo2I_16(b, b + offset, n);
+            MonoTo2I_16(b + 1, b + 1, n);
+        });
+        compareC(buffer, "From2iToMono_16", n, [&](LVM_INT16 *b) {
+            From2iToMono_16(b, b + offset, n);
+            From2iToMono_16(b + 1, b + 1, n);
+        });
+        compareC(buffer, "LVC_Core_MixHard_2St_D16C31_SAT", n, [&](LVM_INT16 *b) {
+            LVMixer3_st mixer1, mixer2;
+            LVC_Mixer_Init(&mixer1, 0x7fff, 0x7fff);
+            LVC_Mixer_Init(&mixer2, 0x2345, 0x2345);
+            LVC_Core_MixHard_2St_D16C31_SAT(&mixer1, &mixer2, b, b + n, b + offset, n);
+            LVC_Core_MixHard_2St_D16C31_SAT(&mixer2, &mixer1, b + 1, b + offset, b + 1, n);
+        });
+
+        std::vector<LVM_INT32> buffer32(2 * (n + 8));
+        for (LVM_INT32 &sample : buffer32) {
+            sample = (LVM_INT32)(((uint32_t)rand() << 16) ^ (uint32_t)rand());
+        }
+        for (LVM_INT16 shift = 0; shift < 16; ++shift) {
+            compareC(buffer, "Int16LShiftToInt32_16x32", n, [&](LVM_INT16 *b) {
+                std::vector<LVM_INT32> out(n);
+                Int16LShiftToInt32_16x32(b, out.data(), n, shift);
+                memcpy(b + offset, out.data(), n * sizeof(LVM_INT32));
+            });
+            compareC(buffer32, "Int32RShiftToInt16_Sat_32x16", n, [&](LVM_INT32 *b) {
+                Int32RShiftToInt16_Sat_32x16(b, (LVM_INT16 *)(b + n + 8), n, shift);
+                Int32RShiftToInt16_Sat_32x16(b, (LVM_INT16 *)b, n, shift);
+            });
+        }
+    }
+}
+
+// Quantized RBJ audio EQ cookbook coefficients, used to get stable filters.
+struct Cookbook {
+    double a0, a1, a2, b1, b2;  // normalized, b1 and b2 negated as LVM expects
+
+    Cookbook(double fc, double q, double gainDb, bool peaking) {
+        const double w0 = 2 * M_PI * fc;
+        const double alpha = sin(w0) / (2 * q);
+        const double a = pow(10, gainDb / 40);
+        double b0n, b1n, b2n, a0n, a1n, a2n;
+        if (peaking) {
+            b0n = 1 + alpha * a;
+            b1n = -2 * cos(w0);
+            b2n = 1 - alpha * a;
+            a0n = 1 + alpha / a;
+            a1n = -2 * cos(w0);
+            a2n = 1 - alpha / a;
+        } else {  // low pass
+            b0n = (1 - cos(w0)) / 2;
+            b1n = 1 - cos(w0);
+            b2n = (1 - cos(w0)) / 2;
+            a0n = 1 + alpha;
+            a1n = -2 * cos(w0);
+            a2n = 1 - alpha;
+        }
+        a0 = b0n / a0n;
+        a1 = b1n / a0n;
+        a2 = b2n / a0n;
+        b1 = -a1n / a0n;
+        b2 = -a2n / a0n;
+    }
+};
+
+template <typename T>
+static T quantize(double value, int fractionalBits) {
+    return (T)llrint(value * (double)(1LL << fractionalBits));
+}
+
+template <typename T>
+static bool fits(double value, int fractionalBits) {
+    return fabs(value) * (double)(1LL << fractionalBits) < (double)std::numeric_limits<T>::max();
+}
+
+TEST(lvm_simd, biquads) {
+    srand(43);
+    static const double kCutoffs[] = { 0.001, 0.01, 0.1, 0.3 };
+    for (double fc : kCutoffs) {
+        const Cookbook lowPass(fc, 0.707, 0, false);
+        for (LVM_INT16 n : kSizes) {
+            // interleaved stereo input, run twice so the delays carry over
+            std::vector<LVM_INT16> in16 = randomSamples(2 * n);
+            std::vector<LVM_INT32> in32(2 * n);
+            for (size_t i = 0; i < in32.size(); ++i) {
+                in32[i] = (LVM_INT32)in16[i] << 10;
+            }
+
+            for (int q = 13; q <= 15; ++q) {
+                if (!fits<LVM_INT16>(lowPass.b1, q)) {
+                    continue;
+                }
+                BQ_C16_Coefs_t coefs = {
+                    quantize<LVM_INT16>(lowPass.a2, q),
+                    quantize<LVM_INT16>(lowPass.a1, q),
+                    quantize<LVM_INT16>(lowPass.a0, q),
+                    quantize<LVM_INT16>(lowPass.b2, q),
+                    quantize<LVM_INT16>(lowPass.b1, q),
+                };
+                compareC(in16, "BQ_2I_D16F32", n, [&](LVM_INT16 *b) {
+                    Biquad_Instance_t instance;
+                    Biquad_2I_Order2_Taps_t taps;
+                    memset(&taps, 0, sizeof(taps));
+                    BQ_2I_D16F32Css_TRC_WRA_01_Init(&instance, &taps, &coefs);
+                    for (int pass = 0; pass < 2; ++pass) {
+                        switch (q) {
+                        case 13:
+                            BQ_2I_D16F32C13_TRC_WRA_01(&instance, b, b, n);
+                            break;
+                        case 14:
+                            BQ_2I_D16F32C14_TRC_WRA_01(&instance, b, b, n);
+                            break;
+                        default:
+                            BQ_2I_D16F32C15_TRC_WRA_01(&instance, b, b, n);
+                            break;
+                        }
+                    }
+                    memcpy(b, taps.Storage, std::min(sizeof(taps), 2 * n * sizeof(LVM_INT16)));
+                });
+            }
+
+            BQ_C32_Coefs_t coefs32 = {
+                quantize<LVM_INT32>(lowPass.a2, 30),
+                quantize<LVM_INT32>(lowPass.a1, 30),
+                quantize<LVM_INT32>(lowPass.a0, 30),
+                quantize<LVM_INT32>(lowPass.b2, 30),
+                quantize<LVM_INT32>(lowPass.b1, 30),
+            };
+            compareC(in32, "BQ_2I_D32F32C30", n, [&](LVM_INT32 *b) {
+                Biquad_Instance_t instance;
+                Biquad_2I_Order2_Taps_t taps;
+                memset(&taps, 0, sizeof(taps));
+                BQ_2I_D32F32Cll_TRC_WRA_01_Init(&instance, &taps, &coefs32);
+                BQ_2I_D32F32C30_TRC_WRA_01(&instance, b, b, n);
+                BQ_2I_D32F32C30_TRC_WRA_01(&instance, b, b, n);
+                memcpy(b, taps.Storage, std::min(sizeof(taps), 2 * n * sizeof(LVM_INT32)));
+            });
+
+            // peaking filters in the form LVEQNB uses: y = x + G * bandpass(x)
+            const Cookbook peak(fc, 2, 12, true);
+            const double bandA0 = (peak.a0 - peak.a2) / 2;
+            const LVM_INT16 gain = quantize<LVM_INT16>(1.5, 11);
+            PK_C16_Coefs_t pk16 = {
+                quantize<LVM_INT16>(bandA0, 14),
+                quantize<LVM_INT16>(peak.b2, 14),
+                quantize<LVM_INT16>(peak.b1, 14),
+                gain,
+            };
+            compareC(in32, "PK_2I_D32F32C14G11", n, [&](LVM_INT32 *b) {
+                Biquad_Instance_t instance;
+                Biquad_2I_Order2_Taps_t taps;
+                memset(&taps, 0, sizeof(taps));
+                PK_2I_D32F32CssGss_TRC_WRA_01_Init(&instance, &taps, &pk16);
+                PK_2I_D32F32C14G11_TRC_WRA_01(&instance, b, b, n);
+                PK_2I_D32F32C14G11_TRC_WRA_01(&instance, b, b, n);
+                memcpy(b, taps.Storage, std::min(sizeof(taps), 2 * n * sizeof(LVM_INT32)));
+            });
+            PK_C32_Coefs_t pk32 = {
+                quantize<LVM_INT32>(bandA0, 30),
+                quantize<LVM_INT32>(peak.b2, 30),
+                quantize<LVM_INT32>(peak.b1, 30),
+                gain,
+            };
+            compareC(in32, "PK_2I_D32F32C30G11", n, [&](LVM_INT32 *b) {
+                Biquad_Instance_t instance;
+                Biquad_2I_Order2_Taps_t taps;
+                memset(&taps, 0, sizeof(taps));
+                PK_2I_D32F32CllGss_TRC_WRA_01_Init(&instance, &taps, &pk32);
+                PK_2I_D32F32C30G11_TRC_WRA_01(&instance, b, b, n);
+                PK_2I_D32F32C30G11_TRC_WRA_01(&instance, b, b, n);
+                memcpy(b, taps.Storage, std::min(sizeof(taps), 2 * n * sizeof(LVM_INT32)));
+            });
+        }
+    }
+}
+
+// Runs the equalizer, bass boost and virtualizer of one session over input.
+static std::vector<int16_t> runBundle(uint32_t sampleRate, const std::vector<int16_t> &input,
+        size_t blockFrames) {
+    static const effect_uuid_t kUuids[] = {
+        // same order as gEqualizerDescriptor, gBassBoostDescriptor, gVirtualizerDescriptor
+        { 0xce772f20, 0x847d, 0x11df, 0xbb17, { 0x00, 0x02, 0xa5, 0xd5, 0xc5, 0x1b } },
+        { 0x8631f300, 0x72e2, 0x11df, 0xb57e, { 0x00, 0x02, 0xa5, 0xd5, 0xc5, 0x1b } },
+        { 0x1d4033c0, 0x8557, 0x11df, 0x9f2d, { 0x00, 0x02, 0xa5, 0xd5, 0xc5, 0x1b } },
+    };
+    // equalizer preset, bass boost and virtualizer strength
+    static const int32_t kParamIds[] =
+            { EQ_PARAM_CUR_PRESET, BASSBOOST_PARAM_STRENGTH, VIRTUALIZER_PARAM_STRENGTH };
+    static const int16_t kValues[] = { 5 /* Heavy Metal */, 1000, 1000 };
+    static const int kSessionId = 1234;
+
+    std::vector<effect_handle_t> handles(ARRAY_SIZE(kUuids));
+    for (size_t i = 0; i < handles.size(); ++i) {
+        EXPECT_EQ(0, AUDIO_EFFECT_LIBRARY_INFO_SYM.create_effect(&kUuids[i], kSessionId, 0,
+                &handles[i]));
+        EXPECT_EQ(0, configureEffect(handles[i], sampleRate, AUDIO_CHANNEL_OUT_STEREO,
+                AUDIO_FORMAT_PCM_16_BIT, EFFECT_BUFFER_ACCESS_WRITE));
+        uint32_t device = AUDIO_DEVICE_OUT_WIRED_HEADPHONE;
+        (*handles[i])->command(handles[i], EFFECT_CMD_SET_DEVICE, sizeof(device), &device,
+                NULL, NULL);
+        EXPECT_EQ(0, setEffectParam(handles[i], kParamIds[i], &kValues[i], sizeof(int16_t)));
+        EXPECT_EQ(0, enableEffect(handles[i]));
+    }
+
+    // the bundle processes once all of the enabled effects have been called
+    std::vector<int16_t> output(input.size());
+    processEffects(handles, input, 2, &output, blockFrames);
+
+    for (size_t i = 0; i < handles.size(); ++i) {
+        EXPECT_EQ(0, AUDIO_EFFECT_LIBRARY_INFO_SYM.release_effect(handles[i]));
+    }
+    return output;
+}
+
+TEST(lvm_simd, bundle) {
+    static const uint32_t kSampleRates[] = { 44100, 48000 };
+    static const size_t kBlockFrames[] = { 76, 128, 256 };  // multiples of 4, at most 256
+    srand(44);
+    for (uint32_t sampleRate : kSampleRates) {
+        const std::vector<int16_t> input = makeInput(sampleRate, sampleRate * 2);
+        for (size_t blockFrames : kBlockFrames) {
+            LVM_SetUseSimd(LVM_FALSE);
+            std::vector<int16_t> expected = runBundle(sampleRate, input, blockFrames);
+            LVM_SetUseSimd(LVM_TRUE);
+            std::vector<int16_t> actual = runBundle(sampleRate, input, blockFrames);
+
+            // the effects must actually have been applied
+            size_t changed = 0;
+            for (size_t i = 0; i < input.size(); ++i) {
+                if (expected[i] != input[i]) {
+                    ++changed;
+                }
+            }
+            EXPECT_GT(changed, input.size() / 2);
+            expectSame(expected, actual, "bundle", (int)blockFrames);
+        }
+    }
+}
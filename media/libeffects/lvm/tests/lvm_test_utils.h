@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_LVM_TEST_UTILS_H
+#define ANDROID_LVM_TEST_UTILS_H
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <hardware/audio_effect.h>
+
+#ifndef ARRAY_SIZE
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+#endif
+
+// A sine sweep followed by noise, interleaved stereo.
+static inline std::vector<int16_t> makeInput(uint32_t sampleRate, size_t frameCount) {
+    std::vector<int16_t> input(2 * frameCount);
+    double phase = 0;
+    for (size_t i = 0; i < frameCount; ++i) {
+        if (i < frameCount / 2) {
+            // logarithmic sweep from 20 Hz to 20 kHz at -3 dBFS
+            const double f = 20 * pow(1000, (double)i / (frameCount / 2));
+            phase += 2 * M_PI * f / sampleRate;
+            input[2 * i] = (int16_t)(23197 * sin(phase));
+            input[2 * i + 1] = (int16_t)(23197 * sin(phase * 1.01));
+        } else {
+            input[2 * i] = (int16_t)rand();
+            input[2 * i + 1] = (int16_t)rand();
+        }
+    }
+    return input;
+}
+
+// The float samples with the same values as the 16 bit samples.
+static inline std::vector<float> toFloat(const std::vector<int16_t> &samples) {
+    std::vector<float> result(samples.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        result[i] = samples[i] / 32768.0f;
+    }
+    return result;
+}
+
+// Sends EFFECT_CMD_INIT, EFFECT_CMD_SET_CONFIG with the given format and channel masks,
+// and returns the status of the configuration.
+static inline int configureEffect(effect_handle_t handle, uint32_t sampleRate,
+        audio_channel_mask_t inChannels, audio_format_t format, uint8_t accessMode) {
+    int reply = 0;
+    uint32_t replySize = sizeof(reply);
+    int status = (*handle)->command(handle, EFFECT_CMD_INIT, 0, NULL, &replySize, &reply);
+    if (status != 0) {
+        return status;
+    }
+
+    effect_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.inputCfg.samplingRate = config.outputCfg.samplingRate = sampleRate;
+    config.inputCfg.channels = inChannels;
+    config.outputCfg.channels = AUDIO_CHANNEL_OUT_STEREO;
+    config.inputCfg.format = config.outputCfg.format = format;
+    config.inputCfg.accessMode = EFFECT_BUFFER_ACCESS_READ;
+    config.outputCfg.accessMode = accessMode;
+    config.inputCfg.mask = config.outputCfg.mask = EFFECT_CONFIG_ALL;
+    replySize = sizeof(reply);
+    status = (*handle)->command(handle, EFFECT_CMD_SET_CONFIG, sizeof(config), &config,
+            &replySize, &reply);
+    return status != 0 ? status : reply;
+}
+
+// Sets a parameter with a single 32 bit id.
+static inline int setEffectParam(effect_handle_t handle, int32_t id, const void *value,
+        size_t valueSize) {
+    uint32_t cmd[(sizeof(effect_param_t) + sizeof(int32_t) + sizeof(int32_t) * 4)
+            / sizeof(uint32_t)];
+    effect_param_t *param = (effect_param_t *)cmd;
+    if (valueSize > sizeof(int32_t) * 4) {
+        return -EINVAL;
+    }
+    param->psize = sizeof(int32_t);
+    param->vsize = valueSize;
+    memcpy(param->data, &id, sizeof(int32_t));
+    memcpy(param->data + sizeof(int32_t), value, valueSize);
+    int reply = 0;
+    uint32_t replySize = sizeof(reply);
+    int status = (*handle)->command(handle, EFFECT_CMD_SET_PARAM,
+            sizeof(effect_param_t) + sizeof(int32_t) + valueSize, param, &replySize, &reply);
+    return status != 0 ? status : reply;
+}
+
+static inline int enableEffect(effect_handle_t handle) {
+    int reply = 0;
+    uint32_t replySize = sizeof(reply);
+    int status = (*handle)->command(handle, EFFECT_CMD_ENABLE, 0, NULL, &replySize, &reply);
+    return status != 0 ? status : reply;
+}
+
+// Runs input through all the effects in blocks of blockFrames, each effect called in turn on
+// the same buffers as an effect chain would. Returns the processing time in seconds.
+template <typename T>
+static double processEffects(const std::vector<effect_handle_t> &handles,
+        const std::vector<T> &input, size_t inChannelCount, std::vector<T> *output,
+        size_t blockFrames) {
+    const size_t frameCount = input.size() / inChannelCount;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < frameCount; i += blockFrames) {
+        const size_t frames = std::min(blockFrames, frameCount - i);
+        audio_buffer_t inBuffer, outBuffer;
+        inBuffer.frameCount = outBuffer.frameCount = frames;
+        inBuffer.raw = (void *)&input[inChannelCount * i];
+        outBuffer.raw = &(*output)[2 * i];
+        for (size_t j = 0; j < handles.size(); ++j) {
+            EXPECT_EQ(0, (*handles[j])->process(handles[j], &inBuffer, &outBuffer));
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+}
+
+// Signal to error ratio of actual, in dB.
+static inline double signalToError(const std::vector<float> &expected,
+        const std::vector<float> &actual) {
+    double signal = 0;
+    double error = 0;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        signal += (double)expected[i] * expected[i];
+        error += ((double)actual[i] - expected[i]) * ((double)actual[i] - expected[i]);
+    }
+    return error == 0 ? INFINITY : 10 * log10(signal / error);
+}
+
+#endif // ANDROID_LVM_TEST_UTILS_H
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "reverb_float_tests"
+
+#include <stdio.h>
+#include <vector>
+
+#include <cutils/log.h>
+#include <gtest/gtest.h>
+#include <hardware/audio_effect.h>
+#include <audio_effects/effect_environmentalreverb.h>
+#include <audio_effects/effect_presetreverb.h>
+
+#include "lvm_test_utils.h"
+
+// The reverb wrapper is compiled into this test.
+extern "C" audio_effect_library_t AUDIO_EFFECT_LIBRARY_INFO_SYM;
+
+static const uint32_t kSampleRate = 48000;
+static const size_t kBlockFrames = 256;
+
+static const effect_uuid_t kAuxEnvReverbUuid =
+    { 0x4a387fc0, 0x8ab3, 0x11df, 0x8bad, { 0x00, 0x02, 0xa5, 0xd5, 0xc5, 0x1b } };
+static const effect_uuid_t kInsertPresetReverbUuid =
+    { 0x172cdf00, 0xa3bc, 0x11df, 0xa72f, { 0x00, 0x02, 0xa5, 0xd5, 0xc5, 0x1b } };
+
+// The left channel of input.
+template <typename T>
+static std::vector<T> toMono(const std::vector<T> &input) {
+    std::vector<T> mono(input.size() / 2);
+    for (size_t i = 0; i < mono.size(); ++i) {
+        mono[i] = input[2 * i];
+    }
+    return mono;
+}
+
+// Runs the large hall insert preset reverb over stereo input, or the auxiliary environmental
+// reverb over mono input, with the samples in the given format. Returns the processing time
+// in seconds.
+template <typename T>
+static double runReverb(bool auxiliary, audio_format_t format, uint8_t accessMode,
+        const std::vector<T> &input, std::vector<T> *output) {
+    effect_handle_t handle;
+    EXPECT_EQ(0, AUDIO_EFFECT_LIBRARY_INFO_SYM.create_effect(
+            auxiliary ? &kAuxEnvReverbUuid : &kInsertPresetReverbUuid, 0, 0, &handle));
+    EXPECT_EQ(0, configureEffect(handle, kSampleRate,
+            auxiliary ? AUDIO_CHANNEL_OUT_MONO : AUDIO_CHANNEL_OUT_STEREO, format, accessMode));
+    if (auxiliary) {
+        static const int16_t kRoomLevel = 0;      // millibels
+        static const int16_t kReverbLevel = 0;    // millibels
+        static const uint32_t kDecayTime = 2000;  // milliseconds
+        EXPECT_EQ(0, setEffectParam(handle, REVERB_PARAM_ROOM_LEVEL, &kRoomLevel,
+                sizeof(kRoomLevel)));
+        EXPECT_EQ(0, setEffectParam(handle, REVERB_PARAM_REVERB_LEVEL, &kReverbLevel,
+                sizeof(kReverbLevel)));
+        EXPECT_EQ(0, setEffectParam(handle, REVERB_PARAM_DECAY_TIME, &kDecayTime,
+                sizeof(kDecayTime)));
+    } else {
+        static const uint16_t kPreset = REVERB_PRESET_LARGEHALL;
+        EXPECT_EQ(0, setEffectParam(handle, REVERB_PARAM_PRESET, &kPreset, sizeof(kPreset)));
+    }
+    EXPECT_EQ(0, enableEffect(handle));
+
+    std::vector<effect_handle_t> handles(1, handle);
+    double elapsed = processEffects(handles, input, auxiliary ? 1 : 2, output, kBlockFrames);
+
+    EXPECT_EQ(0, AUDIO_EFFECT_LIBRARY_INFO_SYM.release_effect(handle));
+    return elapsed;
+}
+
+TEST(reverb_float, config) {
+    effect_handle_t handle;
+    ASSERT_EQ(0, AUDIO_EFFECT_LIBRARY_INFO_SYM.create_effect(&kInsertPresetReverbUuid, 0, 0,
+            &handle));
+    EXPECT_EQ(0, configureEffect(handle, kSampleRate, AUDIO_CHANNEL_OUT_STEREO,
+            AUDIO_FORMAT_PCM_FLOAT, EFFECT_BUFFER_ACCESS_ACCUMULATE));
+    EXPECT_EQ(0, configureEffect(handle, kSampleRate, AUDIO_CHANNEL_OUT_STEREO,
+            AUDIO_FORMAT_PCM_16_BIT, EFFECT_BUFFER_ACCESS_ACCUMULATE));
+    EXPECT_NE(0, configureEffect(handle, kSampleRate, AUDIO_CHANNEL_OUT_STEREO,
+            AUDIO_FORMAT_PCM_32_BIT, EFFECT_BUFFER_ACCESS_ACCUMULATE));
+    EXPECT_EQ(0, AUDIO_EFFECT_LIBRARY_INFO_SYM.release_effect(handle));
+}
+
+// The float mode skips the 16 bit quantization and clamping of the output, so for input with
+// 16 bit resolution it must stay within a 16 bit LSB or so of the 16 bit mode where that one
+// does not clip.
+TEST(reverb_float, accuracy) {
+    const std::vector<int16_t> stereo16 = makeInput(kSampleRate, kSampleRate * 2);
+    for (int auxiliary = 0; auxiliary <= 1; ++auxiliary) {
+        const std::vector<int16_t> input16 = auxiliary ? toMono(stereo16) : stereo16;
+        const std::vector<float> input = toFloat(input16);
+        const size_t outputSize = stereo16.size();
+
+        std::vector<int16_t> output16(outputSize);
+        runReverb(auxiliary, AUDIO_FORMAT_PCM_16_BIT, EFFECT_BUFFER_ACCESS_WRITE, input16,
+                &output16);
+        const std::vector<float> expected = toFloat(output16);
+
+        std::vector<float> output(outputSize);
+        runReverb(auxiliary, AUDIO_FORMAT_PCM_FLOAT, EFFECT_BUFFER_ACCESS_WRITE, input,
+                &output);
+        for (size_t i = 0; i < outputSize; ++i) {
+            output[i] = std::min(std::max(output[i], -1.0f), 32767 / 32768.0f);
+        }
+        const double snr = signalToError(expected, output);
+        printf("%s reverb float vs int16: %.1f dB\n", auxiliary ? "auxiliary" : "insert", snr);
+        EXPECT_GT(snr, 60.);
+        for (size_t i = 0; i < outputSize; ++i) {
+            ASSERT_NEAR(expected[i], output[i], 2. / 32768) << "i=" << i;
+        }
+    }
+}
+
+// A signal below the 16 bit LSB is lost in the 16 bit mode but not in the float mode.
+TEST(reverb_float, low_level) {
+    const std::vector<int16_t> stereo16 = makeInput(kSampleRate, kSampleRate);
+    std::vector<float> input = toFloat(toMono(stereo16));
+    for (size_t i = 0; i < input.size(); ++i) {
+        input[i] *= 1.0f / 65536;
+    }
+
+    std::vector<float> output(stereo16.size());
+    runReverb(true, AUDIO_FORMAT_PCM_FLOAT, EFFECT_BUFFER_ACCESS_WRITE, input, &output);
+    double energy = 0;
+    for (size_t i = 0; i < output.size(); ++i) {
+        energy += (double)output[i] * output[i];
+    }
+    EXPECT_GT(energy, 0.);
+}
+
+// Accumulating float output is not clamped at full scale.
+TEST(reverb_float, headroom) {
+    const std::vector<float> input = toFloat(makeInput(kSampleRate, kSampleRate));
+
+    std::vector<float> expected(input.size());
+    runReverb(false, AUDIO_FORMAT_PCM_FLOAT, EFFECT_BUFFER_ACCESS_WRITE, input, &expected);
+
+    std::vector<float> accumulated(input.size(), 1.0f);
+    runReverb(false, AUDIO_FORMAT_PCM_FLOAT, EFFECT_BUFFER_ACCESS_ACCUMULATE, input,
+            &accumulated);
+    for (size_t i = 0; i < accumulated.size(); ++i) {
+        ASSERT_EQ(1.0f + expected[i], accumulated[i]) << "i=" << i;
+    }
+}
+
+/* Throughput test
+ *
+ * Reports how many times faster than real time the insert reverb processes in 16 bit and
+ * float mode.
+ */
+TEST(reverb_float, throughput) {
+    const std::vector<int16_t> input16 = makeInput(kSampleRate, kSampleRate * 10);
+    const std::vector<float> input = toFloat(input16);
+    std::vector<int16_t> output16(input16.size());
+    std::vector<float> output(input.size());
+    const double seconds = input16.size() / 2 / (double)kSampleRate;
+
+    // best of 3 runs
+    double best16 = 0.;
+    double bestFloat = 0.;
+    for (int i = 0; i < 3; ++i) {
+        best16 = std::max(best16, seconds / runReverb(false, AUDIO_FORMAT_PCM_16_BIT,
+                EFFECT_BUFFER_ACCESS_ACCUMULATE, input16, &output16));
+        bestFloat = std::max(bestFloat, seconds / runReverb(false, AUDIO_FORMAT_PCM_FLOAT,
+                EFFECT_BUFFER_ACCESS_ACCUMULATE, input, &output));
+    }
+    printf("%-18s %14s %14s\n", "times real time", "int16", "float");
+    printf("%-18s %14.1f %14.1f\n", "reverb", best16, bestFloat);
+    EXPECT_GT(best16, 1.);
+    EXPECT_GT(bestFloat, 1.);
+}
@@ -71,6 +71,24 @@ static inline int16_t clamp16(int32_t sample)
     return sample;
 }
 
+// Converts a float sample with full scale 1.0 to 16 bit, clamping values out of range.
+static inline int16_t clamp16_from_float(float sample)
+{
+    const float scaled = sample * 32768.0f;
+    if (scaled >= 32767.0f) {
+        return 32767;
+    }
+    if (scaled <= -32768.0f) {
+        return -32768;
+    }
+    return (int16_t)lrintf(scaled);
+}
+
+static inline float float_from_i16(int16_t sample)
+{
+    return sample * (1.0f / 32768.0f);
+}
+
 // Namespaces
 namespace android {
 namespace {
@@ -729,48 +747,65 @@ int LvmBundle_init(EffectContext *pContext){
 // Apply LVM Bundle effects
 //
 // Inputs:
-//  pIn:        pointer to stereo 16 bit input data
-//  pOut:       pointer to stereo 16 bit output data
+//  pIn:        pointer to stereo 16 bit or float input data
+//  pOut:       pointer to stereo 16 bit or float output data
 //  frameCount: Frames to process
 //  pContext:   effect engine context
 //  strength    strength to be applied
 //
 //  Outputs:
-//  pOut:       pointer to updated stereo 16 bit output data
+//  pOut:       pointer to updated stereo 16 bit or float output data
 //
 //----------------------------------------------------------------------------
 
-int LvmBundle_process(LVM_INT16        *pIn,
-                      LVM_INT16        *pOut,
+int LvmBundle_process(void             *pIn,
+                      void             *pOut,
                       int              frameCount,
                       EffectContext    *pContext){
 
     LVM_ControlParams_t     ActiveParams;                           /* Current control Parameters */
     LVM_ReturnStatus_en     LvmStatus = LVM_SUCCESS;                /* Function call status */
+    LVM_INT16               *pIn16 = (LVM_INT16 *)pIn;
     LVM_INT16               *pOutTmp;
+    const bool              isFloat = pContext->config.inputCfg.format == AUDIO_FORMAT_PCM_FLOAT;
 
-    if (pContext->config.outputCfg.accessMode == EFFECT_BUFFER_ACCESS_WRITE){
-        pOutTmp = pOut;
-    } else if (pContext->config.outputCfg.accessMode == EFFECT_BUFFER_ACCESS_ACCUMULATE){
+    if (pContext->config.outputCfg.accessMode != EFFECT_BUFFER_ACCESS_WRITE &&
+            pContext->config.outputCfg.accessMode != EFFECT_BUFFER_ACCESS_ACCUMULATE){
+        ALOGV("LVM_ERROR : LvmBundle_process invalid access mode");
+        return -EINVAL;
+    }
+
+    if (pContext->config.outputCfg.accessMode == EFFECT_BUFFER_ACCESS_WRITE && !isFloat){
+        pOutTmp = (LVM_INT16 *)pOut;
+    } else {
         if (pContext->pBundledContext->frameCount != frameCount) {
             if (pContext->pBundledContext->workBuffer != NULL) {
                 free(pContext->pBundledContext->workBuffer);
             }
+            // 16 bit output, followed by the 16 bit input in float mode
             pContext->pBundledContext->workBuffer =
-                    (LVM_INT16 *)calloc(frameCount, sizeof(LVM_INT16) * 2);
+                    (LVM_INT16 *)calloc(frameCount, sizeof(LVM_INT16) * 2 * 2);
             if (pContext->pBundledContext->workBuffer == NULL) {
+                pContext->pBundledContext->frameCount = -1;
                 return -ENOMEM;
             }
             pContext->pBundledContext->frameCount = frameCount;
         }
         pOutTmp = pContext->pBundledContext->workBuffer;
-    } else {
-        ALOGV("LVM_ERROR : LvmBundle_process invalid access mode");
-        return -EINVAL;
+    }
+
+    // The LVM core processes 16 bit samples: float data is converted on the way in and out,
+    // and float output is accumulated without clamping.
+    if (isFloat) {
+        const float *pInFloat = (const float *)pIn;
+        pIn16 = pContext->pBundledContext->workBuffer + frameCount * 2;
+        for (int i = 0; i < frameCount * 2; i++) {
+            pIn16[i] = clamp16_from_float(pInFloat[i]);
+        }
     }
 
     #ifdef LVM_PCM
-    fwrite(pIn, frameCount*sizeof(LVM_INT16)*2, 1, pContext->pBundledContext->PcmInPtr);
+    fwrite(pIn16, frameCount*sizeof(LVM_INT16)*2, 1, pContext->pBundledContext->PcmInPtr);
     fflush(pContext->pBundledContext->PcmInPtr);
     #endif
 
@@ -778,7 +813,7 @@ int LvmBundle_process(LVM_INT16        *pIn,
 
     /* Process the samples */
     LvmStatus = LVM_Process(pContext->pBundledContext->hInstance, /* Instance handle */
-                            pIn,                                  /* Input buffer */
+                            pIn16,                                /* Input buffer */
                             pOutTmp,                              /* Output buffer */
                             (LVM_UINT16)frameCount,               /* Number of samples to read */
                             0);                                   /* Audo Time */
@@ -791,9 +826,21 @@ int LvmBundle_process(LVM_INT16        *pIn,
     fflush(pContext->pBundledContext->PcmOutPtr);
     #endif
 
-    if (pContext->config.outputCfg.accessMode == EFFECT_BUFFER_ACCESS_ACCUMULATE){
+    if (isFloat) {
+        float *pOutFloat = (float *)pOut;
+        if (pContext->config.outputCfg.accessMode == EFFECT_BUFFER_ACCESS_ACCUMULATE){
+            for (int i=0; i<frameCount*2; i++){
+                pOutFloat[i] += float_from_i16(pOutTmp[i]);
+            }
+        } else {
+            for (int i=0; i<frameCount*2; i++){
+                pOutFloat[i] = float_from_i16(pOutTmp[i]);
+            }
+        }
+    } else if (pContext->config.outputCfg.accessMode == EFFECT_BUFFER_ACCESS_ACCUMULATE){
+        LVM_INT16 *pOut16 = (LVM_INT16 *)pOut;
         for (int i=0; i<frameCount*2; i++){
-            pOut[i] = clamp16((LVM_INT32)pOut[i] + (LVM_INT32)pOutTmp[i]);
+            pOut16[i] = clamp16((LVM_INT32)pOut16[i] + (LVM_INT32)pOutTmp[i]);
         }
     }
     return 0;
@@ -1125,7 +1172,8 @@ int Effect_setConfig(EffectContext *pContext, effect_config_t *pConfig){
     CHECK_ARG(pConfig->inputCfg.channels == AUDIO_CHANNEL_OUT_STEREO);
     CHECK_ARG(pConfig->outputCfg.accessMode == EFFECT_BUFFER_ACCESS_WRITE
               || pConfig->outputCfg.accessMode == EFFECT_BUFFER_ACCESS_ACCUMULATE);
-    CHECK_ARG(pConfig->inputCfg.format == AUDIO_FORMAT_PCM_16_BIT);
+    CHECK_ARG(pConfig->inputCfg.format == AUDIO_FORMAT_PCM_16_BIT
+              || pConfig->inputCfg.format == AUDIO_FORMAT_PCM_FLOAT);
 
     pContext->config = *pConfig;
 
@@ -3198,8 +3246,8 @@ int Effect_process(effect_handle_t     self,
         pContext->pBundledContext->NumberEffectsCalled = 0;
         /* Process all the available frames, block processing is
            handled internalLY by the LVM bundle */
-        processStatus = android::LvmBundle_process(    (LVM_INT16 *)inBuffer->raw,
-                                                (LVM_INT16 *)outBuffer->raw,
+        processStatus = android::LvmBundle_process(    inBuffer->raw,
+                                                outBuffer->raw,
                                                 outBuffer->frameCount,
                                                 pContext);
         if (processStatus != 0){
@@ -3214,13 +3262,23 @@ int Effect_process(effect_handle_t     self,
         //popcount(pContext->pBundledContext->EffectsBitMap),
         //pContext->pBundledContext->NumberEffectsCalled, pContext->EffectType);
         // 2 is for stereo input
+        const bool isFloat = pContext->config.inputCfg.format == AUDIO_FORMAT_PCM_FLOAT;
         if (pContext->config.outputCfg.accessMode == EFFECT_BUFFER_ACCESS_ACCUMULATE) {
-            for (size_t i=0; i < outBuffer->frameCount*2; i++){
-                outBuffer->s16[i] =
-                        clamp16((LVM_INT32)outBuffer->s16[i] + (LVM_INT32)inBuffer->s16[i]);
+            if (isFloat) {
+                const float *pInFloat = (const float *)inBuffer->raw;
+                float *pOutFloat = (float *)outBuffer->raw;
+                for (size_t i=0; i < outBuffer->frameCount*2; i++){
+                    pOutFloat[i] += pInFloat[i];
+                }
+            } else {
+                for (size_t i=0; i < outBuffer->frameCount*2; i++){
+                    outBuffer->s16[i] =
+                            clamp16((LVM_INT32)outBuffer->s16[i] + (LVM_INT32)inBuffer->s16[i]);
+                }
             }
         } else if (outBuffer->raw != inBuffer->raw) {
-            memcpy(outBuffer->raw, inBuffer->raw, outBuffer->frameCount*sizeof(LVM_INT16)*2);
+            memcpy(outBuffer->raw, inBuffer->raw,
+                    outBuffer->frameCount * (isFloat ? sizeof(float) : sizeof(LVM_INT16)) * 2);
         }
     }
 
@@ -21,6 +21,7 @@
 
 #include <assert.h>
 #include <inttypes.h>
+#include <math.h>
 #include <new>
 #include <stdlib.h>
 #include <string.h>
@@ -393,6 +394,63 @@ static inline int16_t clamp16(int32_t sample)
     return sample;
 }
 
+// The reverb core processes Q8.23 samples, which have 8 bits of headroom above full scale.
+static inline LVM_INT32 clampq8_23_from_float(float sample)
+{
+    const float scaled = sample * (1 << 23);
+    if (scaled >= 2147483647.0f) {
+        return LVM_MAXINT_32;
+    }
+    if (scaled <= -2147483648.0f) {
+        return -LVM_MAXINT_32 - 1;
+    }
+    return (LVM_INT32)lrintf(scaled);
+}
+
+static inline float float_from_q8_23(LVM_INT32 sample)
+{
+    return sample * (1.0f / (1 << 23));
+}
+
+//----------------------------------------------------------------------------
+// reverb32()
+//----------------------------------------------------------------------------
+// Purpose:
+// Run the reverb core on the Q8.23 input in pContext->InFrames32, leaving the
+// stereo Q8.23 output in pContext->OutFrames32
+//
+// Inputs:
+//  frameCount:      Frames to process
+//  samplesPerFrame: 1 for mono input, 2 for stereo input
+//  pContext:        effect engine context
+//
+//----------------------------------------------------------------------------
+
+int reverb32(int frameCount, int samplesPerFrame, ReverbContext *pContext){
+
+    LVREV_ReturnStatus_en   LvmStatus = LVREV_SUCCESS;              /* Function call status */
+
+    if (pContext->preset && pContext->curPreset == REVERB_PRESET_NONE) {
+        memset(pContext->OutFrames32, 0, frameCount * sizeof(LVM_INT32) * 2); //always stereo here
+    } else {
+        if(pContext->bEnabled == LVM_FALSE && pContext->SamplesToExitCount > 0) {
+            memset(pContext->InFrames32,0,frameCount * sizeof(LVM_INT32) * samplesPerFrame);
+            ALOGV("\tZeroing %d samples per frame at the end of call", samplesPerFrame);
+        }
+
+        /* Process the samples, producing a stereo output */
+        LvmStatus = LVREV_Process(pContext->hInstance,      /* Instance handle */
+                                  pContext->InFrames32,     /* Input buffer */
+                                  pContext->OutFrames32,    /* Output buffer */
+                                  frameCount);              /* Number of samples to read */
+    }
+
+    LVM_ERROR_CHECK(LvmStatus, "LVREV_Process", "process")
+    if(LvmStatus != LVREV_SUCCESS) return -EINVAL;
+
+    return 0;
+}    /* end reverb32 */
+
 //----------------------------------------------------------------------------
 // process()
 //----------------------------------------------------------------------------
@@ -417,7 +475,6 @@ int process( LVM_INT16     *pIn,
              ReverbContext *pContext){
 
     LVM_INT16               samplesPerFrame = 1;
-    LVREV_ReturnStatus_en   LvmStatus = LVREV_SUCCESS;              /* Function call status */
     LVM_INT16 *OutFrames16;
 
 
@@ -461,23 +518,8 @@ int process( LVM_INT16     *pIn,
         }
     }
 
-    if (pContext->preset && pContext->curPreset == REVERB_PRESET_NONE) {
-        memset(pContext->OutFrames32, 0, frameCount * sizeof(LVM_INT32) * 2); //always stereo here
-    } else {
-        if(pContext->bEnabled == LVM_FALSE && pContext->SamplesToExitCount > 0) {
-            memset(pContext->InFrames32,0,frameCount * sizeof(LVM_INT32) * samplesPerFrame);
-            ALOGV("\tZeroing %d samples per frame at the end of call", samplesPerFrame);
-        }
-
-        /* Process the samples, producing a stereo output */
-        LvmStatus = LVREV_Process(pContext->hInstance,      /* Instance handle */
-                                  pContext->InFrames32,     /* Input buffer */
-                                  pContext->OutFrames32,    /* Output buffer */
-                                  frameCount);              /* Number of samples to read */
-    }
-
-    LVM_ERROR_CHECK(LvmStatus, "LVREV_Process", "process")
-    if(LvmStatus != LVREV_SUCCESS) return -EINVAL;
+    int status = reverb32(frameCount, samplesPerFrame, pContext);
+    if (status != 0) return status;
 
     // Convert to 16 bits
     if (pContext->auxiliary) {
@@ -545,6 +587,139 @@ int process( LVM_INT16     *pIn,
     return 0;
 }    /* end process */
 
+//----------------------------------------------------------------------------
+// processFloat()
+//----------------------------------------------------------------------------
+// Purpose:
+// Apply the Reverb to float data. The samples are converted straight to and
+// from the Q8.23 format of the reverb core, so the 16 bit path's quantization
+// and clamping are avoided.
+//
+// Inputs:
+//  pIn:        pointer to stereo/mono float input data
+//  pOut:       pointer to stereo float output data
+//  frameCount: Frames to process
+//  pContext:   effect engine context
+//
+//  Outputs:
+//  pOut:       pointer to updated stereo float output data
+//
+//----------------------------------------------------------------------------
+
+int processFloat( float         *pIn,
+                  float         *pOut,
+                  int           frameCount,
+                  ReverbContext *pContext){
+
+    LVM_INT16               samplesPerFrame = 1;
+    float *OutFramesFloat;
+
+    // Check that the input is either mono or stereo
+    if (pContext->config.inputCfg.channels == AUDIO_CHANNEL_OUT_STEREO) {
+        samplesPerFrame = 2;
+    } else if (pContext->config.inputCfg.channels != AUDIO_CHANNEL_OUT_MONO) {
+        ALOGV("\tLVREV_ERROR : processFloat invalid PCM format");
+        return -EINVAL;
+    }
+
+    // float and Q8.23 samples are the same size, the output is converted in place
+    OutFramesFloat = (float *)pContext->OutFrames32;
+
+    // Check for NULL pointers
+    if((pContext->InFrames32 == NULL)||(pContext->OutFrames32 == NULL)){
+        ALOGV("\tLVREV_ERROR : processFloat failed to allocate memory for temporary buffers ");
+        return -EINVAL;
+    }
+
+    #ifdef LVM_PCM
+    fwrite(pIn, frameCount*sizeof(float)*samplesPerFrame, 1, pContext->PcmInPtr);
+    fflush(pContext->PcmInPtr);
+    #endif
+
+    if (pContext->preset && pContext->nextPreset != pContext->curPreset) {
+        Reverb_LoadPreset(pContext);
+    }
+
+    // Convert to Input 32 bits
+    if (pContext->auxiliary) {
+        for (int i = 0; i < frameCount * samplesPerFrame; i++) {
+            pContext->InFrames32[i] = clampq8_23_from_float(pIn[i]);
+        }
+    } else {
+        // insert reverb input is always stereo
+        static const float kSendLevel = REVERB_SEND_LEVEL / (float)REVERB_UNIT_VOLUME;
+        for (int i = 0; i < frameCount * 2; i++) {
+            pContext->InFrames32[i] = clampq8_23_from_float(pIn[i] * kSendLevel);
+        }
+    }
+
+    int status = reverb32(frameCount, samplesPerFrame, pContext);
+    if (status != 0) return status;
+
+    // Convert to float
+    if (pContext->auxiliary) {
+        for (int i = 0; i < frameCount * 2; i++) { //always stereo here
+            OutFramesFloat[i] = float_from_q8_23(pContext->OutFrames32[i]);
+        }
+    } else {
+        for (int i = 0; i < frameCount * 2; i++) { //always stereo here
+            OutFramesFloat[i] = float_from_q8_23(pContext->OutFrames32[i]) + pIn[i];
+        }
+
+        // apply volume with ramp if needed
+        static const float kUnitVolume = REVERB_UNIT_VOLUME;
+        if ((pContext->leftVolume != pContext->prevLeftVolume ||
+                pContext->rightVolume != pContext->prevRightVolume) &&
+                pContext->volumeMode == REVERB_VOLUME_RAMP) {
+            float vl = pContext->prevLeftVolume / kUnitVolume;
+            float incl = (pContext->leftVolume - pContext->prevLeftVolume)
+                    / kUnitVolume / frameCount;
+            float vr = pContext->prevRightVolume / kUnitVolume;
+            float incr = (pContext->rightVolume - pContext->prevRightVolume)
+                    / kUnitVolume / frameCount;
+            for (int i = 0; i < frameCount; i++) {
+                OutFramesFloat[2*i] *= vl;
+                OutFramesFloat[2*i+1] *= vr;
+
+                vl += incl;
+                vr += incr;
+            }
+
+            pContext->prevLeftVolume = pContext->leftVolume;
+            pContext->prevRightVolume = pContext->rightVolume;
+        } else if (pContext->volumeMode != REVERB_VOLUME_OFF) {
+            if (pContext->leftVolume != REVERB_UNIT_VOLUME ||
+                pContext->rightVolume != REVERB_UNIT_VOLUME) {
+                const float vl = pContext->leftVolume / kUnitVolume;
+                const float vr = pContext->rightVolume / kUnitVolume;
+                for (int i = 0; i < frameCount; i++) {
+                    OutFramesFloat[2*i] *= vl;
+                    OutFramesFloat[2*i+1] *= vr;
+                }
+            }
+            pContext->prevLeftVolume = pContext->leftVolume;
+            pContext->prevRightVolume = pContext->rightVolume;
+            pContext->volumeMode = REVERB_VOLUME_RAMP;
+        }
+    }
+
+    #ifdef LVM_PCM
+    fwrite(OutFramesFloat, frameCount*sizeof(float)*2, 1, pContext->PcmOutPtr);
+    fflush(pContext->PcmOutPtr);
+    #endif
+
+    // Accumulate if required, float output is not clamped
+    if (pContext->config.outputCfg.accessMode == EFFECT_BUFFER_ACCESS_ACCUMULATE){
+        for (int i = 0; i < frameCount * 2; i++) { //always stereo here
+            pOut[i] += OutFramesFloat[i];
+        }
+    }else{
+        memcpy(pOut, OutFramesFloat, frameCount*sizeof(float)*2);
+    }
+
+    return 0;
+}    /* end processFloat */
+
 //----------------------------------------------------------------------------
 // Reverb_free()
 //----------------------------------------------------------------------------
@@ -617,7 +792,8 @@ int Reverb_setConfig(ReverbContext *pContext, effect_config_t *pConfig){
     CHECK_ARG(pConfig->outputCfg.channels == AUDIO_CHANNEL_OUT_STEREO);
     CHECK_ARG(pConfig->outputCfg.accessMode == EFFECT_BUFFER_ACCESS_WRITE
               || pConfig->outputCfg.accessMode == EFFECT_BUFFER_ACCESS_ACCUMULATE);
-    CHECK_ARG(pConfig->inputCfg.format == AUDIO_FORMAT_PCM_16_BIT);
+    CHECK_ARG(pConfig->inputCfg.format == AUDIO_FORMAT_PCM_16_BIT
+              || pConfig->inputCfg.format == AUDIO_FORMAT_PCM_FLOAT);
 
     //ALOGV("\tReverb_setConfig calling memcpy");
     pContext->config = *pConfig;
@@ -1906,10 +2082,17 @@ int Reverb_process(effect_handle_t   self,
     }
     //ALOGV("\tReverb_process() Calling process with %d frames", outBuffer->frameCount);
     /* Process all the available frames, block processing is handled internalLY by the LVM bundle */
-    status = process(    (LVM_INT16 *)inBuffer->raw,
-                         (LVM_INT16 *)outBuffer->raw,
-                                      outBuffer->frameCount,
-                                      pContext);
+    if (pContext->config.inputCfg.format == AUDIO_FORMAT_PCM_FLOAT) {
+        status = processFloat(    (float *)inBuffer->raw,
+                                  (float *)outBuffer->raw,
+                                           outBuffer->frameCount,
+                                           pContext);
+    } else {
+        status = process(    (LVM_INT16 *)inBuffer->raw,
+                             (LVM_INT16 *)outBuffer->raw,
+                                          outBuffer->frameCount,
+                                          pContext);
+    }
 
     if (pContext->bEnabled == LVM_FALSE) {
         if (pContext->SamplesToExitCount > 0) {
@@ -26,6 +26,11 @@
 #include <math.h>
 #include <audio_effects/effect_visualizer.h>
 #include <cutils/log.h>
+#include <media/EffectVisualizerApi.h>
+
+#include "FloatFft.h"
+
+using android::FloatFft;
 
 
 extern "C" {
@@ -88,6 +93,16 @@ struct VisualizerContext {
     uint8_t mMeasurementWindowSizeInBuffers;
     uint8_t mMeasurementBufferIdx;
     BufferStats mPastMeasurements[MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS];
+    // for the float capture, allocated while mFloatCaptureSize is not 0
+    uint32_t mFloatCaptureSize;
+    uint32_t mWindowType;
+    float *mFloatCaptureBuf; // CAPTURE_BUF_SIZE mono samples, indexed like mCaptureBuf
+    FloatFft *mFft;
+    float *mWindow;          // mFloatCaptureSize coefficients
+    float mWindowSum;
+    float mWindowSumSquares;
+    float *mFftIn;           // mFloatCaptureSize samples
+    float *mFftOut;          // mFloatCaptureSize / 2 + 1 complex bins
 };
 
 //
@@ -118,6 +133,105 @@ void Visualizer_reset(VisualizerContext *pContext)
     pContext->mBufferUpdateTime.tv_sec = 0;
     pContext->mLatency = 0;
     memset(pContext->mCaptureBuf, 0x80, CAPTURE_BUF_SIZE);
+    if (pContext->mFloatCaptureBuf != NULL) {
+        memset(pContext->mFloatCaptureBuf, 0, CAPTURE_BUF_SIZE * sizeof(float));
+    }
+}
+
+void Visualizer_computeWindow(VisualizerContext *pContext)
+{
+    const uint32_t size = pContext->mFloatCaptureSize;
+    double sum = 0;
+    double sumSquares = 0;
+    for (uint32_t i = 0; i < size; i++) {
+        // periodic windows, which is what an FFT expects
+        const double phase = 2 * M_PI * i / size;
+        double w;
+        switch (pContext->mWindowType) {
+        case VISUALIZER_WINDOW_HANN:
+            w = 0.5 - 0.5 * cos(phase);
+            break;
+        case VISUALIZER_WINDOW_HAMMING:
+            w = 0.54 - 0.46 * cos(phase);
+            break;
+        case VISUALIZER_WINDOW_BLACKMAN:
+            w = 0.42 - 0.5 * cos(phase) + 0.08 * cos(2 * phase);
+            break;
+        default:
+            w = 1.;
+            break;
+        }
+        pContext->mWindow[i] = w;
+        sum += w;
+        sumSquares += w * w;
+    }
+    pContext->mWindowSum = sum;
+    pContext->mWindowSumSquares = sumSquares;
+}
+
+void Visualizer_freeFloatCapture(VisualizerContext *pContext)
+{
+    free(pContext->mFloatCaptureBuf);
+    pContext->mFloatCaptureBuf = NULL;
+    delete pContext->mFft;
+    pContext->mFft = NULL;
+    free(pContext->mWindow);
+    pContext->mWindow = NULL;
+    free(pContext->mFftIn);
+    pContext->mFftIn = NULL;
+    free(pContext->mFftOut);
+    pContext->mFftOut = NULL;
+    pContext->mFloatCaptureSize = 0;
+}
+
+//----------------------------------------------------------------------------
+// Visualizer_setFloatCaptureSize()
+//----------------------------------------------------------------------------
+// Purpose: Enable the float capture with the given size, or disable it.
+//
+// Inputs:
+//  pContext:   effect engine context
+//  size:       0, or a power of 2 in the VISUALIZER_FLOAT_CAPTURE_SIZE_ range
+//
+// Outputs:
+//
+//----------------------------------------------------------------------------
+
+int Visualizer_setFloatCaptureSize(VisualizerContext *pContext, uint32_t size)
+{
+    if (size != 0 && (size < VISUALIZER_FLOAT_CAPTURE_SIZE_MIN ||
+            size > VISUALIZER_FLOAT_CAPTURE_SIZE_MAX || (size & (size - 1)) != 0)) {
+        return -EINVAL;
+    }
+    if (size == pContext->mFloatCaptureSize) {
+        return 0;
+    }
+    if (size == 0) {
+        Visualizer_freeFloatCapture(pContext);
+        return 0;
+    }
+
+    // keep the samples captured so far when only the size changes
+    float *captureBuf = pContext->mFloatCaptureBuf;
+    pContext->mFloatCaptureBuf = NULL;
+    Visualizer_freeFloatCapture(pContext);
+    if (captureBuf == NULL) {
+        captureBuf = (float *)calloc(CAPTURE_BUF_SIZE, sizeof(float));
+    }
+    pContext->mFloatCaptureBuf = captureBuf;
+    pContext->mFft = FloatFft::create(size);
+    pContext->mWindow = (float *)malloc(size * sizeof(float));
+    pContext->mFftIn = (float *)malloc(size * sizeof(float));
+    pContext->mFftOut = (float *)malloc((size / 2 + 1) * 2 * sizeof(float));
+    if (pContext->mFloatCaptureBuf == NULL || pContext->mFft == NULL ||
+            pContext->mWindow == NULL || pContext->mFftIn == NULL || pContext->mFftOut == NULL) {
+        ALOGE("Visualizer_setFloatCaptureSize() cannot allocate for size %u", size);
+        Visualizer_freeFloatCapture(pContext);
+        return -ENOMEM;
+    }
+    pContext->mFloatCaptureSize = size;
+    Visualizer_computeWindow(pContext);
+    return 0;
 }
 
 //----------------------------------------------------------------------------
@@ -221,6 +335,10 @@ int Visualizer_init(VisualizerContext *pContext)
         pContext->mPastMeasurements[i].mRmsSquared = 0;
     }
 
+    // float capture initialization
+    Visualizer_freeFloatCapture(pContext);
+    pContext->mWindowType = VISUALIZER_WINDOW_HANN;
+
     Visualizer_setConfig(pContext, &pContext->mConfig);
 
     return 0;
@@ -249,6 +367,11 @@ int VisualizerLib_Create(const effect_uuid_t *uuid,
 
     pContext->mItfe = &gVisualizerInterface;
     pContext->mState = VISUALIZER_STATE_UNINITIALIZED;
+    pContext->mFloatCaptureBuf = NULL;
+    pContext->mFft = NULL;
+    pContext->mWindow = NULL;
+    pContext->mFftIn = NULL;
+    pContext->mFftOut = NULL;
 
     ret = Visualizer_init(pContext);
     if (ret < 0) {
@@ -275,6 +398,7 @@ int VisualizerLib_Release(effect_handle_t handle) {
         return -EINVAL;
     }
     pContext->mState = VISUALIZER_STATE_UNINITIALIZED;
+    Visualizer_freeFloatCapture(pContext);
     delete pContext;
 
     return 0;
@@ -389,6 +513,19 @@ int Visualizer_process(
         smp = smp >> shift;
         buf[captIdx] = ((uint8_t)smp)^0x80;
     }
+    if (pContext->mFloatCaptureBuf != NULL) {
+        // the float capture keeps the full resolution, regardless of the scaling mode
+        float *floatBuf = pContext->mFloatCaptureBuf;
+        for (inIdx = 0, captIdx = pContext->mCaptureIdx;
+             inIdx < inBuffer->frameCount;
+             inIdx++, captIdx++) {
+            if (captIdx >= CAPTURE_BUF_SIZE) {
+                captIdx = 0;
+            }
+            floatBuf[captIdx] = (inBuffer->s16[2 * inIdx] + inBuffer->s16[2 * inIdx + 1])
+                    * (1.0f / 65536);
+        }
+    }
 
     // XXX the following two should really be atomic, though it probably doesn't
     // matter much for visualization purposes
@@ -413,6 +550,104 @@ int Visualizer_process(
     return 0;
 }   // end Visualizer_process
 
+//----------------------------------------------------------------------------
+// Visualizer_getCaptureStart()
+//----------------------------------------------------------------------------
+// Purpose: Find where the last captureSize samples played start in the capture
+//  buffers, accounting for the latency of the audio pipeline.
+//
+// Inputs:
+//  pContext:       effect engine context
+//  captureSize:    number of samples to return
+//
+// Outputs:
+//  *pStart:        index of the oldest sample to return
+//  returned value: false if the audio framework has stopped playing audio, in
+//      which case silence must be returned
+//
+//----------------------------------------------------------------------------
+
+bool Visualizer_getCaptureStart(VisualizerContext *pContext, uint32_t captureSize,
+        uint32_t *pStart)
+{
+    const uint32_t deltaMs = Visualizer_getDeltaTimeMsFromUpdatedTime(pContext);
+
+    // if audio framework has stopped playing audio although the effect is still
+    // active we must clear the capture buffer to return silence
+    if ((pContext->mLastCaptureIdx == pContext->mCaptureIdx) &&
+            (pContext->mBufferUpdateTime.tv_sec != 0) &&
+            (deltaMs > MAX_STALL_TIME_MS)) {
+        ALOGV("capture going to idle");
+        pContext->mBufferUpdateTime.tv_sec = 0;
+        return false;
+    }
+
+    int32_t latencyMs = pContext->mLatency;
+    latencyMs -= deltaMs;
+    if (latencyMs < 0) {
+        latencyMs = 0;
+    }
+    uint32_t deltaSmpl = captureSize
+            + pContext->mConfig.inputCfg.samplingRate * latencyMs / 1000;
+
+    // large sample rate, latency, or capture size, could cause overflow.
+    // do not offset more than the size of buffer.
+    if (deltaSmpl > CAPTURE_BUF_SIZE) {
+        android_errorWriteLog(0x534e4554, "31781965");
+        deltaSmpl = CAPTURE_BUF_SIZE;
+    }
+
+    int32_t capturePoint = pContext->mCaptureIdx - deltaSmpl;
+    // a negative capturePoint means we wrap the buffer.
+    if (capturePoint < 0) {
+        capturePoint += CAPTURE_BUF_SIZE;
+    }
+    *pStart = capturePoint;
+    return true;
+}
+
+// Copies the last mFloatCaptureSize samples played to mFftIn. Returns false if
+// there is nothing to analyze, mFftIn then holds silence.
+bool Visualizer_captureFloat(VisualizerContext *pContext)
+{
+    const uint32_t captureSize = pContext->mFloatCaptureSize;
+    uint32_t start;
+    if (pContext->mState != VISUALIZER_STATE_ACTIVE ||
+            !Visualizer_getCaptureStart(pContext, captureSize, &start)) {
+        memset(pContext->mFftIn, 0, captureSize * sizeof(float));
+        return false;
+    }
+    uint32_t size = CAPTURE_BUF_SIZE - start;
+    if (size > captureSize) {
+        size = captureSize;
+    }
+    memcpy(pContext->mFftIn, pContext->mFloatCaptureBuf + start, size * sizeof(float));
+    memcpy(pContext->mFftIn + size, pContext->mFloatCaptureBuf,
+            (captureSize - size) * sizeof(float));
+    pContext->mLastCaptureIdx = pContext->mCaptureIdx;
+    return true;
+}
+
+// Windows mFftIn in place and transforms it to mFftOut.
+void Visualizer_transformFloat(VisualizerContext *pContext)
+{
+    float *in = pContext->mFftIn;
+    const float *window = pContext->mWindow;
+    for (uint32_t i = 0; i < pContext->mFloatCaptureSize; i++) {
+        in[i] *= window[i];
+    }
+    pContext->mFft->forward(in, pContext->mFftOut);
+}
+
+// Converts a mean square value, relative to full scale, to millibels.
+static inline int32_t Visualizer_powerToMb(double power)
+{
+    if (power < 2.5e-10) {
+        return -9600; //-96dB
+    }
+    return (int32_t) (1000 * log10(power));
+}
+
 int Visualizer_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
         void *pCmdData, uint32_t *replySize, void *pReplyData) {
 
@@ -506,6 +741,18 @@ int Visualizer_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
             p->vsize = sizeof(uint32_t);
             *replySize += sizeof(uint32_t);
             break;
+        case VISUALIZER_PARAM_FLOAT_CAPTURE_SIZE:
+            ALOGV("get mFloatCaptureSize = %" PRIu32, pContext->mFloatCaptureSize);
+            *((uint32_t *)p->data + 1) = pContext->mFloatCaptureSize;
+            p->vsize = sizeof(uint32_t);
+            *replySize += sizeof(uint32_t);
+            break;
+        case VISUALIZER_PARAM_WINDOW:
+            ALOGV("get mWindowType = %" PRIu32, pContext->mWindowType);
+            *((uint32_t *)p->data + 1) = pContext->mWindowType;
+            p->vsize = sizeof(uint32_t);
+            *replySize += sizeof(uint32_t);
+            break;
         default:
             p->status = -EINVAL;
         }
@@ -550,6 +797,23 @@ int Visualizer_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
             pContext->mMeasurementMode = *((uint32_t *)p->data + 1);
             ALOGV("set mMeasurementMode = %" PRIu32, pContext->mMeasurementMode);
             break;
+        case VISUALIZER_PARAM_FLOAT_CAPTURE_SIZE: {
+            const uint32_t captureSize = *((uint32_t *)p->data + 1);
+            *(int32_t *)pReplyData = Visualizer_setFloatCaptureSize(pContext, captureSize);
+            ALOGV("set mFloatCaptureSize = %u", captureSize);
+            } break;
+        case VISUALIZER_PARAM_WINDOW: {
+            const uint32_t window = *((uint32_t *)p->data + 1);
+            if (window > VISUALIZER_WINDOW_BLACKMAN) {
+                *(int32_t *)pReplyData = -EINVAL;
+                break;
+            }
+            pContext->mWindowType = window;
+            if (pContext->mFloatCaptureSize != 0) {
+                Visualizer_computeWindow(pContext);
+            }
+            ALOGV("set mWindowType = %u", window);
+            } break;
         default:
             *(int32_t *)pReplyData = -EINVAL;
         }
@@ -568,49 +832,17 @@ int Visualizer_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
             return -EINVAL;
         }
         if (pContext->mState == VISUALIZER_STATE_ACTIVE) {
-            const uint32_t deltaMs = Visualizer_getDeltaTimeMsFromUpdatedTime(pContext);
-
-            // if audio framework has stopped playing audio although the effect is still
-            // active we must clear the capture buffer to return silence
-            if ((pContext->mLastCaptureIdx == pContext->mCaptureIdx) &&
-                    (pContext->mBufferUpdateTime.tv_sec != 0) &&
-                    (deltaMs > MAX_STALL_TIME_MS)) {
-                    ALOGV("capture going to idle");
-                    pContext->mBufferUpdateTime.tv_sec = 0;
-                    memset(pReplyData, 0x80, captureSize);
+            uint32_t start;
+            if (!Visualizer_getCaptureStart(pContext, captureSize, &start)) {
+                memset(pReplyData, 0x80, captureSize);
             } else {
-                int32_t latencyMs = pContext->mLatency;
-                latencyMs -= deltaMs;
-                if (latencyMs < 0) {
-                    latencyMs = 0;
-                }
-                uint32_t deltaSmpl = captureSize
-                        + pContext->mConfig.inputCfg.samplingRate * latencyMs / 1000;
-
-                // large sample rate, latency, or capture size, could cause overflow.
-                // do not offset more than the size of buffer.
-                if (deltaSmpl > CAPTURE_BUF_SIZE) {
-                    android_errorWriteLog(0x534e4554, "31781965");
-                    deltaSmpl = CAPTURE_BUF_SIZE;
-                }
-
-                int32_t capturePoint = pContext->mCaptureIdx - deltaSmpl;
-                // a negative capturePoint means we wrap the buffer.
-                if (capturePoint < 0) {
-                    uint32_t size = -capturePoint;
-                    if (size > captureSize) {
-                        size = captureSize;
-                    }
-                    memcpy(pReplyData,
-                           pContext->mCaptureBuf + CAPTURE_BUF_SIZE + capturePoint,
-                           size);
-                    pReplyData = (char *)pReplyData + size;
-                    captureSize -= size;
-                    capturePoint = 0;
+                // the capture may wrap around the end of the buffer
+                uint32_t size = CAPTURE_BUF_SIZE - start;
+                if (size > captureSize) {
+                    size = captureSize;
                 }
-                memcpy(pReplyData,
-                       pContext->mCaptureBuf + capturePoint,
-                       captureSize);
+                memcpy(pReplyData, pContext->mCaptureBuf + start, size);
+                memcpy((char *)pReplyData + size, pContext->mCaptureBuf, captureSize - size);
             }
 
             pContext->mLastCaptureIdx = pContext->mCaptureIdx;
@@ -681,6 +913,84 @@ int Visualizer_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
         }
         break;
 
+    case VISUALIZER_CMD_CAPTURE_FFT_FLOAT: {
+        const uint32_t captureSize = pContext->mFloatCaptureSize;
+        const uint32_t binCount = captureSize / 2 + 1;
+        if (captureSize == 0 || pReplyData == NULL || replySize == NULL ||
+                *replySize != binCount * sizeof(float)) {
+            ALOGV("VISUALIZER_CMD_CAPTURE_FFT_FLOAT() error float capture size %" PRIu32,
+                    captureSize);
+            return -EINVAL;
+        }
+        float *magnitudes = (float *)pReplyData;
+        if (!Visualizer_captureFloat(pContext)) {
+            memset(magnitudes, 0, binCount * sizeof(float));
+            break;
+        }
+        Visualizer_transformFloat(pContext);
+        // a full scale sine on a bin reads 1.0
+        const float *spectrum = pContext->mFftOut;
+        const float scale = 2 / pContext->mWindowSum;
+        for (uint32_t k = 0; k < binCount; k++) {
+            magnitudes[k] = scale * sqrtf(spectrum[2 * k] * spectrum[2 * k] +
+                    spectrum[2 * k + 1] * spectrum[2 * k + 1]);
+        }
+        magnitudes[0] *= 0.5f;
+        magnitudes[binCount - 1] *= 0.5f;
+        } break;
+
+    case VISUALIZER_CMD_MEASURE_BANDS: {
+        const uint32_t captureSize = pContext->mFloatCaptureSize;
+        if (captureSize == 0 || pReplyData == NULL || replySize == NULL ||
+                *replySize != sizeof(visualizer_band_measurement_t)) {
+            ALOGV("VISUALIZER_CMD_MEASURE_BANDS() error float capture size %" PRIu32,
+                    captureSize);
+            return -EINVAL;
+        }
+        visualizer_band_measurement_t *measurement = (visualizer_band_measurement_t *)pReplyData;
+        double bandPower[VISUALIZER_BAND_COUNT];
+        memset(bandPower, 0, sizeof(bandPower));
+        float peak = 0;
+        double sumSquares = 0;
+        if (Visualizer_captureFloat(pContext)) {
+            const float *in = pContext->mFftIn;
+            for (uint32_t i = 0; i < captureSize; i++) {
+                const float smp = fabsf(in[i]);
+                if (smp > peak) {
+                    peak = smp;
+                }
+                sumSquares += smp * smp;
+            }
+
+            Visualizer_transformFloat(pContext);
+            // the mean square contributed by each bin of the one sided spectrum
+            const float *spectrum = pContext->mFftOut;
+            const double scale = 2. / (captureSize * (double)pContext->mWindowSumSquares);
+            const double binHz = pContext->mConfig.inputCfg.samplingRate / (double)captureSize;
+            // the lowest band goes from 31.25 Hz / sqrt(2) to 31.25 Hz * sqrt(2)
+            const double lowestHz = 31.25 / M_SQRT2;
+            for (uint32_t k = 1; k <= captureSize / 2; k++) {
+                const double octaves = log2(k * binHz / lowestHz);
+                if (octaves < 0 || octaves >= VISUALIZER_BAND_COUNT) {
+                    continue;
+                }
+                double power = scale * (spectrum[2 * k] * spectrum[2 * k] +
+                        spectrum[2 * k + 1] * spectrum[2 * k + 1]);
+                if (k == captureSize / 2) {
+                    power *= 0.5;
+                }
+                bandPower[(int)octaves] += power;
+            }
+        }
+        measurement->peakMb = Visualizer_powerToMb(peak * peak);
+        measurement->rmsMb = Visualizer_powerToMb(sumSquares / captureSize);
+        for (uint32_t i = 0; i < VISUALIZER_BAND_COUNT; i++) {
+            measurement->bandMb[i] = Visualizer_powerToMb(bandPower[i]);
+        }
+        ALOGV("VISUALIZER_CMD_MEASURE_BANDS peak %" PRId32 "mB, rms %" PRId32 "mB",
+                measurement->peakMb, measurement->rmsMb);
+        } break;
+
     default:
         ALOGW("Visualizer_command invalid command %" PRIu32, cmdCode);
         return -EINVAL;
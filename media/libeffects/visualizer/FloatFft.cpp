@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "FloatFft"
+//#define LOG_NDEBUG 0
+
+#include <math.h>
+#include <new>
+#include <stdlib.h>
+
+#include <cutils/log.h>
+
+#include "FloatFft.h"
+
+#if defined(__aarch64__) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FLOAT_FFT_NEON
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define FLOAT_FFT_SSE
+#endif
+
+namespace android {
+
+#if defined(FLOAT_FFT_NEON) || defined(FLOAT_FFT_SSE)
+
+// four floats, for the butterflies of four consecutive points of a radix-4 stage
+#if defined(FLOAT_FFT_NEON)
+typedef float32x4_t fft_vec_t;
+static inline fft_vec_t vecLoad(const float *p) { return vld1q_f32(p); }
+static inline void vecStore(float *p, fft_vec_t v) { vst1q_f32(p, v); }
+static inline fft_vec_t vecAdd(fft_vec_t a, fft_vec_t b) { return vaddq_f32(a, b); }
+static inline fft_vec_t vecSub(fft_vec_t a, fft_vec_t b) { return vsubq_f32(a, b); }
+static inline fft_vec_t vecMul(fft_vec_t a, fft_vec_t b) { return vmulq_f32(a, b); }
+#else
+typedef __m128 fft_vec_t;
+static inline fft_vec_t vecLoad(const float *p) { return _mm_loadu_ps(p); }
+static inline void vecStore(float *p, fft_vec_t v) { _mm_storeu_ps(p, v); }
+static inline fft_vec_t vecAdd(fft_vec_t a, fft_vec_t b) { return _mm_add_ps(a, b); }
+static inline fft_vec_t vecSub(fft_vec_t a, fft_vec_t b) { return _mm_sub_ps(a, b); }
+static inline fft_vec_t vecMul(fft_vec_t a, fft_vec_t b) { return _mm_mul_ps(a, b); }
+#endif
+
+// (re, im) *= (wr, wi)
+static inline void vecComplexMul(fft_vec_t *re, fft_vec_t *im, fft_vec_t wr, fft_vec_t wi) {
+    const fft_vec_t r = vecSub(vecMul(*re, wr), vecMul(*im, wi));
+    *im = vecAdd(vecMul(*re, wi), vecMul(*im, wr));
+    *re = r;
+}
+
+#define FLOAT_FFT_SIMD
+#endif
+
+// static
+FloatFft *FloatFft::create(uint32_t size) {
+    if (size < kMinSize || size > kMaxSize || (size & (size - 1)) != 0) {
+        ALOGE("FloatFft::create() invalid size %u", size);
+        return NULL;
+    }
+    FloatFft *fft = new(std::nothrow) FloatFft(size);
+    if (fft != NULL && !fft->init()) {
+        delete fft;
+        fft = NULL;
+    }
+    return fft;
+}
+
+FloatFft::FloatFft(uint32_t size)
+    : mSize(size),
+      mHalfSize(size / 2),
+      mRe(NULL),
+      mIm(NULL),
+      mTwiddles(NULL),
+      mIndex(NULL),
+      mPostCos(NULL),
+      mPostSin(NULL)
+{
+}
+
+FloatFft::~FloatFft() {
+    free(mRe);
+    free(mIm);
+    free(mTwiddles);
+    free(mIndex);
+    free(mPostCos);
+    free(mPostSin);
+}
+
+bool FloatFft::init() {
+    const uint32_t n = mHalfSize;
+    mRe = (float *)malloc(n * sizeof(float));
+    mIm = (float *)malloc(n * sizeof(float));
+    // 6 arrays of L / 4 values per radix-4 stage of length L, at most 2 n in total
+    mTwiddles = (float *)malloc(2 * n * sizeof(float));
+    mIndex = (uint32_t *)malloc(n * sizeof(uint32_t));
+    mPostCos = (float *)malloc((n + 1) * sizeof(float));
+    mPostSin = (float *)malloc((n + 1) * sizeof(float));
+    if (mRe == NULL || mIm == NULL || mTwiddles == NULL || mIndex == NULL ||
+            mPostCos == NULL || mPostSin == NULL) {
+        return false;
+    }
+
+    float *tw = mTwiddles;
+    uint32_t length = n;
+    for (; length >= 4; length /= 4) {
+        const uint32_t quarter = length / 4;
+        for (uint32_t j = 0; j < quarter; j++) {
+            for (uint32_t m = 1; m <= 3; m++) {
+                const double phase = -2 * M_PI * m * j / length;
+                tw[(2 * m - 2) * quarter + j] = cos(phase);
+                tw[(2 * m - 1) * quarter + j] = sin(phase);
+            }
+        }
+        tw += 6 * quarter;
+    }
+    const bool radix2Stage = length == 2;
+
+    // Each stage splits its blocks into sub-blocks holding every 4th (or 2nd) frequency,
+    // so the frequency of a position is its digit reversal.
+    for (uint32_t position = 0; position < n; position++) {
+        uint32_t frequency = 0;
+        uint32_t weight = 1;
+        uint32_t remainder = position;
+        uint32_t block = n;
+        while (block > 1) {
+            const uint32_t radix = (block == 2 && radix2Stage) ? 2 : 4;
+            block /= radix;
+            frequency += (remainder / block) * weight;
+            remainder %= block;
+            weight *= radix;
+        }
+        mIndex[frequency] = position;
+    }
+
+    for (uint32_t k = 0; k <= n; k++) {
+        const double phase = 2 * M_PI * k / mSize;
+        mPostCos[k] = cos(phase);
+        mPostSin[k] = sin(phase);
+    }
+    return true;
+}
+
+// Decimation in frequency, in place on mRe and mIm.
+void FloatFft::complexFft() {
+    const uint32_t n = mHalfSize;
+    const float *tw = mTwiddles;
+    uint32_t length = n;
+    for (; length >= 4; length /= 4) {
+        const uint32_t quarter = length / 4;
+        const float *w1r = tw;
+        const float *w1i = tw + quarter;
+        const float *w2r = tw + 2 * quarter;
+        const float *w2i = tw + 3 * quarter;
+        const float *w3r = tw + 4 * quarter;
+        const float *w3i = tw + 5 * quarter;
+        for (uint32_t base = 0; base < n; base += length) {
+            float *r0 = mRe + base;
+            float *r1 = r0 + quarter;
+            float *r2 = r1 + quarter;
+            float *r3 = r2 + quarter;
+            float *i0 = mIm + base;
+            float *i1 = i0 + quarter;
+            float *i2 = i1 + quarter;
+            float *i3 = i2 + quarter;
+            uint32_t j = 0;
+#ifdef FLOAT_FFT_SIMD
+            for (; j + 4 <= quarter; j += 4) {
+                const fft_vec_t ar = vecLoad(r0 + j), ai = vecLoad(i0 + j);
+                const fft_vec_t br = vecLoad(r1 + j), bi = vecLoad(i1 + j);
+                const fft_vec_t cr = vecLoad(r2 + j), ci = vecLoad(i2 + j);
+                const fft_vec_t dr = vecLoad(r3 + j), di = vecLoad(i3 + j);
+                const fft_vec_t t0r = vecAdd(ar, cr), t0i = vecAdd(ai, ci);
+                const fft_vec_t t1r = vecSub(ar, cr), t1i = vecSub(ai, ci);
+                const fft_vec_t t2r = vecAdd(br, dr), t2i = vecAdd(bi, di);
+                const fft_vec_t t3r = vecSub(br, dr), t3i = vecSub(bi, di);
+                fft_vec_t y1r = vecAdd(t1r, t3i), y1i = vecSub(t1i, t3r);
+                fft_vec_t y2r = vecSub(t0r, t2r), y2i = vecSub(t0i, t2i);
+                fft_vec_t y3r = vecSub(t1r, t3i), y3i = vecAdd(t1i, t3r);
+                vecComplexMul(&y1r, &y1i, vecLoad(w1r + j), vecLoad(w1i + j));
+                vecComplexMul(&y2r, &y2i, vecLoad(w2r + j), vecLoad(w2i + j));
+                vecComplexMul(&y3r, &y3i, vecLoad(w3r + j), vecLoad(w3i + j));
+                vecStore(r0 + j, vecAdd(t0r, t2r));
+                vecStore(i0 + j, vecAdd(t0i, t2i));
+                vecStore(r1 + j, y1r);
+                vecStore(i1 + j, y1i);
+                vecStore(r2 + j, y2r);
+                vecStore(i2 + j, y2i);
+                vecStore(r3 + j, y3r);
+                vecStore(i3 + j, y3i);
+            }
+#endif
+            for (; j < quarter; j++) {
+                const float t0r = r0[j] + r2[j], t0i = i0[j] + i2[j];
+                const float t1r = r0[j] - r2[j], t1i = i0[j] - i2[j];
+                const float t2r = r1[j] + r3[j], t2i = i1[j] + i3[j];
+                const float t3r = r1[j] - r3[j], t3i = i1[j] - i3[j];
+                // leg m is multiplied by (-i)^(l m) for input l, then by w^(m j)
+                const float y1r = t1r + t3i, y1i = t1i - t3r;
+                const float y2r = t0r - t2r, y2i = t0i - t2i;
+                const float y3r = t1r - t3i, y3i = t1i + t3r;
+                r0[j] = t0r + t2r;
+                i0[j] = t0i + t2i;
+                r1[j] = y1r * w1r[j] - y1i * w1i[j];
+                i1[j] = y1r * w1i[j] + y1i * w1r[j];
+                r2[j] = y2r * w2r[j] - y2i * w2i[j];
+                i2[j] = y2r * w2i[j] + y2i * w2r[j];
+                r3[j] = y3r * w3r[j] - y3i * w3i[j];
+                i3[j] = y3r * w3i[j] + y3i * w3r[j];
+            }
+        }
+        tw += 6 * quarter;
+    }
+    if (length == 2) {
+        for (uint32_t base = 0; base < n; base += 2) {
+            const float ar = mRe[base], ai = mIm[base];
+            const float br = mRe[base + 1], bi = mIm[base + 1];
+            mRe[base] = ar + br;
+            mIm[base] = ai + bi;
+            mRe[base + 1] = ar - br;
+            mIm[base + 1] = ai - bi;
+        }
+    }
+}
+
+void FloatFft::forward(const float *in, float *spectrum) {
+    const uint32_t n = mHalfSize;
+    // even samples as the real part and odd ones as the imaginary part
+    for (uint32_t i = 0; i < n; i++) {
+        mRe[i] = in[2 * i];
+        mIm[i] = in[2 * i + 1];
+    }
+
+    complexFft();
+
+    // X[k] = E[k] + e^(-2 pi i k / size) O[k], with E and O the spectra of the even and
+    // odd samples, obtained from Z[k] and conj(Z[n - k]).
+    for (uint32_t k = 0; k <= n; k++) {
+        const uint32_t p = mIndex[k & (n - 1)];
+        const uint32_t q = mIndex[(n - k) & (n - 1)];
+        const float zr = mRe[p], zi = mIm[p];
+        const float cr = mRe[q], ci = -mIm[q];
+        const float er = 0.5f * (zr + cr), ei = 0.5f * (zi + ci);
+        const float or_ = 0.5f * (zi - ci), oi = -0.5f * (zr - cr);
+        spectrum[2 * k] = er + mPostCos[k] * or_ + mPostSin[k] * oi;
+        spectrum[2 * k + 1] = ei + mPostCos[k] * oi - mPostSin[k] * or_;
+    }
+}
+
+}  // namespace android
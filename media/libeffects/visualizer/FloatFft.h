@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_FLOAT_FFT_H
+#define ANDROID_FLOAT_FFT_H
+
+#include <stdint.h>
+
+namespace android {
+
+// Forward FFT of real float samples.
+//
+// The size/2 point complex FFT behind it is done in radix-4 stages, plus one radix-2 stage
+// when log2(size/2) is odd, on separate real and imaginary arrays so that the butterflies of
+// a stage are computed four at a time with NEON or SSE. The output stays in digit reversed
+// order and is read through an index table when the real spectrum is unpacked.
+class FloatFft {
+public:
+    // size must be a power of 2 in [kMinSize, kMaxSize]
+    static const uint32_t kMinSize = 8;
+    static const uint32_t kMaxSize = 65536;
+
+    // Returns NULL if size is not valid or memory is short.
+    static FloatFft *create(uint32_t size);
+    ~FloatFft();
+
+    uint32_t size() const { return mSize; }
+
+    // Transforms size() samples into size()/2 + 1 complex bins from DC to half the sampling
+    // rate, interleaved real and imaginary parts. The result is not scaled.
+    void forward(const float *in, float *spectrum);
+
+private:
+    explicit FloatFft(uint32_t size);
+    bool init();
+    void complexFft();
+
+    const uint32_t mSize;       // real samples
+    const uint32_t mHalfSize;   // complex points
+    float *mRe;                 // mHalfSize points being transformed
+    float *mIm;
+    float *mTwiddles;           // for each radix-4 stage, w^j, w^2j and w^3j, real then imag
+    uint32_t *mIndex;           // position of each frequency in the digit reversed output
+    float *mPostCos;            // e^(-2 pi i k / mSize) for the real spectrum unpacking
+    float *mPostSin;
+
+    FloatFft(const FloatFft &);
+    FloatFft &operator=(const FloatFft &);
+};
+
+}  // namespace android
+
+#endif  // ANDROID_FLOAT_FFT_H
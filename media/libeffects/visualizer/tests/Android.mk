@@ -0,0 +1,26 @@
+# Build the unit tests for the visualizer float FFT
+LOCAL_PATH:= $(call my-dir)
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+	visualizer_fft_tests.cpp \
+	../EffectVisualizer.cpp \
+	../FloatFft.cpp
+
+LOCAL_SHARED_LIBRARIES := \
+	liblog \
+	libcutils \
+	libaudioutils
+
+LOCAL_C_INCLUDES := \
+	$(LOCAL_PATH)/.. \
+	$(call include-path-for, audio-effects) \
+	$(call include-path-for, audio-utils) \
+	frameworks/av/include
+
+LOCAL_MODULE := visualizer_fft_tests
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_CFLAGS := -Werror -Wall
+
+include $(BUILD_NATIVE_TEST)
@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "visualizer_fft_tests"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include <audio_utils/fixedfft.h>
+#include <cutils/log.h>
+#include <gtest/gtest.h>
+#include <hardware/audio_effect.h>
+#include <media/EffectVisualizerApi.h>
+
+#include "FloatFft.h"
+
+using namespace android;
+
+// The visualizer effect is compiled into this test.
+extern "C" audio_effect_library_t AUDIO_EFFECT_LIBRARY_INFO_SYM;
+
+static const uint32_t kSampleRate = 48000;
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+TEST(float_fft, sizes) {
+    EXPECT_TRUE(FloatFft::create(4) == NULL);
+    EXPECT_TRUE(FloatFft::create(1000) == NULL);
+    EXPECT_TRUE(FloatFft::create(2 * FloatFft::kMaxSize) == NULL);
+    for (uint32_t size = FloatFft::kMinSize; size <= FloatFft::kMaxSize; size *= 2) {
+        FloatFft *fft = FloatFft::create(size);
+        ASSERT_TRUE(fft != NULL) << "size=" << size;
+        EXPECT_EQ(size, fft->size());
+        delete fft;
+    }
+}
+
+// Compares with a DFT computed in double, for sizes with and without a radix-2 stage.
+TEST(float_fft, accuracy) {
+    for (uint32_t size = FloatFft::kMinSize; size <= 4096; size *= 2) {
+        std::vector<float> in(size);
+        for (uint32_t i = 0; i < size; i++) {
+            in[i] = rand() / (float)RAND_MAX * 2 - 1;
+        }
+        FloatFft *fft = FloatFft::create(size);
+        ASSERT_TRUE(fft != NULL);
+        std::vector<float> spectrum(size + 2);
+        fft->forward(&in[0], &spectrum[0]);
+        delete fft;
+
+        double signal = 0;
+        double error = 0;
+        for (uint32_t k = 0; k <= size / 2; k++) {
+            double re = 0;
+            double im = 0;
+            for (uint32_t i = 0; i < size; i++) {
+                const double phase = -2 * M_PI * (double)k * i / size;
+                re += in[i] * cos(phase);
+                im += in[i] * sin(phase);
+            }
+            signal += re * re + im * im;
+            error += (re - spectrum[2 * k]) * (re - spectrum[2 * k]) +
+                    (im - spectrum[2 * k + 1]) * (im - spectrum[2 * k + 1]);
+        }
+        EXPECT_GT(10 * log10(signal / error), 120.) << "size=" << size;
+    }
+}
+
+static int command(effect_handle_t handle, uint32_t cmdCode, uint32_t cmdSize, void *cmdData,
+        uint32_t replySize, void *replyData) {
+    return (*handle)->command(handle, cmdCode, cmdSize, cmdData, &replySize, replyData);
+}
+
+static int setParam(effect_handle_t handle, uint32_t param, uint32_t value) {
+    uint32_t buf32[sizeof(effect_param_t) / sizeof(uint32_t) + 2];
+    effect_param_t *p = (effect_param_t *)buf32;
+    p->psize = sizeof(uint32_t);
+    p->vsize = sizeof(uint32_t);
+    *(uint32_t *)p->data = param;
+    *((uint32_t *)p->data + 1) = value;
+    int reply = 0;
+    int status = command(handle, EFFECT_CMD_SET_PARAM, sizeof(buf32), p, sizeof(reply), &reply);
+    return status != 0 ? status : reply;
+}
+
+class VisualizerTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        static const effect_uuid_t kVisualizerUuid =
+            { 0xd069d9e0, 0x8329, 0x11df, 0x9168, { 0x00, 0x02, 0xa5, 0xd5, 0xc5, 0x1b } };
+        ASSERT_EQ(0, AUDIO_EFFECT_LIBRARY_INFO_SYM.create_effect(&kVisualizerUuid, 0, 0,
+                &mHandle));
+
+        effect_config_t config;
+        memset(&config, 0, sizeof(config));
+        config.inputCfg.samplingRate = config.outputCfg.samplingRate = kSampleRate;
+        config.inputCfg.channels = config.outputCfg.channels = AUDIO_CHANNEL_OUT_STEREO;
+        config.inputCfg.format = config.outputCfg.format = AUDIO_FORMAT_PCM_16_BIT;
+        config.inputCfg.accessMode = EFFECT_BUFFER_ACCESS_READ;
+        config.outputCfg.accessMode = EFFECT_BUFFER_ACCESS_WRITE;
+        int reply = -1;
+        ASSERT_EQ(0, command(mHandle, EFFECT_CMD_SET_CONFIG, sizeof(config), &config,
+                sizeof(reply), &reply));
+        ASSERT_EQ(0, reply);
+        ASSERT_EQ(0, command(mHandle, EFFECT_CMD_ENABLE, 0, NULL, sizeof(reply), &reply));
+        ASSERT_EQ(0, reply);
+    }
+
+    virtual void TearDown() {
+        EXPECT_EQ(0, AUDIO_EFFECT_LIBRARY_INFO_SYM.release_effect(mHandle));
+    }
+
+    // Plays a full scale sine on both channels for half a second.
+    void playSine(double frequency) {
+        static const size_t kBlockFrames = 256;
+        std::vector<int16_t> block(2 * kBlockFrames);
+        std::vector<int16_t> out(block.size());
+        size_t frame = 0;
+        for (size_t i = 0; i < kSampleRate / 2 / kBlockFrames; i++) {
+            for (size_t j = 0; j < kBlockFrames; j++, frame++) {
+                block[2 * j] = block[2 * j + 1] =
+                        (int16_t)lrint(32767 * sin(2 * M_PI * frequency * frame / kSampleRate));
+            }
+            audio_buffer_t inBuffer, outBuffer;
+            inBuffer.frameCount = outBuffer.frameCount = kBlockFrames;
+            inBuffer.s16 = &block[0];
+            outBuffer.s16 = &out[0];
+            ASSERT_EQ(0, (*mHandle)->process(mHandle, &inBuffer, &outBuffer));
+        }
+    }
+
+    effect_handle_t mHandle;
+};
+
+TEST_F(VisualizerTest, params) {
+    float magnitudes[VISUALIZER_FLOAT_CAPTURE_SIZE_MIN / 2 + 1];
+    // the float capture is disabled by default
+    EXPECT_NE(0, command(mHandle, VISUALIZER_CMD_CAPTURE_FFT_FLOAT, 0, NULL,
+            sizeof(magnitudes), magnitudes));
+
+    EXPECT_NE(0, setParam(mHandle, VISUALIZER_PARAM_FLOAT_CAPTURE_SIZE, 1000));
+    EXPECT_NE(0, setParam(mHandle, VISUALIZER_PARAM_FLOAT_CAPTURE_SIZE,
+            2 * VISUALIZER_FLOAT_CAPTURE_SIZE_MAX));
+    EXPECT_NE(0, setParam(mHandle, VISUALIZER_PARAM_WINDOW, VISUALIZER_WINDOW_BLACKMAN + 1));
+    EXPECT_EQ(0, setParam(mHandle, VISUALIZER_PARAM_FLOAT_CAPTURE_SIZE,
+            VISUALIZER_FLOAT_CAPTURE_SIZE_MIN));
+    EXPECT_EQ(0, command(mHandle, VISUALIZER_CMD_CAPTURE_FFT_FLOAT, 0, NULL,
+            sizeof(magnitudes), magnitudes));
+    EXPECT_NE(0, command(mHandle, VISUALIZER_CMD_CAPTURE_FFT_FLOAT, 0, NULL,
+            sizeof(magnitudes) - sizeof(float), magnitudes));
+    EXPECT_EQ(0, setParam(mHandle, VISUALIZER_PARAM_FLOAT_CAPTURE_SIZE, 0));
+}
+
+TEST_F(VisualizerTest, float_fft) {
+    static const uint32_t kCaptureSize = 4096;
+    static const uint32_t kBin = 85;
+    ASSERT_EQ(0, setParam(mHandle, VISUALIZER_PARAM_FLOAT_CAPTURE_SIZE, kCaptureSize));
+
+    static const uint32_t kWindows[] = { VISUALIZER_WINDOW_RECTANGULAR, VISUALIZER_WINDOW_HANN,
+            VISUALIZER_WINDOW_HAMMING, VISUALIZER_WINDOW_BLACKMAN };
+    for (size_t w = 0; w < sizeof(kWindows) / sizeof(kWindows[0]); w++) {
+        ASSERT_EQ(0, setParam(mHandle, VISUALIZER_PARAM_WINDOW, kWindows[w]));
+        playSine(kBin * (double)kSampleRate / kCaptureSize);
+
+        std::vector<float> magnitudes(kCaptureSize / 2 + 1);
+        ASSERT_EQ(0, command(mHandle, VISUALIZER_CMD_CAPTURE_FFT_FLOAT, 0, NULL,
+                magnitudes.size() * sizeof(float), &magnitudes[0]));
+        EXPECT_NEAR(1.0, magnitudes[kBin], 0.001) << "window " << kWindows[w];
+        for (size_t k = 0; k < magnitudes.size(); k++) {
+            if (k + 3 < kBin || k > kBin + 3) {
+                ASSERT_LT(magnitudes[k], 0.001) << "window " << kWindows[w] << " bin " << k;
+            }
+        }
+    }
+}
+
+TEST_F(VisualizerTest, measure_bands) {
+    ASSERT_EQ(0, setParam(mHandle, VISUALIZER_PARAM_FLOAT_CAPTURE_SIZE, 8192));
+    // the center of the 6th band
+    playSine(1000);
+
+    visualizer_band_measurement_t measurement;
+    ASSERT_EQ(0, command(mHandle, VISUALIZER_CMD_MEASURE_BANDS, 0, NULL, sizeof(measurement),
+            &measurement));
+    // a full scale sine is at 0 dB peak and -3 dB RMS
+    EXPECT_NEAR(0, measurement.peakMb, 10);
+    EXPECT_NEAR(-301, measurement.rmsMb, 10);
+    for (int i = 0; i < VISUALIZER_BAND_COUNT; i++) {
+        if (i == 5) {
+            EXPECT_NEAR(-301, measurement.bandMb[i], 10);
+        } else {
+            EXPECT_LT(measurement.bandMb[i], -6000) << "band " << i;
+        }
+    }
+
+    // silence once disabled
+    int reply = -1;
+    ASSERT_EQ(0, command(mHandle, EFFECT_CMD_DISABLE, 0, NULL, sizeof(reply), &reply));
+    ASSERT_EQ(0, command(mHandle, VISUALIZER_CMD_MEASURE_BANDS, 0, NULL, sizeof(measurement),
+            &measurement));
+    EXPECT_EQ(-9600, measurement.peakMb);
+    EXPECT_EQ(-9600, measurement.bandMb[5]);
+}
+
+/* Benchmark
+ *
+ * Reports the time of one transform of the float FFT at different sizes, next to the
+ * fixed point FFT used by Visualizer::getFft() at its maximum capture size.
+ */
+TEST(float_fft, benchmark) {
+    static const int kIterations = 2000;
+    static const uint32_t kFixedSize = 1024;
+
+    std::vector<int32_t> fixedIn(kFixedSize / 2);
+    for (size_t i = 0; i < fixedIn.size(); i++) {
+        fixedIn[i] = (rand() << 16) | (rand() & 0xffff);
+    }
+    std::vector<int32_t> work(fixedIn.size());
+    double start = nowSeconds();
+    for (int i = 0; i < kIterations; i++) {
+        work = fixedIn;
+        fixed_fft_real(kFixedSize / 2, &work[0]);
+    }
+    const double fixedUs = (nowSeconds() - start) / kIterations * 1e6;
+    printf("%-24s %10s\n", "transform", "us");
+    printf("fixed_fft_real %-9u %10.2f\n", kFixedSize, fixedUs);
+
+    for (uint32_t size = 1024; size <= VISUALIZER_FLOAT_CAPTURE_SIZE_MAX; size *= 4) {
+        FloatFft *fft = FloatFft::create(size);
+        ASSERT_TRUE(fft != NULL);
+        std::vector<float> in(size);
+        for (size_t i = 0; i < size; i++) {
+            in[i] = rand() / (float)RAND_MAX * 2 - 1;
+        }
+        std::vector<float> spectrum(size + 2);
+        start = nowSeconds();
+        for (int i = 0; i < kIterations; i++) {
+            fft->forward(&in[0], &spectrum[0]);
+        }
+        const double floatUs = (nowSeconds() - start) / kIterations * 1e6;
+        printf("FloatFft %-15u %10.2f\n", size, floatUs);
+        delete fft;
+    }
+}
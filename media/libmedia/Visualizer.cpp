@@ -45,6 +45,8 @@ Visualizer::Visualizer (const String16& opPackageName,
         mSampleRate(44100000),
         mScalingMode(VISUALIZER_SCALING_MODE_NORMALIZED),
         mMeasurementMode(MEASUREMENT_MODE_NONE),
+        mFloatCaptureSize(0),
+        mWindow(VISUALIZER_WINDOW_HANN),
         mCaptureCallBack(NULL),
         mCaptureCbkUser(NULL)
 {
@@ -328,6 +330,101 @@ status_t Visualizer::doFft(uint8_t *fft, uint8_t *waveform)
     return NO_ERROR;
 }
 
+status_t Visualizer::setFloatCaptureSize(uint32_t size)
+{
+    if (size != 0 &&
+        (size > VISUALIZER_FLOAT_CAPTURE_SIZE_MAX ||
+         size < VISUALIZER_FLOAT_CAPTURE_SIZE_MIN ||
+         popcount(size) != 1)) {
+        return BAD_VALUE;
+    }
+
+    Mutex::Autolock _l(mCaptureLock);
+    status_t status = setUint32Parameter(VISUALIZER_PARAM_FLOAT_CAPTURE_SIZE, size);
+    ALOGV("setFloatCaptureSize size %d status %d", size, status);
+    if (status == NO_ERROR) {
+        mFloatCaptureSize = size;
+    }
+    return status;
+}
+
+status_t Visualizer::setWindow(uint32_t window)
+{
+    if (window > VISUALIZER_WINDOW_BLACKMAN) {
+        return BAD_VALUE;
+    }
+
+    Mutex::Autolock _l(mCaptureLock);
+    status_t status = setUint32Parameter(VISUALIZER_PARAM_WINDOW, window);
+    ALOGV("setWindow window %d status %d", window, status);
+    if (status == NO_ERROR) {
+        mWindow = window;
+    }
+    return status;
+}
+
+status_t Visualizer::getFloatFft(float *magnitudes)
+{
+    if (magnitudes == NULL) {
+        return BAD_VALUE;
+    }
+    if (mFloatCaptureSize == 0) {
+        return NO_INIT;
+    }
+
+    status_t status = NO_ERROR;
+    uint32_t replySize = (mFloatCaptureSize / 2 + 1) * sizeof(float);
+    if (mEnabled) {
+        status = command(VISUALIZER_CMD_CAPTURE_FFT_FLOAT, 0, NULL, &replySize, magnitudes);
+        ALOGV("getFloatFft() command returned %d", status);
+        if ((status == NO_ERROR) && (replySize == 0)) {
+            status = NOT_ENOUGH_DATA;
+        }
+    } else {
+        ALOGV("getFloatFft() disabled");
+        memset(magnitudes, 0, replySize);
+    }
+    return status;
+}
+
+status_t Visualizer::getBandMeasurements(visualizer_band_measurement_t *measurement)
+{
+    if (measurement == NULL) {
+        return BAD_VALUE;
+    }
+    if (mFloatCaptureSize == 0) {
+        return NO_INIT;
+    }
+    if (!mEnabled) {
+        ALOGV("getBandMeasurements() disabled");
+        return INVALID_OPERATION;
+    }
+
+    uint32_t replySize = sizeof(visualizer_band_measurement_t);
+    status_t status = command(VISUALIZER_CMD_MEASURE_BANDS, 0, NULL, &replySize, measurement);
+    ALOGV("getBandMeasurements() command returned %d", status);
+    if ((status == NO_ERROR) && (replySize == 0)) {
+        status = NOT_ENOUGH_DATA;
+    }
+    return status;
+}
+
+status_t Visualizer::setUint32Parameter(int32_t param, uint32_t value)
+{
+    uint32_t buf32[sizeof(effect_param_t) / sizeof(uint32_t) + 2];
+    effect_param_t *p = (effect_param_t *)buf32;
+
+    p->psize = sizeof(uint32_t);
+    p->vsize = sizeof(uint32_t);
+    *(int32_t *)p->data = param;
+    *((uint32_t *)p->data + 1) = value;
+    status_t status = setParameter(p);
+    if (status == NO_ERROR) {
+        status = p->status;
+    }
+    return status;
+}
+
 void Visualizer::periodicCapture()
 {
     Mutex::Autolock _l(mCaptureLock);
@@ -398,6 +495,9 @@ void Visualizer::controlStatusChanged(bool controlGranted) {
         setScalingMode(mScalingMode);
         ALOGV("    capture size reset to %d", mCaptureSize);
         setCaptureSize(mCaptureSize);
+        ALOGV("    float capture size reset to %d, window to %d", mFloatCaptureSize, mWindow);
+        setFloatCaptureSize(mFloatCaptureSize);
+        setWindow(mWindow);
     }
     AudioEffect::controlStatusChanged(controlGranted);
 }
@@ -584,6 +584,20 @@ void NuPlayer::GenericSource::disconnect() {
     }
 }
 
+sp<AMessage> NuPlayer::GenericSource::getCacheStats() {
+    sp<DataSource> dataSource;
+    {
+        Mutex::Autolock _l(mDisconnectLock);
+        dataSource = mDataSource;
+    }
+
+    if (dataSource != NULL
+            && (dataSource->flags() & DataSource::kIsCachingDataSource)) {
+        return static_cast<NuCachedSource2 *>(dataSource.get())->getStats();
+    }
+    return NULL;
+}
+
 void NuPlayer::GenericSource::setDrmPlaybackStatusIfNeeded(int playbackStatus, int64_t position) {
     if (mDecryptHandle != NULL) {
         mDrmManagerClient->setPlaybackStatus(mDecryptHandle, playbackStatus, position);
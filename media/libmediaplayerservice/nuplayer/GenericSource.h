@@ -79,6 +79,8 @@ struct NuPlayer::GenericSource : public NuPlayer::Source {
 
     virtual void setOffloadAudio(bool offload);
 
+    virtual sp<AMessage> getCacheStats();
+
 protected:
     virtual ~GenericSource();
 
@@ -1963,6 +1963,13 @@ void NuPlayer::getStats(Vector<sp<AMessage> > *mTrackStats) {
     }
 }
 
+sp<AMessage> NuPlayer::getCacheStats() {
+    if (mSource == NULL) {
+        return NULL;
+    }
+    return mSource->getCacheStats();
+}
+
 sp<MetaData> NuPlayer::getFileMeta() {
     return mSource->getFileFormatMeta();
 }
@@ -701,6 +701,34 @@ status_t NuPlayerDriver::dump(
         }
     }
 
+    sp<AMessage> cacheStats = mPlayer->getCacheStats();
+    if (cacheStats != NULL) {
+        int64_t numReads = 0, numHits = 0, bytesFetched = 0, bytesRefetched = 0;
+        int64_t numNewRanges = 0;
+        int32_t numRanges = 0, kbps = -1;
+        size_t readAheadBytes = 0;
+        cacheStats->findInt64("reads", &numReads);
+        cacheStats->findInt64("cache-hits", &numHits);
+        cacheStats->findInt64("bytes-fetched", &bytesFetched);
+        cacheStats->findInt64("bytes-refetched", &bytesRefetched);
+        cacheStats->findInt64("new-ranges", &numNewRanges);
+        cacheStats->findInt32("num-ranges", &numRanges);
+        cacheStats->findSize("read-ahead-bytes", &readAheadBytes);
+        cacheStats->findInt32("bandwidth-kbps", &kbps);
+
+        snprintf(buf, sizeof(buf), "  cache\n    reads(%lld), hitRate(%.2f%%), "
+                 "newRanges(%lld), cachedRanges(%d)\n",
+                 (long long)numReads,
+                 numReads == 0 ? 0.0 : (double)(numHits * 100) / numReads,
+                 (long long)numNewRanges, numRanges);
+        logString.append(buf);
+        snprintf(buf, sizeof(buf), "    bytesFetched(%lld), bytesRefetched(%lld), "
+                 "readAhead(%zu KB), bandwidth(%d kbps)\n",
+                 (long long)bytesFetched, (long long)bytesRefetched,
+                 readAheadBytes / 1024, kbps);
+        logString.append(buf);
+    }
+
     ALOGI("%s", logString.c_str());
 
     if (fd >= 0) {
@@ -123,6 +123,11 @@ struct NuPlayer::Source : public AHandler {
 
     virtual void setOffloadAudio(bool /* offload */) {}
 
+    // Statistics of the source's data cache, if it has one.
+    virtual sp<AMessage> getCacheStats() {
+        return NULL;
+    }
+
 protected:
     virtual ~Source() {}
 
@@ -34,3 +34,5 @@ LOCAL_C_INCLUDES := $(call include-path-for, audio-utils)
 LOCAL_CFLAGS := -Werror -Wall
 
 include $(BUILD_SHARED_LIBRARY)
+
+include $(call all-makefiles-under,$(LOCAL_PATH))
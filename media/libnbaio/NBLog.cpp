@@ -25,24 +25,19 @@
 #include <new>
 #include <cutils/atomic.h>
 #include <media/nbaio/NBLog.h>
+#include <utils/KeyedVector.h>
 #include <utils/Log.h>
 #include <utils/String8.h>
 
 namespace android {
 
-int NBLog::Entry::readAt(size_t offset) const
+size_t NBLog::Entry::copyTo(uint8_t *buffer) const
 {
-    // FIXME This is too slow, despite the name it is used during writing
-    if (offset == 0)
-        return mEvent;
-    else if (offset == 1)
-        return mLength;
-    else if (offset < (size_t) (mLength + 2))
-        return ((char *) mData)[offset - 2];
-    else if (offset == (size_t) (mLength + 2))
-        return mLength;
-    else
-        return 0;
+    buffer[0] = mEvent;
+    buffer[1] = mLength;
+    memcpy(&buffer[2], mData, mLength);
+    buffer[mLength + 2] = mLength;
+    return mLength + 3;
 }
 
 // ---------------------------------------------------------------------------
@@ -147,6 +142,42 @@ void NBLog::Writer::logTimestamp(const struct timespec& ts)
     log(EVENT_TIMESTAMP, &ts, sizeof(struct timespec));
 }
 
+void NBLog::Writer::logEvent(int id, const int32_t *args, size_t argc)
+{
+    if (!mEnabled) {
+        return;
+    }
+    struct timespec ts;
+    if (!clock_gettime(CLOCK_MONOTONIC, &ts)) {
+        logEvent(id, ts, args, argc);
+    }
+}
+
+void NBLog::Writer::logEvent(int id, const struct timespec& ts, const int32_t *args,
+        size_t argc)
+{
+    if (!mEnabled) {
+        return;
+    }
+    if (id <= EVENT_ID_NONE || id > UINT16_MAX || (args == NULL && argc > 0)) {
+        return;
+    }
+    if (argc > kMaxEventArgs) {
+        argc = kMaxEventArgs;
+    }
+    uint8_t data[kBinaryHeaderSize + kMaxEventArgs * sizeof(int32_t)];
+    int64_t timestampNs = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    uint16_t id16 = id;
+    uint16_t argc16 = argc;
+    memcpy(&data[0], &timestampNs, sizeof(timestampNs));
+    memcpy(&data[8], &id16, sizeof(id16));
+    memcpy(&data[10], &argc16, sizeof(argc16));
+    if (argc > 0) {
+        memcpy(&data[kBinaryHeaderSize], args, argc * sizeof(int32_t));
+    }
+    log(EVENT_BINARY, data, kBinaryHeaderSize + argc * sizeof(int32_t));
+}
+
 void NBLog::Writer::log(Event event, const void *data, size_t length)
 {
     if (!mEnabled) {
@@ -158,6 +189,7 @@ void NBLog::Writer::log(Event event, const void *data, size_t length)
     switch (event) {
     case EVENT_STRING:
     case EVENT_TIMESTAMP:
+    case EVENT_BINARY:
         break;
     case EVENT_RESERVED:
     default:
@@ -176,26 +208,27 @@ void NBLog::Writer::log(const NBLog::Entry *entry, bool trusted)
         log(entry->mEvent, entry->mData, entry->mLength);
         return;
     }
+    logEntry(entry);
+}
+
+void NBLog::Writer::logEntry(const NBLog::Entry *entry)
+{
+    // re-check, as LockedWriter may have been disabled while this entry was being prepared
+    if (!mEnabled) {
+        return;
+    }
+    uint8_t buffer[255 + 3];            // mEvent, mLength, data[length], mLength
+    size_t need = entry->copyTo(buffer);
     size_t rear = mRear & (mSize - 1);
-    size_t written = mSize - rear;      // written = number of bytes that have been written so far
-    size_t need = entry->mLength + 3;   // mEvent, mLength, data[length], mLength
-                                        // need = number of bytes remaining to write
+    size_t written = mSize - rear;      // written = number of bytes that fit before wraparound
     if (written > need) {
         written = need;
     }
-    size_t i;
-    // FIXME optimize this using memcpy for the data part of the Entry.
-    // The Entry could have a method copyTo(ptr, offset, size) to optimize the copy.
-    for (i = 0; i < written; ++i) {
-        mShared->mBuffer[rear + i] = entry->readAt(i);
-    }
-    if (rear + written == mSize && (need -= written) > 0)  {
-        for (i = 0; i < need; ++i) {
-            mShared->mBuffer[i] = entry->readAt(written + i);
-        }
-        written += need;
+    memcpy(&mShared->mBuffer[rear], buffer, written);
+    if (written < need) {
+        memcpy(mShared->mBuffer, &buffer[written], need - written);
     }
-    android_atomic_release_store(mRear += written, &mShared->mRear);
+    android_atomic_release_store(mRear += need, &mShared->mRear);
 }
 
 bool NBLog::Writer::isEnabled() const
@@ -222,40 +255,10 @@ NBLog::LockedWriter::LockedWriter(size_t size, void *shared)
 {
 }
 
-void NBLog::LockedWriter::log(const char *string)
-{
-    Mutex::Autolock _l(mLock);
-    Writer::log(string);
-}
-
-void NBLog::LockedWriter::logf(const char *fmt, ...)
-{
-    // FIXME should not take the lock until after formatting is done
-    Mutex::Autolock _l(mLock);
-    va_list ap;
-    va_start(ap, fmt);
-    Writer::logvf(fmt, ap);
-    va_end(ap);
-}
-
-void NBLog::LockedWriter::logvf(const char *fmt, va_list ap)
-{
-    // FIXME should not take the lock until after formatting is done
-    Mutex::Autolock _l(mLock);
-    Writer::logvf(fmt, ap);
-}
-
-void NBLog::LockedWriter::logTimestamp()
-{
-    // FIXME should not take the lock until after the clock_gettime() syscall
-    Mutex::Autolock _l(mLock);
-    Writer::logTimestamp();
-}
-
-void NBLog::LockedWriter::logTimestamp(const struct timespec& ts)
+void NBLog::LockedWriter::logEntry(const NBLog::Entry *entry)
 {
     Mutex::Autolock _l(mLock);
-    Writer::logTimestamp(ts);
+    Writer::logEntry(entry);
 }
 
 bool NBLog::LockedWriter::isEnabled() const
@@ -335,6 +338,22 @@ void NBLog::Reader::dump(int fd, size_t indent)
             if (ts.tv_sec > maxSec) {
                 maxSec = ts.tv_sec;
             }
+        } else if (event == EVENT_BINARY) {
+            uint16_t argc;
+            if (length < kBinaryHeaderSize) {
+                // corrupt
+                break;
+            }
+            memcpy(&argc, &copy[i - length - 1 + 10], sizeof(argc));
+            if (argc > kMaxEventArgs || length != kBinaryHeaderSize + argc * sizeof(int32_t)) {
+                // corrupt
+                break;
+            }
+            int64_t timestampNs;
+            memcpy(&timestampNs, &copy[i - length - 1], sizeof(timestampNs));
+            if (timestampNs / 1000000000 > maxSec) {
+                maxSec = timestampNs / 1000000000;
+            }
         }
         i -= length + 3;
     }
@@ -357,6 +376,7 @@ void NBLog::Reader::dump(int fd, size_t indent)
         timestamp.appendFormat("[%*s]", (int) width + 4, "");
     }
     bool deferredTimestamp = false;
+    KeyedVector<int, EventStats> eventStats;
     while (i < avail) {
         event = (Event) copy[i];
         length = copy[i + 1];
@@ -416,6 +436,39 @@ void NBLog::Reader::dump(int fd, size_t indent)
                     (int) (ts.tv_nsec / 1000000));
             deferredTimestamp = true;
             } break;
+        case EVENT_BINARY: {
+            // already checked the length and argument count
+            int64_t timestampNs;
+            uint16_t id, argc;
+            int32_t args[kMaxEventArgs];
+            memcpy(&timestampNs, data, sizeof(timestampNs));
+            memcpy(&id, &copy[i + 2 + 8], sizeof(id));
+            memcpy(&argc, &copy[i + 2 + 10], sizeof(argc));
+            memcpy(args, &copy[i + 2 + kBinaryHeaderSize], argc * sizeof(int32_t));
+            if (deferredTimestamp) {
+                dumpLine(timestamp, body);
+                deferredTimestamp = false;
+            }
+            // the event carries its own timestamp, which is shown for this line only
+            String8 eventTimestamp;
+            eventTimestamp.appendFormat("[%d.%03d]", (int) (timestampNs / 1000000000),
+                    (int) (timestampNs % 1000000000 / 1000000));
+            const char *name = eventIdName(id);
+            if (name != NULL) {
+                body.append(name);
+            } else {
+                body.appendFormat("event %u", id);
+            }
+            for (size_t j = 0; j < argc; ++j) {
+                body.appendFormat(" %d", args[j]);
+            }
+            dumpLine(eventTimestamp, body);
+            ssize_t index = eventStats.indexOfKey(id);
+            if (index < 0) {
+                index = eventStats.add(id, EventStats());
+            }
+            eventStats.editValueAt(index).add(timestampNs, args, argc);
+            } break;
         case EVENT_RESERVED:
         default:
             body.appendFormat("warning: unknown event %d", event);
@@ -431,6 +484,11 @@ void NBLog::Reader::dump(int fd, size_t indent)
     if (deferredTimestamp) {
         dumpLine(timestamp, body);
     }
+    timestamp.clear();
+    for (size_t j = 0; j < eventStats.size(); ++j) {
+        eventStats.valueAt(j).dump(body, eventStats.keyAt(j));
+        dumpLine(timestamp, body);
+    }
     // FIXME it would be more efficient to put a char mCopy[256] as a member variable of the dumper
     delete[] copy;
 }
@@ -445,6 +503,85 @@ void NBLog::Reader::dumpLine(const String8& timestamp, String8& body)
     body.clear();
 }
 
+/*static*/
+const char *NBLog::Reader::eventIdName(int id)
+{
+    switch (id) {
+    case EVENT_ID_UNDERRUN:
+        return "underrun";
+    case EVENT_ID_OVERRUN:
+        return "overrun";
+    case EVENT_ID_WARMUP:
+        return "warmup";
+    default:
+        return NULL;
+    }
+}
+
+NBLog::Reader::EventStats::EventStats()
+    : mCount(0), mLastNs(0), mIntervalMinNs(INT64_MAX), mIntervalMaxNs(0), mIntervalTotalNs(0),
+      mArgCount(0), mArgMin(INT32_MAX), mArgMax(INT32_MIN), mArgTotal(0)
+{
+    memset(mIntervalHistogram, 0, sizeof(mIntervalHistogram));
+}
+
+void NBLog::Reader::EventStats::add(int64_t timestampNs, const int32_t *args, size_t argc)
+{
+    if (mCount > 0 && timestampNs >= mLastNs) {
+        int64_t interval = timestampNs - mLastNs;
+        if (interval < mIntervalMinNs) {
+            mIntervalMinNs = interval;
+        }
+        if (interval > mIntervalMaxNs) {
+            mIntervalMaxNs = interval;
+        }
+        mIntervalTotalNs += interval;
+        // bucket k counts intervals of [2^(k-1), 2^k) microseconds, bucket 0 less than 1 us
+        uint64_t us = interval / 1000;
+        size_t bucket = us == 0 ? 0 : 64 - __builtin_clzll(us);
+        if (bucket >= kHistogramBuckets) {
+            bucket = kHistogramBuckets - 1;
+        }
+        mIntervalHistogram[bucket]++;
+    }
+    mLastNs = timestampNs;
+    mCount++;
+    if (argc > 0) {
+        if (args[0] < mArgMin) {
+            mArgMin = args[0];
+        }
+        if (args[0] > mArgMax) {
+            mArgMax = args[0];
+        }
+        mArgTotal += args[0];
+        mArgCount++;
+    }
+}
+
+void NBLog::Reader::EventStats::dump(String8& body, int id) const
+{
+    const char *name = eventIdName(id);
+    if (name != NULL) {
+        body.appendFormat("summary of %s: %zu events", name, mCount);
+    } else {
+        body.appendFormat("summary of event %d: %zu events", id, mCount);
+    }
+    if (mCount > 1) {
+        body.appendFormat(", interval min %.3f mean %.3f max %.3f ms, histogram",
+                mIntervalMinNs * 1e-6, mIntervalTotalNs * 1e-6 / (mCount - 1),
+                mIntervalMaxNs * 1e-6);
+        for (size_t k = 0; k < kHistogramBuckets; ++k) {
+            if (mIntervalHistogram[k] != 0) {
+                body.appendFormat(" <%uus:%u", 1u << k, mIntervalHistogram[k]);
+            }
+        }
+    }
+    if (mArgCount > 0) {
+        body.appendFormat(", arg0 min %d mean %.1f max %d",
+                mArgMin, (double) mArgTotal / mArgCount, mArgMax);
+    }
+}
+
 bool NBLog::Reader::isIMemory(const sp<IMemory>& iMemory) const
 {
     return iMemory != 0 && mIMemory != 0 && iMemory->pointer() == mIMemory->pointer();
@@ -0,0 +1,19 @@
+# Build the unit tests.
+LOCAL_PATH:= $(call my-dir)
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := NBLog_test
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_SRC_FILES := \
+	NBLog_test.cpp
+
+LOCAL_SHARED_LIBRARIES := \
+	libnbaio \
+	libutils \
+	liblog
+
+LOCAL_CFLAGS := -Werror -Wall
+
+include $(BUILD_NATIVE_TEST)
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "NBLog_test"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <media/nbaio/NBLog.h>
+#include <utils/Log.h>
+
+namespace android {
+
+static struct timespec makeTs(time_t sec, long nsec) {
+    struct timespec ts;
+    ts.tv_sec = sec;
+    ts.tv_nsec = nsec;
+    return ts;
+}
+
+class NBLogTest : public ::testing::Test {
+protected:
+    void init(size_t size) {
+        // the shared memory starts zeroed, as the one allocated by AudioFlinger
+        mShared.assign(NBLog::Timeline::sharedSize(size), 0);
+        mWriter = new NBLog::Writer(size, &mShared[0]);
+        mReader = new NBLog::Reader(size, &mShared[0]);
+    }
+
+    // Returns the lines of a dump of the entries logged since the previous one.
+    std::vector<std::string> dumpLines() {
+        std::vector<std::string> lines;
+        FILE *file = tmpfile();
+        if (file == NULL) {
+            ADD_FAILURE() << "tmpfile() failed";
+            return lines;
+        }
+        mReader->dump(fileno(file));
+        rewind(file);
+        char line[1024];
+        while (fgets(line, sizeof(line), file) != NULL) {
+            lines.push_back(std::string(line, strcspn(line, "\n")));
+        }
+        fclose(file);
+        return lines;
+    }
+
+    std::vector<char> mShared;
+    sp<NBLog::Writer> mWriter;
+    sp<NBLog::Reader> mReader;
+};
+
+// Binary events come back with their identifier, timestamp and arguments, in order with the
+// other entries, followed by the statistics of each identifier.
+TEST_F(NBLogTest, events_round_trip) {
+    init(4096);
+    const int32_t underruns[] = { 5000000, 7000000, INT32_MAX };
+    const int32_t warmup[] = { 12, 345678 };
+    const int32_t user[] = { -1, 0, INT32_MIN, INT32_MAX };
+    mWriter->logEvent(NBLog::EVENT_ID_UNDERRUN, makeTs(100, 0), &underruns[0], 1);
+    mWriter->log("between events");
+    mWriter->logEvent(NBLog::EVENT_ID_UNDERRUN, makeTs(100, 10000000), &underruns[1], 1);
+    mWriter->logEvent(NBLog::EVENT_ID_UNDERRUN, makeTs(100, 30000000), &underruns[2], 1);
+    mWriter->logEvent(NBLog::EVENT_ID_WARMUP, makeTs(101, 500000000), warmup, 2);
+    mWriter->logEvent(NBLog::EVENT_ID_USER + 1, makeTs(101, 500250000), user, 4);
+    mWriter->logEvent(NBLog::EVENT_ID_USER + 1, makeTs(102, 0));
+
+    const char *expected[] = {
+        "[100.000] underrun 5000000",
+        "[       ] between events",
+        "[100.010] underrun 7000000",
+        "[100.030] underrun 2147483647",
+        "[101.500] warmup 12 345678",
+        "[101.500] event 257 -1 0 -2147483648 2147483647",
+        "[102.000] event 257",
+        " summary of underrun: 3 events, interval min 10.000 mean 15.000 max 20.000 ms, "
+                "histogram <16384us:1 <32768us:1, arg0 min 5000000 mean 719827882.3 "
+                "max 2147483647",
+        " summary of warmup: 1 events, arg0 min 12 mean 12.0 max 12",
+        " summary of event 257: 2 events, interval min 499.750 mean 499.750 max 499.750 ms, "
+                "histogram <524288us:1, arg0 min -1 mean -1.0 max -1",
+    };
+    std::vector<std::string> lines = dumpLines();
+    ASSERT_EQ(sizeof(expected) / sizeof(expected[0]), lines.size());
+    for (size_t i = 0; i < lines.size(); i++) {
+        EXPECT_EQ(expected[i], lines[i]);
+    }
+
+    // the next dump only has the new entries, and their own statistics;
+    // invalid identifiers are not logged
+    mWriter->logEvent(NBLog::EVENT_ID_NONE, makeTs(103, 0));
+    mWriter->logEvent(UINT16_MAX + 1, makeTs(103, 0));
+    const int32_t overrun = 1000;
+    mWriter->logEvent(NBLog::EVENT_ID_OVERRUN, makeTs(103, 1000000), &overrun, 1);
+    lines = dumpLines();
+    ASSERT_EQ(2u, lines.size());
+    EXPECT_EQ("[103.001] overrun 1000", lines[0]);
+    EXPECT_EQ(" summary of overrun: 1 events, arg0 min 1000 mean 1000.0 max 1000", lines[1]);
+
+    EXPECT_EQ(0u, dumpLines().size());
+}
+
+// When the writer laps the reader, the oldest events are lost but the newest ones that fit
+// are decoded intact, across the wraparound of the buffer.
+TEST_F(NBLogTest, events_wraparound) {
+    static const size_t kSize = 256;
+    static const int kEvents = 100;
+    // an entry is the event type, the length twice, and the binary event with one argument
+    static const size_t kEntrySize = 3 + 12 + sizeof(int32_t);
+    static const int kKept = kSize / kEntrySize;
+
+    init(kSize);
+    for (int32_t i = 0; i < kEvents; i++) {
+        mWriter->logEvent(NBLog::EVENT_ID_UNDERRUN, makeTs(0, i * 1000000), &i, 1);
+    }
+
+    std::vector<std::string> lines = dumpLines();
+    ASSERT_EQ((size_t) (kKept + 2), lines.size());
+    char expected[256];
+    snprintf(expected, sizeof(expected), " warning: lost %zu bytes worth of events",
+            kEvents * kEntrySize - kKept * kEntrySize);
+    EXPECT_EQ(expected, lines[0]);
+    for (int i = 0; i < kKept; i++) {
+        const int event = kEvents - kKept + i;
+        snprintf(expected, sizeof(expected), "[0.%03d] underrun %d", event, event);
+        EXPECT_EQ(expected, lines[i + 1]);
+    }
+    snprintf(expected, sizeof(expected), " summary of underrun: %d events, interval min 1.000 "
+            "mean 1.000 max 1.000 ms, histogram <1024us:%d, arg0 min %d mean %.1f max %d",
+            kKept, kKept - 1, kEvents - kKept, kEvents - (kKept + 1) / 2.0, kEvents - 1);
+    EXPECT_EQ(expected, lines[kKept + 1]);
+}
+
+} // namespace android
@@ -18,22 +18,77 @@
 #define LOG_TAG "FileSource"
 #include <utils/Log.h>
 
+#include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/FileSource.h>
 #include <media/stagefright/Utils.h>
+#include <cutils/properties.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 
 namespace android {
 
+// Do not take up more than a quarter of a 32-bit address space.
+static const uint64_t kMaxMappedSize =
+        sizeof(void *) > 4 ? INT64_MAX : (1ull << 30);
+
+// Keeps a mapping alive for as long as the source or any buffer returned by
+// getBufferAt() references it.
+struct FileSource::Mapping : public RefBase {
+    Mapping(void *base, size_t size)
+        : mBase(base),
+          mSize(size) {
+    }
+
+    void *mBase;
+    size_t mSize;
+
+protected:
+    virtual ~Mapping() {
+        munmap(mBase, mSize);
+    }
+
+private:
+    DISALLOW_EVIL_CONSTRUCTORS(Mapping);
+};
+
+static bool shouldMapFiles() {
+    return property_get_bool("media.stagefright.mmap-source", false);
+}
+
+// Whether a process of another user may truncate the file, e.g. the app that
+// passed its descriptor. Accessing a mapping past the new end of the file
+// raises SIGBUS, where pread64() would have failed.
+static bool canBeTruncatedByOthers(int fd) {
+#ifdef F_GET_SEALS
+    int seals = fcntl(fd, F_GET_SEALS);
+    if (seals >= 0 && (seals & F_SEAL_SHRINK) != 0) {
+        return false;
+    }
+#endif
+    struct stat s;
+    if (fstat(fd, &s) != 0 || !S_ISREG(s.st_mode)) {
+        return true;
+    }
+    // only the owner may write to the file, and the owner is trusted
+    if (s.st_uid != geteuid() && s.st_uid != 0) {
+        return true;
+    }
+    return (s.st_mode & (S_IWGRP | S_IWOTH)) != 0;
+}
+
 FileSource::FileSource(const char *filename)
     : mFd(-1),
       mOffset(0),
       mLength(-1),
       mName("<null>"),
+      mMappedData(NULL),
+      mAccessPattern(kAccessPatternNormal),
       mDecryptHandle(NULL),
       mDrmManagerClient(NULL),
       mDrmBufOffset(0),
@@ -48,6 +103,9 @@ FileSource::FileSource(const char *filename)
 
     if (mFd >= 0) {
         mLength = lseek64(mFd, 0, SEEK_END);
+        if (shouldMapFiles()) {
+            mapFile();
+        }
     } else {
         ALOGE("Failed to open file '%s'. (%s)", filename, strerror(errno));
     }
@@ -58,6 +116,8 @@ FileSource::FileSource(int fd, int64_t offset, int64_t length)
       mOffset(offset),
       mLength(length),
       mName("<null>"),
+      mMappedData(NULL),
+      mAccessPattern(kAccessPatternNormal),
       mDecryptHandle(NULL),
       mDrmManagerClient(NULL),
       mDrmBufOffset(0),
@@ -97,9 +157,16 @@ FileSource::FileSource(int fd, int64_t offset, int64_t length)
             (long long) mOffset,
             (long long) mLength);
 
+    if (shouldMapFiles()) {
+        mapFile();
+    }
 }
 
 FileSource::~FileSource() {
+    // Buffers returned by getBufferAt() may still reference the mapping.
+    mMappedData = NULL;
+    mMapping.clear();
+
     if (mFd >= 0) {
         ::close(mFd);
         mFd = -1;
@@ -147,15 +214,113 @@ ssize_t FileSource::readAt(off64_t offset, void *data, size_t size) {
     if (mDecryptHandle != NULL && DecryptApiType::CONTAINER_BASED
             == mDecryptHandle->decryptApiType) {
         return readAtDRM(offset, data, size);
-   } else {
-        off64_t result = lseek64(mFd, offset + mOffset, SEEK_SET);
+    } else if (mMappedData != NULL) {
+        if (offset < 0) {
+            return UNKNOWN_ERROR;
+        }
+        memcpy(data, mMappedData + offset, size);
+        return size;
+    } else {
+        ssize_t result = pread64(mFd, data, size, offset + mOffset);
         if (result == -1) {
-            ALOGE("seek to %lld failed", (long long)(offset + mOffset));
+            ALOGE("read at %lld failed (%s)",
+                    (long long)(offset + mOffset), strerror(errno));
             return UNKNOWN_ERROR;
         }
 
-        return ::read(mFd, data, size);
+        return result;
+    }
+}
+
+bool FileSource::mapFile() {
+    Mutex::Autolock autoLock(mLock);
+
+    if (mMappedData != NULL) {
+        return true;
+    }
+    if (mFd < 0 || mLength <= 0 || mDecryptHandle != NULL) {
+        return false;
+    }
+    if (canBeTruncatedByOthers(mFd)) {
+        ALOGV("not mapping %s, others may truncate it", mName.string());
+        return false;
+    }
+
+    // mmap() wants a page aligned file offset.
+    const off64_t pageSize = sysconf(_SC_PAGESIZE);
+    const off64_t start = mOffset - mOffset % pageSize;
+    const uint64_t size = (uint64_t)(mOffset - start) + (uint64_t)mLength;
+    if (size > kMaxMappedSize) {
+        ALOGV("not mapping %lld bytes", (long long)mLength);
+        return false;
+    }
+
+    // Read-only, so that the holder of a buffer returned by getBufferAt()
+    // cannot change what later reads of the same range return.
+    void *base = mmap64(NULL, size, PROT_READ, MAP_PRIVATE, mFd, start);
+    if (base == MAP_FAILED) {
+        ALOGW("failed to map %s (%s)", mName.string(), strerror(errno));
+        return false;
+    }
+
+    mMapping = new Mapping(base, size);
+    mMappedData = (const uint8_t *)base + (mOffset - start);
+    adviseAccessPattern_l();
+
+    ALOGV("mapped %lld bytes", (long long)mLength);
+    return true;
+}
+
+void FileSource::setAccessPattern(AccessPattern pattern) {
+    Mutex::Autolock autoLock(mLock);
+
+    if (mFd < 0 || pattern == mAccessPattern) {
+        return;
+    }
+    mAccessPattern = pattern;
+    adviseAccessPattern_l();
+}
+
+void FileSource::adviseAccessPattern_l() {
+    if (mMapping != NULL) {
+        int advice = MADV_NORMAL;
+        if (mAccessPattern == kAccessPatternSequential) {
+            advice = MADV_SEQUENTIAL;
+        } else if (mAccessPattern == kAccessPatternRandom) {
+            advice = MADV_RANDOM;
+        }
+        if (madvise(mMapping->mBase, mMapping->mSize, advice) != 0) {
+            ALOGV("madvise failed (%s)", strerror(errno));
+        }
+    } else {
+        int advice = POSIX_FADV_NORMAL;
+        if (mAccessPattern == kAccessPatternSequential) {
+            advice = POSIX_FADV_SEQUENTIAL;
+        } else if (mAccessPattern == kAccessPatternRandom) {
+            advice = POSIX_FADV_RANDOM;
+        }
+        // returns the error rather than setting errno
+        int err = posix_fadvise(mFd, mOffset, mLength, advice);
+        if (err != 0) {
+            ALOGV("posix_fadvise failed (%s)", strerror(err));
+        }
+    }
+}
+
+status_t FileSource::getBufferAt(off64_t offset, size_t size, sp<ABuffer> *buffer) {
+    Mutex::Autolock autoLock(mLock);
+
+    if (mMappedData == NULL) {
+        return ERROR_UNSUPPORTED;
     }
+    if (offset < 0 || offset > mLength || (uint64_t)size > (uint64_t)(mLength - offset)) {
+        return ERROR_END_OF_STREAM;
+    }
+
+    *buffer = new ABuffer(const_cast<uint8_t *>(mMappedData) + offset, size);
+    (*buffer)->meta()->setObject("mapping", mMapping);
+
+    return OK;
 }
 
 status_t FileSource::getSize(off64_t *size) {
@@ -184,6 +349,13 @@ sp<DecryptHandle> FileSource::DrmInitialization(const char *mime) {
                 mFd, mOffset, mLength, mime);
     }
 
+    if (mDecryptHandle != NULL) {
+        // Protected content is read through the DRM framework.
+        Mutex::Autolock autoLock(mLock);
+        mMappedData = NULL;
+        mMapping.clear();
+    }
+
     if (mDecryptHandle == NULL) {
         delete mDrmManagerClient;
         mDrmManagerClient = NULL;
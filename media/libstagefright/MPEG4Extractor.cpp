@@ -139,12 +139,18 @@ private:
 
     bool mIsAVC;
     bool mIsHEVC;
+    bool mIsAudio;
     size_t mNALLengthSize;
 
     bool mStarted;
 
     MediaBufferGroup *mGroup;
 
+    // Audio samples returned in place by the data source, see read(). They do
+    // not come from mGroup, but are limited to as many as it holds.
+    Vector<wp<ABuffer> > mInPlaceBuffers;
+    size_t mMaxInPlaceBuffers;
+
     MediaBuffer *mBuffer;
 
     bool mWantsNALFragments;
@@ -152,6 +158,7 @@ private:
     uint8_t *mSrcBuffer;
 
     size_t parseNALSize(const uint8_t *data) const;
+    bool canReturnInPlace_l();
     status_t parseChunk(off64_t *offset);
     status_t parseTrackFragmentHeader(off64_t offset, off64_t size);
     status_t parseTrackFragmentRun(off64_t offset, off64_t size);
@@ -3745,9 +3752,11 @@ MPEG4Source::MPEG4Source(
       mCurrentSampleInfoOffsets(NULL),
       mIsAVC(false),
       mIsHEVC(false),
+      mIsAudio(false),
       mNALLengthSize(0),
       mStarted(false),
       mGroup(NULL),
+      mMaxInPlaceBuffers(0),
       mBuffer(NULL),
       mWantsNALFragments(false),
       mSrcBuffer(NULL) {
@@ -3775,6 +3784,7 @@ MPEG4Source::MPEG4Source(
 
     mIsAVC = !strcasecmp(mime, MEDIA_MIMETYPE_VIDEO_AVC);
     mIsHEVC = !strcasecmp(mime, MEDIA_MIMETYPE_VIDEO_HEVC);
+    mIsAudio = !strncasecmp(mime, "audio/", 6);
 
     if (mIsAVC) {
         uint32_t type;
@@ -3856,6 +3866,7 @@ status_t MPEG4Source::start(MetaData *params) {
     const size_t kMaxBuffers = 8;
     const size_t buffers = min(kMaxBufferSize / max_size, kMaxBuffers);
     mGroup = new MediaBufferGroup(buffers, max_size);
+    mMaxInPlaceBuffers = buffers;
     mSrcBuffer = new (std::nothrow) uint8_t[max_size];
     if (mSrcBuffer == NULL) {
         // file probably specified a bad max size
@@ -3864,6 +3875,9 @@ status_t MPEG4Source::start(MetaData *params) {
         return ERROR_MALFORMED;
     }
 
+    // Samples are mostly read in file order from here on.
+    mDataSource->setAccessPattern(DataSource::kAccessPatternSequential);
+
     mStarted = true;
 
     return OK;
@@ -3884,6 +3898,7 @@ status_t MPEG4Source::stop() {
 
     delete mGroup;
     mGroup = NULL;
+    mInPlaceBuffers.clear();
 
     mStarted = false;
     mCurrentSampleIndex = 0;
@@ -4500,6 +4515,16 @@ size_t MPEG4Source::parseNALSize(const uint8_t *data) const {
     return 0;
 }
 
+bool MPEG4Source::canReturnInPlace_l() {
+    // forget the buffers that have been released by their last holder
+    for (size_t i = mInPlaceBuffers.size(); i > 0; --i) {
+        if (mInPlaceBuffers[i - 1].promote() == NULL) {
+            mInPlaceBuffers.removeAt(i - 1);
+        }
+    }
+    return mInPlaceBuffers.size() < mMaxInPlaceBuffers;
+}
+
 status_t MPEG4Source::read(
         MediaBuffer **out, const ReadOptions *options) {
     Mutex::Autolock autoLock(mLock);
@@ -4606,6 +4631,7 @@ status_t MPEG4Source::read(
     uint32_t cts, stts;
     bool isSyncSample;
     bool newBuffer = false;
+    bool inPlace = false;
     if (mBuffer == NULL) {
         newBuffer = true;
 
@@ -4617,7 +4643,22 @@ status_t MPEG4Source::read(
             return err;
         }
 
-        err = mGroup->acquire_buffer(&mBuffer);
+        if (mIsAudio && canReturnInPlace_l()) {
+            // Return the sample data in place if the source can map it. Such
+            // buffers do not belong to mGroup, so this is limited to audio,
+            // which is never handed out by reference to secure decoders, and
+            // are read-only: decoders copy the samples into their own buffers.
+            sp<ABuffer> data;
+            if (mDataSource->getBufferAt(offset, size, &data) == OK) {
+                mBuffer = new MediaBuffer(data);
+                mInPlaceBuffers.push(data);
+                inPlace = true;
+            }
+        }
+    }
+
+    if (newBuffer && !inPlace) {
+        status_t err = mGroup->acquire_buffer(&mBuffer);
 
         if (err != OK) {
             CHECK(mBuffer == NULL);
@@ -4631,7 +4672,7 @@ status_t MPEG4Source::read(
 
     if ((!mIsAVC && !mIsHEVC) || mWantsNALFragments) {
         if (newBuffer) {
-            ssize_t num_bytes_read =
+            ssize_t num_bytes_read = inPlace ? (ssize_t)size :
                 mDataSource->readAt(offset, (uint8_t *)mBuffer->data(), size);
 
             if (num_bytes_read < (ssize_t)size) {
@@ -4712,9 +4753,16 @@ status_t MPEG4Source::read(
         ssize_t num_bytes_read = 0;
         int32_t drm = 0;
         bool usesDRM = (mFormat->findInt32(kKeyIsDRM, &drm) && drm != 0);
+        // The start codes are inserted reading straight from the source if it
+        // can map the sample, and from a copy in mSrcBuffer otherwise.
+        sp<ABuffer> mappedSrc;
+        const uint8_t *srcData = mSrcBuffer;
         if (usesDRM) {
             num_bytes_read =
                 mDataSource->readAt(offset, (uint8_t*)mBuffer->data(), size);
+        } else if (mDataSource->getBufferAt(offset, size, &mappedSrc) == OK) {
+            srcData = mappedSrc->data();
+            num_bytes_read = size;
         } else {
             num_bytes_read = mDataSource->readAt(offset, mSrcBuffer, size);
         }
@@ -4739,7 +4787,7 @@ status_t MPEG4Source::read(
                 bool isMalFormed = !isInRange((size_t)0u, size, srcOffset, mNALLengthSize);
                 size_t nalLength = 0;
                 if (!isMalFormed) {
-                    nalLength = parseNALSize(&mSrcBuffer[srcOffset]);
+                    nalLength = parseNALSize(&srcData[srcOffset]);
                     srcOffset += mNALLengthSize;
                     isMalFormed = !isInRange((size_t)0u, size, srcOffset, nalLength);
                 }
@@ -4769,7 +4817,7 @@ status_t MPEG4Source::read(
                 dstData[dstOffset++] = 0;
                 dstData[dstOffset++] = 0;
                 dstData[dstOffset++] = 1;
-                memcpy(&dstData[dstOffset], &mSrcBuffer[srcOffset], nalLength);
+                memcpy(&dstData[dstOffset], &srcData[srcOffset], nalLength);
                 srcOffset += nalLength;
                 dstOffset += nalLength;
             }
@@ -67,6 +67,12 @@ static const int64_t kMinStreamableFileSizeInBytes = 5 * 1024 * 1024;
 static const int64_t kMax32BitFileSize = 0x00ffffffffLL; // 2^32-1 : max FAT32
                                                          // filesystem file size
                                                          // used by most SD cards
+// Media data is written out in blocks of up to kWriteBufferSize bytes that
+// start and end at kWriteAlignment boundaries of the file.
+static const size_t kWriteBufferSize = 256 * 1024;
+static const size_t kWriteAlignment = 4096;
+// Blocks are reserved for the file this far ahead of the data written.
+static const int64_t kPreallocateBytes = 16 * 1024 * 1024;
 static const uint8_t kNalUnitTypeSeqParamSet = 0x07;
 static const uint8_t kNalUnitTypePicParamSet = 0x08;
 static const int64_t kInitialDelayTimeUs     = 700000LL;
@@ -107,6 +113,7 @@ public:
 
     int64_t getDurationUs() const;
     int64_t getEstimatedTrackSizeBytes() const;
+    int64_t estimateSampleTableSizeBytes(int64_t durationUs) const;
     void writeTrackHeader(bool use32BitOffset = true);
     void bufferChunk(int64_t timestampUs);
     bool isAvc() const { return mIsAvc; }
@@ -423,6 +430,7 @@ MPEG4Writer::MPEG4Writer(int fd)
       mMdatOffset(0),
       mMoovBoxBuffer(NULL),
       mMoovBoxBufferOffset(0),
+      mMoovBoxBufferSize(0),
       mWriteMoovBoxToMemory(false),
       mFreeBoxOffset(0),
       mStreamableFile(false),
@@ -436,6 +444,13 @@ MPEG4Writer::MPEG4Writer(int fd)
       mAreGeoTagsAvailable(false),
       mStartTimeOffsetMs(-1),
       mMetaKeys(new AMessage()),
+      mWriteBuffer(NULL),
+      mWriteBufferSize(0),
+      mWriteBufferOffset(0),
+      mPreallocate(false),
+      mPreallocatedEnd(0),
+      mNumFileWrites(0),
+      mFileBytesWritten(0),
       mIsAudioAMR(false) {
     addDeviceMeta();
 
@@ -468,6 +483,9 @@ status_t MPEG4Writer::dump(
     result.append(buffer);
     snprintf(buffer, SIZE, "     mStarted: %s\n", mStarted? "true": "false");
     result.append(buffer);
+    snprintf(buffer, SIZE, "     file writes: %" PRId64 " (%" PRId64 " bytes)\n",
+            mNumFileWrites, mFileBytesWritten);
+    result.append(buffer);
     ::write(fd, result.string(), result.size());
     for (List<Track *>::iterator it = mTracks.begin();
          it != mTracks.end(); ++it) {
@@ -651,6 +669,25 @@ int64_t MPEG4Writer::estimateMoovBoxSize(int32_t bitRate) {
         size = mMaxFileSizeLimitBytes * 6 / 1000;
     }
 
+    // If the duration is limited and the sample rate of every track is
+    // known, size the sample tables from the largest number of samples
+    // that can be recorded rather than from the bit rate.
+    if (mMaxFileDurationLimitUs != 0) {
+        int64_t tableSize = estimateSampleTableSizeBytes(mMaxFileDurationLimitUs);
+        if (tableSize > 0) {
+            if (mMaxFileSizeLimitBytes != 0 && mIsFileSizeLimitExplicitlyRequested) {
+                tableSize = std::min(tableSize, factor * size);
+            }
+            tableSize = std::max(tableSize, MIN_MOOV_BOX_SIZE);
+            tableSize = std::min(tableSize, factor * MAX_MOOV_BOX_SIZE);
+            tableSize += mMoovExtraSize;
+
+            ALOGI("duration limit: %" PRId64 " us and the estimated moov size"
+                 " %" PRId64 " bytes", mMaxFileDurationLimitUs, tableSize);
+            return tableSize;
+        }
+    }
+
     // Max file duration limit is set
     if (mMaxFileDurationLimitUs != 0) {
         if (bitRate > 0) {
@@ -688,6 +725,20 @@ int64_t MPEG4Writer::estimateMoovBoxSize(int32_t bitRate) {
     return factor * size;
 }
 
+int64_t MPEG4Writer::estimateSampleTableSizeBytes(int64_t durationUs) {
+    // mvhd, udta and meta boxes.
+    int64_t size = 1024;
+    for (List<Track *>::iterator it = mTracks.begin();
+         it != mTracks.end(); ++it) {
+        int64_t trackSize = (*it)->estimateSampleTableSizeBytes(durationUs);
+        if (trackSize < 0) {
+            return -1;
+        }
+        size += trackSize;
+    }
+    return size;
+}
+
 status_t MPEG4Writer::start(MetaData *param) {
     if (mInitCheck != OK) {
         return UNKNOWN_ERROR;
@@ -766,44 +817,35 @@ status_t MPEG4Writer::start(MetaData *param) {
          mMaxFileSizeLimitBytes >= kMinStreamableFileSizeInBytes);
 
     /*
-     * mWriteMoovBoxToMemory is true if the amount of data in moov box is
-     * smaller than the reserved free space at the beginning of a file, AND
-     * when the content of moov box is constructed. Note that video/audio
-     * frame data is always written to the file but not in the memory.
+     * mWriteMoovBoxToMemory is true while the moov box is constructed.
+     * Note that video/audio frame data is always written to the file
+     * but not in the memory.
      *
      * Before stop()/reset() is called, mWriteMoovBoxToMemory is always
      * false. When reset() is called at the end of a recording session,
-     * Moov box needs to be constructed.
-     *
-     * 1) Right before a moov box is constructed, mWriteMoovBoxToMemory
-     * to set to mStreamableFile so that if
-     * the file is intended to be streamable, it is set to true;
-     * otherwise, it is set to false. When the value is set to false,
-     * all the content of the moov box is written immediately to
-     * the end of the file. When the value is set to true, all the
-     * content of the moov box is written to an in-memory cache,
-     * mMoovBoxBuffer, util the following condition happens. Note
-     * that the size of the in-memory cache is the same as the
-     * reserved free space at the beginning of the file.
-     *
-     * 2) While the data of the moov box is written to an in-memory
-     * cache, the data size is checked against the reserved space.
-     * If the data size surpasses the reserved space, subsequent moov
-     * data could no longer be hold in the in-memory cache. This also
-     * indicates that the reserved space was too small. At this point,
-     * _all_ moov data must be written to the end of the file.
-     * mWriteMoovBoxToMemory must be set to false to direct the write
-     * to the file.
-     *
-     * 3) If the data size in moov box is smaller than the reserved
-     * space after moov box is completely constructed, the in-memory
-     * cache copy of the moov box is written to the reserved free
-     * space. Thus, immediately after the moov is completedly
-     * constructed, mWriteMoovBoxToMemory is always set to false.
+     * the whole moov box is constructed in an in-memory cache,
+     * mMoovBoxBuffer, which starts with the size of the reserved free
+     * space at the beginning of the file and grows as needed. Once the
+     * moov box is completely constructed, it is written to the file in
+     * a single shot: into the reserved free space if the file is
+     * intended to be streamable and the moov box fits, and to the end
+     * of the file otherwise.
      */
     mWriteMoovBoxToMemory = false;
     mMoovBoxBuffer = NULL;
     mMoovBoxBufferOffset = 0;
+    mMoovBoxBufferSize = 0;
+
+    if (mWriteBuffer == NULL) {
+        mWriteBuffer = (uint8_t *) malloc(kWriteBufferSize);
+        if (mWriteBuffer == NULL) {
+            return NO_MEMORY;
+        }
+    }
+    mWriteBufferSize = 0;
+    mWriteBufferOffset = mOffset;
+    mPreallocate = true;
+    mPreallocatedEnd = 0;
 
     writeFtypBox(param);
 
@@ -819,7 +861,6 @@ status_t MPEG4Writer::start(MetaData *param) {
     CHECK_GE(mEstimatedMoovBoxSize, 8);
     if (mStreamableFile) {
         // Reserve a 'free' box only for streamable file
-        lseek64(mFd, mFreeBoxOffset, SEEK_SET);
         writeInt32(mEstimatedMoovBoxSize);
         write("free", 4);
         mMdatOffset = mFreeBoxOffset + mEstimatedMoovBoxSize;
@@ -828,7 +869,6 @@ status_t MPEG4Writer::start(MetaData *param) {
     }
 
     mOffset = mMdatOffset;
-    lseek64(mFd, mMdatOffset, SEEK_SET);
     if (mUse32BitOffset) {
         write("????mdat", 8);
     } else {
@@ -941,6 +981,19 @@ void MPEG4Writer::writeCompositionMatrix(int degrees) {
 }
 
 void MPEG4Writer::release() {
+    if (mWriteBuffer != NULL) {
+        flushWriteBuffer_l(true);
+        free(mWriteBuffer);
+        mWriteBuffer = NULL;
+    }
+    if (mPreallocatedEnd > 0) {
+        // Give back the blocks reserved past the end of the file.
+        struct stat st;
+        if (fstat(mFd, &st) == 0 && st.st_size < mPreallocatedEnd) {
+            ftruncate(mFd, st.st_size);
+        }
+        mPreallocatedEnd = 0;
+    }
     close(mFd);
     mFd = -1;
     mInitCheck = NO_INIT;
@@ -997,57 +1050,45 @@ status_t MPEG4Writer::reset() {
 
     // Fix up the size of the 'mdat' chunk.
     if (mUse32BitOffset) {
-        lseek64(mFd, mMdatOffset, SEEK_SET);
         uint32_t size = htonl(static_cast<uint32_t>(mOffset - mMdatOffset));
-        ::write(mFd, &size, 4);
+        writeAt_l(mMdatOffset, &size, 4);
     } else {
-        lseek64(mFd, mMdatOffset + 8, SEEK_SET);
         uint64_t size = mOffset - mMdatOffset;
         size = hton64(size);
-        ::write(mFd, &size, 8);
+        writeAt_l(mMdatOffset + 8, &size, 8);
     }
-    lseek64(mFd, mOffset, SEEK_SET);
 
     // Construct moov box now
     mMoovBoxBufferOffset = 0;
-    mWriteMoovBoxToMemory = mStreamableFile;
-    if (mWriteMoovBoxToMemory) {
-        // There is no need to allocate in-memory cache
-        // for moov box if the file is not streamable.
-
-        mMoovBoxBuffer = (uint8_t *) malloc(mEstimatedMoovBoxSize);
-        CHECK(mMoovBoxBuffer != NULL);
-    }
+    mMoovBoxBufferSize = mEstimatedMoovBoxSize;
+    mMoovBoxBuffer = (uint8_t *) malloc(mMoovBoxBufferSize);
+    CHECK(mMoovBoxBuffer != NULL);
+    mWriteMoovBoxToMemory = true;
     writeMoovBox(maxDurationUs);
+    mWriteMoovBoxToMemory = false;
 
-    // mWriteMoovBoxToMemory could be set to false in
-    // MPEG4Writer::write() method
-    if (mWriteMoovBoxToMemory) {
-        mWriteMoovBoxToMemory = false;
-        // Content of the moov box is saved in the cache, and the in-memory
-        // moov box needs to be written to the file in a single shot.
-
-        CHECK_LE(mMoovBoxBufferOffset + 8, mEstimatedMoovBoxSize);
-
+    if (mStreamableFile && mMoovBoxBufferOffset + 8 <= mEstimatedMoovBoxSize) {
         // Moov box
-        lseek64(mFd, mFreeBoxOffset, SEEK_SET);
-        mOffset = mFreeBoxOffset;
-        write(mMoovBoxBuffer, 1, mMoovBoxBufferOffset);
+        writeAt_l(mFreeBoxOffset, mMoovBoxBuffer, mMoovBoxBufferOffset);
 
         // Free box
-        lseek64(mFd, mOffset, SEEK_SET);
-        writeInt32(mEstimatedMoovBoxSize - mMoovBoxBufferOffset);
-        write("free", 4);
+        uint8_t freeBox[8];
+        uint32_t freeBoxSize = htonl(mEstimatedMoovBoxSize - mMoovBoxBufferOffset);
+        memcpy(freeBox, &freeBoxSize, 4);
+        memcpy(freeBox + 4, "free", 4);
+        writeAt_l(mFreeBoxOffset + mMoovBoxBufferOffset, freeBox, 8);
     } else {
+        // The reserved free space at the beginning of the file, if any,
+        // is not big enough for the moov box.
+        writeBuffered_l(mMoovBoxBuffer, mMoovBoxBufferOffset);
         ALOGI("The mp4 file will not be streamable.");
     }
 
     // Free in-memory cache for moov box
-    if (mMoovBoxBuffer != NULL) {
-        free(mMoovBoxBuffer);
-        mMoovBoxBuffer = NULL;
-        mMoovBoxBufferOffset = 0;
-    }
+    free(mMoovBoxBuffer);
+    mMoovBoxBuffer = NULL;
+    mMoovBoxBufferOffset = 0;
+    mMoovBoxBufferSize = 0;
 
     CHECK(mBoxes.empty());
 
@@ -1174,15 +1215,113 @@ void MPEG4Writer::unlock() {
 off64_t MPEG4Writer::addSample_l(MediaBuffer *buffer) {
     off64_t old_offset = mOffset;
 
-    ::write(mFd,
+    writeBuffered_l(
           (const uint8_t *)buffer->data() + buffer->range_offset(),
           buffer->range_length());
 
-    mOffset += buffer->range_length();
-
     return old_offset;
 }
 
+void MPEG4Writer::writeBuffered_l(const void *data, size_t size) {
+    if (mOffset != mWriteBufferOffset + (off64_t)mWriteBufferSize) {
+        // Not contiguous with the buffered data.
+        flushWriteBuffer_l(true);
+        mWriteBufferOffset = mOffset;
+    }
+
+    const uint8_t *ptr = (const uint8_t *)data;
+    while (size > 0) {
+        if (mWriteBufferSize == kWriteBufferSize) {
+            flushWriteBuffer_l(false);
+        }
+        size_t n = std::min(size, kWriteBufferSize - mWriteBufferSize);
+        memcpy(mWriteBuffer + mWriteBufferSize, ptr, n);
+        mWriteBufferSize += n;
+        mOffset += n;
+        ptr += n;
+        size -= n;
+    }
+}
+
+void MPEG4Writer::writeAt_l(off64_t offset, const void *data, size_t size) {
+    const off64_t end = offset + size;
+    if (offset >= mWriteBufferOffset
+            && end <= mWriteBufferOffset + (off64_t)mWriteBufferSize) {
+        // Still in the write buffer.
+        memcpy(mWriteBuffer + (offset - mWriteBufferOffset), data, size);
+        return;
+    }
+    if (end > mWriteBufferOffset) {
+        flushWriteBuffer_l(true);
+    }
+    writeToFile_l(offset, data, size);
+}
+
+void MPEG4Writer::flushWriteBuffer_l(bool all) {
+    size_t size = mWriteBufferSize;
+    if (!all) {
+        off64_t end = (mWriteBufferOffset + size) & ~(off64_t)(kWriteAlignment - 1);
+        if (end <= mWriteBufferOffset) {
+            return;
+        }
+        size = end - mWriteBufferOffset;
+    }
+    if (size == 0) {
+        return;
+    }
+
+    writeToFile_l(mWriteBufferOffset, mWriteBuffer, size);
+
+    mWriteBufferSize -= size;
+    mWriteBufferOffset += size;
+    memmove(mWriteBuffer, mWriteBuffer + size, mWriteBufferSize);
+}
+
+void MPEG4Writer::writeToFile_l(off64_t offset, const void *data, size_t size) {
+    preallocate_l(offset + size);
+
+    const uint8_t *ptr = (const uint8_t *)data;
+    while (size > 0) {
+        ssize_t n = pwrite64(mFd, ptr, size, offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            ALOGE("failed to write %zu bytes at %" PRId64 ": %s (%d)",
+                    size, offset, strerror(errno), errno);
+            break;
+        }
+        ++mNumFileWrites;
+        mFileBytesWritten += n;
+        ptr += n;
+        size -= n;
+        offset += n;
+    }
+}
+
+void MPEG4Writer::preallocate_l(off64_t end) {
+    if (!mPreallocate || end <= mPreallocatedEnd) {
+        return;
+    }
+
+    off64_t newEnd = std::max(end, mPreallocatedEnd + kPreallocateBytes);
+    if (mMaxFileSizeLimitBytes != 0) {
+        newEnd = std::max(end, std::min(newEnd, (off64_t)mMaxFileSizeLimitBytes));
+    }
+
+    // Reserving the blocks ahead of the data keeps the file contiguous
+    // and takes block allocation out of the write path. The file size is
+    // not changed, and the blocks left past its end are released when
+    // the file is closed.
+    if (fallocate64(mFd, FALLOC_FL_KEEP_SIZE,
+            mPreallocatedEnd, newEnd - mPreallocatedEnd) != 0) {
+        ALOGV("fallocate is not supported: %s (%d)", strerror(errno), errno);
+        mPreallocate = false;
+        return;
+    }
+    mPreallocatedEnd = newEnd;
+}
+
 void MPEG4Writer::StripStartcode(MediaBuffer *buffer) {
     if (buffer->range_length() < 4) {
         return;
@@ -1234,30 +1373,21 @@ off64_t MPEG4Writer::addLengthPrefixedSample_l(MediaBuffer *buffer) {
     size_t length = buffer->range_length();
 
     if (mUse4ByteNalLength) {
-        uint8_t x = length >> 24;
-        ::write(mFd, &x, 1);
-        x = (length >> 16) & 0xff;
-        ::write(mFd, &x, 1);
-        x = (length >> 8) & 0xff;
-        ::write(mFd, &x, 1);
-        x = length & 0xff;
-        ::write(mFd, &x, 1);
-
-        ::write(mFd,
-              (const uint8_t *)buffer->data() + buffer->range_offset(),
-              length);
-
-        mOffset += length + 4;
+        uint8_t x[4];
+        x[0] = length >> 24;
+        x[1] = (length >> 16) & 0xff;
+        x[2] = (length >> 8) & 0xff;
+        x[3] = length & 0xff;
+        writeBuffered_l(x, 4);
     } else {
         CHECK_LT(length, 65536);
 
-        uint8_t x = length >> 8;
-        ::write(mFd, &x, 1);
-        x = length & 0xff;
-        ::write(mFd, &x, 1);
-        ::write(mFd, (const uint8_t *)buffer->data() + buffer->range_offset(), length);
-        mOffset += length + 2;
+        uint8_t x[2];
+        x[0] = length >> 8;
+        x[1] = length & 0xff;
+        writeBuffered_l(x, 2);
     }
+    writeBuffered_l((const uint8_t *)buffer->data() + buffer->range_offset(), length);
 
     return old_offset;
 }
@@ -1267,35 +1397,18 @@ size_t MPEG4Writer::write(
 
     const size_t bytes = size * nmemb;
     if (mWriteMoovBoxToMemory) {
-
-        off64_t moovBoxSize = 8 + mMoovBoxBufferOffset + bytes;
-        if (moovBoxSize > mEstimatedMoovBoxSize) {
-            // The reserved moov box at the beginning of the file
-            // is not big enough. Moov box should be written to
-            // the end of the file from now on, but not to the
-            // in-memory cache.
-
-            // We write partial moov box that is in the memory to
-            // the file first.
-            for (List<off64_t>::iterator it = mBoxes.begin();
-                 it != mBoxes.end(); ++it) {
-                (*it) += mOffset;
-            }
-            lseek64(mFd, mOffset, SEEK_SET);
-            ::write(mFd, mMoovBoxBuffer, mMoovBoxBufferOffset);
-            ::write(mFd, ptr, bytes);
-            mOffset += (bytes + mMoovBoxBufferOffset);
-
-            // All subsequent moov box content will be written
-            // to the end of the file.
-            mWriteMoovBoxToMemory = false;
-        } else {
-            memcpy(mMoovBoxBuffer + mMoovBoxBufferOffset, ptr, bytes);
-            mMoovBoxBufferOffset += bytes;
-        }
+        if (mMoovBoxBufferOffset + (off64_t)bytes > mMoovBoxBufferSize) {
+            // The moov box is larger than the reserved free space at the
+            // beginning of the file, and will be written to the end of it.
+            mMoovBoxBufferSize = std::max(
+                    2 * mMoovBoxBufferSize, mMoovBoxBufferOffset + (off64_t)bytes);
+            mMoovBoxBuffer = (uint8_t *) realloc(mMoovBoxBuffer, mMoovBoxBufferSize);
+            CHECK(mMoovBoxBuffer != NULL);
+        }
+        memcpy(mMoovBoxBuffer + mMoovBoxBufferOffset, ptr, bytes);
+        mMoovBoxBufferOffset += bytes;
     } else {
-        ::write(mFd, ptr, size * nmemb);
-        mOffset += bytes;
+        writeBuffered_l(ptr, bytes);
     }
     return bytes;
 }
@@ -1328,10 +1441,8 @@ void MPEG4Writer::endBox() {
        int32_t x = htonl(mMoovBoxBufferOffset - offset);
        memcpy(mMoovBoxBuffer + offset, &x, 4);
     } else {
-        lseek64(mFd, offset, SEEK_SET);
-        writeInt32(mOffset - offset);
-        mOffset -= 4;
-        lseek64(mFd, mOffset, SEEK_SET);
+        int32_t x = htonl(mOffset - offset);
+        writeAt_l(offset, &x, 4);
     }
 }
 
@@ -1786,6 +1897,10 @@ void MPEG4Writer::writeChunkToFile(Chunk* chunk) {
         chunk->mSamples.erase(it);
     }
     chunk->mSamples.clear();
+
+    // Chunks are written in one go rather than sample by sample; keep
+    // only the data past the last page boundary for the next chunk.
+    flushWriteBuffer_l(false);
 }
 
 void MPEG4Writer::writeAllChunks() {
@@ -2989,6 +3104,53 @@ int64_t MPEG4Writer::Track::getEstimatedTrackSizeBytes() const {
     return mEstimatedTrackSizeBytes;
 }
 
+int64_t MPEG4Writer::Track::estimateSampleTableSizeBytes(int64_t durationUs) const {
+    const char *mime;
+    CHECK(mMeta->findCString(kKeyMIMEType, &mime));
+
+    // Upper bound of the number of samples per second.
+    int64_t samplesPerSec;
+    if (!strcasecmp(MEDIA_MIMETYPE_AUDIO_AMR_NB, mime)
+            || !strcasecmp(MEDIA_MIMETYPE_AUDIO_AMR_WB, mime)) {
+        samplesPerSec = 50;  // 20 ms frames
+    } else if (mIsAudio) {
+        int32_t sampleRate;
+        if (!mMeta->findInt32(kKeySampleRate, &sampleRate) || sampleRate <= 0) {
+            return -1;
+        }
+        samplesPerSec = divUp((int64_t)sampleRate, (int64_t)1024);  // AAC frames
+    } else {
+        int32_t frameRate;
+        if (!mMeta->findInt32(kKeyFrameRate, &frameRate) || frameRate <= 0) {
+            return -1;
+        }
+        samplesPerSec = frameRate;
+    }
+
+    // Allow 10% for timestamp jitter.
+    int64_t numSamples = divUp(durationUs * samplesPerSec * 11, (int64_t)10000000);
+    int64_t numChunks = numSamples;
+    const int64_t interleaveDurationUs = mOwner->interleaveDuration();
+    if (interleaveDurationUs > 0) {
+        numChunks = std::min(numChunks, durationUs / interleaveDurationUs + 2);
+    }
+
+    // Each sample has a stsz entry. A video sample may in the worst case
+    // start a new stts and ctts entry and be a sync sample, while audio
+    // sample durations only change occasionally. Each chunk has a stsc
+    // and a stco/co64 entry.
+    int64_t size = numSamples * 4;
+    if (mIsAudio) {
+        size += divUp(durationUs, (int64_t)1000000) * 8;
+    } else {
+        size += numSamples * (8 + 8 + 4);
+    }
+    size += numChunks * (12 + (mOwner->use32BitFileOffset() ? 4 : 8));
+
+    // Track, media and sample description boxes.
+    return size + 1024 + mCodecSpecificDataSize;
+}
+
 status_t MPEG4Writer::Track::checkCodecSpecificData() const {
     const char *mime;
     CHECK(mMeta->findCString(kKeyMIMEType, &mime));
@@ -25,11 +25,16 @@
 
 #include <cutils/properties.h>
 #include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
 #include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/AUtils.h>
 #include <media/stagefright/MediaErrors.h>
 
 namespace android {
 
+// Data just behind the reader is kept, in case it reads backwards a bit.
+static const size_t kGrayArea = 1024 * 1024;
+
 struct PageCache {
     PageCache(size_t pageSize);
     ~PageCache();
@@ -44,6 +49,7 @@ struct PageCache {
 
     void appendPage(Page *page);
     size_t releaseFromStart(size_t maxBytes);
+    size_t releaseFromEnd(size_t maxBytes);
 
     size_t totalSize() const {
         return mTotalSize;
@@ -136,6 +142,30 @@ size_t PageCache::releaseFromStart(size_t maxBytes) {
     return bytesReleased;
 }
 
+size_t PageCache::releaseFromEnd(size_t maxBytes) {
+    size_t bytesReleased = 0;
+
+    while (maxBytes > 0 && !mActivePages.empty()) {
+        List<Page *>::iterator it = --mActivePages.end();
+
+        Page *page = *it;
+
+        if (maxBytes < page->mSize) {
+            break;
+        }
+
+        mActivePages.erase(it);
+
+        maxBytes -= page->mSize;
+        bytesReleased += page->mSize;
+
+        releasePage(page);
+    }
+
+    mTotalSize -= bytesReleased;
+    return bytesReleased;
+}
+
 void PageCache::copy(size_t from, void *data, size_t size) {
     ALOGV("copy from %zu size %zu", from, size);
 
@@ -188,6 +218,14 @@ NuCachedSource2::NuCachedSource2(
       mLooper(new ALooper),
       mCache(new PageCache(kPageSize)),
       mCacheOffset(0),
+      mReadAheadBytes(kDefaultHighWaterThreshold),
+      mAccessCount(0),
+      mBandwidthBps(0),
+      mNumReads(0),
+      mNumCacheHits(0),
+      mBytesFetched(0),
+      mBytesRefetched(0),
+      mNumNewRanges(0),
       mFinalStatus(OK),
       mLastAccessPos(0),
       mFetching(true),
@@ -214,6 +252,10 @@ NuCachedSource2::NuCachedSource2(
         mKeepAliveIntervalUs = 0;
     }
 
+    // Read ahead fully from the start, as before the first jump the
+    // source is most likely played sequentially.
+    mReadAheadBytes = mHighwaterThresholdBytes;
+
     mLooper->setName("NuCachedSource2");
     mLooper->registerHandler(mReflector);
 
@@ -234,6 +276,11 @@ NuCachedSource2::~NuCachedSource2() {
 
     delete mCache;
     mCache = NULL;
+
+    for (size_t i = 0; i < mRetainedRanges.size(); ++i) {
+        delete mRetainedRanges[i].mCache;
+    }
+    mRetainedRanges.clear();
 }
 
 // static
@@ -277,6 +324,23 @@ void NuCachedSource2::disconnect() {
     }
 }
 
+sp<AMessage> NuCachedSource2::getStats() {
+    Mutex::Autolock autoLock(mLock);
+
+    sp<AMessage> stats = new AMessage;
+    stats->setInt64("reads", mNumReads);
+    stats->setInt64("cache-hits", mNumCacheHits);
+    stats->setInt64("bytes-fetched", mBytesFetched);
+    stats->setInt64("bytes-refetched", mBytesRefetched);
+    stats->setInt64("new-ranges", mNumNewRanges);
+    stats->setInt32("num-ranges", 1 + mRetainedRanges.size());
+    stats->setSize("read-ahead-bytes", mReadAheadBytes);
+    if (mBandwidthBps > 0) {
+        stats->setInt32("bandwidth-kbps", (int32_t)(mBandwidthBps * 8 / 1000));
+    }
+    return stats;
+}
+
 status_t NuCachedSource2::setCacheStatCollectFreq(int32_t freqMs) {
     if (mSource->flags() & kIsHTTPBasedSource) {
         HTTPBase *source = static_cast<HTTPBase *>(mSource.get());
@@ -359,11 +423,41 @@ void NuCachedSource2::fetchInternal() {
 
     PageCache::Page *page = mCache->acquirePage();
 
-    ssize_t n = mSource->readAt(
-            mCacheOffset + mCache->totalSize(), page->mData, kPageSize);
+    const off64_t fetchOffset = mCacheOffset + mCache->totalSize();
+    const int64_t fetchStartUs = ALooper::GetNowUs();
+    ssize_t n = mSource->readAt(fetchOffset, page->mData, kPageSize);
+    const int64_t fetchTimeUs = ALooper::GetNowUs() - fetchStartUs;
+
+    // Prefer the HTTP source's estimate, which covers more than one fetch.
+    int64_t bandwidthBps = 0;
+    int32_t kbps;
+    if (n > 0 && getEstimatedBandwidthKbps(&kbps) == OK && kbps > 0) {
+        bandwidthBps = kbps * 1000ll / 8;
+    }
 
     Mutex::Autolock autoLock(mLock);
 
+    if (n > 0) {
+        if (bandwidthBps == 0) {
+            bandwidthBps = n * 1000000ll / (fetchTimeUs > 0 ? fetchTimeUs : 1);
+            if (mBandwidthBps > 0) {
+                bandwidthBps = (mBandwidthBps * 7 + bandwidthBps) / 8;
+            }
+        }
+        mBandwidthBps = bandwidthBps;
+
+        mBytesFetched += n;
+        for (size_t i = 0; i < mDiscardedRanges.size(); ++i) {
+            const ByteRange &range = mDiscardedRanges[i];
+            off64_t start = max(range.mStart, fetchOffset);
+            off64_t end = min(range.mEnd, fetchOffset + n);
+            if (start < end) {
+                mBytesRefetched += end - start;
+                break;
+            }
+        }
+    }
+
     if (n == 0 || mDisconnecting) {
         ALOGI("caching reached eos.");
 
@@ -426,6 +520,14 @@ void NuCachedSource2::onFetch() {
                 static_cast<HTTPBase *>(mSource.get())->disconnect();
                 mFinalStatus = -EAGAIN;
             }
+        } else if (mFetching) {
+            Mutex::Autolock autoLock(mLock);
+            if (mCacheOffset + (off64_t)mCache->totalSize() - mLastAccessPos
+                    >= (off64_t)mReadAheadBytes) {
+                ALOGV("Read %zu bytes ahead, done prefetching for now",
+                        mReadAheadBytes);
+                mFetching = false;
+            }
         }
     } else {
         Mutex::Autolock autoLock(mLock);
@@ -482,35 +584,172 @@ void NuCachedSource2::onRead(const sp<AMessage> &msg) {
 
 void NuCachedSource2::restartPrefetcherIfNecessary_l(
         bool ignoreLowWaterThreshold, bool force) {
-    static const size_t kGrayArea = 1024 * 1024;
-
     if (mFetching || (mFinalStatus != OK && mNumRetriesLeft == 0)) {
         return;
     }
 
+    // With a short read-ahead, resume before the reader gets to its end.
+    const size_t lowwaterThresholdBytes = min(mLowwaterThresholdBytes, mReadAheadBytes / 2);
     if (!ignoreLowWaterThreshold && !force
             && mCacheOffset + mCache->totalSize() - mLastAccessPos
-                >= mLowwaterThresholdBytes) {
+                >= lowwaterThresholdBytes) {
         return;
     }
 
     size_t maxBytes = mLastAccessPos - mCacheOffset;
 
     if (!force) {
-        if (maxBytes < kGrayArea) {
+        if (maxBytes >= kGrayArea) {
+            maxBytes -= kGrayArea;
+        } else if (mCache->totalSize() + kGrayArea > mHighwaterThresholdBytes) {
             return;
+        } else {
+            maxBytes = 0;
         }
-
-        maxBytes -= kGrayArea;
     }
 
-    size_t actualBytes = mCache->releaseFromStart(maxBytes);
-    mCacheOffset += actualBytes;
+    releaseFromStart_l(mCache, &mCacheOffset, maxBytes);
+
+    // The reader has caught up with the read-ahead, so it is reading
+    // sequentially.
+    if (!ignoreLowWaterThreshold) {
+        growReadAhead_l();
+    }
 
     ALOGI("restarting prefetcher, totalSize = %zu", mCache->totalSize());
     mFetching = true;
 }
 
+void NuCachedSource2::growReadAhead_l() {
+    if (mReadAheadBytes < mHighwaterThresholdBytes / 2) {
+        mReadAheadBytes *= 2;
+    } else {
+        mReadAheadBytes = mHighwaterThresholdBytes;
+    }
+}
+
+size_t NuCachedSource2::initialReadAhead_l() const {
+    if (mBandwidthBps <= 0) {
+        return mHighwaterThresholdBytes;
+    }
+    int64_t bytes = mBandwidthBps * kInitialReadAheadUs / 1000000ll;
+    if (bytes < kMinReadAheadBytes) {
+        bytes = kMinReadAheadBytes;
+    }
+    if (bytes > (int64_t)mHighwaterThresholdBytes) {
+        bytes = mHighwaterThresholdBytes;
+    }
+    return bytes;
+}
+
+void NuCachedSource2::releaseFromStart_l(
+        PageCache *cache, off64_t *offset, size_t maxBytes) {
+    size_t actualBytes = cache->releaseFromStart(maxBytes);
+    addDiscardedRange_l(*offset, *offset + actualBytes);
+    *offset += actualBytes;
+}
+
+void NuCachedSource2::releaseFromEnd_l(CachedRange *range, size_t maxBytes) {
+    const off64_t end = range->mOffset + range->mCache->totalSize();
+    size_t actualBytes = range->mCache->releaseFromEnd(maxBytes);
+    addDiscardedRange_l(end - actualBytes, end);
+}
+
+void NuCachedSource2::addDiscardedRange_l(off64_t start, off64_t end) {
+    if (start >= end) {
+        return;
+    }
+
+    if (mDiscardedRanges.size() >= kMaxNumDiscardedRanges) {
+        mDiscardedRanges.removeAt(0);
+    }
+    ByteRange range;
+    range.mStart = start;
+    range.mEnd = end;
+    mDiscardedRanges.push(range);
+}
+
+ssize_t NuCachedSource2::findRetainedRange_l(off64_t offset, size_t size) const {
+    for (size_t i = 0; i < mRetainedRanges.size(); ++i) {
+        const CachedRange &range = mRetainedRanges[i];
+        if (offset >= range.mOffset
+                && offset + size <= range.mOffset + range.mCache->totalSize()) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void NuCachedSource2::retainActiveRange_l() {
+    if (mCache->totalSize() == 0) {
+        return;
+    }
+
+    CachedRange range;
+    range.mCache = mCache;
+    range.mOffset = mCacheOffset;
+    range.mReadAheadBytes = mReadAheadBytes;
+    range.mLastAccessPos = mLastAccessPos;
+    range.mLastAccess = ++mAccessCount;
+    mRetainedRanges.push(range);
+
+    mCache = new PageCache(kPageSize);
+    mCacheOffset = 0;
+
+    trimRetainedRanges_l();
+}
+
+void NuCachedSource2::trimRetainedRanges_l() {
+    // Retained ranges may take up to half as much memory as the range
+    // being fetched into.
+    const size_t maxBytes = mHighwaterThresholdBytes / 2;
+
+    size_t totalBytes = 0;
+    for (size_t i = 0; i < mRetainedRanges.size(); ++i) {
+        totalBytes += mRetainedRanges[i].mCache->totalSize();
+    }
+
+    // First drop what the readers have left behind.
+    for (size_t i = 0; i < mRetainedRanges.size() && totalBytes > maxBytes; ++i) {
+        CachedRange &range = mRetainedRanges.editItemAt(i);
+        if (range.mLastAccessPos > range.mOffset + (off64_t)kGrayArea) {
+            size_t size = range.mCache->totalSize();
+            releaseFromStart_l(range.mCache, &range.mOffset,
+                    range.mLastAccessPos - range.mOffset - kGrayArea);
+            totalBytes -= size - range.mCache->totalSize();
+        }
+    }
+
+    // Then shorten the least recently used ranges, dropping the data
+    // furthest ahead of their readers first.
+    while (!mRetainedRanges.isEmpty()
+            && (totalBytes > maxBytes
+                    || mRetainedRanges.size() > kMaxNumRetainedRanges)) {
+        size_t oldest = 0;
+        for (size_t i = 1; i < mRetainedRanges.size(); ++i) {
+            if (mRetainedRanges[i].mLastAccess < mRetainedRanges[oldest].mLastAccess) {
+                oldest = i;
+            }
+        }
+
+        CachedRange &range = mRetainedRanges.editItemAt(oldest);
+        size_t size = range.mCache->totalSize();
+        if (mRetainedRanges.size() <= kMaxNumRetainedRanges) {
+            // Pages are only released whole.
+            releaseFromEnd_l(&range, totalBytes - maxBytes + kPageSize);
+        } else {
+            releaseFromEnd_l(&range, size);
+        }
+        totalBytes -= size - range.mCache->totalSize();
+
+        if (range.mCache->totalSize() == 0) {
+            ALOGV("dropping cached range at %lld", (long long)range.mOffset);
+            delete range.mCache;
+            mRetainedRanges.removeAt(oldest);
+        }
+    }
+}
+
 ssize_t NuCachedSource2::readAt(off64_t offset, void *data, size_t size) {
     Mutex::Autolock autoSerializer(mSerializer);
 
@@ -521,6 +760,8 @@ ssize_t NuCachedSource2::readAt(off64_t offset, void *data, size_t size) {
         return ERROR_END_OF_STREAM;
     }
 
+    ++mNumReads;
+
     // If the request can be completely satisfied from the cache, do so.
 
     if (offset >= mCacheOffset
@@ -529,6 +770,18 @@ ssize_t NuCachedSource2::readAt(off64_t offset, void *data, size_t size) {
         mCache->copy(delta, data, size);
 
         mLastAccessPos = offset + size;
+        ++mNumCacheHits;
+
+        return size;
+    }
+
+    ssize_t index = findRetainedRange_l(offset, size);
+    if (index >= 0) {
+        CachedRange &range = mRetainedRanges.editItemAt(index);
+        range.mCache->copy(offset - range.mOffset, data, size);
+        range.mLastAccessPos = offset + size;
+        range.mLastAccess = ++mAccessCount;
+        ++mNumCacheHits;
 
         return size;
     }
@@ -601,7 +854,16 @@ ssize_t NuCachedSource2::readInternal(off64_t offset, void *data, size_t size) {
         return ERROR_END_OF_STREAM;
     }
 
-    if (!mFetching) {
+    // A read in a retained range continues there, even if the active range
+    // is not being fetched into.
+    if ((offset < mCacheOffset
+            || offset > (off64_t)(mCacheOffset + mCache->totalSize()))
+            && findRetainedRange_l(offset, 0) >= 0) {
+        seekInternal_l(offset);
+    }
+
+    if (!mFetching && offset >= mCacheOffset
+            && offset <= (off64_t)(mCacheOffset + mCache->totalSize())) {
         mLastAccessPos = offset;
         restartPrefetcherIfNecessary_l(
                 false, // ignoreLowWaterThreshold
@@ -651,20 +913,43 @@ ssize_t NuCachedSource2::readInternal(off64_t offset, void *data, size_t size) {
 }
 
 status_t NuCachedSource2::seekInternal_l(off64_t offset) {
-    mLastAccessPos = offset;
-
     if (offset >= mCacheOffset
             && offset <= (off64_t)(mCacheOffset + mCache->totalSize())) {
+        mLastAccessPos = offset;
         return OK;
     }
 
-    ALOGI("new range: offset= %lld", (long long)offset);
+    // Keep the current range and continue in a retained one if it covers
+    // the offset, otherwise start a new range.
+    ssize_t index = findRetainedRange_l(offset, 0);
+    if (index >= 0) {
+        CachedRange range = mRetainedRanges[index];
+        mRetainedRanges.removeAt(index);
 
-    mCacheOffset = offset;
+        ALOGV("continuing range: offset= %lld", (long long)range.mOffset);
+        retainActiveRange_l();
 
-    size_t totalSize = mCache->totalSize();
-    CHECK_EQ(mCache->releaseFromStart(totalSize), totalSize);
+        delete mCache;
+        mCache = range.mCache;
+        mCacheOffset = range.mOffset;
+        mReadAheadBytes = range.mReadAheadBytes;
+    } else {
+        ALOGI("new range: offset= %lld", (long long)offset);
 
+        retainActiveRange_l();
+
+        size_t totalSize = mCache->totalSize();
+        releaseFromStart_l(mCache, &mCacheOffset, totalSize);
+        mCacheOffset = offset;
+        mReadAheadBytes = initialReadAhead_l();
+        ++mNumNewRanges;
+    }
+    mLastAccessPos = offset;
+
+    // Reaching the end of the previous range is no reason to reconnect.
+    if (mFinalStatus == ERROR_END_OF_STREAM) {
+        mFinalStatus = OK;
+    }
     mNumRetriesLeft = kMaxNumRetries;
     mFetching = true;
 
@@ -674,6 +959,8 @@ status_t NuCachedSource2::seekInternal_l(off64_t offset) {
 void NuCachedSource2::resumeFetchingIfNecessary() {
     Mutex::Autolock autoLock(mLock);
 
+    // Called by players that are buffering for playback.
+    mReadAheadBytes = mHighwaterThresholdBytes;
     restartPrefetcherIfNecessary_l(true /* ignore low water threshold */);
 }
 
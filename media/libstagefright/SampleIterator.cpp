@@ -33,7 +33,6 @@ namespace android {
 SampleIterator::SampleIterator(SampleTable *table)
     : mTable(table),
       mInitialized(false),
-      mTimeToSampleIndex(0),
       mTTSSampleIndex(0),
       mTTSSampleTime(0),
       mTTSCount(0),
@@ -61,7 +60,8 @@ status_t SampleIterator::seekTo(uint32_t sampleIndex) {
     if (mTable->mSampleToChunkOffset < 0
             || mTable->mChunkOffsetOffset < 0
             || mTable->mSampleSizeOffset < 0
-            || mTable->mTimeToSampleCount == 0) {
+            || mTable->mTimeToSampleCount == 0
+            || mTable->mTimeToSampleStarts == NULL) {
 
         return ERROR_MALFORMED;
     }
@@ -130,13 +130,6 @@ status_t SampleIterator::seekTo(uint32_t sampleIndex) {
     }
 
     mCurrentSampleSize = mCurrentChunkSampleSizes[chunkRelativeSampleIndex];
-    if (sampleIndex < mTTSSampleIndex) {
-        mTimeToSampleIndex = 0;
-        mTTSSampleIndex = 0;
-        mTTSSampleTime = 0;
-        mTTSCount = 0;
-        mTTSDuration = 0;
-    }
 
     status_t err;
     if ((err = findSampleTimeAndDuration(
@@ -200,13 +193,15 @@ status_t SampleIterator::getChunkOffset(uint32_t chunk, off64_t *offset) {
         return ERROR_OUT_OF_RANGE;
     }
 
+    if (mTable->mChunkOffsets == NULL) {
+        return ERROR_MALFORMED;
+    }
+
     if (mTable->mChunkOffsetType == SampleTable::kChunkOffsetType32) {
         uint32_t offset32;
 
-        if (mTable->mDataSource->readAt(
-                    mTable->mChunkOffsetOffset + 8 + 4 * chunk,
-                    &offset32,
-                    sizeof(offset32)) < (ssize_t)sizeof(offset32)) {
+        if (mTable->mChunkOffsets->read(
+                    4 * (uint64_t)chunk, &offset32, sizeof(offset32)) != OK) {
             return ERROR_IO;
         }
 
@@ -215,10 +210,8 @@ status_t SampleIterator::getChunkOffset(uint32_t chunk, off64_t *offset) {
         CHECK_EQ(mTable->mChunkOffsetType, SampleTable::kChunkOffsetType64);
 
         uint64_t offset64;
-        if (mTable->mDataSource->readAt(
-                    mTable->mChunkOffsetOffset + 8 + 8 * chunk,
-                    &offset64,
-                    sizeof(offset64)) < (ssize_t)sizeof(offset64)) {
+        if (mTable->mChunkOffsets->read(
+                    8 * (uint64_t)chunk, &offset64, sizeof(offset64)) != OK) {
             return ERROR_IO;
         }
 
@@ -241,25 +234,28 @@ status_t SampleIterator::getSampleSizeDirect(
         return OK;
     }
 
+    if (mTable->mSampleSizes == NULL) {
+        return ERROR_MALFORMED;
+    }
+
     switch (mTable->mSampleSizeFieldSize) {
         case 32:
         {
-            if (mTable->mDataSource->readAt(
-                        mTable->mSampleSizeOffset + 12 + 4 * sampleIndex,
-                        size, sizeof(*size)) < (ssize_t)sizeof(*size)) {
+            uint32_t x;
+            if (mTable->mSampleSizes->read(
+                        4 * (uint64_t)sampleIndex, &x, sizeof(x)) != OK) {
                 return ERROR_IO;
             }
 
-            *size = ntohl(*size);
+            *size = ntohl(x);
             break;
         }
 
         case 16:
         {
             uint16_t x;
-            if (mTable->mDataSource->readAt(
-                        mTable->mSampleSizeOffset + 12 + 2 * sampleIndex,
-                        &x, sizeof(x)) < (ssize_t)sizeof(x)) {
+            if (mTable->mSampleSizes->read(
+                        2 * (uint64_t)sampleIndex, &x, sizeof(x)) != OK) {
                 return ERROR_IO;
             }
 
@@ -270,9 +266,7 @@ status_t SampleIterator::getSampleSizeDirect(
         case 8:
         {
             uint8_t x;
-            if (mTable->mDataSource->readAt(
-                        mTable->mSampleSizeOffset + 12 + sampleIndex,
-                        &x, sizeof(x)) < (ssize_t)sizeof(x)) {
+            if (mTable->mSampleSizes->read(sampleIndex, &x, sizeof(x)) != OK) {
                 return ERROR_IO;
             }
 
@@ -285,9 +279,7 @@ status_t SampleIterator::getSampleSizeDirect(
             CHECK_EQ(mTable->mSampleSizeFieldSize, 4);
 
             uint8_t x;
-            if (mTable->mDataSource->readAt(
-                        mTable->mSampleSizeOffset + 12 + sampleIndex / 2,
-                        &x, sizeof(x)) < (ssize_t)sizeof(x)) {
+            if (mTable->mSampleSizes->read(sampleIndex / 2, &x, sizeof(x)) != OK) {
                 return ERROR_IO;
             }
 
@@ -305,21 +297,34 @@ status_t SampleIterator::findSampleTimeAndDuration(
         return ERROR_OUT_OF_RANGE;
     }
 
-    while (sampleIndex >= mTTSSampleIndex + mTTSCount) {
-        if (mTimeToSampleIndex == mTable->mTimeToSampleCount) {
-            return ERROR_OUT_OF_RANGE;
+    if (sampleIndex < mTTSSampleIndex || sampleIndex - mTTSSampleIndex >= mTTSCount) {
+        // find the last time-to-sample entry starting at or before sampleIndex
+        const SampleTable::TimeToSampleStart *starts = mTable->mTimeToSampleStarts;
+        uint32_t left = 0;
+        uint32_t right_plus_one = mTable->mTimeToSampleCount;
+        while (left < right_plus_one) {
+            uint32_t center = left + (right_plus_one - left) / 2;
+            if (starts[center].mSampleIndex <= sampleIndex) {
+                left = center + 1;
+            } else {
+                right_plus_one = center;
+            }
         }
 
-        mTTSSampleIndex += mTTSCount;
-        mTTSSampleTime += mTTSCount * mTTSDuration;
-
-        mTTSCount = mTable->mTimeToSample[2 * mTimeToSampleIndex];
-        mTTSDuration = mTable->mTimeToSample[2 * mTimeToSampleIndex + 1];
+        if (left == 0
+                || sampleIndex - starts[left - 1].mSampleIndex
+                        >= mTable->mTimeToSample[2 * (left - 1)]) {
+            return ERROR_OUT_OF_RANGE;
+        }
 
-        ++mTimeToSampleIndex;
+        mTTSSampleIndex = (uint32_t)starts[left - 1].mSampleIndex;
+        mTTSSampleTime = starts[left - 1].mSampleTime;
+        mTTSCount = mTable->mTimeToSample[2 * (left - 1)];
+        mTTSDuration = mTable->mTimeToSample[2 * (left - 1) + 1];
     }
 
-    *time = mTTSSampleTime + mTTSDuration * (sampleIndex - mTTSSampleIndex);
+    *time = (uint32_t)(mTTSSampleTime
+            + (uint64_t)mTTSDuration * (sampleIndex - mTTSSampleIndex));
 
     int32_t offset = mTable->getCompositionTimeOffset(sampleIndex);
     if ((offset < 0 && *time < (offset == INT32_MIN ?
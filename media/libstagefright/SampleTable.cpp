@@ -51,8 +51,9 @@ const off64_t kMaxOffset = std::numeric_limits<off64_t>::max();
 
 struct SampleTable::CompositionDeltaLookup {
     CompositionDeltaLookup();
+    ~CompositionDeltaLookup();
 
-    void setEntries(
+    status_t setEntries(
             const int32_t *deltaEntries, size_t numDeltaEntries);
 
     int32_t getCompositionTimeOffset(uint32_t sampleIndex);
@@ -63,8 +64,10 @@ private:
     const int32_t *mDeltaEntries;
     size_t mNumDeltaEntries;
 
+    // first sample index of each entry
+    uint64_t *mEntrySampleIndices;
+
     size_t mCurrentDeltaEntry;
-    size_t mCurrentEntrySampleIndex;
 
     DISALLOW_EVIL_CONSTRUCTORS(CompositionDeltaLookup);
 };
@@ -72,44 +75,173 @@ private:
 SampleTable::CompositionDeltaLookup::CompositionDeltaLookup()
     : mDeltaEntries(NULL),
       mNumDeltaEntries(0),
-      mCurrentDeltaEntry(0),
-      mCurrentEntrySampleIndex(0) {
+      mEntrySampleIndices(NULL),
+      mCurrentDeltaEntry(0) {
+}
+
+SampleTable::CompositionDeltaLookup::~CompositionDeltaLookup() {
+    delete[] mEntrySampleIndices;
+    mEntrySampleIndices = NULL;
 }
 
-void SampleTable::CompositionDeltaLookup::setEntries(
+status_t SampleTable::CompositionDeltaLookup::setEntries(
         const int32_t *deltaEntries, size_t numDeltaEntries) {
     Mutex::Autolock autolock(mLock);
 
+    delete[] mEntrySampleIndices;
+    mEntrySampleIndices = new (std::nothrow) uint64_t[numDeltaEntries];
+    if (mEntrySampleIndices == NULL) {
+        mDeltaEntries = NULL;
+        mNumDeltaEntries = 0;
+        return ERROR_OUT_OF_RANGE;
+    }
+
+    uint64_t sampleIndex = 0;
+    for (size_t i = 0; i < numDeltaEntries; ++i) {
+        mEntrySampleIndices[i] = sampleIndex;
+        sampleIndex += (uint32_t)deltaEntries[2 * i];
+    }
+
     mDeltaEntries = deltaEntries;
     mNumDeltaEntries = numDeltaEntries;
     mCurrentDeltaEntry = 0;
-    mCurrentEntrySampleIndex = 0;
+
+    return OK;
 }
 
 int32_t SampleTable::CompositionDeltaLookup::getCompositionTimeOffset(
         uint32_t sampleIndex) {
     Mutex::Autolock autolock(mLock);
 
-    if (mDeltaEntries == NULL) {
+    if (mDeltaEntries == NULL || mNumDeltaEntries == 0) {
         return 0;
     }
 
-    if (sampleIndex < mCurrentEntrySampleIndex) {
-        mCurrentDeltaEntry = 0;
-        mCurrentEntrySampleIndex = 0;
+    // Samples are mostly looked up in order, so try the current and the next
+    // entry before searching.
+    for (size_t i = mCurrentDeltaEntry;
+            i < mNumDeltaEntries && i <= mCurrentDeltaEntry + 1; ++i) {
+        if (sampleIndex >= mEntrySampleIndices[i]
+                && sampleIndex - mEntrySampleIndices[i] < (uint32_t)mDeltaEntries[2 * i]) {
+            mCurrentDeltaEntry = i;
+            return mDeltaEntries[2 * i + 1];
+        }
     }
 
-    while (mCurrentDeltaEntry < mNumDeltaEntries) {
-        uint32_t sampleCount = mDeltaEntries[2 * mCurrentDeltaEntry];
-        if (sampleIndex < mCurrentEntrySampleIndex + sampleCount) {
-            return mDeltaEntries[2 * mCurrentDeltaEntry + 1];
+    // find the last entry starting at or before sampleIndex
+    size_t left = 0;
+    size_t right = mNumDeltaEntries;
+    while (left < right) {
+        size_t center = left + (right - left) / 2;
+        if (mEntrySampleIndices[center] <= sampleIndex) {
+            left = center + 1;
+        } else {
+            right = center;
         }
+    }
 
-        mCurrentEntrySampleIndex += sampleCount;
-        ++mCurrentDeltaEntry;
+    if (left == 0) {
+        return 0;
     }
 
-    return 0;
+    size_t entry = left - 1;
+    if (sampleIndex - mEntrySampleIndices[entry] >= (uint32_t)mDeltaEntries[2 * entry]) {
+        // past the last sample covered by the table
+        return 0;
+    }
+
+    mCurrentDeltaEntry = entry;
+    return mDeltaEntries[2 * entry + 1];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+SampleTable::PagedTable::PagedTable(
+        const sp<DataSource> &source, off64_t offset, uint64_t size)
+    : mDataSource(source),
+      mOffset(offset),
+      mSize(size),
+      mUseCount(0) {
+}
+
+SampleTable::PagedTable::~PagedTable() {
+    for (size_t i = 0; i < mPages.size(); ++i) {
+        delete[] mPages[i].mData;
+    }
+}
+
+status_t SampleTable::PagedTable::getPage(uint64_t index, const Page **page) {
+    ++mUseCount;
+
+    size_t leastRecentlyUsed = 0;
+    for (size_t i = 0; i < mPages.size(); ++i) {
+        if (mPages[i].mIndex == index) {
+            mPages.editItemAt(i).mLastUse = mUseCount;
+            *page = &mPages[i];
+            return OK;
+        }
+        if (mUseCount - mPages[i].mLastUse > mUseCount - mPages[leastRecentlyUsed].mLastUse) {
+            leastRecentlyUsed = i;
+        }
+    }
+
+    Page *p;
+    if (mPages.size() < kMaxPages) {
+        Page newPage;
+        newPage.mData = new (std::nothrow) uint8_t[kPageSize];
+        if (newPage.mData == NULL) {
+            return ERROR_OUT_OF_RANGE;
+        }
+        mPages.push(newPage);
+        p = &mPages.editItemAt(mPages.size() - 1);
+    } else {
+        p = &mPages.editItemAt(leastRecentlyUsed);
+    }
+
+    uint64_t pageOffset = index * kPageSize;
+    size_t pageSize = mSize - pageOffset < kPageSize ? mSize - pageOffset : kPageSize;
+    ssize_t n = mDataSource->readAt(mOffset + pageOffset, p->mData, pageSize);
+
+    // Only a complete page is kept. A failed or short read may be transient,
+    // e.g. on a network source, so the slot is left unused and the page is
+    // read again next time; reads of the missing part fail meanwhile.
+    p->mIndex = (size_t)n == pageSize ? index : kNoPage;
+    p->mSize = n > 0 ? n : 0;
+    p->mLastUse = (size_t)n == pageSize ? mUseCount : 0;
+    if (n < 0) {
+        return n;
+    }
+    *page = p;
+
+    return OK;
+}
+
+status_t SampleTable::PagedTable::read(uint64_t offset, void *data, size_t size) {
+    if (offset > mSize || size > mSize - offset) {
+        return ERROR_OUT_OF_RANGE;
+    }
+
+    uint8_t *dst = (uint8_t *)data;
+    while (size > 0) {
+        const Page *page;
+        status_t err = getPage(offset / kPageSize, &page);
+        if (err != OK) {
+            return err;
+        }
+
+        size_t pageOffset = offset % kPageSize;
+        size_t copy = kPageSize - pageOffset < size ? kPageSize - pageOffset : size;
+        if (pageOffset + copy > page->mSize) {
+            return ERROR_IO;
+        }
+        memcpy(dst, page->mData + pageOffset, copy);
+
+        dst += copy;
+        offset += copy;
+        size -= copy;
+    }
+
+    return OK;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -119,15 +251,22 @@ SampleTable::SampleTable(const sp<DataSource> &source)
       mChunkOffsetOffset(-1),
       mChunkOffsetType(0),
       mNumChunkOffsets(0),
+      mChunkOffsets(NULL),
       mSampleToChunkOffset(-1),
       mNumSampleToChunkOffsets(0),
       mSampleSizeOffset(-1),
       mSampleSizeFieldSize(0),
       mDefaultSampleSize(0),
       mNumSampleSizes(0),
+      mSampleSizes(NULL),
       mHasTimeToSample(false),
       mTimeToSampleCount(0),
       mTimeToSample(NULL),
+      mTimeToSampleStarts(NULL),
+      mTimeToSampleWraps(false),
+      mCompositionOrder(kCompositionOrderUnknown),
+      mMinCompositionOffset(0),
+      mMaxCompositionOffset(0),
       mSampleTimeEntries(NULL),
       mCompositionTimeDeltaEntries(NULL),
       mNumCompositionTimeDeltaEntries(0),
@@ -145,12 +284,21 @@ SampleTable::~SampleTable() {
     delete[] mSampleToChunkEntries;
     mSampleToChunkEntries = NULL;
 
-    delete[] mSyncSamples;
+    delete mSyncSamples;
     mSyncSamples = NULL;
 
+    delete mChunkOffsets;
+    mChunkOffsets = NULL;
+
+    delete mSampleSizes;
+    mSampleSizes = NULL;
+
     delete[] mTimeToSample;
     mTimeToSample = NULL;
 
+    delete[] mTimeToSampleStarts;
+    mTimeToSampleStarts = NULL;
+
     delete mCompositionDeltaLookup;
     mCompositionDeltaLookup = NULL;
 
@@ -209,6 +357,10 @@ status_t SampleTable::setChunkOffsetParams(
         }
     }
 
+    mChunkOffsets = new PagedTable(
+            mDataSource, data_offset + 8,
+            (uint64_t)mNumChunkOffsets * (mChunkOffsetType == kChunkOffsetType32 ? 4 : 8));
+
     return OK;
 }
 
@@ -346,6 +498,9 @@ status_t SampleTable::setSampleSizeParams(
         if (data_size < 12 + mNumSampleSizes * 4) {
             return ERROR_MALFORMED;
         }
+
+        mSampleSizes = new PagedTable(
+                mDataSource, data_offset + 12, (uint64_t)mNumSampleSizes * 4);
     } else {
         if ((mDefaultSampleSize & 0xffffff00) != 0) {
             // The high 24 bits are reserved and must be 0.
@@ -363,6 +518,10 @@ status_t SampleTable::setSampleSizeParams(
         if (data_size < 12 + (mNumSampleSizes * mSampleSizeFieldSize + 4) / 8) {
             return ERROR_MALFORMED;
         }
+
+        mSampleSizes = new PagedTable(
+                mDataSource, data_offset + 12,
+                ((uint64_t)mNumSampleSizes * mSampleSizeFieldSize + 4) / 8);
     }
 
     return OK;
@@ -430,6 +589,46 @@ status_t SampleTable::setTimeToSampleParams(
         mTimeToSample[i] = ntohl(mTimeToSample[i]);
     }
 
+    // Index the entries by their first sample, so that the decode time of a
+    // sample is found by a binary search over the entries.
+    allocSize = (uint64_t)mTimeToSampleCount * sizeof(TimeToSampleStart);
+    mTotalSize += allocSize;
+    if (mTotalSize > kMaxTotalSize) {
+        ALOGE("Time-to-sample index would make sample table too large.\n"
+              "    Requested time-to-sample index size = %llu\n"
+              "    Eventual sample table size >= %llu\n"
+              "    Allowed sample table size = %llu\n",
+              (unsigned long long)allocSize,
+              (unsigned long long)mTotalSize,
+              (unsigned long long)kMaxTotalSize);
+        return ERROR_OUT_OF_RANGE;
+    }
+
+    mTimeToSampleStarts = new (std::nothrow) TimeToSampleStart[mTimeToSampleCount];
+    if (!mTimeToSampleStarts) {
+        ALOGE("Cannot allocate time-to-sample index with %llu entries.",
+                (unsigned long long)mTimeToSampleCount);
+        return ERROR_OUT_OF_RANGE;
+    }
+
+    // decode times are 32 bits and wrap around like the running sums in
+    // SampleIterator and buildSampleEntriesTable_l() do
+    uint64_t sampleIndex = 0;
+    uint32_t sampleTime = 0;
+    uint64_t totalTime = 0;
+    for (uint32_t i = 0; i < mTimeToSampleCount; ++i) {
+        mTimeToSampleStarts[i].mSampleIndex = sampleIndex;
+        mTimeToSampleStarts[i].mSampleTime = sampleTime;
+
+        uint64_t duration = (uint64_t)mTimeToSample[2 * i] * mTimeToSample[2 * i + 1];
+        sampleIndex += mTimeToSample[2 * i];
+        sampleTime = (uint32_t)(sampleTime + duration);
+        if (totalTime <= UINT32_MAX) {
+            totalTime += duration;
+        }
+    }
+    mTimeToSampleWraps = totalTime > UINT32_MAX;
+
     mHasTimeToSample = true;
     return OK;
 }
@@ -506,10 +705,14 @@ status_t SampleTable::setCompositionTimeToSampleParams(
         mCompositionTimeDeltaEntries[i] = ntohl(mCompositionTimeDeltaEntries[i]);
     }
 
-    mCompositionDeltaLookup->setEntries(
-            mCompositionTimeDeltaEntries, mNumCompositionTimeDeltaEntries);
+    mTotalSize += (uint64_t)numEntries * sizeof(uint64_t);
+    if (mTotalSize > kMaxTotalSize) {
+        ALOGE("Composition-time-to-sample index would make sample table too large.");
+        return ERROR_OUT_OF_RANGE;
+    }
 
-    return OK;
+    return mCompositionDeltaLookup->setEntries(
+            mCompositionTimeDeltaEntries, mNumCompositionTimeDeltaEntries);
 }
 
 status_t SampleTable::setSyncSampleParams(off64_t data_offset, size_t data_size) {
@@ -534,45 +737,12 @@ status_t SampleTable::setSyncSampleParams(off64_t data_offset, size_t data_size)
         ALOGV("Table of sync samples is empty or has only a single entry!");
     }
 
-    uint64_t allocSize = (uint64_t)numSyncSamples * sizeof(uint32_t);
-    if (allocSize > kMaxTotalSize) {
-        ALOGE("Sync sample table size too large.");
-        return ERROR_OUT_OF_RANGE;
-    }
-
-    mTotalSize += allocSize;
-    if (mTotalSize > kMaxTotalSize) {
-        ALOGE("Sync sample table size would make sample table too large.\n"
-              "    Requested sync sample table size = %llu\n"
-              "    Eventual sample table size >= %llu\n"
-              "    Allowed sample table size = %llu\n",
-              (unsigned long long)allocSize,
-              (unsigned long long)mTotalSize,
-              (unsigned long long)kMaxTotalSize);
-        return ERROR_OUT_OF_RANGE;
-    }
-
-    mSyncSamples = new (std::nothrow) uint32_t[numSyncSamples];
-    if (!mSyncSamples) {
-        ALOGE("Cannot allocate sync sample table with %llu entries.",
-                (unsigned long long)numSyncSamples);
-        return ERROR_OUT_OF_RANGE;
-    }
-
-    if (mDataSource->readAt(data_offset + 8, mSyncSamples,
-            (size_t)allocSize) != (ssize_t)allocSize) {
-        delete[] mSyncSamples;
-        mSyncSamples = NULL;
-        return ERROR_IO;
+    if ((data_size - 8) / sizeof(uint32_t) < numSyncSamples) {
+        return ERROR_MALFORMED;
     }
 
-    for (size_t i = 0; i < numSyncSamples; ++i) {
-        if (mSyncSamples[i] == 0) {
-            ALOGE("b/32423862, unexpected zero value in stss");
-            continue;
-        }
-        mSyncSamples[i] = ntohl(mSyncSamples[i]) - 1;
-    }
+    mSyncSamples = new PagedTable(
+            mDataSource, data_offset + 8, (uint64_t)numSyncSamples * sizeof(uint32_t));
 
     mSyncSampleOffset = data_offset;
     mNumSyncSamples = numSyncSamples;
@@ -627,9 +797,7 @@ int SampleTable::CompareIncreasingTime(const void *_a, const void *_b) {
     return 0;
 }
 
-void SampleTable::buildSampleEntriesTable() {
-    Mutex::Autolock autoLock(mLock);
-
+void SampleTable::buildSampleEntriesTable_l() {
     if (mSampleTimeEntries != NULL || mNumSampleSizes == 0) {
         if (mNumSampleSizes == 0) {
             ALOGE("b/23247055, mNumSampleSizes(%u)", mNumSampleSizes);
@@ -704,15 +872,191 @@ void SampleTable::buildSampleEntriesTable() {
           CompareIncreasingTime);
 }
 
+// Applies a composition time offset to a decode time. Returns false if the
+// result would overflow.
+static bool addCompositionTimeOffset(uint32_t time, int32_t offset, uint32_t *result) {
+    if ((offset < 0 && time < (offset == INT32_MIN ?
+            INT32_MAX : uint32_t(-offset))) ||
+            (offset > 0 && time > UINT32_MAX - offset)) {
+        return false;
+    }
+    *result = offset > 0 ? time + offset : time - (-offset);
+    return true;
+}
+
+bool SampleTable::getDecodeTime_l(uint32_t sampleIndex, uint32_t *time) {
+    // find the last time-to-sample entry starting at or before sampleIndex
+    uint32_t left = 0;
+    uint32_t right_plus_one = mTimeToSampleCount;
+    while (left < right_plus_one) {
+        uint32_t center = left + (right_plus_one - left) / 2;
+        if (mTimeToSampleStarts[center].mSampleIndex <= sampleIndex) {
+            left = center + 1;
+        } else {
+            right_plus_one = center;
+        }
+    }
+
+    if (left == 0) {
+        return false;
+    }
+
+    const TimeToSampleStart &start = mTimeToSampleStarts[left - 1];
+    uint64_t n = sampleIndex - start.mSampleIndex;
+    if (n >= mTimeToSample[2 * (left - 1)]) {
+        return false;
+    }
+
+    *time = (uint32_t)(start.mSampleTime + n * mTimeToSample[2 * (left - 1) + 1]);
+    return true;
+}
+
+bool SampleTable::getCompositionTime_l(uint32_t sampleIndex, uint32_t *time) {
+    uint32_t decodeTime;
+    return getDecodeTime_l(sampleIndex, &decodeTime) && addCompositionTimeOffset(
+            decodeTime, getCompositionTimeOffset(sampleIndex), time);
+}
+
+// Reordered samples are searched around their decode order position if the
+// composition time offsets span at most this many samples.
+static const uint32_t kMaxCompositionWindow = 64;
+
+// Composition times are usually in decode order, e.g. if there is no
+// composition time-to-sample table or the frames are not reordered. Otherwise
+// frames are mostly reordered within a few samples, e.g. B-frames. Both cases
+// are recognized by walking the time-to-sample and the composition offset
+// runs side by side: within a span of samples covered by a single run of each,
+// composition times increase with decode times, so only the first and last
+// sample of each span are looked at.
+SampleTable::CompositionOrder SampleTable::checkCompositionOrder_l() {
+    if (mNumSampleSizes == 0 || mTimeToSampleCount == 0 || mTimeToSampleStarts == NULL
+            || mTimeToSampleWraps) {
+        return kCompositionOrderTable;
+    }
+
+    // all samples must have a decode time
+    const uint32_t last = mTimeToSampleCount - 1;
+    if (mTimeToSampleStarts[last].mSampleIndex + mTimeToSample[2 * last]
+            < mNumSampleSizes) {
+        return kCompositionOrderTable;
+    }
+
+    bool inOrder = true;
+    int64_t minOffset = INT64_MAX;
+    int64_t maxOffset = INT64_MIN;
+    uint32_t minDuration = UINT32_MAX;
+    int64_t previousTime = 0;
+    size_t entry = 0;           // composition offset entry
+    uint64_t entryStart = 0;    // first sample of the entry
+    for (uint32_t i = 0; i < mTimeToSampleCount; ++i) {
+        const TimeToSampleStart &run = mTimeToSampleStarts[i];
+        const uint32_t delta = mTimeToSample[2 * i + 1];
+        uint64_t start = run.mSampleIndex;
+        uint64_t end = start + mTimeToSample[2 * i];
+        if (end > mNumSampleSizes) {
+            end = mNumSampleSizes;
+        }
+        if (start < end && (end - start > 1 || end < mNumSampleSizes)
+                && delta < minDuration) {
+            minDuration = delta;
+        }
+
+        while (start < end) {
+            while (entry < mNumCompositionTimeDeltaEntries && entryStart
+                    + (uint32_t)mCompositionTimeDeltaEntries[2 * entry] <= start) {
+                entryStart += (uint32_t)mCompositionTimeDeltaEntries[2 * entry];
+                ++entry;
+            }
+
+            // samples past the composition offset table have no offset
+            int64_t offset = 0;
+            uint64_t spanEnd = end;
+            if (entry < mNumCompositionTimeDeltaEntries) {
+                offset = mCompositionTimeDeltaEntries[2 * entry + 1];
+                uint64_t entryEnd =
+                        entryStart + (uint32_t)mCompositionTimeDeltaEntries[2 * entry];
+                if (entryEnd < spanEnd) {
+                    spanEnd = entryEnd;
+                }
+            }
+
+            int64_t firstTime = run.mSampleTime + (start - run.mSampleIndex) * delta + offset;
+            int64_t lastTime =
+                    run.mSampleTime + (spanEnd - 1 - run.mSampleIndex) * delta + offset;
+            if (firstTime < 0 || lastTime > UINT32_MAX) {
+                // composition times are clamped in the sorted table
+                return kCompositionOrderTable;
+            }
+            if (firstTime < previousTime) {
+                inOrder = false;
+            }
+            previousTime = lastTime;
+
+            if (offset < minOffset) {
+                minOffset = offset;
+            }
+            if (offset > maxOffset) {
+                maxOffset = offset;
+            }
+            start = spanEnd;
+        }
+    }
+
+    mMinCompositionOffset = minOffset;
+    mMaxCompositionOffset = maxOffset;
+
+    if (inOrder) {
+        return kCompositionOrderDecode;
+    }
+    if (minDuration > 0
+            && (uint64_t)(maxOffset - minOffset) / minDuration < kMaxCompositionWindow) {
+        return kCompositionOrderWindow;
+    }
+    return kCompositionOrderTable;
+}
+
+bool SampleTable::prepareCompositionOrder_l() {
+    if (mCompositionOrder == kCompositionOrderUnknown) {
+        mCompositionOrder = checkCompositionOrder_l();
+        ALOGV("composition order %d, offsets %lld to %lld", mCompositionOrder,
+                (long long)mMinCompositionOffset, (long long)mMaxCompositionOffset);
+    }
+
+    if (mCompositionOrder != kCompositionOrderTable) {
+        return true;
+    }
+
+    buildSampleEntriesTable_l();
+    return mSampleTimeEntries != NULL;
+}
+
+uint32_t SampleTable::getCompositionTimeAt_l(uint32_t position) {
+    if (mSampleTimeEntries != NULL) {
+        return mSampleTimeEntries[position].mCompositionTime;
+    }
+
+    uint32_t time = 0;
+    getCompositionTime_l(position, &time);
+    return time;
+}
+
+uint32_t SampleTable::getSampleIndexAt_l(uint32_t position) const {
+    return mSampleTimeEntries != NULL ? mSampleTimeEntries[position].mSampleIndex : position;
+}
+
 status_t SampleTable::findSampleAtTime(
         uint64_t req_time, uint64_t scale_num, uint64_t scale_den,
         uint32_t *sample_index, uint32_t flags) {
-    buildSampleEntriesTable();
+    Mutex::Autolock autoLock(mLock);
 
-    if (mSampleTimeEntries == NULL) {
+    if (!prepareCompositionOrder_l()) {
         return ERROR_OUT_OF_RANGE;
     }
 
+    if (mCompositionOrder == kCompositionOrderWindow) {
+        return findSampleInWindow_l(req_time, scale_num, scale_den, sample_index, flags);
+    }
+
     uint32_t left = 0;
     uint32_t right_plus_one = mNumSampleSizes;
     while (left < right_plus_one) {
@@ -725,7 +1069,7 @@ status_t SampleTable::findSampleAtTime(
         } else if (req_time > centerTime) {
             left = center + 1;
         } else {
-            *sample_index = mSampleTimeEntries[center].mSampleIndex;
+            *sample_index = getSampleIndexAt_l(center);
             return OK;
         }
     }
@@ -774,7 +1118,194 @@ status_t SampleTable::findSampleAtTime(
         }
     }
 
-    *sample_index = mSampleTimeEntries[closestIndex].mSampleIndex;
+    *sample_index = getSampleIndexAt_l(closestIndex);
+    return OK;
+}
+
+// Scales a composition time, or a bound of one, as getSampleTime() does.
+static uint64_t scaleTime(int64_t time, uint64_t scale_num, uint64_t scale_den) {
+    if (time < 0) {
+        time = 0;
+    } else if (time > UINT32_MAX) {
+        time = UINT32_MAX;
+    }
+    return scale_den != 0 ? (uint64_t)time * scale_num / scale_den : 0;
+}
+
+// Returns the first sample whose decode time plus |offset| scales to at least
+// req_time, or to more than req_time if |after|.
+uint32_t SampleTable::findDecodeIndex_l(
+        int64_t offset, uint64_t req_time, uint64_t scale_num, uint64_t scale_den,
+        bool after) {
+    uint32_t left = 0;
+    uint32_t right_plus_one = mNumSampleSizes;
+    while (left < right_plus_one) {
+        uint32_t center = left + (right_plus_one - left) / 2;
+        uint32_t decodeTime = 0;
+        getDecodeTime_l(center, &decodeTime);
+        uint64_t time = scaleTime((int64_t)decodeTime + offset, scale_num, scale_den);
+
+        if (time < req_time || (after && time == req_time)) {
+            left = center + 1;
+        } else {
+            right_plus_one = center;
+        }
+    }
+    return left;
+}
+
+// Finds the sample at req_time in composition order without a sorted table of
+// all samples: the composition time of a sample is its decode time plus an
+// offset between mMinCompositionOffset and mMaxCompositionOffset, so the
+// samples closest to req_time are within that range of a decode order search.
+status_t SampleTable::findSampleInWindow_l(
+        uint64_t req_time, uint64_t scale_num, uint64_t scale_den,
+        uint32_t *sample_index, uint32_t flags) {
+    // samples before |first| are certainly earlier than req_time, samples from
+    // |last| on certainly later
+    const uint32_t first = findDecodeIndex_l(
+            mMaxCompositionOffset, req_time, scale_num, scale_den, false /* after */);
+    const uint32_t last = findDecodeIndex_l(
+            mMinCompositionOffset, req_time, scale_num, scale_den, true /* after */);
+
+    bool hasBefore = false;
+    bool hasAfter = false;
+    uint32_t before = 0;
+    uint32_t after = 0;
+    uint32_t beforeTime = 0;
+    uint32_t afterTime = 0;
+    uint32_t time = 0;
+    uint32_t decodeTime = 0;
+
+    for (uint32_t i = first; i < last; ++i) {
+        getCompositionTime_l(i, &time);
+        uint64_t sampleTime = scaleTime(time, scale_num, scale_den);
+        if (sampleTime == req_time) {
+            *sample_index = i;
+            return OK;
+        }
+        if (sampleTime < req_time) {
+            if (!hasBefore || time > beforeTime) {
+                hasBefore = true;
+                before = i;
+                beforeTime = time;
+            }
+        } else if (!hasAfter || time < afterTime) {
+            hasAfter = true;
+            after = i;
+            afterTime = time;
+        }
+    }
+
+    // the latest earlier sample is at most the offset range before |first|
+    for (uint32_t i = first; i-- > 0;) {
+        getDecodeTime_l(i, &decodeTime);
+        if (hasBefore && (int64_t)decodeTime + mMaxCompositionOffset <= beforeTime) {
+            break;
+        }
+        getCompositionTime_l(i, &time);
+        if (!hasBefore || time > beforeTime) {
+            hasBefore = true;
+            before = i;
+            beforeTime = time;
+        }
+    }
+
+    // and the earliest later sample at most the offset range after |last|
+    for (uint32_t i = last; i < mNumSampleSizes; ++i) {
+        getDecodeTime_l(i, &decodeTime);
+        if (hasAfter && (int64_t)decodeTime + mMinCompositionOffset >= afterTime) {
+            break;
+        }
+        getCompositionTime_l(i, &time);
+        if (!hasAfter || time < afterTime) {
+            hasAfter = true;
+            after = i;
+            afterTime = time;
+        }
+    }
+
+    if (!hasAfter) {
+        if (flags == kFlagAfter) {
+            return ERROR_OUT_OF_RANGE;
+        }
+        flags = kFlagBefore;
+    } else if (!hasBefore) {
+        // as in findSampleAtTime(), return the first sample rather than
+        // out of range
+        flags = kFlagAfter;
+    }
+
+    switch (flags) {
+        case kFlagBefore:
+        {
+            *sample_index = before;
+            break;
+        }
+
+        case kFlagAfter:
+        {
+            *sample_index = after;
+            break;
+        }
+
+        default:
+        {
+            CHECK(flags == kFlagClosest);
+            // pick closest based on timestamp. use abs_difference for safety
+            if (abs_difference(scaleTime(afterTime, scale_num, scale_den), req_time) >
+                abs_difference(req_time, scaleTime(beforeTime, scale_num, scale_den))) {
+                *sample_index = before;
+            } else {
+                *sample_index = after;
+            }
+            break;
+        }
+    }
+
+    return OK;
+}
+
+status_t SampleTable::getSyncSample_l(uint32_t index, uint32_t *sampleIndex) {
+    uint32_t x;
+    status_t err = mSyncSamples->read((uint64_t)index * sizeof(x), &x, sizeof(x));
+    if (err != OK) {
+        return err;
+    }
+
+    x = ntohl(x);
+    if (x == 0) {
+        // b/32423862, unexpected zero value in stss
+        *sampleIndex = 0;
+    } else {
+        *sampleIndex = x - 1;
+    }
+
+    return OK;
+}
+
+// Finds the first sync sample at or after sampleIndex, starting at the sync
+// sample table entry |first|. Sets |index| to mNumSyncSamples if there is none.
+status_t SampleTable::findSyncSampleIndex_l(
+        uint32_t sampleIndex, uint32_t first, uint32_t *index) {
+    uint32_t left = first;
+    uint32_t right_plus_one = mNumSyncSamples;
+    while (left < right_plus_one) {
+        uint32_t center = left + (right_plus_one - left) / 2;
+        uint32_t x;
+        status_t err = getSyncSample_l(center, &x);
+        if (err != OK) {
+            return err;
+        }
+
+        if (x < sampleIndex) {
+            left = center + 1;
+        } else {
+            right_plus_one = center;
+        }
+    }
+
+    *index = left;
     return OK;
 }
 
@@ -795,17 +1326,18 @@ status_t SampleTable::findSyncSampleNear(
         return OK;
     }
 
-    uint32_t left = 0;
-    uint32_t right_plus_one = mNumSyncSamples;
-    while (left < right_plus_one) {
-        uint32_t center = left + (right_plus_one - left) / 2;
-        uint32_t x = mSyncSamples[center];
+    uint32_t left;
+    status_t err = findSyncSampleIndex_l(start_sample_index, 0, &left);
+    if (err != OK) {
+        return err;
+    }
 
-        if (start_sample_index < x) {
-            right_plus_one = center;
-        } else if (start_sample_index > x) {
-            left = center + 1;
-        } else {
+    uint32_t x;
+    if (left < mNumSyncSamples) {
+        if ((err = getSyncSample_l(left, &x)) != OK) {
+            return err;
+        }
+        if (x == start_sample_index) {
             *sample_index = x;
             return OK;
         }
@@ -847,20 +1379,22 @@ status_t SampleTable::findSyncSampleNear(
             // this route is not used, but implement it nonetheless
             CHECK(flags == kFlagClosest);
 
-            status_t err = mSampleIterator->seekTo(start_sample_index);
+            err = mSampleIterator->seekTo(start_sample_index);
             if (err != OK) {
                 return err;
             }
             uint32_t sample_time = mSampleIterator->getSampleTime();
 
-            err = mSampleIterator->seekTo(mSyncSamples[left]);
-            if (err != OK) {
+            uint32_t upper;
+            if ((err = getSyncSample_l(left, &upper)) != OK
+                    || (err = mSampleIterator->seekTo(upper)) != OK) {
                 return err;
             }
             uint32_t upper_time = mSampleIterator->getSampleTime();
 
-            err = mSampleIterator->seekTo(mSyncSamples[left - 1]);
-            if (err != OK) {
+            uint32_t lower;
+            if ((err = getSyncSample_l(left - 1, &lower)) != OK
+                    || (err = mSampleIterator->seekTo(lower)) != OK) {
                 return err;
             }
             uint32_t lower_time = mSampleIterator->getSampleTime();
@@ -874,8 +1408,7 @@ status_t SampleTable::findSyncSampleNear(
         }
     }
 
-    *sample_index = mSyncSamples[left];
-    return OK;
+    return getSyncSample_l(left, sample_index);
 }
 
 status_t SampleTable::findThumbnailSample(uint32_t *sample_index) {
@@ -901,11 +1434,15 @@ status_t SampleTable::findThumbnailSample(uint32_t *sample_index) {
     }
 
     for (size_t i = 0; i < numSamplesToScan; ++i) {
-        uint32_t x = mSyncSamples[i];
+        uint32_t x;
+        status_t err = getSyncSample_l(i, &x);
+        if (err != OK) {
+            return err;
+        }
 
         // Now x is a sample index.
         size_t sampleSize;
-        status_t err = getSampleSize_l(x, &sampleSize);
+        err = getSampleSize_l(x, &sampleSize);
         if (err != OK) {
             return err;
         }
@@ -959,15 +1496,35 @@ status_t SampleTable::getMetaDataForSample(
             // Every sample is a sync sample.
             *isSyncSample = true;
         } else {
-            size_t i = (mLastSyncSampleIndex < mNumSyncSamples)
-                    && (mSyncSamples[mLastSyncSampleIndex] <= sampleIndex)
-                ? mLastSyncSampleIndex : 0;
+            // Samples are mostly read in order, so check the sync sample
+            // found last time before searching.
+            uint32_t i = mNumSyncSamples;
+            uint32_t x = 0;
+            if (mLastSyncSampleIndex < mNumSyncSamples
+                    && getSyncSample_l(mLastSyncSampleIndex, &x) == OK
+                    && x >= sampleIndex) {
+                uint32_t previous;
+                if (mLastSyncSampleIndex == 0
+                        || (getSyncSample_l(mLastSyncSampleIndex - 1, &previous) == OK
+                                && previous < sampleIndex)) {
+                    i = mLastSyncSampleIndex;
+                }
+            }
 
-            while (i < mNumSyncSamples && mSyncSamples[i] < sampleIndex) {
-                ++i;
+            if (i == mNumSyncSamples) {
+                uint32_t first = 0;
+                if (mLastSyncSampleIndex < mNumSyncSamples && x < sampleIndex) {
+                    first = mLastSyncSampleIndex;
+                }
+                if ((err = findSyncSampleIndex_l(sampleIndex, first, &i)) != OK) {
+                    return err;
+                }
+                if (i < mNumSyncSamples && (err = getSyncSample_l(i, &x)) != OK) {
+                    return err;
+                }
             }
 
-            if (i < mNumSyncSamples && mSyncSamples[i] == sampleIndex) {
+            if (i < mNumSyncSamples && x == sampleIndex) {
                 *isSyncSample = true;
             }
 
@@ -430,6 +430,7 @@ static VideoFrame *extractVideoFrame(
     CHECK(outputFormat->findInt32("color-format", &srcFormat));
 
     ColorConverter converter((OMX_COLOR_FORMATTYPE)srcFormat, OMX_COLOR_Format16bitRGB565);
+    converter.setNumThreads(ColorConverter::kMaxThreads);
 
     if (converter.isValid()) {
         err = converter.convert(
@@ -21,6 +21,16 @@
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/ColorConverter.h>
 #include <media/stagefright/MediaErrors.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
+#include <string.h>
+
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "libyuv/convert_from.h"
 
@@ -28,11 +38,426 @@
 
 namespace android {
 
+// Conversion of planar and semi-planar YUV 4:2:0 to RGB565, one row at a time.
+//
+// B = 1.164 * (Y - 16) + 2.018 * (U - 128)
+// G = 1.164 * (Y - 16) - 0.813 * (V - 128) - 0.391 * (U - 128)
+// R = 1.164 * (Y - 16) + 1.596 * (V - 128)
+//
+// B = 298/256 * (Y - 16) + 517/256 * (U - 128)
+// G = .................. - 208/256 * (V - 128) - 100/256 * (U - 128)
+// R = .................. + 409/256 * (V - 128)
+//
+// min_B = (298 * (- 16) + 517 * (- 128)) / 256 = -277
+// min_G = (298 * (- 16) - 208 * (255 - 128) - 100 * (255 - 128)) / 256 = -172
+// min_R = (298 * (- 16) + 409 * (- 128)) / 256 = -223
+//
+// max_B = (298 * (255 - 16) + 517 * (255 - 128)) / 256 = 534
+// max_G = (298 * (255 - 16) - 208 * (- 128) - 100 * (- 128)) / 256 = 432
+// max_R = (298 * (255 - 16) + 409 * (255 - 128)) / 256 = 481
+//
+// clip range -278 .. 535
+//
+// The vector converters shift instead of dividing by 256, which only differs
+// for negative values, and saturate instead of using the clip table. Both
+// map every negative value to 0, so they are bit exact with the scalar code.
+
+enum ChromaLayout {
+    kChromaPlanar,          // separate U and V planes
+    kChromaInterleavedUV,   // one plane of U,V pairs
+    kChromaInterleavedVU,   // one plane of V,U pairs
+};
+
+// Converts |width| pixels of a row. |u| and |v| point to the chroma samples of
+// the first pixel pair; for interleaved layouts they are one byte apart.
+typedef void (*ConvertRowFunc)(
+        const uint8_t *y, const uint8_t *u, const uint8_t *v,
+        uint16_t *dst, size_t width, const uint8_t *clip);
+
+template <bool BGR>
+static inline uint32_t packRGB565(const uint8_t *clip, signed r, signed g, signed b) {
+    if (BGR) {
+        return ((clip[b] >> 3) << 11) | ((clip[g] >> 2) << 5) | (clip[r] >> 3);
+    }
+    return ((clip[r] >> 3) << 11) | ((clip[g] >> 2) << 5) | (clip[b] >> 3);
+}
+
+template <ChromaLayout LAYOUT, bool BGR>
+static void convertRowScalar(
+        const uint8_t *src_y, const uint8_t *src_u, const uint8_t *src_v,
+        uint16_t *dst_ptr, size_t width, const uint8_t *kAdjustedClip) {
+    const size_t uvStep = LAYOUT == kChromaPlanar ? 1 : 2;
+
+    for (size_t x = 0; x < width; x += 2) {
+        signed y1 = (signed)src_y[x] - 16;
+        signed y2 = (signed)src_y[x + 1] - 16;
+
+        signed u = (signed)src_u[(x / 2) * uvStep] - 128;
+        signed v = (signed)src_v[(x / 2) * uvStep] - 128;
+
+        signed u_b = u * 517;
+        signed u_g = -u * 100;
+        signed v_g = -v * 208;
+        signed v_r = v * 409;
+
+        signed tmp1 = y1 * 298;
+        signed b1 = (tmp1 + u_b) / 256;
+        signed g1 = (tmp1 + v_g + u_g) / 256;
+        signed r1 = (tmp1 + v_r) / 256;
+
+        signed tmp2 = y2 * 298;
+        signed b2 = (tmp2 + u_b) / 256;
+        signed g2 = (tmp2 + v_g + u_g) / 256;
+        signed r2 = (tmp2 + v_r) / 256;
+
+        uint32_t rgb1 = packRGB565<BGR>(kAdjustedClip, r1, g1, b1);
+        uint32_t rgb2 = packRGB565<BGR>(kAdjustedClip, r2, g2, b2);
+
+        if (x + 1 < width) {
+            *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
+        } else {
+            dst_ptr[x] = rgb1;
+        }
+    }
+}
+
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+
+#define USE_COLOR_CONVERTER_SIMD 1
+
+// Converts 8 pixels per iteration, the remainder with the scalar code.
+template <ChromaLayout LAYOUT, bool BGR>
+static void convertRowSimd(
+        const uint8_t *src_y, const uint8_t *src_u, const uint8_t *src_v,
+        uint16_t *dst_ptr, size_t width, const uint8_t *kAdjustedClip) {
+    const int16x8_t k16 = vdupq_n_s16(16);
+    const int16x8_t k128 = vdupq_n_s16(128);
+    const uint8_t *src_uv = LAYOUT == kChromaInterleavedVU ? src_v : src_u;
+
+    size_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+        int16x8_t y = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(src_y + x))), k16);
+
+        // one chroma sample per pixel pair, duplicated for both pixels
+        uint8x8_t u8, v8;
+        if (LAYOUT == kChromaPlanar) {
+            uint32_t u4, v4;
+            memcpy(&u4, src_u + x / 2, sizeof(u4));
+            memcpy(&v4, src_v + x / 2, sizeof(v4));
+            uint8x8_t u = vreinterpret_u8_u32(vdup_n_u32(u4));
+            uint8x8_t v = vreinterpret_u8_u32(vdup_n_u32(v4));
+            u8 = vzip_u8(u, u).val[0];
+            v8 = vzip_u8(v, v).val[0];
+        } else {
+            uint8x8_t c = vld1_u8(src_uv + x);
+            uint8x8x2_t pairs = vtrn_u8(c, c);
+            u8 = LAYOUT == kChromaInterleavedUV ? pairs.val[0] : pairs.val[1];
+            v8 = LAYOUT == kChromaInterleavedUV ? pairs.val[1] : pairs.val[0];
+        }
+        int16x8_t u = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u8)), k128);
+        int16x8_t v = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v8)), k128);
+
+        int32x4_t y_lo = vmull_n_s16(vget_low_s16(y), 298);
+        int32x4_t y_hi = vmull_n_s16(vget_high_s16(y), 298);
+
+        int32x4_t b_lo = vmlal_n_s16(y_lo, vget_low_s16(u), 517);
+        int32x4_t b_hi = vmlal_n_s16(y_hi, vget_high_s16(u), 517);
+        int32x4_t g_lo = vmlal_n_s16(
+                vmlal_n_s16(y_lo, vget_low_s16(u), -100), vget_low_s16(v), -208);
+        int32x4_t g_hi = vmlal_n_s16(
+                vmlal_n_s16(y_hi, vget_high_s16(u), -100), vget_high_s16(v), -208);
+        int32x4_t r_lo = vmlal_n_s16(y_lo, vget_low_s16(v), 409);
+        int32x4_t r_hi = vmlal_n_s16(y_hi, vget_high_s16(v), 409);
+
+        uint8x8_t b = vqmovun_s16(vcombine_s16(vshrn_n_s32(b_lo, 8), vshrn_n_s32(b_hi, 8)));
+        uint8x8_t g = vqmovun_s16(vcombine_s16(vshrn_n_s32(g_lo, 8), vshrn_n_s32(g_hi, 8)));
+        uint8x8_t r = vqmovun_s16(vcombine_s16(vshrn_n_s32(r_lo, 8), vshrn_n_s32(r_hi, 8)));
+
+        uint16x8_t rgb = vshll_n_u8(BGR ? b : r, 8);
+        rgb = vsriq_n_u16(rgb, vshll_n_u8(g, 8), 5);
+        rgb = vsriq_n_u16(rgb, vshll_n_u8(BGR ? r : b, 8), 11);
+        vst1q_u16(dst_ptr + x, rgb);
+    }
+
+    if (x < width) {
+        const size_t uvOffset = LAYOUT == kChromaPlanar ? x / 2 : x;
+        convertRowScalar<LAYOUT, BGR>(
+                src_y + x, src_u + uvOffset, src_v + uvOffset,
+                dst_ptr + x, width - x, kAdjustedClip);
+    }
+}
+
+#elif defined(__SSE2__)
+
+#define USE_COLOR_CONVERTER_SIMD 1
+
+// Converts 8 pixels per iteration, the remainder with the scalar code.
+// SSE2 has no 32-bit multiply, so the products are formed with
+// _mm_madd_epi16 on interleaved pairs of samples.
+template <ChromaLayout LAYOUT, bool BGR>
+static void convertRowSimd(
+        const uint8_t *src_y, const uint8_t *src_u, const uint8_t *src_v,
+        uint16_t *dst_ptr, size_t width, const uint8_t *kAdjustedClip) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i k16 = _mm_set1_epi16(16);
+    const __m128i k128 = _mm_set1_epi16(128);
+    const __m128i kYU_B = _mm_setr_epi16(298, 517, 298, 517, 298, 517, 298, 517);
+    const __m128i kYV_R = _mm_setr_epi16(298, 409, 298, 409, 298, 409, 298, 409);
+    const __m128i kY0_G = _mm_setr_epi16(298, 0, 298, 0, 298, 0, 298, 0);
+    const __m128i kUV_G = _mm_setr_epi16(-100, -208, -100, -208, -100, -208, -100, -208);
+    const __m128i kMask5 = _mm_set1_epi16(0xf8);
+    const __m128i kMask6 = _mm_set1_epi16(0xfc);
+    const uint8_t *src_uv = LAYOUT == kChromaInterleavedVU ? src_v : src_u;
+
+    size_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i y = _mm_sub_epi16(
+                _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(src_y + x)), zero), k16);
+
+        // one chroma sample per pixel pair, duplicated for both pixels
+        __m128i u, v;
+        if (LAYOUT == kChromaPlanar) {
+            int32_t u4, v4;
+            memcpy(&u4, src_u + x / 2, sizeof(u4));
+            memcpy(&v4, src_v + x / 2, sizeof(v4));
+            u = _mm_cvtsi32_si128(u4);
+            v = _mm_cvtsi32_si128(v4);
+            u = _mm_unpacklo_epi8(_mm_unpacklo_epi8(u, u), zero);
+            v = _mm_unpacklo_epi8(_mm_unpacklo_epi8(v, v), zero);
+        } else {
+            __m128i c = _mm_unpacklo_epi8(
+                    _mm_loadl_epi64((const __m128i *)(src_uv + x)), zero);
+            __m128i even = _mm_shufflehi_epi16(
+                    _mm_shufflelo_epi16(c, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+            __m128i odd = _mm_shufflehi_epi16(
+                    _mm_shufflelo_epi16(c, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+            u = LAYOUT == kChromaInterleavedUV ? even : odd;
+            v = LAYOUT == kChromaInterleavedUV ? odd : even;
+        }
+        u = _mm_sub_epi16(u, k128);
+        v = _mm_sub_epi16(v, k128);
+
+        __m128i yu_lo = _mm_unpacklo_epi16(y, u);
+        __m128i yu_hi = _mm_unpackhi_epi16(y, u);
+        __m128i yv_lo = _mm_unpacklo_epi16(y, v);
+        __m128i yv_hi = _mm_unpackhi_epi16(y, v);
+        __m128i uv_lo = _mm_unpacklo_epi16(u, v);
+        __m128i uv_hi = _mm_unpackhi_epi16(u, v);
+
+        __m128i b = _mm_packs_epi32(
+                _mm_srai_epi32(_mm_madd_epi16(yu_lo, kYU_B), 8),
+                _mm_srai_epi32(_mm_madd_epi16(yu_hi, kYU_B), 8));
+        __m128i g = _mm_packs_epi32(
+                _mm_srai_epi32(_mm_add_epi32(
+                        _mm_madd_epi16(yu_lo, kY0_G), _mm_madd_epi16(uv_lo, kUV_G)), 8),
+                _mm_srai_epi32(_mm_add_epi32(
+                        _mm_madd_epi16(yu_hi, kY0_G), _mm_madd_epi16(uv_hi, kUV_G)), 8));
+        __m128i r = _mm_packs_epi32(
+                _mm_srai_epi32(_mm_madd_epi16(yv_lo, kYV_R), 8),
+                _mm_srai_epi32(_mm_madd_epi16(yv_hi, kYV_R), 8));
+
+        // saturate to 0..255
+        b = _mm_unpacklo_epi8(_mm_packus_epi16(b, b), zero);
+        g = _mm_unpacklo_epi8(_mm_packus_epi16(g, g), zero);
+        r = _mm_unpacklo_epi8(_mm_packus_epi16(r, r), zero);
+
+        __m128i rgb = _mm_or_si128(
+                _mm_or_si128(
+                        _mm_slli_epi16(_mm_and_si128(BGR ? b : r, kMask5), 8),
+                        _mm_slli_epi16(_mm_and_si128(g, kMask6), 3)),
+                _mm_srli_epi16(BGR ? r : b, 3));
+        _mm_storeu_si128((__m128i *)(dst_ptr + x), rgb);
+    }
+
+    if (x < width) {
+        const size_t uvOffset = LAYOUT == kChromaPlanar ? x / 2 : x;
+        convertRowScalar<LAYOUT, BGR>(
+                src_y + x, src_u + uvOffset, src_v + uvOffset,
+                dst_ptr + x, width - x, kAdjustedClip);
+    }
+}
+
+#else
+
+#define USE_COLOR_CONVERTER_SIMD 0
+
+#endif
+
+template <ChromaLayout LAYOUT, bool BGR>
+static ConvertRowFunc GetRowConverter(bool useSimd) {
+#if USE_COLOR_CONVERTER_SIMD
+    if (useSimd) {
+        return convertRowSimd<LAYOUT, BGR>;
+    }
+#else
+    (void)useSimd;
+#endif
+    return convertRowScalar<LAYOUT, BGR>;
+}
+
+// The planes of a source frame and the destination, all offset to the first
+// pixel to convert.
+struct YUVFrame {
+    const uint8_t *mY;
+    const uint8_t *mU;
+    const uint8_t *mV;
+    size_t mYStride;
+    size_t mUVStride;
+    uint16_t *mDst;
+    size_t mDstStride;
+    size_t mWidth;
+    size_t mHeight;
+    ConvertRowFunc mConvertRow;
+    const uint8_t *mClip;
+};
+
+static void convertRows(const YUVFrame &frame, size_t firstRow, size_t endRow) {
+    for (size_t y = firstRow; y < endRow; ++y) {
+        frame.mConvertRow(
+                frame.mY + y * frame.mYStride,
+                frame.mU + (y / 2) * frame.mUVStride,
+                frame.mV + (y / 2) * frame.mUVStride,
+                frame.mDst + y * frame.mDstStride,
+                frame.mWidth, frame.mClip);
+    }
+}
+
+static void convertBand(const YUVFrame &frame, size_t band, size_t numBands) {
+    // start bands on even rows so that no chroma row is shared between bands
+    const size_t rowsPerBand = ((frame.mHeight + numBands - 1) / numBands + 1) & ~1;
+    const size_t firstRow = band * rowsPerBand;
+    const size_t endRow = firstRow + rowsPerBand;
+    if (firstRow < frame.mHeight) {
+        convertRows(frame, firstRow, endRow < frame.mHeight ? endRow : frame.mHeight);
+    }
+}
+
+// Worker threads shared by all converters in the process. A frame is split
+// into row bands which the workers and the calling thread convert in parallel.
+struct RowBandWorkers {
+    static RowBandWorkers *Get() {
+        static RowBandWorkers *sWorkers = new RowBandWorkers;
+        return sWorkers;
+    }
+
+    // Converts |frame| in |numBands| bands. Returns false without converting
+    // anything if the workers are busy with another frame.
+    bool convert(const YUVFrame &frame, size_t numBands) {
+        if (mConvertLock.tryLock() != OK) {
+            return false;
+        }
+
+        {
+            Mutex::Autolock autoLock(mLock);
+            mFrame = &frame;
+            mNumBands = numBands;
+            mNextBand = 0;
+            mBandsDone = 0;
+            mWorkAvailable.broadcast();
+        }
+
+        convertBands();
+
+        {
+            Mutex::Autolock autoLock(mLock);
+            while (mBandsDone < mNumBands) {
+                mAllBandsDone.wait(mLock);
+            }
+            mFrame = NULL;
+        }
+
+        mConvertLock.unlock();
+        return true;
+    }
+
+private:
+    struct Worker : public Thread {
+        Worker(RowBandWorkers *owner)
+            : Thread(false /* canCallJava */),
+              mOwner(owner) {
+        }
+
+        virtual bool threadLoop() {
+            mOwner->waitForWork();
+            mOwner->convertBands();
+            return true;
+        }
+
+    private:
+        RowBandWorkers *mOwner;
+    };
+
+    Mutex mConvertLock;
+    Mutex mLock;
+    Condition mWorkAvailable;
+    Condition mAllBandsDone;
+    const YUVFrame *mFrame;
+    size_t mNumBands;
+    size_t mNextBand;
+    size_t mBandsDone;
+    Vector<sp<Worker> > mWorkers;
+
+    RowBandWorkers()
+        : mFrame(NULL),
+          mNumBands(0),
+          mNextBand(0),
+          mBandsDone(0) {
+        for (size_t i = 1; i < ColorConverter::kMaxThreads; ++i) {
+            sp<Worker> worker = new Worker(this);
+            worker->run("ColorConverter");
+            mWorkers.push(worker);
+        }
+    }
+
+    void waitForWork() {
+        Mutex::Autolock autoLock(mLock);
+        while (mFrame == NULL || mNextBand >= mNumBands) {
+            mWorkAvailable.wait(mLock);
+        }
+    }
+
+    // Converts bands of the current frame until none is left to start.
+    void convertBands() {
+        Mutex::Autolock autoLock(mLock);
+        while (mFrame != NULL && mNextBand < mNumBands) {
+            const YUVFrame *frame = mFrame;
+            const size_t numBands = mNumBands;
+            const size_t band = mNextBand++;
+
+            mLock.unlock();
+            convertBand(*frame, band, numBands);
+            mLock.lock();
+
+            if (++mBandsDone == mNumBands) {
+                mAllBandsDone.signal();
+            }
+        }
+    }
+
+    DISALLOW_EVIL_CONSTRUCTORS(RowBandWorkers);
+};
+
+// Frames with fewer rows per thread than this are not worth splitting.
+static const size_t kMinRowsPerBand = 64;
+
+static void convertFrame(const YUVFrame &frame, size_t numThreads) {
+    size_t numBands = frame.mHeight / kMinRowsPerBand;
+    if (numBands > numThreads) {
+        numBands = numThreads;
+    }
+    if (numBands > 1 && RowBandWorkers::Get()->convert(frame, numBands)) {
+        return;
+    }
+    convertRows(frame, 0, frame.mHeight);
+}
+
 ColorConverter::ColorConverter(
         OMX_COLOR_FORMATTYPE from, OMX_COLOR_FORMATTYPE to)
     : mSrcFormat(from),
       mDstFormat(to),
-      mClip(NULL) {
+      mClip(NULL),
+      mNumThreads(1),
+      mUseSimd(true) {
 }
 
 ColorConverter::~ColorConverter() {
@@ -40,6 +465,19 @@ ColorConverter::~ColorConverter() {
     mClip = NULL;
 }
 
+void ColorConverter::setNumThreads(size_t numThreads) {
+    if (numThreads < 1) {
+        numThreads = 1;
+    } else if (numThreads > kMaxThreads) {
+        numThreads = kMaxThreads;
+    }
+    mNumThreads = numThreads;
+}
+
+void ColorConverter::setUseSimd(bool useSimd) {
+    mUseSimd = useSimd;
+}
+
 bool ColorConverter::isValid() const {
     if (mDstFormat != OMX_COLOR_Format16bitRGB565) {
         return false;
@@ -240,95 +678,38 @@ status_t ColorConverter::convertYUV420Planar(
         return ERROR_UNSUPPORTED;
     }
 
-    uint8_t *kAdjustedClip = initClip();
+    YUVFrame frame;
+    frame.mClip = initClip();
 
-    uint16_t *dst_ptr = (uint16_t *)dst.mBits
+    frame.mDst = (uint16_t *)dst.mBits
         + dst.mCropTop * dst.mWidth + dst.mCropLeft;
+    frame.mDstStride = dst.mWidth;
 
-    const uint8_t *src_y =
+    frame.mY =
         (const uint8_t *)src.mBits + src.mCropTop * src.mWidth + src.mCropLeft;
+    frame.mYStride = src.mWidth;
 
-    const uint8_t *src_u =
-        (const uint8_t *)src_y + src.mWidth * src.mHeight
+    frame.mU =
+        frame.mY + src.mWidth * src.mHeight
         + src.mCropTop * (src.mWidth / 2) + src.mCropLeft / 2;
 
-    const uint8_t *src_v =
-        src_u + (src.mWidth / 2) * (src.mHeight / 2);
-
-    for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            // B = 1.164 * (Y - 16) + 2.018 * (U - 128)
-            // G = 1.164 * (Y - 16) - 0.813 * (V - 128) - 0.391 * (U - 128)
-            // R = 1.164 * (Y - 16) + 1.596 * (V - 128)
-
-            // B = 298/256 * (Y - 16) + 517/256 * (U - 128)
-            // G = .................. - 208/256 * (V - 128) - 100/256 * (U - 128)
-            // R = .................. + 409/256 * (V - 128)
-
-            // min_B = (298 * (- 16) + 517 * (- 128)) / 256 = -277
-            // min_G = (298 * (- 16) - 208 * (255 - 128) - 100 * (255 - 128)) / 256 = -172
-            // min_R = (298 * (- 16) + 409 * (- 128)) / 256 = -223
-
-            // max_B = (298 * (255 - 16) + 517 * (255 - 128)) / 256 = 534
-            // max_G = (298 * (255 - 16) - 208 * (- 128) - 100 * (- 128)) / 256 = 432
-            // max_R = (298 * (255 - 16) + 409 * (255 - 128)) / 256 = 481
-
-            // clip range -278 .. 535
-
-            signed y1 = (signed)src_y[x] - 16;
-            signed y2 = (signed)src_y[x + 1] - 16;
-
-            signed u = (signed)src_u[x / 2] - 128;
-            signed v = (signed)src_v[x / 2] - 128;
-
-            signed u_b = u * 517;
-            signed u_g = -u * 100;
-            signed v_g = -v * 208;
-            signed v_r = v * 409;
-
-            signed tmp1 = y1 * 298;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
-
-            signed tmp2 = y2 * 298;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
-
-            uint32_t rgb1 =
-                ((kAdjustedClip[r1] >> 3) << 11)
-                | ((kAdjustedClip[g1] >> 2) << 5)
-                | (kAdjustedClip[b1] >> 3);
-
-            uint32_t rgb2 =
-                ((kAdjustedClip[r2] >> 3) << 11)
-                | ((kAdjustedClip[g2] >> 2) << 5)
-                | (kAdjustedClip[b2] >> 3);
-
-            if (x + 1 < src.cropWidth()) {
-                *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
-            } else {
-                dst_ptr[x] = rgb1;
-            }
-        }
-
-        src_y += src.mWidth;
+    frame.mV =
+        frame.mU + (src.mWidth / 2) * (src.mHeight / 2);
+    frame.mUVStride = src.mWidth / 2;
 
-        if (y & 1) {
-            src_u += src.mWidth / 2;
-            src_v += src.mWidth / 2;
-        }
+    frame.mWidth = src.cropWidth();
+    frame.mHeight = src.cropHeight();
+    frame.mConvertRow = GetRowConverter<kChromaPlanar, false /* BGR */>(mUseSimd);
 
-        dst_ptr += dst.mWidth;
-    }
+    convertFrame(frame, mNumThreads);
 
     return OK;
 }
 
 status_t ColorConverter::convertQCOMYUV420SemiPlanar(
         const BitmapParams &src, const BitmapParams &dst) {
-    uint8_t *kAdjustedClip = initClip();
+    YUVFrame frame;
+    frame.mClip = initClip();
 
     if (!((src.mCropLeft & 1) == 0
             && src.cropWidth() == dst.cropWidth()
@@ -336,64 +717,25 @@ status_t ColorConverter::convertQCOMYUV420SemiPlanar(
         return ERROR_UNSUPPORTED;
     }
 
-    uint16_t *dst_ptr = (uint16_t *)dst.mBits
+    frame.mDst = (uint16_t *)dst.mBits
         + dst.mCropTop * dst.mWidth + dst.mCropLeft;
+    frame.mDstStride = dst.mWidth;
 
-    const uint8_t *src_y =
+    frame.mY =
         (const uint8_t *)src.mBits + src.mCropTop * src.mWidth + src.mCropLeft;
+    frame.mYStride = src.mWidth;
 
-    const uint8_t *src_u =
-        (const uint8_t *)src_y + src.mWidth * src.mHeight
+    frame.mU =
+        frame.mY + src.mWidth * src.mHeight
         + src.mCropTop * src.mWidth + src.mCropLeft;
+    frame.mV = frame.mU + 1;
+    frame.mUVStride = src.mWidth;
 
-    for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            signed y1 = (signed)src_y[x] - 16;
-            signed y2 = (signed)src_y[x + 1] - 16;
+    frame.mWidth = src.cropWidth();
+    frame.mHeight = src.cropHeight();
+    frame.mConvertRow = GetRowConverter<kChromaInterleavedUV, true /* BGR */>(mUseSimd);
 
-            signed u = (signed)src_u[x & ~1] - 128;
-            signed v = (signed)src_u[(x & ~1) + 1] - 128;
-
-            signed u_b = u * 517;
-            signed u_g = -u * 100;
-            signed v_g = -v * 208;
-            signed v_r = v * 409;
-
-            signed tmp1 = y1 * 298;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
-
-            signed tmp2 = y2 * 298;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
-
-            uint32_t rgb1 =
-                ((kAdjustedClip[b1] >> 3) << 11)
-                | ((kAdjustedClip[g1] >> 2) << 5)
-                | (kAdjustedClip[r1] >> 3);
-
-            uint32_t rgb2 =
-                ((kAdjustedClip[b2] >> 3) << 11)
-                | ((kAdjustedClip[g2] >> 2) << 5)
-                | (kAdjustedClip[r2] >> 3);
-
-            if (x + 1 < src.cropWidth()) {
-                *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
-            } else {
-                dst_ptr[x] = rgb1;
-            }
-        }
-
-        src_y += src.mWidth;
-
-        if (y & 1) {
-            src_u += src.mWidth;
-        }
-
-        dst_ptr += dst.mWidth;
-    }
+    convertFrame(frame, mNumThreads);
 
     return OK;
 }
@@ -402,7 +744,8 @@ status_t ColorConverter::convertYUV420SemiPlanar(
         const BitmapParams &src, const BitmapParams &dst) {
     // XXX Untested
 
-    uint8_t *kAdjustedClip = initClip();
+    YUVFrame frame;
+    frame.mClip = initClip();
 
     if (!((src.mCropLeft & 1) == 0
             && src.cropWidth() == dst.cropWidth()
@@ -410,71 +753,34 @@ status_t ColorConverter::convertYUV420SemiPlanar(
         return ERROR_UNSUPPORTED;
     }
 
-    uint16_t *dst_ptr = (uint16_t *)dst.mBits
+    frame.mDst = (uint16_t *)dst.mBits
         + dst.mCropTop * dst.mWidth + dst.mCropLeft;
+    frame.mDstStride = dst.mWidth;
 
-    const uint8_t *src_y =
+    frame.mY =
         (const uint8_t *)src.mBits + src.mCropTop * src.mWidth + src.mCropLeft;
+    frame.mYStride = src.mWidth;
 
-    const uint8_t *src_u =
-        (const uint8_t *)src_y + src.mWidth * src.mHeight
+    // chroma samples are stored V first
+    frame.mV =
+        frame.mY + src.mWidth * src.mHeight
         + src.mCropTop * src.mWidth + src.mCropLeft;
+    frame.mU = frame.mV + 1;
+    frame.mUVStride = src.mWidth;
 
-    for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            signed y1 = (signed)src_y[x] - 16;
-            signed y2 = (signed)src_y[x + 1] - 16;
-
-            signed v = (signed)src_u[x & ~1] - 128;
-            signed u = (signed)src_u[(x & ~1) + 1] - 128;
-
-            signed u_b = u * 517;
-            signed u_g = -u * 100;
-            signed v_g = -v * 208;
-            signed v_r = v * 409;
+    frame.mWidth = src.cropWidth();
+    frame.mHeight = src.cropHeight();
+    frame.mConvertRow = GetRowConverter<kChromaInterleavedVU, true /* BGR */>(mUseSimd);
 
-            signed tmp1 = y1 * 298;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
-
-            signed tmp2 = y2 * 298;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
-
-            uint32_t rgb1 =
-                ((kAdjustedClip[b1] >> 3) << 11)
-                | ((kAdjustedClip[g1] >> 2) << 5)
-                | (kAdjustedClip[r1] >> 3);
-
-            uint32_t rgb2 =
-                ((kAdjustedClip[b2] >> 3) << 11)
-                | ((kAdjustedClip[g2] >> 2) << 5)
-                | (kAdjustedClip[r2] >> 3);
-
-            if (x + 1 < src.cropWidth()) {
-                *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
-            } else {
-                dst_ptr[x] = rgb1;
-            }
-        }
-
-        src_y += src.mWidth;
-
-        if (y & 1) {
-            src_u += src.mWidth;
-        }
-
-        dst_ptr += dst.mWidth;
-    }
+    convertFrame(frame, mNumThreads);
 
     return OK;
 }
 
 status_t ColorConverter::convertTIYUV420PackedSemiPlanar(
         const BitmapParams &src, const BitmapParams &dst) {
-    uint8_t *kAdjustedClip = initClip();
+    YUVFrame frame;
+    frame.mClip = initClip();
 
     if (!((src.mCropLeft & 1) == 0
             && src.cropWidth() == dst.cropWidth()
@@ -482,62 +788,23 @@ status_t ColorConverter::convertTIYUV420PackedSemiPlanar(
         return ERROR_UNSUPPORTED;
     }
 
-    uint16_t *dst_ptr = (uint16_t *)dst.mBits
+    frame.mDst = (uint16_t *)dst.mBits
         + dst.mCropTop * dst.mWidth + dst.mCropLeft;
+    frame.mDstStride = dst.mWidth;
 
-    const uint8_t *src_y = (const uint8_t *)src.mBits;
-
-    const uint8_t *src_u =
-        (const uint8_t *)src_y + src.mWidth * (src.mHeight - src.mCropTop / 2);
-
-    for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            signed y1 = (signed)src_y[x] - 16;
-            signed y2 = (signed)src_y[x + 1] - 16;
-
-            signed u = (signed)src_u[x & ~1] - 128;
-            signed v = (signed)src_u[(x & ~1) + 1] - 128;
-
-            signed u_b = u * 517;
-            signed u_g = -u * 100;
-            signed v_g = -v * 208;
-            signed v_r = v * 409;
-
-            signed tmp1 = y1 * 298;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
-
-            signed tmp2 = y2 * 298;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
-
-            uint32_t rgb1 =
-                ((kAdjustedClip[r1] >> 3) << 11)
-                | ((kAdjustedClip[g1] >> 2) << 5)
-                | (kAdjustedClip[b1] >> 3);
-
-            uint32_t rgb2 =
-                ((kAdjustedClip[r2] >> 3) << 11)
-                | ((kAdjustedClip[g2] >> 2) << 5)
-                | (kAdjustedClip[b2] >> 3);
-
-            if (x + 1 < src.cropWidth()) {
-                *(uint32_t *)(&dst_ptr[x]) = (rgb2 << 16) | rgb1;
-            } else {
-                dst_ptr[x] = rgb1;
-            }
-        }
+    frame.mY = (const uint8_t *)src.mBits;
+    frame.mYStride = src.mWidth;
 
-        src_y += src.mWidth;
+    frame.mU =
+        frame.mY + src.mWidth * (src.mHeight - src.mCropTop / 2);
+    frame.mV = frame.mU + 1;
+    frame.mUVStride = src.mWidth;
 
-        if (y & 1) {
-            src_u += src.mWidth;
-        }
+    frame.mWidth = src.cropWidth();
+    frame.mHeight = src.cropHeight();
+    frame.mConvertRow = GetRowConverter<kChromaInterleavedUV, false /* BGR */>(mUseSimd);
 
-        dst_ptr += dst.mWidth;
-    }
+    convertFrame(frame, mNumThreads);
 
     return OK;
 }
@@ -143,6 +143,7 @@ void SoftwareRenderer::resetFormatIfChanged(const sp<AMessage> &format) {
         mConverter = new ColorConverter(
                 mColorFormat, OMX_COLOR_Format16bitRGB565);
         CHECK(mConverter->isValid());
+        mConverter->setNumThreads(ColorConverter::kMaxThreads);
     }
 
     CHECK(mNativeWindow != NULL);
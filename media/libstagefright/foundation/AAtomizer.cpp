@@ -53,15 +53,4 @@ const char *AAtomizer::atomize(const char *name) {
     return (*--entry.end()).c_str();
 }
 
-// static
-uint32_t AAtomizer::Hash(const char *s) {
-    uint32_t sum = 0;
-    while (*s != '\0') {
-        sum = (sum * 31) + *s;
-        ++s;
-    }
-
-    return sum;
-}
-
 }  // namespace android
@@ -23,6 +23,8 @@
 
 namespace android {
 
+A_OBJECT_POOL_IMPLEMENT(ABuffer, 256)
+
 ABuffer::ABuffer(size_t capacity)
     : mMediaBufferBase(NULL),
       mRangeOffset(0),
@@ -23,6 +23,8 @@
 
 #include <sys/time.h>
 
+#include <algorithm>
+
 #include "ALooper.h"
 
 #include "AHandler.h"
@@ -70,7 +72,9 @@ int64_t ALooper::GetNowUs() {
 }
 
 ALooper::ALooper()
-    : mRunningLocally(false) {
+    : mPendingEvents(NULL),
+      mNextEventSeq(0),
+      mRunningLocally(false) {
     // clean up stale AHandlers. Doing it here instead of in the destructor avoids
     // the side effect of objects being deleted from the unregister function recursively.
     gLooperRoster.unregisterStaleHandlers();
@@ -78,6 +82,12 @@ ALooper::ALooper()
 
 ALooper::~ALooper() {
     stop();
+    PendingEvent *pending = mPendingEvents.exchange(NULL, std::memory_order_acquire);
+    while (pending != NULL) {
+        PendingEvent *next = pending->mNext;
+        delete pending;
+        pending = next;
+    }
     // stale AHandlers are now cleaned up in the constructor of the next ALooper to come along
 }
 
@@ -165,9 +175,41 @@ status_t ALooper::stop() {
     return OK;
 }
 
-void ALooper::post(const sp<AMessage> &msg, int64_t delayUs) {
-    Mutex::Autolock autoLock(mLock);
+// static
+__attribute__((no_sanitize("integer")))
+bool ALooper::EventLater(const Event &a, const Event &b) {
+    if (a.mWhenUs != b.mWhenUs) {
+        return a.mWhenUs > b.mWhenUs;
+    }
+    // sequence numbers may wrap around
+    return (int32_t)(a.mSeq - b.mSeq) > 0;
+}
+
+void ALooper::pushEvent_l(const Event &event) {
+    mEventQueue.push(event);
+    Event *events = mEventQueue.editArray();
+    std::push_heap(events, events + mEventQueue.size(), EventLater);
+}
+
+void ALooper::popEvent_l(Event *event) {
+    Event *events = mEventQueue.editArray();
+    std::pop_heap(events, events + mEventQueue.size(), EventLater);
+    *event = mEventQueue.top();
+    mEventQueue.pop();
+}
 
+void ALooper::drainPendingEvents_l() {
+    PendingEvent *pending = mPendingEvents.exchange(NULL, std::memory_order_acquire);
+    // the stack is in reverse post order, but the heap orders by sequence number.
+    while (pending != NULL) {
+        pushEvent_l(pending->mEvent);
+        PendingEvent *next = pending->mNext;
+        delete pending;
+        pending = next;
+    }
+}
+
+void ALooper::post(const sp<AMessage> &msg, int64_t delayUs) {
     int64_t whenUs;
     if (delayUs > 0) {
         whenUs = GetNowUs() + delayUs;
@@ -175,20 +217,40 @@ void ALooper::post(const sp<AMessage> &msg, int64_t delayUs) {
         whenUs = GetNowUs();
     }
 
-    List<Event>::iterator it = mEventQueue.begin();
-    while (it != mEventQueue.end() && (*it).mWhenUs <= whenUs) {
-        ++it;
+    if (delayUs <= 0) {
+        // Fast path: push onto the pending stack without taking mLock.
+        // Only the post that finds the stack empty needs to wake up the looper;
+        // later posts are picked up by the same drain.
+        PendingEvent *pending = new PendingEvent;
+        pending->mEvent.mWhenUs = whenUs;
+        pending->mEvent.mSeq = mNextEventSeq.fetch_add(1, std::memory_order_relaxed);
+        pending->mEvent.mMessage = msg;
+
+        PendingEvent *head = mPendingEvents.load(std::memory_order_relaxed);
+        do {
+            pending->mNext = head;
+        } while (!mPendingEvents.compare_exchange_weak(
+                head, pending, std::memory_order_release, std::memory_order_relaxed));
+
+        if (head == NULL) {
+            Mutex::Autolock autoLock(mLock);
+            mQueueChangedCondition.signal();
+        }
+        return;
     }
 
+    Mutex::Autolock autoLock(mLock);
+
     Event event;
     event.mWhenUs = whenUs;
+    event.mSeq = mNextEventSeq.fetch_add(1, std::memory_order_relaxed);
     event.mMessage = msg;
 
-    if (it == mEventQueue.begin()) {
+    if (mEventQueue.isEmpty() || EventLater(mEventQueue[0], event)) {
         mQueueChangedCondition.signal();
     }
 
-    mEventQueue.insert(it, event);
+    pushEvent_l(event);
 }
 
 bool ALooper::loop() {
@@ -199,11 +261,12 @@ bool ALooper::loop() {
         if (mThread == NULL && !mRunningLocally) {
             return false;
         }
-        if (mEventQueue.empty()) {
+        drainPendingEvents_l();
+        if (mEventQueue.isEmpty()) {
             mQueueChangedCondition.wait(mLock);
             return true;
         }
-        int64_t whenUs = (*mEventQueue.begin()).mWhenUs;
+        int64_t whenUs = mEventQueue[0].mWhenUs;
         int64_t nowUs = GetNowUs();
 
         if (whenUs > nowUs) {
@@ -213,8 +276,7 @@ bool ALooper::loop() {
             return true;
         }
 
-        event = *mEventQueue.begin();
-        mEventQueue.erase(mEventQueue.begin());
+        popEvent_l(&event);
     }
 
     event.mMessage->deliver();
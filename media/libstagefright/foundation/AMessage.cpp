@@ -37,6 +37,12 @@ namespace android {
 
 extern ALooperRoster gLooperRoster;
 
+// A message and, for synchronous posts, a reply token are created for every
+// buffer exchanged between MediaCodec and its codec; keep enough around for a
+// few active codecs.
+A_OBJECT_POOL_IMPLEMENT(AReplyToken, 64)
+A_OBJECT_POOL_IMPLEMENT(AMessage, 256)
+
 status_t AReplyToken::setReply(const sp<AMessage> &reply) {
     if (mReplied) {
         ALOGE("trying to post a duplicate reply");
@@ -126,6 +132,7 @@ static int32_t gDupCalls = 1;
 static int32_t gAverageNumItems = 0;
 static int32_t gAverageNumChecks = 0;
 static int32_t gAverageNumMemChecks = 0;
+static int32_t gAverageNumHashChecks = 0;
 static int32_t gAverageDupItems = 0;
 static int32_t gLastChecked = -1;
 
@@ -133,26 +140,38 @@ static void reportStats() {
     int32_t time = (ALooper::GetNowUs() / 1000);
     if (time / 1000 != gLastChecked / 1000) {
         gLastChecked = time;
-        ALOGI("called findItemIx %zu times (for len=%.1f i=%.1f/%.1f mem) dup %zu times (for len=%.1f)",
+        ALOGI("called findItemIx %d times (for len=%.1f i=%.1f/%.1f hash/%.1f mem) "
+                "dup %d times (for len=%.1f)",
                 gFindItemCalls,
                 gAverageNumItems / (float)gFindItemCalls,
                 gAverageNumChecks / (float)gFindItemCalls,
+                gAverageNumHashChecks / (float)gFindItemCalls,
                 gAverageNumMemChecks / (float)gFindItemCalls,
                 gDupCalls,
                 gAverageDupItems / (float)gDupCalls);
         gFindItemCalls = gDupCalls = 1;
-        gAverageNumItems = gAverageNumChecks = gAverageNumMemChecks = gAverageDupItems = 0;
+        gAverageNumItems = gAverageNumChecks = gAverageNumHashChecks = gAverageNumMemChecks = 0;
+        gAverageDupItems = 0;
         gLastChecked = time;
     }
 }
 #endif
 
-inline size_t AMessage::findItemIndex(const char *name, size_t len) const {
+// Items are matched by name hash first, so a lookup normally does a single
+// memcmp() against the matching item rather than one per item of the same length.
+inline size_t AMessage::findItemIndex(const char *name, size_t len, uint32_t hash) const {
 #ifdef DUMP_STATS
+    size_t hashchecks = 0;
     size_t memchecks = 0;
 #endif
     size_t i = 0;
     for (; i < mNumItems; i++) {
+        if (hash != mItems[i].mNameHash) {
+            continue;
+        }
+#ifdef DUMP_STATS
+        ++hashchecks;
+#endif
         if (len != mItems[i].mNameLength) {
             continue;
         }
@@ -168,6 +187,7 @@ inline size_t AMessage::findItemIndex(const char *name, size_t len) const {
         Mutex::Autolock _l(gLock);
         ++gFindItemCalls;
         gAverageNumItems += mNumItems;
+        gAverageNumHashChecks += hashchecks;
         gAverageNumMemChecks += memchecks;
         gAverageNumChecks += i;
         reportStats();
@@ -176,16 +196,24 @@ inline size_t AMessage::findItemIndex(const char *name, size_t len) const {
     return i;
 }
 
+inline size_t AMessage::findItemIndex(const char *name) const {
+    size_t len;
+    uint32_t hash = AAtomizer::Hash(name, &len);
+    return findItemIndex(name, len, hash);
+}
+
 // assumes item's name was uninitialized or NULL
-void AMessage::Item::setName(const char *name, size_t len) {
+void AMessage::Item::setName(const char *name, size_t len, uint32_t hash) {
     mNameLength = len;
+    mNameHash = hash;
     mName = new char[len + 1];
     memcpy((void*)mName, name, len + 1);
 }
 
 AMessage::Item *AMessage::allocateItem(const char *name) {
-    size_t len = strlen(name);
-    size_t i = findItemIndex(name, len);
+    size_t len;
+    uint32_t hash = AAtomizer::Hash(name, &len);
+    size_t i = findItemIndex(name, len, hash);
     Item *item;
 
     if (i < mNumItems) {
@@ -195,7 +223,7 @@ AMessage::Item *AMessage::allocateItem(const char *name) {
         CHECK(mNumItems < kMaxNumItems);
         i = mNumItems++;
         item = &mItems[i];
-        item->setName(name, len);
+        item->setName(name, len, hash);
     }
 
     return item;
@@ -203,7 +231,7 @@ AMessage::Item *AMessage::allocateItem(const char *name) {
 
 const AMessage::Item *AMessage::findItem(
         const char *name, Type type) const {
-    size_t i = findItemIndex(name, strlen(name));
+    size_t i = findItemIndex(name);
     if (i < mNumItems) {
         const Item *item = &mItems[i];
         return item->mType == type ? item : NULL;
@@ -213,7 +241,7 @@ const AMessage::Item *AMessage::findItem(
 }
 
 bool AMessage::findAsFloat(const char *name, float *value) const {
-    size_t i = findItemIndex(name, strlen(name));
+    size_t i = findItemIndex(name);
     if (i < mNumItems) {
         const Item *item = &mItems[i];
         switch (item->mType) {
@@ -240,7 +268,7 @@ bool AMessage::findAsFloat(const char *name, float *value) const {
 }
 
 bool AMessage::contains(const char *name) const {
-    size_t i = findItemIndex(name, strlen(name));
+    size_t i = findItemIndex(name);
     return i < mNumItems;
 }
 
@@ -456,7 +484,7 @@ sp<AMessage> AMessage::dup() const {
         const Item *from = &mItems[i];
         Item *to = &msg->mItems[i];
 
-        to->setName(from->mName, from->mNameLength);
+        to->setName(from->mName, from->mNameLength, from->mNameHash);
         to->mType = from->mType;
 
         switch (from->mType) {
@@ -720,7 +748,9 @@ sp<AMessage> AMessage::FromParcel(const Parcel &parcel, size_t maxNestingLevel)
             }
         }
 
-        item->setName(name, strlen(name));
+        size_t len;
+        uint32_t hash = AAtomizer::Hash(name, &len);
+        item->setName(name, len, hash);
     }
 
     return msg;
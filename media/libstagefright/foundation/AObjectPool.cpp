@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "AObjectPool"
+#include <utils/Log.h>
+
+#include "AObjectPool.h"
+
+#include <new>
+#include <stdlib.h>
+
+namespace android {
+
+static Mutex &PoolsLock() {
+    static Mutex sLock;
+    return sLock;
+}
+
+static AObjectPool *gPools = NULL;
+
+static void *allocateBlock(const char *name, size_t size) {
+    void *ptr = malloc(size);
+    if (ptr == NULL) {
+        LOG_ALWAYS_FATAL("%s pool: out of memory allocating %zu bytes", name, size);
+    }
+    return ptr;
+}
+
+AObjectPool::AObjectPool(const char *name, size_t blockSize, size_t maxFreeBlocks)
+    : mName(name),
+      mBlockSize(blockSize < sizeof(FreeBlock) ? sizeof(FreeBlock) : blockSize),
+      mMaxFreeBlocks(maxFreeBlocks),
+      mFreeBlocks(NULL),
+      mNumFreeBlocks(0),
+      mNumAllocations(0),
+      mNumReused(0),
+      mNumReleases(0),
+      mNumOversized(0) {
+    int err = pthread_key_create(&mThreadCacheKey, OnThreadExit);
+    if (err != 0) {
+        LOG_ALWAYS_FATAL("%s pool: pthread_key_create failed (%d)", mName, err);
+    }
+    Mutex::Autolock autoLock(PoolsLock());
+    mNextPool = gPools;
+    gPools = this;
+}
+
+AObjectPool::ThreadCache *AObjectPool::getThreadCache() {
+    ThreadCache *cache = static_cast<ThreadCache *>(pthread_getspecific(mThreadCacheKey));
+    if (cache == NULL) {
+        cache = static_cast<ThreadCache *>(calloc(1, sizeof(ThreadCache)));
+        if (cache == NULL) {
+            LOG_ALWAYS_FATAL("%s pool: out of memory allocating thread cache", mName);
+        }
+        cache->mPool = this;
+        pthread_setspecific(mThreadCacheKey, cache);
+    }
+    return cache;
+}
+
+// static
+void AObjectPool::OnThreadExit(void *arg) {
+    ThreadCache *cache = static_cast<ThreadCache *>(arg);
+    cache->mPool->flush(cache, cache->mNumFreeBlocks);
+    free(cache);
+}
+
+void AObjectPool::addCounters_l(ThreadCache *cache) {
+    mNumAllocations += cache->mNumAllocations;
+    mNumReused += cache->mNumReused;
+    mNumReleases += cache->mNumReleases;
+    mNumOversized += cache->mNumOversized;
+    cache->mNumAllocations = 0;
+    cache->mNumReused = 0;
+    cache->mNumReleases = 0;
+    cache->mNumOversized = 0;
+}
+
+void AObjectPool::refill_l(ThreadCache *cache) {
+    addCounters_l(cache);
+    for (size_t i = 0; i < kBatchBlocks && mFreeBlocks != NULL; ++i) {
+        FreeBlock *block = mFreeBlocks;
+        mFreeBlocks = block->mNext;
+        --mNumFreeBlocks;
+        block->mNext = cache->mFreeBlocks;
+        cache->mFreeBlocks = block;
+        ++cache->mNumFreeBlocks;
+    }
+}
+
+void AObjectPool::flush(ThreadCache *cache, size_t count) {
+    // blocks that do not fit in the shared list are freed outside the lock
+    FreeBlock *excess = NULL;
+    {
+        Mutex::Autolock autoLock(mLock);
+        addCounters_l(cache);
+        for (size_t i = 0; i < count && cache->mFreeBlocks != NULL; ++i) {
+            FreeBlock *block = cache->mFreeBlocks;
+            cache->mFreeBlocks = block->mNext;
+            --cache->mNumFreeBlocks;
+            if (mNumFreeBlocks < mMaxFreeBlocks) {
+                block->mNext = mFreeBlocks;
+                mFreeBlocks = block;
+                ++mNumFreeBlocks;
+            } else {
+                block->mNext = excess;
+                excess = block;
+            }
+        }
+    }
+    while (excess != NULL) {
+        FreeBlock *block = excess;
+        excess = block->mNext;
+        free(block);
+    }
+}
+
+#if A_OBJECT_POOL_BYPASS
+
+void *AObjectPool::allocate(size_t size) {
+    {
+        Mutex::Autolock autoLock(mLock);
+        ++mNumAllocations;
+        if (size > mBlockSize) {
+            ++mNumOversized;
+        }
+    }
+    return allocateBlock(mName, size);
+}
+
+void AObjectPool::release(void *ptr, size_t size __unused) {
+    if (ptr == NULL) {
+        return;
+    }
+    {
+        Mutex::Autolock autoLock(mLock);
+        ++mNumReleases;
+    }
+    free(ptr);
+}
+
+#else
+
+void *AObjectPool::allocate(size_t size) {
+    ThreadCache *cache = getThreadCache();
+    ++cache->mNumAllocations;
+    if (size > mBlockSize) {
+        ++cache->mNumOversized;
+        return allocateBlock(mName, size);
+    }
+
+    if (cache->mFreeBlocks == NULL) {
+        Mutex::Autolock autoLock(mLock);
+        refill_l(cache);
+    }
+    if (cache->mFreeBlocks != NULL) {
+        FreeBlock *block = cache->mFreeBlocks;
+        cache->mFreeBlocks = block->mNext;
+        --cache->mNumFreeBlocks;
+        ++cache->mNumReused;
+        return block;
+    }
+    return allocateBlock(mName, mBlockSize);
+}
+
+void AObjectPool::release(void *ptr, size_t size) {
+    if (ptr == NULL) {
+        return;
+    }
+    ThreadCache *cache = getThreadCache();
+    ++cache->mNumReleases;
+    if (size > mBlockSize || mMaxFreeBlocks == 0) {
+        free(ptr);
+        return;
+    }
+
+    FreeBlock *block = static_cast<FreeBlock *>(ptr);
+    block->mNext = cache->mFreeBlocks;
+    cache->mFreeBlocks = block;
+    if (++cache->mNumFreeBlocks > kThreadCacheBlocks) {
+        flush(cache, kBatchBlocks);
+    }
+}
+
+#endif  // A_OBJECT_POOL_BYPASS
+
+void AObjectPool::dump(AString *s) {
+    Mutex::Autolock autoLock(mLock);
+    s->append(AStringPrintf(
+            "  %s: block size %zu, allocations %llu (%llu reused, %llu oversized), "
+            "outstanding %lld, free %zu/%zu\n",
+            mName, mBlockSize,
+            (unsigned long long)mNumAllocations,
+            (unsigned long long)mNumReused,
+            (unsigned long long)mNumOversized,
+            (long long)(mNumAllocations - mNumReleases),
+            mNumFreeBlocks, mMaxFreeBlocks));
+}
+
+// static
+void AObjectPool::DumpAll(AString *s) {
+    Mutex::Autolock autoLock(PoolsLock());
+    for (AObjectPool *pool = gPools; pool != NULL; pool = pool->mNextPool) {
+        pool->dump(s);
+    }
+}
+
+}  // namespace android
@@ -12,6 +12,7 @@ LOCAL_SRC_FILES:=                 \
     ALooperRoster.cpp             \
     AMessage.cpp                  \
     ANetworkSession.cpp           \
+    AObjectPool.cpp               \
     AString.cpp                   \
     AStringUtils.cpp              \
     AWakeLock.cpp                 \
@@ -21,6 +21,7 @@
 #include <media/stagefright/foundation/ABase.h>
 #include <media/stagefright/foundation/AHandlerReflector.h>
 #include <media/stagefright/DataSource.h>
+#include <utils/Vector.h>
 
 namespace android {
 
@@ -65,6 +66,11 @@ struct NuCachedSource2 : public DataSource {
     status_t getEstimatedBandwidthKbps(int32_t *kbps);
     status_t setCacheStatCollectFreq(int32_t freqMs);
 
+    // Returns "reads", "cache-hits", "bytes-fetched", "bytes-refetched",
+    // "new-ranges", "num-ranges" and "read-ahead-bytes" counters, and
+    // "bandwidth-kbps" once a fetch has completed.
+    sp<AMessage> getStats();
+
     static void RemoveCacheSpecificHeaders(
             KeyedVector<String8, String8> *headers,
             String8 *cacheConfig,
@@ -89,6 +95,20 @@ private:
         // Read data after a 15 sec timeout whether we're actively
         // fetching or not.
         kDefaultKeepAliveIntervalUs     = 15000000,
+
+        // Cached ranges besides the one being fetched into are kept for
+        // readers that jump back and forth, e.g. between the moov box at the
+        // end of a file and the samples, or between badly interleaved tracks.
+        kMaxNumRetainedRanges           = 3,
+
+        // After a jump to an uncached offset, read ahead as much as the
+        // source delivers in this time, and double that every time the
+        // reader catches up.
+        kInitialReadAheadUs             = 1000000,
+        kMinReadAheadBytes              = 4 * kPageSize,
+
+        // Number of discarded ranges remembered to count refetched bytes.
+        kMaxNumDiscardedRanges          = 16,
     };
 
     enum {
@@ -109,8 +129,35 @@ private:
     mutable Mutex mLock;
     Condition mCondition;
 
+    struct CachedRange {
+        PageCache *mCache;
+        off64_t mOffset;
+        size_t mReadAheadBytes;
+        off64_t mLastAccessPos;
+        uint64_t mLastAccess;
+    };
+
+    struct ByteRange {
+        off64_t mStart;
+        off64_t mEnd;
+    };
+
+    // The range being fetched into.
     PageCache *mCache;
     off64_t mCacheOffset;
+    size_t mReadAheadBytes;
+
+    Vector<CachedRange> mRetainedRanges;
+    uint64_t mAccessCount;
+
+    Vector<ByteRange> mDiscardedRanges;
+    int64_t mBandwidthBps;
+
+    int64_t mNumReads;
+    int64_t mNumCacheHits;
+    int64_t mBytesFetched;
+    int64_t mBytesRefetched;
+    int64_t mNumNewRanges;
     status_t mFinalStatus;
     off64_t mLastAccessPos;
     sp<AMessage> mAsyncResult;
@@ -136,6 +183,15 @@ private:
     ssize_t readInternal(off64_t offset, void *data, size_t size);
     status_t seekInternal_l(off64_t offset);
 
+    ssize_t findRetainedRange_l(off64_t offset, size_t size) const;
+    void retainActiveRange_l();
+    void trimRetainedRanges_l();
+    void releaseFromStart_l(PageCache *cache, off64_t *offset, size_t maxBytes);
+    void releaseFromEnd_l(CachedRange *range, size_t maxBytes);
+    void addDiscardedRange_l(off64_t start, off64_t end);
+    void growReadAhead_l();
+    size_t initialReadAhead_l() const;
+
     size_t approxDataRemaining_l(status_t *finalStatus) const;
 
     void restartPrefetcherIfNecessary_l(
@@ -56,7 +56,6 @@ private:
     off64_t mCurrentChunkOffset;
     Vector<size_t> mCurrentChunkSampleSizes;
 
-    uint32_t mTimeToSampleIndex;
     uint32_t mTTSSampleIndex;
     uint32_t mTTSSampleTime;
     uint32_t mTTSCount;
@@ -24,6 +24,7 @@
 #include <media/stagefright/MediaErrors.h>
 #include <utils/RefBase.h>
 #include <utils/threads.h>
+#include <utils/Vector.h>
 
 namespace android {
 
@@ -90,6 +91,45 @@ protected:
 private:
     struct CompositionDeltaLookup;
 
+    // Reads a table stored in the data source a page at a time, keeping the
+    // most recently used pages. Used for the tables that have an entry per
+    // chunk or sample, so that they are neither loaded up front nor read an
+    // entry at a time.
+    struct PagedTable {
+        PagedTable(const sp<DataSource> &source, off64_t offset, uint64_t size);
+        ~PagedTable();
+
+        // Copies |size| bytes at |offset| from the start of the table.
+        status_t read(uint64_t offset, void *data, size_t size);
+
+    private:
+        enum {
+            kPageSize = 4096,
+            kMaxPages = 4,
+        };
+
+        // mIndex of a slot that holds no page
+        static const uint64_t kNoPage = UINT64_MAX;
+
+        struct Page {
+            uint64_t mIndex;
+            size_t mSize;
+            uint64_t mLastUse;
+            uint8_t *mData;
+        };
+
+        sp<DataSource> mDataSource;
+        off64_t mOffset;
+        uint64_t mSize;
+        Vector<Page> mPages;
+        uint64_t mUseCount;
+
+        status_t getPage(uint64_t index, const Page **page);
+
+        PagedTable(const PagedTable &);
+        PagedTable &operator=(const PagedTable &);
+    };
+
     static const uint32_t kChunkOffsetType32;
     static const uint32_t kChunkOffsetType64;
     static const uint32_t kSampleSizeType32;
@@ -104,6 +144,7 @@ private:
     off64_t mChunkOffsetOffset;
     uint32_t mChunkOffsetType;
     uint32_t mNumChunkOffsets;
+    PagedTable *mChunkOffsets;
 
     off64_t mSampleToChunkOffset;
     uint32_t mNumSampleToChunkOffsets;
@@ -112,11 +153,38 @@ private:
     uint32_t mSampleSizeFieldSize;
     uint32_t mDefaultSampleSize;
     uint32_t mNumSampleSizes;
+    PagedTable *mSampleSizes;
 
     bool mHasTimeToSample;
     uint32_t mTimeToSampleCount;
     uint32_t* mTimeToSample;
 
+    // First sample and its decode time of each time-to-sample entry.
+    struct TimeToSampleStart {
+        uint64_t mSampleIndex;
+        uint32_t mSampleTime;
+    };
+    TimeToSampleStart *mTimeToSampleStarts;
+    // Whether decode times wrap around 32 bits.
+    bool mTimeToSampleWraps;
+
+    // How samples are found in composition order, decided from the
+    // time-to-sample and composition offset runs on the first seek.
+    enum CompositionOrder {
+        kCompositionOrderUnknown,
+        // composition order is decode order
+        kCompositionOrderDecode,
+        // samples are reordered within a few samples of their decode order,
+        // e.g. B-frames: search around the decode order position
+        kCompositionOrderWindow,
+        // sorted table of all samples
+        kCompositionOrderTable,
+    };
+    CompositionOrder mCompositionOrder;
+    // Range of the composition time offsets of all samples.
+    int64_t mMinCompositionOffset;
+    int64_t mMaxCompositionOffset;
+
     struct SampleTimeEntry {
         uint32_t mSampleIndex;
         uint32_t mCompositionTime;
@@ -129,7 +197,7 @@ private:
 
     off64_t mSyncSampleOffset;
     uint32_t mNumSyncSamples;
-    uint32_t *mSyncSamples;
+    PagedTable *mSyncSamples;
     size_t mLastSyncSampleIndex;
 
     SampleIterator *mSampleIterator;
@@ -146,20 +214,38 @@ private:
 
     friend struct SampleIterator;
 
+    // Returns the composition time and the sample index of the sample at
+    // |position| in composition order.
+    uint32_t getCompositionTimeAt_l(uint32_t position);
+    uint32_t getSampleIndexAt_l(uint32_t position) const;
+
     // normally we don't round
     inline uint64_t getSampleTime(
-            size_t sample_index, uint64_t scale_num, uint64_t scale_den) const {
-        return (sample_index < (size_t)mNumSampleSizes && mSampleTimeEntries != NULL
-                && scale_den != 0)
-                ? (mSampleTimeEntries[sample_index].mCompositionTime * scale_num) / scale_den : 0;
+            size_t sample_index, uint64_t scale_num, uint64_t scale_den) {
+        return (sample_index < (size_t)mNumSampleSizes && scale_den != 0)
+                ? (getCompositionTimeAt_l(sample_index) * scale_num) / scale_den : 0;
     }
 
     status_t getSampleSize_l(uint32_t sample_index, size_t *sample_size);
     int32_t getCompositionTimeOffset(uint32_t sampleIndex);
+    status_t getSyncSample_l(uint32_t index, uint32_t *sampleIndex);
+    status_t findSyncSampleIndex_l(
+            uint32_t sampleIndex, uint32_t first, uint32_t *index);
+
+    bool getDecodeTime_l(uint32_t sampleIndex, uint32_t *time);
+    bool getCompositionTime_l(uint32_t sampleIndex, uint32_t *time);
+    CompositionOrder checkCompositionOrder_l();
+    bool prepareCompositionOrder_l();
+    uint32_t findDecodeIndex_l(
+            int64_t offset, uint64_t req_time, uint64_t scale_num, uint64_t scale_den,
+            bool after);
+    status_t findSampleInWindow_l(
+            uint64_t req_time, uint64_t scale_num, uint64_t scale_den,
+            uint32_t *sample_index, uint32_t flags);
 
     static int CompareIncreasingTime(const void *, const void *);
 
-    void buildSampleEntriesTable();
+    void buildSampleEntriesTable_l();
 
     SampleTable(const SampleTable &);
     SampleTable &operator=(const SampleTable &);
@@ -259,6 +259,9 @@ status_t MatroskaSource::start(MetaData * /* params */) {
 
     mBlockIter.reset();
 
+    // Clusters are read in file order from here on.
+    mExtractor->mDataSource->setAccessPattern(DataSource::kAccessPatternSequential);
+
     return OK;
 }
 
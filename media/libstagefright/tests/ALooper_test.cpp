@@ -0,0 +1,191 @@
+/*
+ * Copyright 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ALooper_test"
+
+#include <gtest/gtest.h>
+#include <utils/Log.h>
+#include <utils/threads.h>
+#include <utils/Vector.h>
+
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/AHandler.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+
+namespace android {
+
+// Records the "seq" field of each delivered message.
+struct RecordingHandler : public AHandler {
+    RecordingHandler() : mExpected(0) {}
+
+    void expect(size_t count) {
+        Mutex::Autolock autoLock(mLock);
+        mExpected = count;
+    }
+
+    bool waitForAll(int64_t timeoutNs) {
+        Mutex::Autolock autoLock(mLock);
+        while (mReceived.size() < mExpected) {
+            if (mCondition.waitRelative(mLock, timeoutNs) != OK) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Vector<int32_t> received() {
+        Mutex::Autolock autoLock(mLock);
+        return mReceived;
+    }
+
+protected:
+    virtual void onMessageReceived(const sp<AMessage> &msg) {
+        int32_t seq;
+        CHECK(msg->findInt32("seq", &seq));
+        Mutex::Autolock autoLock(mLock);
+        mReceived.push(seq);
+        if (mReceived.size() >= mExpected) {
+            mCondition.signal();
+        }
+    }
+
+private:
+    Mutex mLock;
+    Condition mCondition;
+    size_t mExpected;
+    Vector<int32_t> mReceived;
+};
+
+// Posts a number of zero-delay messages from its own thread.
+struct PosterThread : public Thread {
+    PosterThread(const sp<AHandler> &handler, int32_t first, int32_t count)
+        : mHandler(handler), mFirst(first), mCount(count) {}
+
+    virtual bool threadLoop() {
+        for (int32_t i = mFirst; i < mFirst + mCount; ++i) {
+            sp<AMessage> msg = new AMessage(0, mHandler);
+            msg->setInt32("seq", i);
+            msg->post();
+        }
+        return false;
+    }
+
+private:
+    sp<AHandler> mHandler;
+    int32_t mFirst;
+    int32_t mCount;
+};
+
+class ALooperTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        mLooper = new ALooper;
+        mLooper->setName("ALooper_test");
+        mHandler = new RecordingHandler;
+        mLooper->registerHandler(mHandler);
+        ASSERT_EQ(OK, mLooper->start());
+    }
+
+    virtual void TearDown() {
+        mLooper->unregisterHandler(mHandler->id());
+        mLooper->stop();
+    }
+
+    sp<ALooper> mLooper;
+    sp<RecordingHandler> mHandler;
+};
+
+static const int64_t kTimeoutNs = 5000000000ll;
+
+TEST_F(ALooperTest, ImmediatePostsAreDeliveredInOrder) {
+    const int32_t kCount = 1000;
+    mHandler->expect(kCount);
+    for (int32_t i = 0; i < kCount; ++i) {
+        sp<AMessage> msg = new AMessage(0, mHandler);
+        msg->setInt32("seq", i);
+        msg->post();
+    }
+    ASSERT_TRUE(mHandler->waitForAll(kTimeoutNs));
+    Vector<int32_t> received = mHandler->received();
+    ASSERT_EQ((size_t)kCount, received.size());
+    for (int32_t i = 0; i < kCount; ++i) {
+        EXPECT_EQ(i, received[i]);
+    }
+}
+
+TEST_F(ALooperTest, DelayedPostsAreDeliveredByTime) {
+    // post in reverse order of delivery time, interleaved with immediate posts
+    const int32_t kCount = 20;
+    mHandler->expect(kCount * 2);
+    for (int32_t i = kCount - 1; i >= 0; --i) {
+        sp<AMessage> msg = new AMessage(0, mHandler);
+        msg->setInt32("seq", kCount + i);
+        msg->post(20000ll + i * 5000ll);
+    }
+    for (int32_t i = 0; i < kCount; ++i) {
+        sp<AMessage> msg = new AMessage(0, mHandler);
+        msg->setInt32("seq", i);
+        msg->post();
+    }
+    ASSERT_TRUE(mHandler->waitForAll(kTimeoutNs));
+    Vector<int32_t> received = mHandler->received();
+    ASSERT_EQ((size_t)kCount * 2, received.size());
+    for (int32_t i = 0; i < kCount * 2; ++i) {
+        EXPECT_EQ(i, received[i]);
+    }
+}
+
+TEST_F(ALooperTest, PostDeliverThroughput) {
+    const int32_t kThreads = 4;
+    const int32_t kPerThread = 50000;
+    mHandler->expect(kThreads * kPerThread);
+
+    const int64_t startUs = ALooper::GetNowUs();
+    Vector<sp<PosterThread> > threads;
+    for (int32_t i = 0; i < kThreads; ++i) {
+        sp<PosterThread> thread = new PosterThread(mHandler, i * kPerThread, kPerThread);
+        thread->run("ALooper_test poster");
+        threads.push(thread);
+    }
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i]->join();
+    }
+    const int64_t postedUs = ALooper::GetNowUs();
+    ASSERT_TRUE(mHandler->waitForAll(kTimeoutNs * 4));
+    const int64_t deliveredUs = ALooper::GetNowUs();
+
+    // messages from each poster thread must arrive in the order they were posted
+    Vector<int32_t> received = mHandler->received();
+    int32_t last[kThreads];
+    for (int32_t i = 0; i < kThreads; ++i) {
+        last[i] = -1;
+    }
+    for (size_t i = 0; i < received.size(); ++i) {
+        const int32_t thread = received[i] / kPerThread;
+        EXPECT_LT(last[thread], received[i]);
+        last[thread] = received[i];
+    }
+
+    const double messages = kThreads * kPerThread;
+    printf("%d threads posted %.0f messages: %.0f posts/s, %.0f deliveries/s\n",
+            kThreads, messages,
+            messages * 1E6 / (postedUs - startUs + 1),
+            messages * 1E6 / (deliveredUs - startUs + 1));
+}
+
+} // namespace android
@@ -0,0 +1,208 @@
+/*
+ * Copyright 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "AMessage_test"
+
+#include <pthread.h>
+
+#include <gtest/gtest.h>
+#include <utils/Log.h>
+#include <utils/Vector.h>
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ADebug.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/AObjectPool.h>
+#include <media/stagefright/foundation/AString.h>
+
+namespace android {
+
+class AMessageTest : public ::testing::Test {
+};
+
+TEST_F(AMessageTest, FindAndOverwrite) {
+    sp<AMessage> msg = new AMessage;
+    msg->setInt32("width", 1920);
+    msg->setInt32("height", 1080);
+    msg->setInt64("timeUs", 12345ll);
+    msg->setString("mime", "video/avc");
+
+    int32_t width, height;
+    int64_t timeUs;
+    AString mime;
+    ASSERT_TRUE(msg->findInt32("width", &width));
+    ASSERT_TRUE(msg->findInt32("height", &height));
+    ASSERT_TRUE(msg->findInt64("timeUs", &timeUs));
+    ASSERT_TRUE(msg->findString("mime", &mime));
+    EXPECT_EQ(1920, width);
+    EXPECT_EQ(1080, height);
+    EXPECT_EQ(12345ll, timeUs);
+    EXPECT_STREQ("video/avc", mime.c_str());
+
+    // wrong type, missing key, prefix of a key
+    EXPECT_FALSE(msg->findInt64("width", &timeUs));
+    EXPECT_FALSE(msg->findInt32("depth", &width));
+    EXPECT_FALSE(msg->findInt32("widt", &width));
+    EXPECT_FALSE(msg->contains("widthx"));
+
+    msg->setInt32("width", 3840);
+    ASSERT_TRUE(msg->findInt32("width", &width));
+    EXPECT_EQ(3840, width);
+    EXPECT_EQ(4u, msg->countEntries());
+}
+
+TEST_F(AMessageTest, HashCollisions) {
+    // "Aa" and "BB" have the same hash, and so do "AaAa", "AaBB", "BBAa" and "BBBB".
+    sp<AMessage> msg = new AMessage;
+    msg->setInt32("Aa", 1);
+    msg->setInt32("BB", 2);
+    msg->setInt32("AaAa", 3);
+    msg->setInt32("AaBB", 4);
+    msg->setInt32("BBAa", 5);
+    msg->setInt32("BBBB", 6);
+
+    int32_t value;
+    ASSERT_TRUE(msg->findInt32("Aa", &value));
+    EXPECT_EQ(1, value);
+    ASSERT_TRUE(msg->findInt32("BB", &value));
+    EXPECT_EQ(2, value);
+    ASSERT_TRUE(msg->findInt32("AaAa", &value));
+    EXPECT_EQ(3, value);
+    ASSERT_TRUE(msg->findInt32("AaBB", &value));
+    EXPECT_EQ(4, value);
+    ASSERT_TRUE(msg->findInt32("BBAa", &value));
+    EXPECT_EQ(5, value);
+    ASSERT_TRUE(msg->findInt32("BBBB", &value));
+    EXPECT_EQ(6, value);
+
+    sp<AMessage> copy = msg->dup();
+    ASSERT_TRUE(copy->findInt32("BBAa", &value));
+    EXPECT_EQ(5, value);
+    EXPECT_EQ(6u, copy->countEntries());
+}
+
+// Typical keys of a codec output format and buffer message.
+static const char *kKeys[] = {
+    "mime", "width", "height", "stride", "slice-height", "color-format",
+    "crop-left", "crop-top", "crop-right", "crop-bottom", "color-range",
+    "color-standard", "color-transfer", "frame-rate", "bitrate", "max-input-size",
+    "buffer-id", "timeUs", "flags", "offset", "size", "generation", "portIndex",
+    "buffer", "reply", "err",
+};
+static const size_t kNumKeys = sizeof(kKeys) / sizeof(kKeys[0]);
+
+TEST_F(AMessageTest, LookupThroughput) {
+    sp<AMessage> msg = new AMessage;
+    for (size_t i = 0; i < kNumKeys; ++i) {
+        msg->setInt32(kKeys[i], i);
+    }
+
+    const size_t kIterations = 200000;
+    int64_t sum = 0;
+    const int64_t startUs = ALooper::GetNowUs();
+    for (size_t n = 0; n < kIterations; ++n) {
+        for (size_t i = 0; i < kNumKeys; ++i) {
+            int32_t value;
+            if (msg->findInt32(kKeys[i], &value)) {
+                sum += value;
+            }
+        }
+    }
+    const int64_t lookupsUs = ALooper::GetNowUs() - startUs;
+    EXPECT_EQ((int64_t)kIterations * kNumKeys * (kNumKeys - 1) / 2, sum);
+
+    // lookups of keys that are not present scan every item
+    const int64_t missStartUs = ALooper::GetNowUs();
+    for (size_t n = 0; n < kIterations; ++n) {
+        int32_t value;
+        EXPECT_FALSE(msg->findInt32("not-present", &value));
+    }
+    const int64_t missesUs = ALooper::GetNowUs() - missStartUs;
+
+    printf("%zu items: %.2f M lookups/s (hits), %.2f M lookups/s (misses)\n",
+            kNumKeys,
+            (double)kIterations * kNumKeys / (lookupsUs + 1),
+            (double)kIterations / (missesUs + 1));
+}
+
+#if !A_OBJECT_POOL_BYPASS
+TEST_F(AMessageTest, PooledObjectsAreReused) {
+    // the pools hand out the most recently released block first
+    AMessage *first = new AMessage;
+    sp<AMessage> msg = first;
+    msg.clear();
+    msg = new AMessage;
+    EXPECT_EQ(first, msg.get());
+
+    ABuffer *firstBuffer = new ABuffer(16);
+    sp<ABuffer> buffer = firstBuffer;
+    buffer.clear();
+    buffer = new ABuffer(32);
+    EXPECT_EQ(firstBuffer, buffer.get());
+    EXPECT_EQ(32u, buffer->capacity());
+
+    AString dump;
+    AObjectPool::DumpAll(&dump);
+    EXPECT_GE(dump.find("AMessage"), 0);
+    EXPECT_GE(dump.find("ABuffer"), 0);
+}
+#endif
+
+// Messages are usually created on one thread and released on a looper thread,
+// so blocks flow from one thread cache to another through the shared list.
+static void *createMessages(void *arg) {
+    Vector<sp<AMessage> > *messages = static_cast<Vector<sp<AMessage> > *>(arg);
+    for (size_t i = 0; i < 1000; ++i) {
+        messages->push(new AMessage);
+    }
+    return NULL;
+}
+
+static void *releaseMessages(void *arg) {
+    static_cast<Vector<sp<AMessage> > *>(arg)->clear();
+    return NULL;
+}
+
+TEST_F(AMessageTest, PoolAcrossThreads) {
+    static const size_t kNumThreads = 4;
+    Vector<sp<AMessage> > messages[kNumThreads];
+    pthread_t threads[kNumThreads];
+
+    const int64_t startUs = ALooper::GetNowUs();
+    for (size_t round = 0; round < 20; ++round) {
+        for (size_t i = 0; i < kNumThreads; ++i) {
+            ASSERT_EQ(0, pthread_create(&threads[i], NULL, createMessages, &messages[i]));
+        }
+        for (size_t i = 0; i < kNumThreads; ++i) {
+            pthread_join(threads[i], NULL);
+        }
+        for (size_t i = 0; i < kNumThreads; ++i) {
+            EXPECT_EQ(1000u, messages[i].size());
+            ASSERT_EQ(0, pthread_create(&threads[i], NULL, releaseMessages,
+                    &messages[(i + 1) % kNumThreads]));
+        }
+        for (size_t i = 0; i < kNumThreads; ++i) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+    const int64_t elapsedUs = ALooper::GetNowUs() - startUs;
+    printf("%zu threads: %.2f M messages/s\n",
+            kNumThreads, 20.0 * kNumThreads * 1000 / (elapsedUs + 1));
+}
+
+} // namespace android
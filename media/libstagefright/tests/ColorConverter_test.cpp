@@ -0,0 +1,129 @@
+/*
+ * Copyright 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ColorConverter_test"
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <utils/Log.h>
+#include <utils/Vector.h>
+
+#include <media/stagefright/ColorConverter.h>
+#include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/foundation/ALooper.h>
+
+namespace android {
+
+class ColorConverterTest : public ::testing::Test {
+protected:
+    // Fills a synthetic YUV 4:2:0 frame with a gradient and some noise.
+    void makeFrame(size_t width, size_t height) {
+        mWidth = width;
+        mHeight = height;
+        mSrc.clear();
+        mSrc.insertAt(0, width * height * 3 / 2);
+        srand(width * height);
+        for (size_t i = 0; i < mSrc.size(); ++i) {
+            mSrc.editItemAt(i) = (uint8_t)((i % width) + (rand() & 0x3f));
+        }
+    }
+
+    // Converts the frame |iterations| times, returns the average time in us.
+    int64_t convert(
+            OMX_COLOR_FORMATTYPE format, bool useSimd, size_t numThreads,
+            Vector<uint16_t> *dst, size_t iterations = 1) {
+        dst->clear();
+        dst->insertAt(0, mWidth * mHeight);
+
+        ColorConverter converter(format, OMX_COLOR_Format16bitRGB565);
+        EXPECT_TRUE(converter.isValid());
+        converter.setUseSimd(useSimd);
+        converter.setNumThreads(numThreads);
+
+        const int64_t startUs = ALooper::GetNowUs();
+        for (size_t i = 0; i < iterations; ++i) {
+            EXPECT_EQ(OK, converter.convert(
+                    mSrc.array(), mWidth, mHeight, 0, 0, mWidth - 1, mHeight - 1,
+                    dst->editArray(), mWidth, mHeight, 0, 0, mWidth - 1, mHeight - 1));
+        }
+        return (ALooper::GetNowUs() - startUs) / iterations;
+    }
+
+    size_t mWidth;
+    size_t mHeight;
+    Vector<uint8_t> mSrc;
+};
+
+static const OMX_COLOR_FORMATTYPE kFormats[] = {
+    OMX_QCOM_COLOR_FormatYVU420SemiPlanar,
+    OMX_COLOR_FormatYUV420SemiPlanar,
+    OMX_TI_COLOR_FormatYUV420PackedSemiPlanar,
+};
+
+static size_t countMismatches(const Vector<uint16_t> &a, const Vector<uint16_t> &b) {
+    size_t mismatches = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i] != b[i]) {
+            ++mismatches;
+        }
+    }
+    return mismatches;
+}
+
+TEST_F(ColorConverterTest, VectorizedAndBandedMatchScalar) {
+    // odd sizes exercise the scalar remainder of each row
+    static const size_t kSizes[][2] = { { 176, 144 }, { 102, 70 }, { 13, 9 } };
+
+    for (size_t f = 0; f < ARRAY_SIZE(kFormats); ++f) {
+        for (size_t s = 0; s < ARRAY_SIZE(kSizes); ++s) {
+            makeFrame(kSizes[s][0], kSizes[s][1]);
+            Vector<uint16_t> scalar, simd, banded;
+            convert(kFormats[f], false /* useSimd */, 1, &scalar);
+            convert(kFormats[f], true /* useSimd */, 1, &simd);
+            convert(kFormats[f], true /* useSimd */, ColorConverter::kMaxThreads, &banded);
+            EXPECT_EQ(0u, countMismatches(scalar, simd))
+                    << "format " << kFormats[f] << " " << mWidth << "x" << mHeight;
+            EXPECT_EQ(0u, countMismatches(scalar, banded))
+                    << "format " << kFormats[f] << " " << mWidth << "x" << mHeight;
+        }
+    }
+}
+
+TEST_F(ColorConverterTest, Benchmark) {
+    static const size_t kSizes[][2] = { { 1920, 1080 }, { 3840, 2160 } };
+    static const size_t kIterations = 10;
+
+    for (size_t s = 0; s < ARRAY_SIZE(kSizes); ++s) {
+        makeFrame(kSizes[s][0], kSizes[s][1]);
+        for (size_t f = 0; f < ARRAY_SIZE(kFormats); ++f) {
+            Vector<uint16_t> scalar, simd, banded;
+            const int64_t scalarUs = convert(kFormats[f], false, 1, &scalar, kIterations);
+            const int64_t simdUs = convert(kFormats[f], true, 1, &simd, kIterations);
+            const int64_t bandedUs = convert(
+                    kFormats[f], true, ColorConverter::kMaxThreads, &banded, kIterations);
+            EXPECT_EQ(0u, countMismatches(scalar, simd));
+            EXPECT_EQ(0u, countMismatches(scalar, banded));
+            printf("%zux%zu format 0x%08x: scalar %lld us, simd %lld us, "
+                    "simd with %zu threads %lld us\n",
+                    mWidth, mHeight, kFormats[f],
+                    (long long)scalarUs, (long long)simdUs,
+                    ColorConverter::kMaxThreads, (long long)bandedUs);
+        }
+    }
+}
+
+} // namespace android
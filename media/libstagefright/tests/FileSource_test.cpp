@@ -0,0 +1,152 @@
+/*
+ * Copyright 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "FileSource_test"
+
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utils/Log.h>
+#include <utils/Vector.h>
+
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/FileSource.h>
+
+namespace android {
+
+class FileSourceTest : public ::testing::Test {
+protected:
+    static const size_t kFileSize = 4 << 20;
+
+    virtual void SetUp() {
+        strcpy(mPath, "/data/local/tmp/FileSource_test.XXXXXX");
+        int fd = mkstemp(mPath);
+        ASSERT_GE(fd, 0);
+        mData.resize(kFileSize);
+        for (size_t i = 0; i < kFileSize; ++i) {
+            mData.editItemAt(i) = (uint8_t)(i * 31 + (i >> 12));
+        }
+        ASSERT_EQ((ssize_t)kFileSize, write(fd, mData.array(), kFileSize));
+        close(fd);
+    }
+
+    virtual void TearDown() {
+        unlink(mPath);
+    }
+
+    sp<FileSource> openRange(off64_t offset, off64_t length) {
+        return new FileSource(open(mPath, O_RDONLY), offset, length);
+    }
+
+    char mPath[64];
+    Vector<uint8_t> mData;
+};
+
+TEST_F(FileSourceTest, MappedReadsMatch) {
+    const off64_t kOffset = 1000;    // not page aligned
+    const off64_t kLength = kFileSize - 2 * kOffset;
+    sp<FileSource> plain = openRange(kOffset, kLength);
+    sp<FileSource> mapped = openRange(kOffset, kLength);
+    ASSERT_EQ(OK, plain->initCheck());
+    ASSERT_TRUE(mapped->mapFile());
+
+    sp<ABuffer> buffer;
+    EXPECT_EQ(ERROR_UNSUPPORTED, plain->getBufferAt(0, 16, &buffer));
+    EXPECT_EQ(ERROR_END_OF_STREAM, mapped->getBufferAt(kLength - 8, 16, &buffer));
+
+    uint8_t a[1024], b[1024];
+    srand(kFileSize);
+    for (size_t i = 0; i < 1000; ++i) {
+        off64_t offset = rand() % (kLength + 100);
+        size_t size = rand() % sizeof(a);
+        ssize_t n = plain->readAt(offset, a, size);
+        ASSERT_EQ(n, mapped->readAt(offset, b, size));
+        ASSERT_EQ(0, memcmp(a, b, n > 0 ? n : 0));
+        if (n == (ssize_t)size) {
+            ASSERT_EQ(0, memcmp(a, &mData[kOffset + offset], size));
+            ASSERT_EQ(OK, mapped->getBufferAt(offset, size, &buffer));
+            ASSERT_EQ(size, buffer->size());
+            ASSERT_EQ(0, memcmp(a, buffer->data(), size));
+        }
+    }
+
+    mapped->setAccessPattern(DataSource::kAccessPatternRandom);
+    plain->setAccessPattern(DataSource::kAccessPatternSequential);
+}
+
+TEST_F(FileSourceTest, BufferOutlivesSource) {
+    sp<ABuffer> buffer;
+    {
+        sp<FileSource> source = openRange(0, kFileSize);
+        ASSERT_TRUE(source->mapFile());
+        ASSERT_EQ(OK, source->getBufferAt(kFileSize - 4096, 4096, &buffer));
+    }
+    EXPECT_EQ(0, memcmp(buffer->data(), &mData[kFileSize - 4096], 4096));
+}
+
+// Buffers are read-only, so their holders cannot change later reads.
+TEST_F(FileSourceTest, BufferIsReadOnly) {
+    sp<FileSource> source = openRange(0, kFileSize);
+    ASSERT_TRUE(source->mapFile());
+    sp<ABuffer> buffer;
+    ASSERT_EQ(OK, source->getBufferAt(8192, 4096, &buffer));
+    EXPECT_DEATH(memset(buffer->data(), 0x5a, buffer->size()), "");
+
+    uint8_t data[4096];
+    ASSERT_EQ((ssize_t)sizeof(data), source->readAt(8192, data, sizeof(data)));
+    EXPECT_EQ(0, memcmp(data, &mData[8192], sizeof(data)));
+}
+
+// A file that others may write to is not mapped, so truncating it after the
+// source was created makes reads come up short instead of raising SIGBUS.
+TEST_F(FileSourceTest, TruncatedFileIsNotMapped) {
+    ASSERT_EQ(0, chmod(mPath, 0666));
+    sp<FileSource> source = openRange(0, kFileSize);
+    ASSERT_EQ(OK, source->initCheck());
+    EXPECT_FALSE(source->mapFile());
+    sp<ABuffer> buffer;
+    EXPECT_EQ(ERROR_UNSUPPORTED, source->getBufferAt(0, 4096, &buffer));
+
+    ASSERT_EQ(0, truncate(mPath, kFileSize / 2));
+    uint8_t data[4096];
+    EXPECT_EQ((ssize_t)sizeof(data), source->readAt(0, data, sizeof(data)));
+    EXPECT_EQ(0, memcmp(data, &mData[0], sizeof(data)));
+    EXPECT_EQ(1024, source->readAt(kFileSize / 2 - 1024, data, sizeof(data)));
+    EXPECT_EQ(0, source->readAt(kFileSize - 4096, data, sizeof(data)));
+}
+
+// Reads the file in sample sized pieces with and without mapping.
+TEST_F(FileSourceTest, SmallReadThroughput) {
+    static const size_t kReadSize = 188;
+    uint8_t data[kReadSize];
+    for (int map = 0; map < 2; ++map) {
+        sp<FileSource> source = openRange(0, kFileSize);
+        ASSERT_TRUE(!map || source->mapFile());
+        int64_t startUs = ALooper::GetNowUs();
+        for (off64_t offset = 0; offset + kReadSize <= kFileSize; offset += kReadSize) {
+            ASSERT_EQ((ssize_t)kReadSize, source->readAt(offset, data, kReadSize));
+        }
+        int64_t elapsedUs = ALooper::GetNowUs() - startUs;
+        printf("%s: %zu byte reads at %.1f MB/s\n", map ? "mapped" : "pread",
+                kReadSize, (double)kFileSize / (elapsedUs + 1));
+    }
+}
+
+} // namespace android
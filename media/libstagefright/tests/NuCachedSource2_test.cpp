@@ -0,0 +1,168 @@
+/*
+ * Copyright 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "NuCachedSource2_test"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <utils/Log.h>
+#include <utils/threads.h>
+
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/DataSource.h>
+
+#include "include/NuCachedSource2.h"
+
+namespace android {
+
+// Serves a synthetic file no faster than a given rate, like a slow network.
+struct ThrottledDataSource : public DataSource {
+    ThrottledDataSource(off64_t size, int64_t bytesPerSec)
+        : mSize(size),
+          mBytesPerSec(bytesPerSec),
+          mBytesRead(0) {
+    }
+
+    static uint8_t ByteAt(off64_t offset) {
+        return (uint8_t)(offset * 7 + (offset >> 16));
+    }
+
+    virtual status_t initCheck() const {
+        return OK;
+    }
+
+    virtual status_t getSize(off64_t *size) {
+        *size = mSize;
+        return OK;
+    }
+
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        if (offset >= mSize) {
+            return 0;
+        }
+        if ((off64_t)size > mSize - offset) {
+            size = mSize - offset;
+        }
+        for (size_t i = 0; i < size; ++i) {
+            ((uint8_t *)data)[i] = ByteAt(offset + i);
+        }
+        usleep(size * 1000000ll / mBytesPerSec);
+
+        Mutex::Autolock autoLock(mLock);
+        mBytesRead += size;
+        return size;
+    }
+
+    int64_t bytesRead() {
+        Mutex::Autolock autoLock(mLock);
+        return mBytesRead;
+    }
+
+private:
+    const off64_t mSize;
+    const int64_t mBytesPerSec;
+    Mutex mLock;
+    int64_t mBytesRead;
+};
+
+class NuCachedSource2Test : public ::testing::Test {
+protected:
+    static const off64_t kFileSize = 64 << 20;
+
+    virtual void SetUp() {
+        mSource = new ThrottledDataSource(kFileSize, 16 << 20);
+        // 1 MB low water mark, 8 MB high water mark, no keep-alives
+        mCache = NuCachedSource2::Create(mSource, "1024/8192/0");
+    }
+
+    void printStats() {
+        sp<AMessage> stats = mCache->getStats();
+        int64_t numReads, numHits, bytesFetched, bytesRefetched, numNewRanges;
+        int32_t numRanges;
+        ASSERT_TRUE(stats->findInt64("reads", &numReads));
+        ASSERT_TRUE(stats->findInt64("cache-hits", &numHits));
+        ASSERT_TRUE(stats->findInt64("bytes-fetched", &bytesFetched));
+        ASSERT_TRUE(stats->findInt64("bytes-refetched", &bytesRefetched));
+        ASSERT_TRUE(stats->findInt64("new-ranges", &numNewRanges));
+        ASSERT_TRUE(stats->findInt32("num-ranges", &numRanges));
+        printf("%lld reads, %.1f%% hits, %lld KB fetched, %lld KB refetched, "
+                "%lld new ranges, %d cached\n",
+                (long long)numReads, numHits * 100.0 / numReads,
+                (long long)bytesFetched / 1024, (long long)bytesRefetched / 1024,
+                (long long)numNewRanges, numRanges);
+        mBytesRefetched = bytesRefetched;
+        mNumNewRanges = numNewRanges;
+    }
+
+    void read(off64_t offset, size_t size) {
+        uint8_t data[65536];
+        ASSERT_LE(size, sizeof(data));
+        ASSERT_EQ((ssize_t)size, mCache->readAt(offset, data, size));
+        for (size_t i = 0; i < size; ++i) {
+            if (data[i] != ThrottledDataSource::ByteAt(offset + i)) {
+                FAIL() << "mismatch at " << offset + i;
+            }
+        }
+    }
+
+    sp<ThrottledDataSource> mSource;
+    sp<NuCachedSource2> mCache;
+    int64_t mBytesRefetched;
+    int64_t mNumNewRanges;
+};
+
+// The index at the end of the file is read first and then again and again
+// while the samples at the start are read.
+TEST_F(NuCachedSource2Test, IndexAtEnd) {
+    const off64_t kIndexOffset = kFileSize - (512 << 10);
+    const int64_t startUs = ALooper::GetNowUs();
+
+    read(0, 4096);
+    for (off64_t offset = kIndexOffset; offset < kFileSize; offset += 16384) {
+        read(offset, 16384);
+    }
+    for (off64_t offset = 4096; offset < (16 << 20); offset += 16384) {
+        read(offset, 16384);
+        if (offset % (1 << 20) == 4096) {
+            read(kIndexOffset + (offset >> 4) % (512 << 10) / 2, 4096);
+        }
+    }
+
+    printf("read in %lld ms: ", (long long)(ALooper::GetNowUs() - startUs) / 1000);
+    printStats();
+    EXPECT_EQ(0, mBytesRefetched);
+    EXPECT_LE(mNumNewRanges, 2);
+}
+
+// Two tracks far apart in the file are read in turns.
+TEST_F(NuCachedSource2Test, InterleavedTracks) {
+    const off64_t kSecondTrackOffset = kFileSize / 2;
+    const int64_t startUs = ALooper::GetNowUs();
+
+    for (off64_t offset = 0; offset < (8 << 20); offset += 32768) {
+        read(offset, 32768);
+        read(kSecondTrackOffset + offset, 32768);
+    }
+
+    printf("read in %lld ms: ", (long long)(ALooper::GetNowUs() - startUs) / 1000);
+    printStats();
+    EXPECT_EQ(0, mBytesRefetched);
+    EXPECT_LE(mNumNewRanges, 2);
+}
+
+} // namespace android
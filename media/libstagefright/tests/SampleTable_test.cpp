@@ -0,0 +1,350 @@
+/*
+ * Copyright 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SampleTable_test"
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <utils/Log.h>
+#include <utils/Vector.h>
+
+#include <media/stagefright/DataSource.h>
+#include <media/stagefright/Utils.h>
+#include <media/stagefright/foundation/ALooper.h>
+
+#include "include/SampleTable.h"
+
+namespace android {
+
+// Serves the sample table boxes of a synthetic track from memory and counts
+// the reads. The next reads can be made to fail or to come back short, as
+// they may on a network source.
+struct MemoryDataSource : public DataSource {
+    MemoryDataSource() : mNumReads(0), mNumFailingReads(0), mNumShortReads(0) {}
+
+    virtual status_t initCheck() const { return OK; }
+
+    virtual ssize_t readAt(off64_t offset, void *data, size_t size) {
+        ++mNumReads;
+        if (mNumFailingReads > 0) {
+            --mNumFailingReads;
+            return ERROR_IO;
+        }
+        if (offset < 0 || (size_t)offset >= mData.size()) {
+            return 0;
+        }
+        if (size > mData.size() - offset) {
+            size = mData.size() - offset;
+        }
+        if (mNumShortReads > 0) {
+            --mNumShortReads;
+            size /= 2;
+        }
+        memcpy(data, mData.array() + offset, size);
+        return size;
+    }
+
+    void put32(uint32_t x) {
+        mData.push((uint8_t)(x >> 24));
+        mData.push((uint8_t)(x >> 16));
+        mData.push((uint8_t)(x >> 8));
+        mData.push((uint8_t)x);
+    }
+
+    off64_t size() const { return mData.size(); }
+
+    Vector<uint8_t> mData;
+    size_t mNumReads;
+    size_t mNumFailingReads;
+    size_t mNumShortReads;
+};
+
+static const uint32_t kSampleDuration = 1001;    // 30000 Hz time scale
+static const uint32_t kSamplesPerChunk = 10;
+static const uint32_t kSyncInterval = 30;
+
+class SampleTableTest : public ::testing::Test {
+protected:
+    // Builds a track of |numSamples| samples. If |reordered|, composition
+    // offsets follow an I P B B pattern, otherwise there is no ctts box. If
+    // |delayed|, one sample is presented half the track later, which reorders
+    // it too far for a search around its decode order position.
+    void makeTrack(uint32_t numSamples, bool reordered, bool delayed = false) {
+        mNumSamples = numSamples;
+        mSource = new MemoryDataSource;
+        mTable = new SampleTable(mSource);
+
+        off64_t start = mSource->size();
+        mSource->put32(0);
+        mSource->put32(1);
+        mSource->put32(numSamples);
+        mSource->put32(kSampleDuration);
+        ASSERT_EQ(OK, mTable->setTimeToSampleParams(start, mSource->size() - start));
+
+        if (reordered) {
+            start = mSource->size();
+            mSource->put32(0);
+            mSource->put32(numSamples);
+            for (uint32_t i = 0; i < numSamples; ++i) {
+                mSource->put32(1);
+                mSource->put32(compositionOffset(i, numSamples, delayed));
+            }
+            ASSERT_EQ(OK, mTable->setCompositionTimeToSampleParams(
+                    start, mSource->size() - start));
+        }
+
+        start = mSource->size();
+        mSource->put32(0);
+        mSource->put32((numSamples + kSyncInterval - 1) / kSyncInterval);
+        for (uint32_t i = 0; i < numSamples; i += kSyncInterval) {
+            mSource->put32(i + 1);
+        }
+        ASSERT_EQ(OK, mTable->setSyncSampleParams(start, mSource->size() - start));
+
+        start = mSource->size();
+        mSource->put32(0);
+        mSource->put32(0);
+        mSource->put32(numSamples);
+        for (uint32_t i = 0; i < numSamples; ++i) {
+            mSource->put32(sampleSize(i));
+        }
+        ASSERT_EQ(OK, mTable->setSampleSizeParams(
+                FOURCC('s', 't', 's', 'z'), start, mSource->size() - start));
+
+        start = mSource->size();
+        mSource->put32(0);
+        mSource->put32(1);
+        mSource->put32(1);
+        mSource->put32(kSamplesPerChunk);
+        mSource->put32(1);
+        ASSERT_EQ(OK, mTable->setSampleToChunkParams(start, mSource->size() - start));
+
+        start = mSource->size();
+        const uint32_t numChunks = (numSamples + kSamplesPerChunk - 1) / kSamplesPerChunk;
+        mSource->put32(0);
+        mSource->put32(numChunks);
+        for (uint32_t i = 0; i < numChunks; ++i) {
+            mSource->put32(i * kSamplesPerChunk * 1024);
+        }
+        ASSERT_EQ(OK, mTable->setChunkOffsetParams(
+                FOURCC('s', 't', 'c', 'o'), start, mSource->size() - start));
+
+        ASSERT_TRUE(mTable->isValid());
+    }
+
+    static uint32_t sampleSize(uint32_t i) {
+        return 100 + (i * 7919) % 900;
+    }
+
+    static uint32_t compositionOffset(uint32_t i, uint32_t numSamples, bool delayed) {
+        static const uint32_t kOffsets[] = { 1, 3, 0, 0 };
+        uint32_t offset = kOffsets[i % 4] * kSampleDuration;
+        if (delayed && i == numSamples / 4 + 1) {
+            offset += numSamples / 2 * kSampleDuration + 1;
+        }
+        return offset;
+    }
+
+    // Checks findSampleAtTime() against a search of all composition times.
+    void checkSeeks(bool delayed, uint64_t scale_num, uint64_t scale_den) {
+        Vector<uint64_t> times;
+        for (uint32_t i = 0; i < mNumSamples; ++i) {
+            times.push((i * kSampleDuration + compositionOffset(i, mNumSamples, delayed))
+                    * scale_num / scale_den);
+        }
+
+        static const uint32_t kFlags[] = {
+            SampleTable::kFlagBefore, SampleTable::kFlagAfter, SampleTable::kFlagClosest };
+        const uint64_t end = times[mNumSamples - 1] + 3 * kSampleDuration * scale_num / scale_den;
+        const uint64_t step = kSampleDuration * scale_num / scale_den / 3 + 1;
+        for (uint64_t reqTime = 0; reqTime < end; reqTime += step) {
+            bool hasBefore = false, hasAfter = false, hasExact = false;
+            uint32_t before = 0, after = 0, exact = 0;
+            for (uint32_t i = 0; i < mNumSamples; ++i) {
+                if (times[i] == reqTime) {
+                    hasExact = true;
+                    exact = i;
+                } else if (times[i] < reqTime && (!hasBefore || times[i] > times[before])) {
+                    hasBefore = true;
+                    before = i;
+                } else if (times[i] > reqTime && (!hasAfter || times[i] < times[after])) {
+                    hasAfter = true;
+                    after = i;
+                }
+            }
+
+            for (size_t f = 0; f < sizeof(kFlags) / sizeof(kFlags[0]); ++f) {
+                uint32_t sampleIndex;
+                status_t err = mTable->findSampleAtTime(
+                        reqTime, scale_num, scale_den, &sampleIndex, kFlags[f]);
+                if (!hasExact && !hasAfter && kFlags[f] == SampleTable::kFlagAfter) {
+                    EXPECT_EQ(ERROR_OUT_OF_RANGE, err) << "time " << reqTime;
+                    continue;
+                }
+                ASSERT_EQ(OK, err) << "time " << reqTime;
+
+                uint32_t expected;
+                if (hasExact) {
+                    expected = exact;
+                } else if (!hasAfter || (kFlags[f] == SampleTable::kFlagBefore && hasBefore)) {
+                    expected = before;
+                } else if (!hasBefore || kFlags[f] == SampleTable::kFlagAfter) {
+                    expected = after;
+                } else {
+                    expected = times[after] - reqTime > reqTime - times[before] ? before : after;
+                }
+                EXPECT_EQ(expected, sampleIndex) << "time " << reqTime << " flags " << kFlags[f];
+            }
+        }
+    }
+
+    uint32_t mNumSamples;
+    sp<MemoryDataSource> mSource;
+    sp<SampleTable> mTable;
+};
+
+TEST_F(SampleTableTest, SeekAndReadMetaData) {
+    makeTrack(10000, false /* reordered */);
+
+    uint32_t sampleIndex;
+    ASSERT_EQ(OK, mTable->findSampleAtTime(
+            1234 * kSampleDuration, 1, 1, &sampleIndex, SampleTable::kFlagBefore));
+    EXPECT_EQ(1234u, sampleIndex);
+    ASSERT_EQ(OK, mTable->findSampleAtTime(
+            1234 * kSampleDuration + 1, 1, 1, &sampleIndex, SampleTable::kFlagAfter));
+    EXPECT_EQ(1235u, sampleIndex);
+    ASSERT_EQ(OK, mTable->findSampleAtTime(
+            1234 * kSampleDuration + 1, 1, 1, &sampleIndex, SampleTable::kFlagClosest));
+    EXPECT_EQ(1234u, sampleIndex);
+
+    uint32_t syncIndex;
+    ASSERT_EQ(OK, mTable->findSyncSampleNear(1234, &syncIndex, SampleTable::kFlagBefore));
+    EXPECT_EQ(1230u, syncIndex);
+    ASSERT_EQ(OK, mTable->findSyncSampleNear(1234, &syncIndex, SampleTable::kFlagAfter));
+    EXPECT_EQ(1260u, syncIndex);
+
+    // read backwards to defeat any caching of the previous position
+    for (uint32_t i = mNumSamples; i-- > 0;) {
+        off64_t offset;
+        size_t size;
+        uint32_t time, duration;
+        bool isSync;
+        ASSERT_EQ(OK, mTable->getMetaDataForSample(
+                i, &offset, &size, &time, &isSync, &duration));
+        EXPECT_EQ(sampleSize(i), size);
+        EXPECT_EQ(i * kSampleDuration, time);
+        EXPECT_EQ(kSampleDuration, duration);
+        EXPECT_EQ(i % kSyncInterval == 0, isSync);
+    }
+}
+
+TEST_F(SampleTableTest, ReorderedSeek) {
+    makeTrack(10000, true /* reordered */);
+
+    // decode order 0 1 2 3 is presented as 0 2 3 1
+    uint32_t sampleIndex;
+    ASSERT_EQ(OK, mTable->findSampleAtTime(
+            402 * kSampleDuration, 1, 1, &sampleIndex, SampleTable::kFlagBefore));
+    EXPECT_EQ(402u, sampleIndex);
+    ASSERT_EQ(OK, mTable->findSampleAtTime(
+            404 * kSampleDuration, 1, 1, &sampleIndex, SampleTable::kFlagBefore));
+    EXPECT_EQ(401u, sampleIndex);
+    ASSERT_EQ(OK, mTable->findSampleAtTime(
+            405 * kSampleDuration - 1, 1, 1, &sampleIndex, SampleTable::kFlagAfter));
+    EXPECT_EQ(404u, sampleIndex);
+}
+
+// Reordered samples are found around their decode order position, or in a
+// sorted table of all samples if one is reordered too far: both match a search
+// of all composition times.
+TEST_F(SampleTableTest, ReorderedSeekMatchesCompositionOrder) {
+    for (int delayed = 0; delayed < 2; ++delayed) {
+        makeTrack(2000, true /* reordered */, delayed);
+        checkSeeks(delayed, 1, 1);
+        checkSeeks(delayed, 1000000, 30000);
+    }
+}
+
+// A failed or short read does not leave a page of the sample size, chunk
+// offset or sync sample tables failing until the track is closed.
+TEST_F(SampleTableTest, ReadErrorIsNotCached) {
+    makeTrack(10000, false /* reordered */);
+
+    mSource->mNumFailingReads = 1;
+    uint32_t syncIndex;
+    EXPECT_NE(OK, mTable->findSyncSampleNear(7777, &syncIndex, SampleTable::kFlagBefore));
+    ASSERT_EQ(OK, mTable->findSyncSampleNear(7777, &syncIndex, SampleTable::kFlagBefore));
+    EXPECT_EQ(7770u, syncIndex);
+
+    for (int shortRead = 0; shortRead < 2; ++shortRead) {
+        const uint32_t sampleIndex = shortRead ? 9000 : 5000;
+        if (shortRead) {
+            mSource->mNumShortReads = 1;
+        } else {
+            mSource->mNumFailingReads = 1;
+        }
+        size_t size;
+        bool isSync;
+        EXPECT_NE(OK, mTable->getMetaDataForSample(sampleIndex, NULL, &size, NULL, &isSync));
+
+        ASSERT_EQ(OK, mTable->getMetaDataForSample(sampleIndex, NULL, &size, NULL, &isSync));
+        EXPECT_EQ(sampleSize(sampleIndex), size);
+        EXPECT_EQ(sampleIndex % kSyncInterval == 0, isSync);
+    }
+}
+
+// Seek latency on a 10 hour, 30 fps track.
+TEST_F(SampleTableTest, LongTrackSeekLatency) {
+    static const uint32_t kNumSamples = 10 * 3600 * 30;
+    static const size_t kNumSeeks = 1000;
+
+    for (int reordered = 0; reordered < 2; ++reordered) {
+        makeTrack(kNumSamples, reordered);
+        mSource->mNumReads = 0;
+
+        int64_t startUs = ALooper::GetNowUs();
+        size_t maxSize;
+        ASSERT_EQ(OK, mTable->getMaxSampleSize(&maxSize));
+        const int64_t maxSizeUs = ALooper::GetNowUs() - startUs;
+        const size_t maxSizeReads = mSource->mNumReads;
+
+        srand(kNumSamples);
+        int64_t firstSeekUs = 0;
+        startUs = ALooper::GetNowUs();
+        for (size_t i = 0; i < kNumSeeks; ++i) {
+            uint64_t time = (uint64_t)(rand() % kNumSamples) * kSampleDuration;
+            uint32_t sampleIndex, syncIndex;
+            ASSERT_EQ(OK, mTable->findSampleAtTime(
+                    time, 1, 1, &sampleIndex, SampleTable::kFlagClosest));
+            ASSERT_EQ(OK, mTable->findSyncSampleNear(
+                    sampleIndex, &syncIndex, SampleTable::kFlagBefore));
+            ASSERT_EQ(OK, mTable->getMetaDataForSample(syncIndex, NULL, NULL, NULL));
+            if (i == 0) {
+                firstSeekUs = ALooper::GetNowUs() - startUs;
+            }
+        }
+        const int64_t seeksUs = ALooper::GetNowUs() - startUs;
+
+        printf("%u samples%s: max sample size scan %lld us (%zu reads), "
+                "first seek %lld us, %.1f us per seek\n",
+                kNumSamples, reordered ? " (reordered)" : "",
+                (long long)maxSizeUs, maxSizeReads, (long long)firstSeekUs,
+                (double)seeksUs / kNumSeeks);
+    }
+}
+
+} // namespace android
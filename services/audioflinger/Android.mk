@@ -109,6 +109,7 @@ LOCAL_MODULE:= libaudioflinger
 
 LOCAL_SRC_FILES += \
     AudioWatchdog.cpp        \
+    AudioWorkerPool.cpp      \
     FastCapture.cpp          \
     FastCaptureDumpState.cpp \
     FastCaptureState.cpp     \
@@ -210,6 +211,8 @@ LOCAL_CFLAGS += -Werror -Wall
 
 # uncomment to disable NEON on architectures that actually do support NEON, for benchmarking
 #LOCAL_CFLAGS += -DUSE_NEON=false
+# likewise, uncomment to disable the SSE and AVX2 kernels on x86
+#LOCAL_CFLAGS += -DUSE_SSE=false
 
 include $(BUILD_SHARED_LIBRARY)
 
@@ -79,6 +79,7 @@
 #include <hardware/audio.h>
 
 #include "AudioMixer.h"
+#include "AudioResamplerDyn.h"
 #include "AudioFlinger.h"
 #include "ServiceUtilities.h"
 
@@ -412,6 +413,8 @@ void AudioFlinger::dumpInternals(int fd, const Vector<String16>& args __unused)
                             (uint32_t)(mStandbyTimeInNsecs / 1000000));
     result.append(buffer);
     write(fd, result.string(), result.size());
+
+    AudioResamplerFilterCache::dump(fd);
 }
 
 void AudioFlinger::dumpPermissionDenial(int fd, const Vector<String16>& args __unused)
@@ -72,6 +72,7 @@
 #include "FastMixer.h"
 #include <media/nbaio/NBAIO.h>
 #include "AudioWatchdog.h"
+#include "AudioWorkerPool.h"
 #include "AudioMixer.h"
 #include "AudioStreamOut.h"
 #include "SpdifStreamOut.h"
@@ -471,18 +472,8 @@ private:
 
     class TrackHandle;
     class RecordHandle;
-    class RecordThread;
-    class PlaybackThread;
-    class MixerThread;
-    class DirectOutputThread;
-    class OffloadThread;
-    class DuplicatingThread;
-    class AsyncCallbackThread;
     class Track;
     class RecordTrack;
-    class EffectModule;
-    class EffectHandle;
-    class EffectChain;
 
     struct AudioStreamIn;
 
@@ -496,12 +487,27 @@ private:
         bool        mute;
     };
 
+public:
+    // The threads and effect chains can be built and run on their own, by the unit tests.
+    class RecordThread;
+    class PlaybackThread;
+    class MixerThread;
+    class DirectOutputThread;
+    class OffloadThread;
+    class DuplicatingThread;
+    class AsyncCallbackThread;
+    class EffectModule;
+    class EffectHandle;
+    class EffectChain;
+
     // --- PlaybackThread ---
 
 #include "Threads.h"
 
 #include "Effects.h"
 
+private:
+
 #include "PatchPanel.h"
 
     // server side of the client's IAudioTrack
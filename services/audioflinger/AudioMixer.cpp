@@ -38,6 +38,7 @@
 #include <audio_utils/format.h>
 
 #include "AudioMixerOps.h"
+#include "AudioMixerOpsSimd.h"
 #include "AudioMixer.h"
 
 // The FCC_2 macro refers to the Fixed Channel Count of 2 for the legacy integer mixer.
@@ -80,6 +81,15 @@ static const bool kUseNewMixer = true;
 // because of downmix/upmix support.
 static const bool kUseFloat = true;
 
+// Set kUseSimd to true to select the vectorized volume and mix kernels by default.
+// Has no effect on architectures without SSE2 or NEON support.
+static const bool kUseSimd = USE_MIXER_SIMD;
+
+// Set kUseBlockedMix to true to use the cache-blocked mixing engine by default
+// when at least kBlockedMixMinTracks tracks are mixed without resampling.
+static const bool kUseBlockedMix = true;
+static const int kBlockedMixMinTracks = 2;
+
 // Set to default copy buffer size in frames for input processing.
 static const size_t kCopyBufferFrameCount = 256;
 
@@ -103,7 +113,7 @@ T min(const T& a, const T& b)
 
 AudioMixer::AudioMixer(size_t frameCount, uint32_t sampleRate, uint32_t maxNumTracks)
     :   mTrackNames(0), mConfiguredNames((maxNumTracks >= 32 ? 0 : 1 << maxNumTracks) - 1),
-        mSampleRate(sampleRate)
+        mSampleRate(sampleRate), mDirectFrames(0), mCopiedFrames(0)
 {
     ALOG_ASSERT(maxNumTracks <= MAX_NUM_TRACKS, "maxNumTracks %u > MAX_NUM_TRACKS %u",
             maxNumTracks, MAX_NUM_TRACKS);
@@ -120,7 +130,7 @@ AudioMixer::AudioMixer(size_t frameCount, uint32_t sampleRate, uint32_t maxNumTr
     mState.outputTemp   = NULL;
     mState.resampleTemp = NULL;
     mState.mLog         = &mDummyLog;
-    // mState.reserved
+    mState.directTracks = 0;
 
     // FIXME Most of the following initialization is probably redundant since
     // tracks[i] should only be referenced if (mTrackNames & (1 << i)) != 0
@@ -227,6 +237,7 @@ int AudioMixer::getTrackName(audio_channel_mask_t channelMask,
         t->mFormat = format;
         t->mMixerInFormat = selectMixerInFormat(format);
         t->mDownmixRequiresFormat = AUDIO_FORMAT_INVALID; // no format required
+        t->mDirectInput = false;
         t->mMixerChannelMask = audio_channel_mask_from_representation_and_bits(
                 AUDIO_CHANNEL_REPRESENTATION_POSITION, AUDIO_CHANNEL_OUT_STEREO);
         t->mMixerChannelCount = audio_channel_count_from_out_mask(t->mMixerChannelMask);
@@ -287,7 +298,8 @@ bool AudioMixer::setChannelMasks(int name,
             "prepareForDownmix error %d, track channel mask %#x, mixer channel mask %#x",
             status, track.channelMask, track.mMixerChannelMask);
 
-    if (prevDownmixerFormat != track.mDownmixRequiresFormat) {
+    if (prevDownmixerFormat != track.mDownmixRequiresFormat
+            || track.mDirectInput != track.canMixDirect()) {
         track.prepareForReformat(); // because of downmixer, track format may change!
     }
 
@@ -381,8 +393,9 @@ status_t AudioMixer::track_t::prepareForReformat()
     // only configure reformatters as needed
     const audio_format_t targetFormat = mDownmixRequiresFormat != AUDIO_FORMAT_INVALID
             ? mDownmixRequiresFormat : mMixerInFormat;
+    mDirectInput = canMixDirect();
     bool requiresReconfigure = false;
-    if (mFormat != targetFormat) {
+    if (mFormat != targetFormat && !mDirectInput) {
         mReformatBufferProvider = new ReformatBufferProvider(
                 audio_channel_count_from_out_mask(channelMask),
                 mFormat,
@@ -404,6 +417,27 @@ status_t AudioMixer::track_t::prepareForReformat()
     return NO_ERROR;
 }
 
+/* Returns true if the track can be mixed without mReformatBufferProvider.
+ * The track hooks convert PCM_16 input on the fly while mixing it into a PCM_FLOAT mix,
+ * which is bit-exact with reformatting it to float first, so the common case of a PCM_16
+ * track at the mixer sample rate is read directly out of the track buffer.
+ * The resampler, downmixer and timestretch only accept mMixerInFormat input.
+ */
+bool AudioMixer::track_t::canMixDirect() const
+{
+    return mFormat == AUDIO_FORMAT_PCM_16_BIT && mMixerInFormat == AUDIO_FORMAT_PCM_FLOAT
+            && resampler == NULL && downmixerBufferProvider == NULL
+            && mTimestretchBufferProvider == NULL;
+}
+
+// Call after adding or removing the resampler or timestretch.
+void AudioMixer::track_t::updateDirectInput()
+{
+    if (mDirectInput != canMixDirect()) {
+        prepareForReformat();
+    }
+}
+
 void AudioMixer::track_t::reconfigureBufferProviders()
 {
     bufferProvider = mInputBufferProvider;
@@ -687,6 +721,7 @@ void AudioMixer::setParameter(int name, int target, int param, void *value)
             delete track.resampler;
             track.resampler = NULL;
             track.sampleRate = mSampleRate;
+            track.updateDirectInput();
             invalidateState(1 << name);
             break;
         default:
@@ -733,6 +768,7 @@ void AudioMixer::setParameter(int name, int target, int param, void *value)
                 ALOGW_IF(!isAudioPlaybackRateValid(*playbackRate),
                         "bad parameters speed %f, pitch %f",playbackRate->mSpeed,
                         playbackRate->mPitch);
+                const AudioBufferProvider *prevBufferProvider = track.bufferProvider;
                 if (track.setPlaybackRate(*playbackRate)) {
                     ALOGV("setParameter(TIMESTRETCH, PLAYBACK_RATE, STRETCH_MODE, FALLBACK_MODE "
                             "%f %f %d %d",
@@ -741,6 +777,10 @@ void AudioMixer::setParameter(int name, int target, int param, void *value)
                             playbackRate->mStretchMode,
                             playbackRate->mFallbackMode);
                     // invalidateState(1 << name);
+                    if (track.bufferProvider != prevBufferProvider) {
+                        // timestretch was added, the hooks must read its output.
+                        invalidateState(1 << name);
+                    }
                 }
             } break;
             default:
@@ -791,6 +831,7 @@ bool AudioMixer::track_t::setResampler(uint32_t trackSampleRate, uint32_t devSam
                         mMixerInFormat,
                         resamplerChannelCount,
                         devSampleRate, quality);
+                updateDirectInput();
             }
             return true;
         }
@@ -815,6 +856,7 @@ bool AudioMixer::track_t::setPlaybackRate(const AudioPlaybackRate &playbackRate)
         mTimestretchBufferProvider = new TimestretchBufferProvider(timestretchChannelCount,
                 mMixerInFormat, sampleRate, playbackRate);
         reconfigureBufferProviders();
+        updateDirectInput();
     } else {
         reinterpret_cast<TimestretchBufferProvider*>(mTimestretchBufferProvider)
                 ->setPlaybackRate(playbackRate);
@@ -913,6 +955,13 @@ void AudioMixer::setBufferProvider(int name, AudioBufferProvider* bufferProvider
 void AudioMixer::process()
 {
     mState.hook(&mState);
+
+    // counted after the hook, as process__validate() may have changed the enabled tracks.
+    const uint32_t enabledTracks = mState.enabledTracks;
+    mDirectFrames += (int64_t)__builtin_popcount(enabledTracks & mState.directTracks)
+            * mState.frameCount;
+    mCopiedFrames += (int64_t)__builtin_popcount(enabledTracks & ~mState.directTracks)
+            * mState.frameCount;
 }
 
 
@@ -945,6 +994,7 @@ void AudioMixer::process__validate(state_t* state)
     bool all16BitsStereoNoResample = true;
     bool resampling = false;
     bool volumeRamp = false;
+    uint32_t directTracks = 0;
     uint32_t en = state->enabledTracks;
     while (en) {
         const int i = 31 - __builtin_clz(en);
@@ -952,6 +1002,9 @@ void AudioMixer::process__validate(state_t* state)
 
         countActiveTracks++;
         track_t& t = state->tracks[i];
+        if (t.bufferProvider == t.mInputBufferProvider) {
+            directTracks |= 1 << i;
+        }
         uint32_t n = 0;
         // FIXME can overflow (mask is only 3 bits)
         n |= NEEDS_CHANNEL_1 + t.channelCount - 1;
@@ -979,7 +1032,7 @@ void AudioMixer::process__validate(state_t* state)
                 all16BitsStereoNoResample = false;
                 resampling = true;
                 t.hook = getTrackHook(TRACKTYPE_RESAMPLE, t.mMixerChannelCount,
-                        t.mMixerInFormat, t.mMixerFormat);
+                        t.mMixerInFormat, t.mMixerFormat, t.hookInFormat());
                 ALOGV_IF((n & NEEDS_CHANNEL_COUNT__MASK) > NEEDS_CHANNEL_2,
                         "Track %d needs downmix + resample", i);
             } else {
@@ -989,18 +1042,19 @@ void AudioMixer::process__validate(state_t* state)
                                     && t.channelMask == AUDIO_CHANNEL_OUT_MONO)
                                 ? TRACKTYPE_NORESAMPLEMONO : TRACKTYPE_NORESAMPLE,
                             t.mMixerChannelCount,
-                            t.mMixerInFormat, t.mMixerFormat);
+                            t.mMixerInFormat, t.mMixerFormat, t.hookInFormat());
                     all16BitsStereoNoResample = false;
                 }
                 if ((n & NEEDS_CHANNEL_COUNT__MASK) >= NEEDS_CHANNEL_2){
                     t.hook = getTrackHook(TRACKTYPE_NORESAMPLE, t.mMixerChannelCount,
-                            t.mMixerInFormat, t.mMixerFormat);
+                            t.mMixerInFormat, t.mMixerFormat, t.hookInFormat());
                     ALOGV_IF((n & NEEDS_CHANNEL_COUNT__MASK) > NEEDS_CHANNEL_2,
                             "Track %d needs downmix", i);
                 }
             }
         }
     }
+    state->directTracks = directTracks;
 
     // select the processing hooks
     state->hook = process__nop;
@@ -1022,7 +1076,8 @@ void AudioMixer::process__validate(state_t* state)
                 delete [] state->resampleTemp;
                 state->resampleTemp = NULL;
             }
-            state->hook = process__genericNoResampling;
+            state->hook = sUseBlockedMix.load() && countActiveTracks >= kBlockedMixMinTracks
+                    ? process__blockedNoResampling : process__genericNoResampling;
             if (all16BitsStereoNoResample && !volumeRamp) {
                 if (countActiveTracks == 1) {
                     const int i = 31 - __builtin_clz(state->enabledTracks);
@@ -1034,7 +1089,7 @@ void AudioMixer::process__validate(state_t* state)
                         // special case handling due to implicit channel duplication.
                         // Stereo or Multichannel should actually be fine here.
                         state->hook = getProcessHook(PROCESSTYPE_NORESAMPLEONETRACK,
-                                t.mMixerChannelCount, t.mMixerInFormat, t.mMixerFormat);
+                                t.mMixerChannelCount, t.hookInFormat(), t.mMixerFormat);
                     }
                 }
             }
@@ -1072,7 +1127,7 @@ void AudioMixer::process__validate(state_t* state)
                 track_t& t = state->tracks[i];
                 // Muted single tracks handled by allMuted above.
                 state->hook = getProcessHook(PROCESSTYPE_NORESAMPLEONETRACK,
-                        t.mMixerChannelCount, t.mMixerInFormat, t.mMixerFormat);
+                        t.mMixerChannelCount, t.hookInFormat(), t.mMixerFormat);
             }
         }
     }
@@ -1421,6 +1476,27 @@ void AudioMixer::process__genericNoResampling(state_t* state)
     ALOGVV("process__genericNoResampling\n");
     int32_t outTemp[BLOCKSIZE * MAX_NUM_CHANNELS] __attribute__((aligned(32)));
 
+    mixNoResampling(state, outTemp, BLOCKSIZE * MAX_NUM_CHANNELS, BLOCKSIZE);
+}
+
+// cache-blocked code without resampling, for many tracks.
+// All tracks sharing an output buffer are accumulated into an L1-sized tile
+// before the tile is converted to the output format, so each track hook
+// processes long runs of frames and the tile stays cache resident across tracks.
+void AudioMixer::process__blockedNoResampling(state_t* state)
+{
+    ALOGVV("process__blockedNoResampling\n");
+    int32_t outTemp[MIX_TILE_SAMPLES] __attribute__((aligned(32)));
+
+    mixNoResampling(state, outTemp, MIX_TILE_SAMPLES, MIX_TILE_SAMPLES);
+}
+
+// Mixes the enabled tracks without resampling, grouped by output buffer.
+// Each group is mixed tile by tile into outTemp (of outTempSamples samples)
+// with at most maxTileFrames frames per tile; a tile is always a multiple of BLOCKSIZE frames.
+void AudioMixer::mixNoResampling(state_t* state, int32_t* outTemp, size_t outTempSamples,
+        size_t maxTileFrames)
+{
     // acquire each track's buffer
     uint32_t enabledTracks = state->enabledTracks;
     uint32_t e0 = enabledTracks;
@@ -1451,17 +1527,20 @@ void AudioMixer::process__genericNoResampling(state_t* state)
             }
         }
         e0 &= ~(e1);
+        size_t tileFrames = min(maxTileFrames, outTempSamples / t1.mMixerChannelCount);
+        tileFrames -= tileFrames % BLOCKSIZE;
         // this assumes output 16 bits stereo, no resampling
         int32_t *out = t1.mainBuffer;
         size_t numFrames = 0;
         do {
-            memset(outTemp, 0, sizeof(outTemp));
+            const size_t blockFrames = min(tileFrames, state->frameCount - numFrames);
+            memset(outTemp, 0, blockFrames * t1.mMixerChannelCount * sizeof(int32_t));
             e2 = e1;
             while (e2) {
                 const int i = 31 - __builtin_clz(e2);
                 e2 &= ~(1<<i);
                 track_t& t = state->tracks[i];
-                size_t outFrames = BLOCKSIZE;
+                size_t outFrames = blockFrames;
                 int32_t *aux = NULL;
                 if (CC_UNLIKELY(t.needs & NEEDS_AUX)) {
                     aux = t.auxBuffer + numFrames;
@@ -1476,7 +1555,7 @@ void AudioMixer::process__genericNoResampling(state_t* state)
                     }
                     size_t inFrames = (t.frameCount > outFrames)?outFrames:t.frameCount;
                     if (inFrames > 0) {
-                        t.hook(&t, outTemp + (BLOCKSIZE - outFrames) * t.mMixerChannelCount,
+                        t.hook(&t, outTemp + (blockFrames - outFrames) * t.mMixerChannelCount,
                                 inFrames, state->resampleTemp, aux);
                         t.frameCount -= inFrames;
                         outFrames -= inFrames;
@@ -1487,7 +1566,7 @@ void AudioMixer::process__genericNoResampling(state_t* state)
                     if (t.frameCount == 0 && outFrames) {
                         t.bufferProvider->releaseBuffer(&t.buffer);
                         t.buffer.frameCount = (state->frameCount - numFrames) -
-                                (BLOCKSIZE - outFrames);
+                                (blockFrames - outFrames);
                         t.bufferProvider->getNextBuffer(&t.buffer);
                         t.in = t.buffer.raw;
                         if (t.in == NULL) {
@@ -1501,12 +1580,12 @@ void AudioMixer::process__genericNoResampling(state_t* state)
             }
 
             convertMixerFormat(out, t1.mMixerFormat, outTemp, t1.mMixerInFormat,
-                    BLOCKSIZE * t1.mMixerChannelCount);
+                    blockFrames * t1.mMixerChannelCount);
             // TODO: fix ugly casting due to choice of out pointer type
             out = reinterpret_cast<int32_t*>((uint8_t*)out
-                    + BLOCKSIZE * t1.mMixerChannelCount
+                    + blockFrames * t1.mMixerChannelCount
                         * audio_bytes_per_sample(t1.mMixerFormat));
-            numFrames += BLOCKSIZE;
+            numFrames += blockFrames;
         } while (numFrames < state->frameCount);
     }
 
@@ -1678,6 +1757,20 @@ void AudioMixer::process__OneTrack16BitsStereoNoResampling(state_t* state)
 
 /*static*/ pthread_once_t AudioMixer::sOnceControl = PTHREAD_ONCE_INIT;
 
+/*static*/ std::atomic_bool AudioMixer::sUseSimd(kUseSimd);
+
+/*static*/ void AudioMixer::setUseSimd(bool useSimd)
+{
+    sUseSimd.store(useSimd && USE_MIXER_SIMD);
+}
+
+/*static*/ std::atomic_bool AudioMixer::sUseBlockedMix(kUseBlockedMix);
+
+/*static*/ void AudioMixer::setUseBlockedMix(bool useBlockedMix)
+{
+    sUseBlockedMix.store(useBlockedMix);
+}
+
 /*static*/ void AudioMixer::sInitRoutine()
 {
     DownmixerBufferProvider::init(); // for the downmixer
@@ -1692,16 +1785,69 @@ void AudioMixer::process__OneTrack16BitsStereoNoResampling(state_t* state)
 #define MIXTYPE_MONOVOL(mixtype) (mixtype == MIXTYPE_MULTI ? MIXTYPE_MULTI_MONOVOL : \
         mixtype == MIXTYPE_MULTI_SAVEONLY ? MIXTYPE_MULTI_SAVEONLY_MONOVOL : mixtype)
 
+/* Vectorized versions of the mixing functions below, for the common
+ * mono, stereo, 5.1 and 7.1 channel counts (see AudioMixerOpsSimd.h).
+ * Returns false if the configuration is not supported.
+ *
+ * MIXTYPE     (see AudioMixerOps.h MIXTYPE_* enumeration)
+ * TO: int32_t (Q4.27) or float
+ * TI: int32_t (Q4.27) or int16_t (Q0.15) or float
+ */
+template <int MIXTYPE, typename TO, typename TI, typename TV>
+static bool volumeRampMultiSimd(uint32_t channels, TO* out, size_t frameCount,
+        const TI* in, TV *vol, const TV *volinc)
+{
+    switch (channels) {
+    case 1:
+        return MixerSimd<MIXTYPE, 1, TO, TI, TV>::volumeRamp(out, frameCount, in, vol, volinc);
+    case 2:
+        return MixerSimd<MIXTYPE, 2, TO, TI, TV>::volumeRamp(out, frameCount, in, vol, volinc);
+    case 6:
+        return MixerSimd<MIXTYPE_MONOVOL(MIXTYPE), 6, TO, TI, TV>::volumeRamp(out,
+                frameCount, in, vol, volinc);
+    case 8:
+        return MixerSimd<MIXTYPE_MONOVOL(MIXTYPE), 8, TO, TI, TV>::volumeRamp(out,
+                frameCount, in, vol, volinc);
+    default:
+        return false;
+    }
+}
+
+template <int MIXTYPE, typename TO, typename TI, typename TV>
+static bool volumeMultiSimd(uint32_t channels, TO* out, size_t frameCount,
+        const TI* in, const TV *vol)
+{
+    switch (channels) {
+    case 1:
+        return MixerSimd<MIXTYPE, 1, TO, TI, TV>::volume(out, frameCount, in, vol);
+    case 2:
+        return MixerSimd<MIXTYPE, 2, TO, TI, TV>::volume(out, frameCount, in, vol);
+    case 6:
+        return MixerSimd<MIXTYPE_MONOVOL(MIXTYPE), 6, TO, TI, TV>::volume(out,
+                frameCount, in, vol);
+    case 8:
+        return MixerSimd<MIXTYPE_MONOVOL(MIXTYPE), 8, TO, TI, TV>::volume(out,
+                frameCount, in, vol);
+    default:
+        return false;
+    }
+}
+
 /* MIXTYPE     (see AudioMixerOps.h MIXTYPE_* enumeration)
+ * USESIMD     (set to true to use the vectorized kernels when supported)
  * TO: int32_t (Q4.27) or float
  * TI: int32_t (Q4.27) or int16_t (Q0.15) or float
  * TA: int32_t (Q4.27)
  */
-template <int MIXTYPE,
+template <int MIXTYPE, bool USESIMD,
         typename TO, typename TI, typename TV, typename TA, typename TAV>
 static void volumeRampMulti(uint32_t channels, TO* out, size_t frameCount,
         const TI* in, TA* aux, TV *vol, const TV *volinc, TAV *vola, TAV volainc)
 {
+    if (USESIMD && aux == NULL
+            && volumeRampMultiSimd<MIXTYPE>(channels, out, frameCount, in, vol, volinc)) {
+        return;
+    }
     switch (channels) {
     case 1:
         volumeRampMulti<MIXTYPE, 1>(out, frameCount, in, aux, vol, volinc, vola, volainc);
@@ -1737,15 +1883,20 @@ static void volumeRampMulti(uint32_t channels, TO* out, size_t frameCount,
 }
 
 /* MIXTYPE     (see AudioMixerOps.h MIXTYPE_* enumeration)
+ * USESIMD     (set to true to use the vectorized kernels when supported)
  * TO: int32_t (Q4.27) or float
  * TI: int32_t (Q4.27) or int16_t (Q0.15) or float
  * TA: int32_t (Q4.27)
  */
-template <int MIXTYPE,
+template <int MIXTYPE, bool USESIMD,
         typename TO, typename TI, typename TV, typename TA, typename TAV>
 static void volumeMulti(uint32_t channels, TO* out, size_t frameCount,
         const TI* in, TA* aux, const TV *vol, TAV vola)
 {
+    if (USESIMD && aux == NULL
+            && volumeMultiSimd<MIXTYPE>(channels, out, frameCount, in, vol)) {
+        return;
+    }
     switch (channels) {
     case 1:
         volumeMulti<MIXTYPE, 1>(out, frameCount, in, aux, vol, vola);
@@ -1774,38 +1925,49 @@ static void volumeMulti(uint32_t channels, TO* out, size_t frameCount,
     }
 }
 
+/* Only the legacy integer (Q4.27) mix uses integer volume.
+ * A PCM_16 track mixed directly into a float or int16_t output (see canMixDirect())
+ * uses float volume, so that it is mixed exactly as if it had been reformatted to float.
+ */
+template <typename TO, typename TI>
+struct useFloatVolume
+{
+    static const bool value = is_same<TI, float>::value || !is_same<TO, int32_t>::value;
+};
+
 /* MIXTYPE     (see AudioMixerOps.h MIXTYPE_* enumeration)
  * USEFLOATVOL (set to true if float volume is used)
  * ADJUSTVOL   (set to true if volume ramp parameters needs adjustment afterwards)
+ * USESIMD     (set to true to use the vectorized kernels when supported)
  * TO: int32_t (Q4.27) or float
  * TI: int32_t (Q4.27) or int16_t (Q0.15) or float
  * TA: int32_t (Q4.27)
  */
-template <int MIXTYPE, bool USEFLOATVOL, bool ADJUSTVOL,
+template <int MIXTYPE, bool USEFLOATVOL, bool ADJUSTVOL, bool USESIMD,
     typename TO, typename TI, typename TA>
 void AudioMixer::volumeMix(TO *out, size_t outFrames,
         const TI *in, TA *aux, bool ramp, AudioMixer::track_t *t)
 {
     if (USEFLOATVOL) {
         if (ramp) {
-            volumeRampMulti<MIXTYPE>(t->mMixerChannelCount, out, outFrames, in, aux,
+            volumeRampMulti<MIXTYPE, USESIMD>(t->mMixerChannelCount, out, outFrames, in, aux,
                     t->mPrevVolume, t->mVolumeInc, &t->prevAuxLevel, t->auxInc);
             if (ADJUSTVOL) {
                 t->adjustVolumeRamp(aux != NULL, true);
             }
         } else {
-            volumeMulti<MIXTYPE>(t->mMixerChannelCount, out, outFrames, in, aux,
+            volumeMulti<MIXTYPE, USESIMD>(t->mMixerChannelCount, out, outFrames, in, aux,
                     t->mVolume, t->auxLevel);
         }
     } else {
         if (ramp) {
-            volumeRampMulti<MIXTYPE>(t->mMixerChannelCount, out, outFrames, in, aux,
+            volumeRampMulti<MIXTYPE, USESIMD>(t->mMixerChannelCount, out, outFrames, in, aux,
                     t->prevVolume, t->volumeInc, &t->prevAuxLevel, t->auxInc);
             if (ADJUSTVOL) {
                 t->adjustVolumeRamp(aux != NULL);
             }
         } else {
-            volumeMulti<MIXTYPE>(t->mMixerChannelCount, out, outFrames, in, aux,
+            volumeMulti<MIXTYPE, USESIMD>(t->mMixerChannelCount, out, outFrames, in, aux,
                     t->volume, t->auxLevel);
         }
     }
@@ -1819,8 +1981,9 @@ void AudioMixer::volumeMix(TO *out, size_t outFrames,
  * TO: int32_t (Q4.27) or float
  * TI: int32_t (Q4.27) or int16_t (Q0.15) or float
  * TA: int32_t (Q4.27)
+ * USESIMD     (set to true to use the vectorized kernels when supported)
  */
-template <int MIXTYPE, typename TO, typename TI, typename TA>
+template <int MIXTYPE, typename TO, typename TI, typename TA, bool USESIMD>
 void AudioMixer::process_NoResampleOneTrack(state_t* state)
 {
     ALOGVV("process_NoResampleOneTrack\n");
@@ -1842,17 +2005,18 @@ void AudioMixer::process_NoResampleOneTrack(state_t* state)
 
         // in == NULL can happen if the track was flushed just after having
         // been enabled for mixing.
-        if (in == NULL || (((uintptr_t)in) & 3)) {
+        if (in == NULL || (((uintptr_t)in) & (sizeof(TI) - 1))) {
             memset(out, 0, numFrames
                     * channels * audio_bytes_per_sample(t->mMixerFormat));
-            ALOGE_IF((((uintptr_t)in) & 3), "process_NoResampleOneTrack: bus error: "
+            ALOGE_IF((((uintptr_t)in) & (sizeof(TI) - 1)),
+                    "process_NoResampleOneTrack: bus error: "
                     "buffer %p track %p, channels %d, needs %#x",
                     in, t, t->channelCount, t->needs);
             return;
         }
 
         const size_t outFrames = b.frameCount;
-        volumeMix<MIXTYPE, is_same<TI, float>::value, false> (
+        volumeMix<MIXTYPE, useFloatVolume<TO, TI>::value, false, USESIMD> (
                 out, outFrames, in, aux, ramp, t);
 
         out += outFrames * channels;
@@ -1865,7 +2029,7 @@ void AudioMixer::process_NoResampleOneTrack(state_t* state)
         t->bufferProvider->releaseBuffer(&b);
     }
     if (ramp) {
-        t->adjustVolumeRamp(aux != NULL, is_same<TI, float>::value);
+        t->adjustVolumeRamp(aux != NULL, useFloatVolume<TO, TI>::value);
     }
 }
 
@@ -1891,7 +2055,7 @@ void AudioMixer::track__Resample(track_t* t, TO* out, size_t outFrameCount, TO*
         memset(temp, 0, outFrameCount * t->mMixerChannelCount * sizeof(TO));
         t->resampler->resample((int32_t*)temp, outFrameCount, t->bufferProvider);
 
-        volumeMix<MIXTYPE, is_same<TI, float>::value, true>(
+        volumeMix<MIXTYPE, useFloatVolume<TO, TI>::value, true, false>(
                 out, outFrameCount, temp, aux, ramp, t);
 
     } else { // constant volume gain
@@ -1907,15 +2071,16 @@ void AudioMixer::track__Resample(track_t* t, TO* out, size_t outFrameCount, TO*
  * TO: int32_t (Q4.27) or float
  * TI: int32_t (Q4.27) or int16_t (Q0.15) or float
  * TA: int32_t (Q4.27)
+ * USESIMD     (set to true to use the vectorized kernels when supported)
  */
-template <int MIXTYPE, typename TO, typename TI, typename TA>
+template <int MIXTYPE, typename TO, typename TI, typename TA, bool USESIMD>
 void AudioMixer::track__NoResample(track_t* t, TO* out, size_t frameCount,
         TO* temp __unused, TA* aux)
 {
     ALOGVV("track__NoResample\n");
     const TI *in = static_cast<const TI *>(t->in);
 
-    volumeMix<MIXTYPE, is_same<TI, float>::value, true>(
+    volumeMix<MIXTYPE, useFloatVolume<TO, TI>::value, true, USESIMD>(
             out, frameCount, in, aux, t->needsRamp(), t);
 
     // MIXTYPE_MONOEXPAND reads a single input channel and expands to NCHAN output channels.
@@ -1966,9 +2131,12 @@ void AudioMixer::convertMixerFormat(void *out, audio_format_t mixerOutFormat,
 }
 
 /* Returns the proper track hook to use for mixing the track into the output buffer.
+ * inputFormat is the format the hook reads, which is mixerInFormat except for
+ * PCM_16 input mixed directly into a PCM_FLOAT mix.
  */
 AudioMixer::hook_t AudioMixer::getTrackHook(int trackType, uint32_t channelCount,
-        audio_format_t mixerInFormat, audio_format_t mixerOutFormat __unused)
+        audio_format_t mixerInFormat, audio_format_t mixerOutFormat __unused,
+        audio_format_t inputFormat)
 {
     if (!kUseNewMixer && channelCount == FCC_2 && mixerInFormat == AUDIO_FORMAT_PCM_16_BIT) {
         switch (trackType) {
@@ -2005,11 +2173,19 @@ AudioMixer::hook_t AudioMixer::getTrackHook(int trackType, uint32_t channelCount
     case TRACKTYPE_NORESAMPLEMONO:
         switch (mixerInFormat) {
         case AUDIO_FORMAT_PCM_FLOAT:
-            return (AudioMixer::hook_t)
-                    track__NoResample<MIXTYPE_MONOEXPAND, float, float, int32_t>;
+            if (inputFormat == AUDIO_FORMAT_PCM_16_BIT) {
+                return sUseSimd.load() ? (AudioMixer::hook_t)
+                        track__NoResample<MIXTYPE_MONOEXPAND, float, int16_t, int32_t, true>
+                        : (AudioMixer::hook_t)
+                        track__NoResample<MIXTYPE_MONOEXPAND, float, int16_t, int32_t, false>;
+            }
+            return sUseSimd.load() ? (AudioMixer::hook_t)
+                    track__NoResample<MIXTYPE_MONOEXPAND, float, float, int32_t, true>
+                    : (AudioMixer::hook_t)
+                    track__NoResample<MIXTYPE_MONOEXPAND, float, float, int32_t, false>;
         case AUDIO_FORMAT_PCM_16_BIT:
             return (AudioMixer::hook_t)
-                    track__NoResample<MIXTYPE_MONOEXPAND, int32_t, int16_t, int32_t>;
+                    track__NoResample<MIXTYPE_MONOEXPAND, int32_t, int16_t, int32_t, false>;
         default:
             LOG_ALWAYS_FATAL("bad mixerInFormat: %#x", mixerInFormat);
             break;
@@ -2018,11 +2194,21 @@ AudioMixer::hook_t AudioMixer::getTrackHook(int trackType, uint32_t channelCount
     case TRACKTYPE_NORESAMPLE:
         switch (mixerInFormat) {
         case AUDIO_FORMAT_PCM_FLOAT:
-            return (AudioMixer::hook_t)
-                    track__NoResample<MIXTYPE_MULTI, float, float, int32_t>;
+            if (inputFormat == AUDIO_FORMAT_PCM_16_BIT) {
+                return sUseSimd.load() ? (AudioMixer::hook_t)
+                        track__NoResample<MIXTYPE_MULTI, float, int16_t, int32_t, true>
+                        : (AudioMixer::hook_t)
+                        track__NoResample<MIXTYPE_MULTI, float, int16_t, int32_t, false>;
+            }
+            return sUseSimd.load() ? (AudioMixer::hook_t)
+                    track__NoResample<MIXTYPE_MULTI, float, float, int32_t, true>
+                    : (AudioMixer::hook_t)
+                    track__NoResample<MIXTYPE_MULTI, float, float, int32_t, false>;
         case AUDIO_FORMAT_PCM_16_BIT:
-            return (AudioMixer::hook_t)
-                    track__NoResample<MIXTYPE_MULTI, int32_t, int16_t, int32_t>;
+            return sUseSimd.load() ? (AudioMixer::hook_t)
+                    track__NoResample<MIXTYPE_MULTI, int32_t, int16_t, int32_t, true>
+                    : (AudioMixer::hook_t)
+                    track__NoResample<MIXTYPE_MULTI, int32_t, int16_t, int32_t, false>;
         default:
             LOG_ALWAYS_FATAL("bad mixerInFormat: %#x", mixerInFormat);
             break;
@@ -2057,11 +2243,13 @@ AudioMixer::process_hook_t AudioMixer::getProcessHook(int processType, uint32_t
     case AUDIO_FORMAT_PCM_FLOAT:
         switch (mixerOutFormat) {
         case AUDIO_FORMAT_PCM_FLOAT:
-            return process_NoResampleOneTrack<MIXTYPE_MULTI_SAVEONLY,
-                    float /*TO*/, float /*TI*/, int32_t /*TA*/>;
+            return sUseSimd.load() ? process_NoResampleOneTrack<MIXTYPE_MULTI_SAVEONLY,
+                    float /*TO*/, float /*TI*/, int32_t /*TA*/, true /*USESIMD*/>
+                    : process_NoResampleOneTrack<MIXTYPE_MULTI_SAVEONLY,
+                    float /*TO*/, float /*TI*/, int32_t /*TA*/, false /*USESIMD*/>;
         case AUDIO_FORMAT_PCM_16_BIT:
             return process_NoResampleOneTrack<MIXTYPE_MULTI_SAVEONLY,
-                    int16_t, float, int32_t>;
+                    int16_t, float, int32_t, false>;
         default:
             LOG_ALWAYS_FATAL("bad mixerOutFormat: %#x", mixerOutFormat);
             break;
@@ -2070,11 +2258,13 @@ AudioMixer::process_hook_t AudioMixer::getProcessHook(int processType, uint32_t
     case AUDIO_FORMAT_PCM_16_BIT:
         switch (mixerOutFormat) {
         case AUDIO_FORMAT_PCM_FLOAT:
-            return process_NoResampleOneTrack<MIXTYPE_MULTI_SAVEONLY,
-                    float, int16_t, int32_t>;
+            return sUseSimd.load() ? process_NoResampleOneTrack<MIXTYPE_MULTI_SAVEONLY,
+                    float, int16_t, int32_t, true>
+                    : process_NoResampleOneTrack<MIXTYPE_MULTI_SAVEONLY,
+                    float, int16_t, int32_t, false>;
         case AUDIO_FORMAT_PCM_16_BIT:
             return process_NoResampleOneTrack<MIXTYPE_MULTI_SAVEONLY,
-                    int16_t, int16_t, int32_t>;
+                    int16_t, int16_t, int32_t, false>;
         default:
             LOG_ALWAYS_FATAL("bad mixerOutFormat: %#x", mixerOutFormat);
             break;
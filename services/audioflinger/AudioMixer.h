@@ -18,6 +18,7 @@
 #ifndef ANDROID_AUDIO_MIXER_H
 #define ANDROID_AUDIO_MIXER_H
 
+#include <atomic>
 #include <stdint.h>
 #include <sys/types.h>
 
@@ -132,6 +133,24 @@ public:
 
     size_t      getUnreleasedFrames(int name) const;
 
+    // Track frames mixed since the mixer was created, summed over the enabled tracks and split
+    // by whether the mixer read them straight out of the track buffer (direct), or out of an
+    // intermediate buffer filled by a reformat, downmix or timestretch provider (copied).
+    int64_t     getDirectFrames() const { return mDirectFrames; }
+    int64_t     getCopiedFrames() const { return mCopiedFrames; }
+
+    // Enable or disable the vectorized (SSE/NEON) volume and mix kernels for all mixers.
+    // The setting is sampled when the track hooks are next selected in process__validate(),
+    // so it is normally set before any tracks are enabled.  The vectorized kernels are
+    // bit-exact with the scalar path; disabling them is intended for testing and benchmarking.
+    static void setUseSimd(bool useSimd);
+    static bool getUseSimd() { return sUseSimd.load(); }
+
+    // Enable or disable the cache-blocked mixing engine (process__blockedNoResampling)
+    // for all mixers.  Takes effect at the next process__validate().  The blocked engine
+    // produces the same output as process__genericNoResampling.
+    static void setUseBlockedMix(bool useBlockedMix);
+
     static inline bool isValidPcmTrackFormat(audio_format_t format) {
         switch (format) {
         case AUDIO_FORMAT_PCM_8_BIT:
@@ -169,6 +188,9 @@ private:
     typedef void (*hook_t)(track_t* t, int32_t* output, size_t numOutFrames, int32_t* temp,
                            int32_t* aux);
     static const int BLOCKSIZE = 16; // 4 cache lines
+    // size in samples of the mix tile used by process__blockedNoResampling;
+    // 8 KB of int32_t or float, which fits in L1 data cache alongside the track inputs.
+    static const size_t MIX_TILE_SAMPLES = 2048;
 
     struct track_t {
         uint32_t    needs;
@@ -248,6 +270,9 @@ private:
         audio_format_t mDownmixRequiresFormat;  // required downmixer format
                                                 // AUDIO_FORMAT_PCM_16_BIT if 16 bit necessary
                                                 // AUDIO_FORMAT_INVALID if no required format
+        bool           mDirectInput;     // PCM_16 input is mixed directly into a PCM_FLOAT
+                                         // mix without mReformatBufferProvider, see
+                                         // canMixDirect(). Hooks then read mFormat.
 
         float          mVolume[MAX_NUM_VOLUMES];     // floating point set volume
         float          mPrevVolume[MAX_NUM_VOLUMES]; // floating point previous volume
@@ -276,6 +301,10 @@ private:
         void        unprepareForReformat();
         bool        setPlaybackRate(const AudioPlaybackRate &playbackRate);
         void        reconfigureBufferProviders();
+        bool        canMixDirect() const;
+        void        updateDirectInput();
+        // input format of the track and process hooks
+        audio_format_t hookInFormat() const { return mDirectInput ? mFormat : mMixerInFormat; }
     };
 
     typedef void (*process_hook_t)(state_t* state);
@@ -289,7 +318,7 @@ private:
         int32_t         *outputTemp;
         int32_t         *resampleTemp;
         NBLog::Writer*  mLog;
-        int32_t         reserved[1];
+        uint32_t        directTracks;   // tracks whose hooks read the input buffer provider
         // FIXME allocate dynamically to save some memory when maxNumTracks < MAX_NUM_TRACKS
         track_t         tracks[MAX_NUM_TRACKS] __attribute__((aligned(32)));
     };
@@ -303,6 +332,9 @@ private:
 
     const uint32_t  mSampleRate;
 
+    int64_t         mDirectFrames;  // see getDirectFrames()
+    int64_t         mCopiedFrames;  // see getCopiedFrames()
+
     NBLog::Writer   mDummyLog;
 public:
     void            setLog(NBLog::Writer* log);
@@ -331,36 +363,46 @@ private:
     static void process__validate(state_t* state);
     static void process__nop(state_t* state);
     static void process__genericNoResampling(state_t* state);
+    static void process__blockedNoResampling(state_t* state);
+    static void mixNoResampling(state_t* state, int32_t* outTemp, size_t outTempSamples,
+            size_t maxTileFrames);
     static void process__genericResampling(state_t* state);
     static void process__OneTrack16BitsStereoNoResampling(state_t* state);
 
     static pthread_once_t   sOnceControl;
     static void             sInitRoutine();
 
+    // true if the vectorized kernels in AudioMixerOpsSimd.h are selected by the hooks.
+    // Written by setUseSimd() and read from the mixer threads.
+    static std::atomic_bool sUseSimd;
+    // true if process__blockedNoResampling may be selected by process__validate().
+    static std::atomic_bool sUseBlockedMix;
+
     /* multi-format volume mixing function (calls template functions
      * in AudioMixerOps.h).  The template parameters are as follows:
      *
      *   MIXTYPE     (see AudioMixerOps.h MIXTYPE_* enumeration)
      *   USEFLOATVOL (set to true if float volume is used)
      *   ADJUSTVOL   (set to true if volume ramp parameters needs adjustment afterwards)
+     *   USESIMD     (set to true to use the vectorized kernels when supported)
      *   TO: int32_t (Q4.27) or float
      *   TI: int32_t (Q4.27) or int16_t (Q0.15) or float
      *   TA: int32_t (Q4.27)
      */
-    template <int MIXTYPE, bool USEFLOATVOL, bool ADJUSTVOL,
+    template <int MIXTYPE, bool USEFLOATVOL, bool ADJUSTVOL, bool USESIMD,
         typename TO, typename TI, typename TA>
     static void volumeMix(TO *out, size_t outFrames,
             const TI *in, TA *aux, bool ramp, AudioMixer::track_t *t);
 
     // multi-format process hooks
-    template <int MIXTYPE, typename TO, typename TI, typename TA>
+    template <int MIXTYPE, typename TO, typename TI, typename TA, bool USESIMD>
     static void process_NoResampleOneTrack(state_t* state);
 
     // multi-format track hooks
     template <int MIXTYPE, typename TO, typename TI, typename TA>
     static void track__Resample(track_t* t, TO* out, size_t frameCount,
             TO* temp __unused, TA* aux);
-    template <int MIXTYPE, typename TO, typename TI, typename TA>
+    template <int MIXTYPE, typename TO, typename TI, typename TA, bool USESIMD>
     static void track__NoResample(track_t* t, TO* out, size_t frameCount,
             TO* temp __unused, TA* aux);
 
@@ -382,7 +424,8 @@ private:
     static process_hook_t getProcessHook(int processType, uint32_t channelCount,
             audio_format_t mixerInFormat, audio_format_t mixerOutFormat);
     static hook_t getTrackHook(int trackType, uint32_t channelCount,
-            audio_format_t mixerInFormat, audio_format_t mixerOutFormat);
+            audio_format_t mixerInFormat, audio_format_t mixerOutFormat,
+            audio_format_t inputFormat);
 };
 
 // ----------------------------------------------------------------------------
@@ -163,7 +163,6 @@ inline int32_t MixMul<int32_t, int16_t, float>(int16_t value, float volume) {
 
 template <>
 inline int16_t MixMul<int16_t, int16_t, float>(int16_t value, float volume) {
-    LOG_ALWAYS_FATAL("MixMul<int16_t, int16_t, float> Runtime Should not be here");
     return clamp16_from_float(MixMul<float, int16_t, float>(value, volume));
 }
 
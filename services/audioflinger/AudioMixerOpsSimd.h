@@ -0,0 +1,418 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_MIXER_OPS_SIMD_H
+#define ANDROID_AUDIO_MIXER_OPS_SIMD_H
+
+// depends on AudioMixerOps.h
+
+#if defined(__aarch64__) || defined(__ARM_NEON__)
+#ifndef USE_MIXER_NEON
+#define USE_MIXER_NEON (true)
+#endif
+#else
+#define USE_MIXER_NEON (false)
+#endif
+
+#if defined(__SSE2__) && !USE_MIXER_NEON
+#ifndef USE_MIXER_SSE
+#define USE_MIXER_SSE (true)
+#endif
+#else
+#define USE_MIXER_SSE (false)
+#endif
+
+#if USE_MIXER_NEON
+#include <arm_neon.h>
+#elif USE_MIXER_SSE
+#include <emmintrin.h>
+#include <string.h>
+#endif
+
+#define USE_MIXER_SIMD (USE_MIXER_NEON || USE_MIXER_SSE)
+
+namespace android {
+
+/* MixerSimd provides vectorized versions of the volumeMulti() and volumeRampMulti()
+ * templates in AudioMixerOps.h for the common mixer configurations:
+ *
+ *   <TO, TI, TV> = <float, float, float>     constant volume and volume ramp
+ *   <TO, TI, TV> = <float, int16_t, float>   constant volume and volume ramp
+ *   <TO, TI, TV> = <int32_t, int16_t, int16_t> constant volume
+ *
+ * for NCHAN 1 and 2 with MIXTYPE_MULTI, MIXTYPE_MULTI_SAVEONLY and (stereo only)
+ * MIXTYPE_MONOEXPAND, and for any NCHAN with the MONOVOL mixtypes used for
+ * multichannel (5.1, 7.1) content.
+ *
+ * The vector code performs exactly the same arithmetic operations in the same order
+ * per sample as the scalar templates, so the output is bit-exact with the scalar path,
+ * provided the compiler does not contract the scalar multiply-add into a fused operation.
+ * Volume ramps keep one volume per vector lane and advance each lane by the
+ * volume increment once per frame, reproducing the scalar accumulation.
+ *
+ * Aux buffers are not handled; the caller must use the scalar path if aux is not NULL.
+ *
+ * Each method returns true if the mix was performed, false if the configuration
+ * is not supported and the caller must fall back to the scalar path.
+ */
+
+template <int MIXTYPE, int NCHAN, typename TO, typename TI, typename TV>
+struct MixerSimd {
+    static inline bool volume(TO* out __unused, size_t frameCount __unused,
+            const TI* in __unused, const TV *vol __unused) {
+        return false;
+    }
+
+    static inline bool volumeRamp(TO* out __unused, size_t frameCount __unused,
+            const TI* in __unused, TV *vol __unused, const TV *volinc __unused) {
+        return false;
+    }
+};
+
+#if USE_MIXER_SIMD
+
+#if USE_MIXER_NEON
+
+typedef float32x4_t mixer_f32x4_t;
+
+static inline mixer_f32x4_t mixer_ld_f32(const float *p) { return vld1q_f32(p); }
+static inline void mixer_st_f32(float *p, mixer_f32x4_t v) { vst1q_f32(p, v); }
+static inline mixer_f32x4_t mixer_add_f32(mixer_f32x4_t a, mixer_f32x4_t b) {
+    return vaddq_f32(a, b);
+}
+static inline mixer_f32x4_t mixer_mul_f32(mixer_f32x4_t a, mixer_f32x4_t b) {
+    return vmulq_f32(a, b);
+}
+// returns { p[0], p[0], p[1], p[1] }
+static inline mixer_f32x4_t mixer_ld_dup2_f32(const float *p) {
+    const float32x2_t x = vld1_f32(p);
+    const float32x2x2_t z = vzip_f32(x, x);
+    return vcombine_f32(z.val[0], z.val[1]);
+}
+
+// returns { p[0], p[1], p[2], p[3] } converted to float, not scaled
+static inline mixer_f32x4_t mixer_ld_i16(const int16_t *p) {
+    return vcvtq_f32_s32(vmovl_s16(vld1_s16(p)));
+}
+// returns { p[0], p[0], p[1], p[1] } converted to float, not scaled
+static inline mixer_f32x4_t mixer_ld_dup2_i16(const int16_t *p) {
+    int16x4_t x = vld1_lane_s16(p, vdup_n_s16(0), 0);
+    x = vld1_lane_s16(p + 1, x, 1);
+    const float32x2_t f = vget_low_f32(vcvtq_f32_s32(vmovl_s16(x)));
+    const float32x2x2_t z = vzip_f32(f, f);
+    return vcombine_f32(z.val[0], z.val[1]);
+}
+static inline mixer_f32x4_t mixer_dup_f32(float x) { return vdupq_n_f32(x); }
+
+// out[0..7] += in[0..7] * vol[0..7], where vol is a 4 lane pattern repeated twice.
+static inline void mixer_mac8_i16(int32_t *out, const int16_t *in, const int16_t *vol) {
+    const int16x4_t v = vld1_s16(vol);
+    vst1q_s32(out, vmlal_s16(vld1q_s32(out), vld1_s16(in), v));
+    vst1q_s32(out + 4, vmlal_s16(vld1q_s32(out + 4), vld1_s16(in + 4), v));
+}
+
+#else // USE_MIXER_SSE
+
+typedef __m128 mixer_f32x4_t;
+
+static inline mixer_f32x4_t mixer_ld_f32(const float *p) { return _mm_loadu_ps(p); }
+static inline void mixer_st_f32(float *p, mixer_f32x4_t v) { _mm_storeu_ps(p, v); }
+static inline mixer_f32x4_t mixer_add_f32(mixer_f32x4_t a, mixer_f32x4_t b) {
+    return _mm_add_ps(a, b);
+}
+static inline mixer_f32x4_t mixer_mul_f32(mixer_f32x4_t a, mixer_f32x4_t b) {
+    return _mm_mul_ps(a, b);
+}
+// returns { p[0], p[0], p[1], p[1] }
+static inline mixer_f32x4_t mixer_ld_dup2_f32(const float *p) {
+    const __m128 x = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double *>(p)));
+    return _mm_unpacklo_ps(x, x);
+}
+
+// returns { p[0], p[1], p[2], p[3] } converted to float, not scaled
+static inline mixer_f32x4_t mixer_ld_i16(const int16_t *p) {
+    const __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p));
+    return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+}
+// returns { p[0], p[0], p[1], p[1] } converted to float, not scaled
+static inline mixer_f32x4_t mixer_ld_dup2_i16(const int16_t *p) {
+    int32_t pair;
+    memcpy(&pair, p, sizeof(pair));
+    __m128i x = _mm_cvtsi32_si128(pair);
+    x = _mm_unpacklo_epi16(x, x);
+    return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+}
+static inline mixer_f32x4_t mixer_dup_f32(float x) { return _mm_set1_ps(x); }
+
+// out[0..7] += in[0..7] * vol[0..7], where vol is a 4 lane pattern repeated twice.
+static inline void mixer_mac8_i16(int32_t *out, const int16_t *in, const int16_t *vol) {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+    const __m128i v = _mm_unpacklo_epi64(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i *>(vol)),
+            _mm_loadl_epi64(reinterpret_cast<const __m128i *>(vol)));
+    const __m128i lo = _mm_mullo_epi16(x, v);
+    const __m128i hi = _mm_mulhi_epi16(x, v);
+    __m128i *o = reinterpret_cast<__m128i *>(out);
+    _mm_storeu_si128(o, _mm_add_epi32(_mm_loadu_si128(o), _mm_unpacklo_epi16(lo, hi)));
+    _mm_storeu_si128(o + 1, _mm_add_epi32(_mm_loadu_si128(o + 1), _mm_unpackhi_epi16(lo, hi)));
+}
+
+#endif // USE_MIXER_NEON
+
+// Returns true for the mixtypes that use only vol[0] for all channels.
+template <int MIXTYPE>
+static inline bool mixerSimdIsMonoVol() {
+    return MIXTYPE == MIXTYPE_MULTI_MONOVOL || MIXTYPE == MIXTYPE_MULTI_SAVEONLY_MONOVOL;
+}
+
+// Returns true for the mixtypes that accumulate into the out pointer.
+template <int MIXTYPE>
+static inline bool mixerSimdIsAccumulate() {
+    return MIXTYPE == MIXTYPE_MULTI || MIXTYPE == MIXTYPE_MULTI_MONOVOL
+            || MIXTYPE == MIXTYPE_MONOEXPAND;
+}
+
+// Loads input samples for a float mix. scaled() applies the input scaling of
+// MixMul<float, TI, float>() to a product of samples and volumes, in the same order.
+template <typename TI>
+struct MixerSimdInput;
+
+template <>
+struct MixerSimdInput<float> {
+    static inline mixer_f32x4_t load(const float *p) { return mixer_ld_f32(p); }
+    static inline mixer_f32x4_t loadDup2(const float *p) { return mixer_ld_dup2_f32(p); }
+    static inline mixer_f32x4_t scaled(mixer_f32x4_t x) { return x; }
+};
+
+template <>
+struct MixerSimdInput<int16_t> {
+    static inline mixer_f32x4_t load(const int16_t *p) { return mixer_ld_i16(p); }
+    static inline mixer_f32x4_t loadDup2(const int16_t *p) { return mixer_ld_dup2_i16(p); }
+    static inline mixer_f32x4_t scaled(mixer_f32x4_t x) {
+        return mixer_mul_f32(x, mixer_dup_f32(1. / (1 << 15)));
+    }
+};
+
+// The float mix of float or int16_t (Q0.15) input.
+template <int MIXTYPE, int NCHAN, typename TI>
+struct MixerSimdFloat {
+
+    static inline bool volume(float* out, size_t frameCount, const TI* in, const float *vol) {
+        if (mixerSimdIsMonoVol<MIXTYPE>()) {
+            // a single volume for all channels; treat the buffer as one channel.
+            const size_t samples = frameCount * NCHAN;
+            const size_t vecSamples = samples & ~3;
+            scale<false /* EXPAND */>(out, vecSamples, in, vol[0], vol[0]);
+            if (samples > vecSamples) {
+                volumeMulti<MIXTYPE, 1>(out + vecSamples, samples - vecSamples,
+                        in + vecSamples, (int32_t *)NULL, vol, (int32_t)0);
+            }
+            return true;
+        }
+        if (!supported()) {
+            return false;
+        }
+        const size_t framesPerVector = NCHAN <= 4 ? 4 / NCHAN : 1;
+        const size_t vecFrames = frameCount - frameCount % framesPerVector;
+        const size_t inFrameSamples = MIXTYPE == MIXTYPE_MONOEXPAND ? 1 : NCHAN;
+        scale<MIXTYPE == MIXTYPE_MONOEXPAND>(out, vecFrames * NCHAN, in,
+                vol[0], vol[NCHAN - 1]);
+        if (frameCount > vecFrames) {
+            volumeMulti<MIXTYPE, NCHAN>(out + vecFrames * NCHAN, frameCount - vecFrames,
+                    in + vecFrames * inFrameSamples, (int32_t *)NULL, vol, (int32_t)0);
+        }
+        return true;
+    }
+
+    static inline bool volumeRamp(float* out, size_t frameCount, const TI* in,
+            float *vol, const float *volinc) {
+        if (mixerSimdIsMonoVol<MIXTYPE>()) {
+            // one volume per frame, broadcast across the channels of that frame.
+            const size_t vecChannels = NCHAN & ~3;
+            if (vecChannels == 0) {
+                return false;
+            }
+            float v = vol[0];
+            for (size_t i = 0; i < frameCount; ++i) {
+                scale<false /* EXPAND */>(out, vecChannels, in, v, v);
+                for (int j = vecChannels; j < NCHAN; ++j) {
+                    if (mixerSimdIsAccumulate<MIXTYPE>()) {
+                        out[j] += MixMul<float, TI, float>(in[j], v);
+                    } else {
+                        out[j] = MixMul<float, TI, float>(in[j], v);
+                    }
+                }
+                out += NCHAN;
+                in += NCHAN;
+                v += volinc[0];
+            }
+            vol[0] = v;
+            return true;
+        }
+        if (!supported()) {
+            return false;
+        }
+        const size_t framesPerVector = NCHAN <= 4 ? 4 / NCHAN : 1;
+        if (frameCount < framesPerVector) {
+            volumeRampMulti<MIXTYPE, NCHAN>(out, frameCount, in,
+                    (int32_t *)NULL, vol, volinc, (int32_t *)NULL, (int32_t)0);
+            return true;
+        }
+        const size_t vecFrames = frameCount - frameCount % framesPerVector;
+
+        // Lane i holds the volume of channel (i % NCHAN) for frame (i / NCHAN)
+        // of the current vector, computed with the same sequential adds as the scalar path.
+        float lanes[4], incs[4];
+        float v[NCHAN];
+        for (int j = 0; j < NCHAN; ++j) {
+            v[j] = vol[j];
+        }
+        for (size_t i = 0; i < framesPerVector; ++i) {
+            for (int j = 0; j < NCHAN; ++j) {
+                lanes[i * NCHAN + j] = v[j];
+                incs[i * NCHAN + j] = volinc[j];
+                v[j] += volinc[j];
+            }
+        }
+        mixer_f32x4_t volv = mixer_ld_f32(lanes);
+        const mixer_f32x4_t incv = mixer_ld_f32(incs);
+        for (size_t i = 0; i < vecFrames; i += framesPerVector) {
+            mixer_f32x4_t x;
+            if (MIXTYPE == MIXTYPE_MONOEXPAND) {
+                x = MixerSimdInput<TI>::loadDup2(in);
+                in += 2;
+            } else {
+                x = MixerSimdInput<TI>::load(in);
+                in += 4;
+            }
+            x = MixerSimdInput<TI>::scaled(mixer_mul_f32(x, volv));
+            if (mixerSimdIsAccumulate<MIXTYPE>()) {
+                x = mixer_add_f32(mixer_ld_f32(out), x);
+            }
+            mixer_st_f32(out, x);
+            out += 4;
+            for (size_t k = 0; k < framesPerVector; ++k) {
+                volv = mixer_add_f32(volv, incv);
+            }
+        }
+        mixer_st_f32(lanes, volv);
+        for (int j = 0; j < NCHAN; ++j) {
+            vol[j] = lanes[j];
+        }
+        if (frameCount > vecFrames) {
+            volumeRampMulti<MIXTYPE, NCHAN>(out, frameCount - vecFrames, in,
+                    (int32_t *)NULL, vol, volinc, (int32_t *)NULL, (int32_t)0);
+        }
+        return true;
+    }
+
+private:
+    static inline bool supported() {
+        switch (MIXTYPE) {
+        case MIXTYPE_MULTI:
+        case MIXTYPE_MULTI_SAVEONLY:
+            return NCHAN == 1 || NCHAN == 2;
+        case MIXTYPE_MONOEXPAND:
+            return NCHAN == 2;
+        default:
+            return false;
+        }
+    }
+
+    // Scales (and accumulates if required) samples output samples, a multiple of 4,
+    // with volume v0 for even and v1 for odd output samples.
+    // If EXPAND, each input sample is duplicated into two output samples.
+    template <bool EXPAND>
+    static inline void scale(float *out, size_t samples, const TI *in, float v0, float v1) {
+        const float pattern[4] = { v0, v1, v0, v1 };
+        const mixer_f32x4_t volv = mixer_ld_f32(pattern);
+        for (size_t i = 0; i < samples; i += 4) {
+            mixer_f32x4_t x;
+            if (EXPAND) {
+                x = MixerSimdInput<TI>::loadDup2(in);
+                in += 2;
+            } else {
+                x = MixerSimdInput<TI>::load(in);
+                in += 4;
+            }
+            x = MixerSimdInput<TI>::scaled(mixer_mul_f32(x, volv));
+            if (mixerSimdIsAccumulate<MIXTYPE>()) {
+                x = mixer_add_f32(mixer_ld_f32(out), x);
+            }
+            mixer_st_f32(out, x);
+            out += 4;
+        }
+    }
+};
+
+template <int MIXTYPE, int NCHAN>
+struct MixerSimd<MIXTYPE, NCHAN, float, float, float>
+        : public MixerSimdFloat<MIXTYPE, NCHAN, float> {};
+
+// PCM_16 tracks mixed directly into a float mix (see AudioMixer::track_t::canMixDirect())
+template <int MIXTYPE, int NCHAN>
+struct MixerSimd<MIXTYPE, NCHAN, float, int16_t, float>
+        : public MixerSimdFloat<MIXTYPE, NCHAN, int16_t> {};
+
+template <int MIXTYPE, int NCHAN>
+struct MixerSimd<MIXTYPE, NCHAN, int32_t, int16_t, int16_t> {
+
+    static inline bool volume(int32_t* out, size_t frameCount, const int16_t* in,
+            const int16_t *vol) {
+        int16_t pattern[4];
+        size_t samples;
+        int nchan;
+        if (MIXTYPE == MIXTYPE_MULTI_MONOVOL) {
+            // a single volume for all channels; treat the buffer as one channel.
+            pattern[0] = pattern[1] = pattern[2] = pattern[3] = vol[0];
+            samples = frameCount * NCHAN;
+            nchan = 1;
+        } else if (MIXTYPE == MIXTYPE_MULTI && (NCHAN == 1 || NCHAN == 2)) {
+            pattern[0] = pattern[2] = vol[0];
+            pattern[1] = pattern[3] = vol[NCHAN - 1];
+            samples = frameCount * NCHAN;
+            nchan = NCHAN;
+        } else {
+            return false;
+        }
+        const size_t vecSamples = samples & ~7;
+        for (size_t i = 0; i < vecSamples; i += 8) {
+            mixer_mac8_i16(out + i, in + i, pattern);
+        }
+        if (samples > vecSamples) {
+            // the remaining samples are a whole number of frames.
+            if (nchan == 1) {
+                volumeMulti<MIXTYPE_MULTI, 1>(out + vecSamples, samples - vecSamples,
+                        in + vecSamples, (int32_t *)NULL, vol, (int32_t)0);
+            } else {
+                volumeMulti<MIXTYPE, NCHAN>(out + vecSamples, (samples - vecSamples) / NCHAN,
+                        in + vecSamples, (int32_t *)NULL, vol, (int32_t)0);
+            }
+        }
+        return true;
+    }
+
+    static inline bool volumeRamp(int32_t* out __unused, size_t frameCount __unused,
+            const int16_t* in __unused, int16_t *vol __unused, const int16_t *volinc __unused) {
+        return false;
+    }
+};
+
+#endif // USE_MIXER_SIMD
+
+} // namespace android
+
+#endif /*ANDROID_AUDIO_MIXER_OPS_SIMD_H*/
@@ -184,6 +184,28 @@ AudioResampler* AudioResampler::create(audio_format_t format, int inChannelCount
         quality = DYN_MED_QUALITY;
     }
 
+    // only the dynamic resamplers process more than 2 channels natively,
+    // so pick the closest dynamic quality rather than failing.
+    if (inChannelCount > 2) {
+        switch (quality) {
+        default:
+            break;
+        case LOW_QUALITY:
+        case MED_QUALITY:
+            quality = DYN_LOW_QUALITY;
+            break;
+        case HIGH_QUALITY:
+            quality = DYN_MED_QUALITY;
+            break;
+        case VERY_HIGH_QUALITY:
+#ifdef QTI_RESAMPLER
+        case QTI_QUALITY:
+#endif
+            quality = DYN_HIGH_QUALITY;
+            break;
+        }
+    }
+
     // naive implementation of CPU load throttling doesn't account for whether resampler is active
     pthread_mutex_lock(&mutex);
     for (;;) {
@@ -18,6 +18,8 @@
 //#define LOG_NDEBUG 0
 
 #include <malloc.h>
+#include <pthread.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <dlfcn.h>
@@ -29,9 +31,10 @@
 #include <utils/Log.h>
 #include <audio_utils/primitives.h>
 
-#include "AudioResamplerFirOps.h" // USE_NEON and USE_INLINE_ASSEMBLY defined here
+#include "AudioResamplerFirOps.h" // USE_NEON, USE_SSE and USE_INLINE_ASSEMBLY defined here
 #include "AudioResamplerFirProcess.h"
 #include "AudioResamplerFirProcessNeon.h"
+#include "AudioResamplerFirProcessSSE.h"
 #include "AudioResamplerFirGen.h" // requires math.h
 #include "AudioResamplerDyn.h"
 
@@ -39,6 +42,127 @@
 
 namespace android {
 
+/*
+ * The filter cache is a list of filter banks in order of last use, most recent first.
+ * It is expected to hold only a handful of filter banks.
+ */
+struct FilterCacheEntry {
+    AudioResamplerFilterCache::Key mKey;
+    void* mCoefs;
+    size_t mSize;
+    int mRefCount;
+    FilterCacheEntry* mNext;
+};
+
+static pthread_mutex_t gFilterCacheLock = PTHREAD_MUTEX_INITIALIZER;
+static FilterCacheEntry* gFilterCache = NULL;
+static uint32_t gFilterCacheHits = 0;
+static uint32_t gFilterCacheMisses = 0;
+
+static bool keyEquals(const AudioResamplerFilterCache::Key& a,
+        const AudioResamplerFilterCache::Key& b)
+{
+    return a.mType == b.mType && a.mL == b.mL && a.mHalfNumCoefs == b.mHalfNumCoefs
+            && a.mStopBandAtten == b.mStopBandAtten && a.mFcr == b.mFcr;
+}
+
+// finds the entry for key and moves it to the front of the list.
+// must be called with gFilterCacheLock held.
+static FilterCacheEntry* findFilter_l(const AudioResamplerFilterCache::Key& key)
+{
+    for (FilterCacheEntry** link = &gFilterCache; *link != NULL; link = &(*link)->mNext) {
+        FilterCacheEntry* entry = *link;
+        if (keyEquals(entry->mKey, key)) {
+            *link = entry->mNext;
+            entry->mNext = gFilterCache;
+            gFilterCache = entry;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/*static*/
+const void* AudioResamplerFilterCache::acquire(const Key& key)
+{
+    pthread_mutex_lock(&gFilterCacheLock);
+    FilterCacheEntry* entry = findFilter_l(key);
+    const void* coefs = NULL;
+    if (entry != NULL) {
+        entry->mRefCount++;
+        gFilterCacheHits++;
+        coefs = entry->mCoefs;
+    } else {
+        gFilterCacheMisses++;
+    }
+    pthread_mutex_unlock(&gFilterCacheLock);
+    return coefs;
+}
+
+/*static*/
+const void* AudioResamplerFilterCache::add(const Key& key, void* coefs, size_t size)
+{
+    pthread_mutex_lock(&gFilterCacheLock);
+    FilterCacheEntry* entry = findFilter_l(key);
+    if (entry != NULL) {
+        free(coefs);
+    } else {
+        entry = new FilterCacheEntry;
+        entry->mKey = key;
+        entry->mCoefs = coefs;
+        entry->mSize = size;
+        entry->mRefCount = 0;
+        entry->mNext = gFilterCache;
+        gFilterCache = entry;
+    }
+    entry->mRefCount++;
+    pthread_mutex_unlock(&gFilterCacheLock);
+    return entry->mCoefs;
+}
+
+/*static*/
+void AudioResamplerFilterCache::release(const void* coefs)
+{
+    pthread_mutex_lock(&gFilterCacheLock);
+    int unused = 0;
+    for (FilterCacheEntry** link = &gFilterCache; *link != NULL; ) {
+        FilterCacheEntry* entry = *link;
+        if (entry->mCoefs == coefs) {
+            LOG_ALWAYS_FATAL_IF(entry->mRefCount <= 0, "filter %p released too often", coefs);
+            entry->mRefCount--;
+        }
+        // drop the least recently used filter banks beyond kMaxUnusedFilters.
+        if (entry->mRefCount == 0 && ++unused > kMaxUnusedFilters) {
+            *link = entry->mNext;
+            free(entry->mCoefs);
+            delete entry;
+            continue;
+        }
+        link = &entry->mNext;
+    }
+    pthread_mutex_unlock(&gFilterCacheLock);
+}
+
+/*static*/
+void AudioResamplerFilterCache::dump(int fd)
+{
+    pthread_mutex_lock(&gFilterCacheLock);
+    int filters = 0;
+    int unused = 0;
+    size_t bytes = 0;
+    for (FilterCacheEntry* entry = gFilterCache; entry != NULL; entry = entry->mNext) {
+        filters++;
+        if (entry->mRefCount == 0) {
+            unused++;
+        }
+        bytes += entry->mSize;
+    }
+    dprintf(fd, "Resampler filter cache: %d filters (%d unused), %zu bytes,"
+            " %u hits, %u misses\n",
+            filters, unused, bytes, gFilterCacheHits, gFilterCacheMisses);
+    pthread_mutex_unlock(&gFilterCacheLock);
+}
+
 /*
  * InBuffer is a type agnostic input buffer.
  *
@@ -180,7 +304,9 @@ AudioResamplerDyn<TC, TI, TO>::AudioResamplerDyn(
 template<typename TC, typename TI, typename TO>
 AudioResamplerDyn<TC, TI, TO>::~AudioResamplerDyn()
 {
-    free(mCoefBuffer);
+    if (mCoefBuffer) {
+        AudioResamplerFilterCache::release(mCoefBuffer);
+    }
 }
 
 template<typename TC, typename TI, typename TO>
@@ -213,22 +339,39 @@ template<typename TC, typename TI, typename TO>
 void AudioResamplerDyn<TC, TI, TO>::createKaiserFir(Constants &c,
         double stopBandAtten, int inSampleRate, int outSampleRate, double tbwCheat)
 {
-    TC* buf = NULL;
     static const double atten = 0.9998;   // to avoid ripple overflow
     double fcr;
     double tbw = firKaiserTbw(c.mHalfNumCoefs, stopBandAtten);
 
-    (void)posix_memalign(reinterpret_cast<void**>(&buf), 32, (c.mL+1)*c.mHalfNumCoefs*sizeof(TC));
     if (inSampleRate < outSampleRate) { // upsample
         fcr = max(0.5*tbwCheat - tbw/2, tbw/2);
     } else { // downsample
         fcr = max(0.5*tbwCheat*outSampleRate/inSampleRate - tbw/2, tbw/2);
     }
-    // create and set filter
-    firKaiserGen(buf, c.mL, c.mHalfNumCoefs, stopBandAtten, fcr, atten);
+
+    // the filter bank may have been created already for another resampler
+    AudioResamplerFilterCache::Key key;
+    key.mType = is_same<TC, float>::value ? AudioResamplerFilterCache::COEF_FLOAT :
+            is_same<TC, int32_t>::value ? AudioResamplerFilterCache::COEF_INT32 :
+            AudioResamplerFilterCache::COEF_INT16;
+    key.mL = c.mL;
+    key.mHalfNumCoefs = c.mHalfNumCoefs;
+    key.mStopBandAtten = stopBandAtten;
+    key.mFcr = fcr;
+    const TC* buf = static_cast<const TC*>(AudioResamplerFilterCache::acquire(key));
+    if (buf == NULL) {
+        // create and cache filter
+        const size_t size = (c.mL+1)*c.mHalfNumCoefs*sizeof(TC);
+        TC* newBuf = NULL;
+        (void)posix_memalign(reinterpret_cast<void**>(&newBuf), 32, size);
+        firKaiserGen(newBuf, c.mL, c.mHalfNumCoefs, stopBandAtten, fcr, atten);
+        buf = static_cast<const TC*>(AudioResamplerFilterCache::add(key, newBuf, size));
+    }
+
+    // set filter
     c.mFirCoefs = buf;
     if (mCoefBuffer) {
-        free(mCoefBuffer);
+        AudioResamplerFilterCache::release(mCoefBuffer);
     }
     mCoefBuffer = buf;
 #ifdef DEBUG_RESAMPLER
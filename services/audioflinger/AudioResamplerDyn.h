@@ -25,6 +25,47 @@
 
 namespace android {
 
+/* AudioResamplerFilterCache
+ *
+ * A process-wide cache of the polyphase filter banks designed by AudioResamplerDyn.
+ * Resamplers with the same filter design share one read-only filter bank, which is
+ * reference counted. A few filter banks that are no longer used are kept for reuse.
+ */
+class AudioResamplerFilterCache {
+public:
+    enum coef_type {
+        COEF_INT16,
+        COEF_INT32,
+        COEF_FLOAT,
+    };
+
+    // All the parameters that the filter bank depends on.
+    struct Key {
+        coef_type mType;
+        int mL;
+        int mHalfNumCoefs;
+        double mStopBandAtten;
+        double mFcr;
+    };
+
+    // Returns the filter bank for key with a reference held, or NULL if it is not cached.
+    static const void* acquire(const Key& key);
+
+    // Adds coefs, allocated with malloc() and size bytes long, for key, and returns it
+    // with a reference held. If a filter bank for key was added in the meantime,
+    // coefs is freed and the cached filter bank is returned instead.
+    static const void* add(const Key& key, void* coefs, size_t size);
+
+    // Drops a reference to a filter bank returned by acquire() or add().
+    static void release(const void* coefs);
+
+    static void dump(int fd);
+
+private:
+    // tuning parameter: filter banks kept when no resampler uses them.
+    static const int kMaxUnusedFilters = 4;
+};
+
 /* AudioResamplerDyn
  *
  * This class template is used for floating point and integer resamplers.
@@ -124,7 +165,7 @@ private:
      resample_ABP_t mResampleFunc;     // called function for resampling
             int32_t mFilterSampleRate; // designed filter sample rate.
         src_quality mFilterQuality;    // designed filter quality.
-              void* mCoefBuffer;       // if a filter is created, this is not null
+        const void* mCoefBuffer;       // if a filter is acquired, this is not null
 };
 
 } // namespace android
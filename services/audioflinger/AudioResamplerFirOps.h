@@ -36,6 +36,19 @@ namespace android {
 #include <arm_neon.h>
 #endif
 
+// SSSE3 is the baseline for x86 and x86_64; AVX2 is detected at runtime.
+#if (defined(__i386__) || defined(__x86_64__)) && defined(__SSSE3__)
+#ifndef USE_SSE
+#define USE_SSE (true)
+#endif
+#else
+#define USE_SSE (false)
+#endif
+#if USE_SSE
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
 template<typename T, typename U>
 struct is_same
 {
@@ -0,0 +1,989 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_RESAMPLER_FIR_PROCESS_SSE_H
+#define ANDROID_AUDIO_RESAMPLER_FIR_PROCESS_SSE_H
+
+namespace android {
+
+// depends on AudioResamplerFirOps.h, AudioResamplerFirProcess.h
+
+#if USE_SSE
+
+//
+// SSE specializations are enabled for Process() and ProcessL() in AudioResamplerFirProcess.h
+//
+// The SSSE3 intrinsics are the baseline, as SSSE3 is required by both the x86 and x86_64 ABIs.
+// If the CPU supports AVX2 and FMA, the AVX2 intrinsics are selected at runtime;
+// they process 16 coefficients per loop iteration instead of 8.
+//
+// 4, 6 and 8 channel frames (quad, 5.1 and 7.1) are accumulated channel-parallel,
+// so multichannel content is resampled in one pass without a scalar fallback.
+//
+// For int16_t coefficients the result is bit-exact with the generic ProcessBase().
+// For float coefficients the dot products are summed in a different order,
+// so the result differs from ProcessBase() only by rounding.
+//
+
+#if defined(__AVX2__) && defined(__FMA__)
+static const bool kSseUseAvx2 = true;
+#else
+static inline bool sseCpuHasAvx2()
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    const unsigned int features = bit_OSXSAVE | bit_AVX | bit_FMA;
+    if ((ecx & features) != features) {
+        return false;
+    }
+    // the OS must save the XMM and YMM registers on context switch
+    unsigned int xcr0, xcr0hi;
+    asm ("xgetbv" : "=a"(xcr0), "=d"(xcr0hi) : "c"(0));
+    if ((xcr0 & 6) != 6 || __get_cpuid_max(0, NULL) < 7) {
+        return false;
+    }
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return (ebx & bit_AVX2) != 0;
+}
+
+static const bool kSseUseAvx2 = sseCpuHasAvx2();
+#endif
+
+// The helpers below are shared with the AVX2 variants and must be inlined there:
+// calling legacy SSE code with the upper halves of the YMM registers in use is very slow.
+#define SSE_INLINE static inline __attribute__((always_inline))
+
+// Interpolates 8 int16_t coefficients exactly as interpolate<int16_t, uint32_t>():
+// coef0 + (lerp * (coef1 - coef0) >> 15), truncated to 16 bits.
+SSE_INLINE __m128i InterpolateSSE(__m128i coef0, __m128i coef1, __m128i lerp)
+{
+    __m128i diff = _mm_sub_epi16(coef1, coef0);
+    __m128i lo = _mm_mullo_epi16(diff, lerp);
+    __m128i hi = _mm_mulhi_epi16(diff, lerp);
+    return _mm_add_epi16(coef0, _mm_or_si128(_mm_slli_epi16(hi, 1), _mm_srli_epi16(lo, 15)));
+}
+
+SSE_INLINE int32_t HorizontalSumSSE(__m128i accum)
+{
+    accum = _mm_add_epi32(accum, _mm_shuffle_epi32(accum, _MM_SHUFFLE(1, 0, 3, 2)));
+    accum = _mm_add_epi32(accum, _mm_shuffle_epi32(accum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(accum);
+}
+
+// Accumulates the dot products of 8 coefficients of the positive and the negative half
+// of the filter, into accum (mono or left channel) and accum2 (right channel).
+// sP should point to the first of the 8 positive side frames, which are in reverse order.
+template <int CHANNELS, bool FIXED>
+SSE_INLINE void ProcessSSEStep(__m128i& accum, __m128i& accum2,
+        const int16_t*& coefsP,
+        const int16_t*& coefsN,
+        const int16_t*& sP,
+        const int16_t*& sN,
+        __m128i interp,
+        const int16_t*& coefsP1,
+        const int16_t*& coefsN1)
+{
+    __m128i posCoef = _mm_load_si128(reinterpret_cast<const __m128i*>(coefsP));
+    coefsP += 8;
+    __m128i negCoef = _mm_load_si128(reinterpret_cast<const __m128i*>(coefsN));
+    coefsN += 8;
+    if (!FIXED) { // interpolate
+        __m128i posCoef1 = _mm_load_si128(reinterpret_cast<const __m128i*>(coefsP1));
+        coefsP1 += 8;
+        __m128i negCoef1 = _mm_load_si128(reinterpret_cast<const __m128i*>(coefsN1));
+        coefsN1 += 8;
+
+        posCoef = InterpolateSSE(posCoef, posCoef1, interp);
+        negCoef = InterpolateSSE(negCoef1, negCoef, interp);
+    }
+    switch (CHANNELS) {
+    case 1: {
+        // reverse s7, s6, s5, s4, s3, s2, s1, s0
+        const __m128i reverse = _mm_setr_epi8(
+                14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1);
+        __m128i posSamp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sP));
+        __m128i negSamp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sN));
+        sP -= 8;
+        sN += 8;
+        posSamp = _mm_shuffle_epi8(posSamp, reverse);
+
+        // dot product
+        accum = _mm_add_epi32(accum, _mm_madd_epi16(posSamp, posCoef));
+        accum = _mm_add_epi32(accum, _mm_madd_epi16(negSamp, negCoef));
+    } break;
+    case 2: {
+        // split 4 frames into l0, l1, l2, l3, r0, r1, r2, r3 (reversed for the positive side)
+        const __m128i deinterleave = _mm_setr_epi8(
+                0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15);
+        const __m128i deinterleaveReverse = _mm_setr_epi8(
+                12, 13, 8, 9, 4, 5, 0, 1, 14, 15, 10, 11, 6, 7, 2, 3);
+        __m128i posSamp0 = _mm_shuffle_epi8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(sP)), deinterleaveReverse);
+        __m128i posSamp1 = _mm_shuffle_epi8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(sP + 8)), deinterleaveReverse);
+        __m128i negSamp0 = _mm_shuffle_epi8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(sN)), deinterleave);
+        __m128i negSamp1 = _mm_shuffle_epi8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(sN + 8)), deinterleave);
+        sP -= 16;
+        sN += 16;
+
+        // dot product
+        accum = _mm_add_epi32(accum,
+                _mm_madd_epi16(_mm_unpacklo_epi64(posSamp1, posSamp0), posCoef));
+        accum2 = _mm_add_epi32(accum2,
+                _mm_madd_epi16(_mm_unpackhi_epi64(posSamp1, posSamp0), posCoef));
+        accum = _mm_add_epi32(accum,
+                _mm_madd_epi16(_mm_unpacklo_epi64(negSamp0, negSamp1), negCoef));
+        accum2 = _mm_add_epi32(accum2,
+                _mm_madd_epi16(_mm_unpackhi_epi64(negSamp0, negSamp1), negCoef));
+    } break;
+    }
+}
+
+template <int CHANNELS>
+SSE_INLINE void ProcessSSEAccumulate(int32_t* out, __m128i accum, __m128i accum2,
+        const int32_t* volumeLR)
+{
+    // apply the volume in the same way as the generic code, for bit-exact results.
+    int32_t l = HorizontalSumSSE(accum);
+    int32_t r = CHANNELS == 2 ? HorizontalSumSSE(accum2) : l;
+    out[0] += volumeAdjust(l, volumeLR[0]);
+    out[1] += volumeAdjust(r, volumeLR[1]);
+}
+
+// Loads one frame of 4, 6 or 8 int16_t samples, without reading past the frame.
+template <int CHANNELS>
+SSE_INLINE __m128i LoadFrameSSE(const int16_t* s)
+{
+    switch (CHANNELS) {
+    case 4:
+        return _mm_loadl_epi64(reinterpret_cast<const __m128i*>(s));
+    case 6:
+        return _mm_unpacklo_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(s)),
+                _mm_cvtsi32_si128(*reinterpret_cast<const int32_t*>(s + 4)));
+    default:
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+    }
+}
+
+// Accumulates the 2 taps of the coefficient pair PAIR (of 4 pairs in coef), for the frames
+// s and s + step, into accum (channels 0 to 3) and accum2 (channels 4 to 7).
+template <int CHANNELS, int PAIR>
+SSE_INLINE void MacFramePairSSE(__m128i& accum, __m128i& accum2, __m128i coef,
+        const int16_t* s, int step)
+{
+    // the samples of both frames are interleaved channel by channel, so that
+    // _mm_madd_epi16() computes s[i] * c[2 * PAIR] + s[step + i] * c[2 * PAIR + 1].
+    const __m128i coefPair = _mm_shuffle_epi32(coef, _MM_SHUFFLE(PAIR, PAIR, PAIR, PAIR));
+    const __m128i frame0 = LoadFrameSSE<CHANNELS>(s + 2 * PAIR * step);
+    const __m128i frame1 = LoadFrameSSE<CHANNELS>(s + (2 * PAIR + 1) * step);
+    accum = _mm_add_epi32(accum, _mm_madd_epi16(_mm_unpacklo_epi16(frame0, frame1), coefPair));
+    if (CHANNELS > 4) {
+        accum2 = _mm_add_epi32(accum2,
+                _mm_madd_epi16(_mm_unpackhi_epi16(frame0, frame1), coefPair));
+    }
+}
+
+// Multichannel frames are processed 4 channels at a time, for 4, 6 and 8 channels
+// (the ProcessL() and Process() specializations below are the only callers).
+// As the generic code, the volume of the left channel applies to all channels.
+template <int CHANNELS, bool FIXED>
+SSE_INLINE void ProcessSSEMultichannel(int32_t* out,
+        int count,
+        const int16_t* coefsP,
+        const int16_t* coefsN,
+        const int16_t* sP,
+        const int16_t* sN,
+        const int32_t* volumeLR,
+        uint32_t lerpP,
+        const int16_t* coefsP1,
+        const int16_t* coefsN1)
+{
+    __m128i interp = _mm_set1_epi16(static_cast<int16_t>(lerpP));
+    __m128i accum = _mm_setzero_si128();
+    __m128i accum2 = _mm_setzero_si128();
+    do {
+        __m128i posCoef = _mm_load_si128(reinterpret_cast<const __m128i*>(coefsP));
+        coefsP += 8;
+        __m128i negCoef = _mm_load_si128(reinterpret_cast<const __m128i*>(coefsN));
+        coefsN += 8;
+        if (!FIXED) { // interpolate
+            __m128i posCoef1 = _mm_load_si128(reinterpret_cast<const __m128i*>(coefsP1));
+            coefsP1 += 8;
+            __m128i negCoef1 = _mm_load_si128(reinterpret_cast<const __m128i*>(coefsN1));
+            coefsN1 += 8;
+
+            posCoef = InterpolateSSE(posCoef, posCoef1, interp);
+            negCoef = InterpolateSSE(negCoef1, negCoef, interp);
+        }
+        MacFramePairSSE<CHANNELS, 0>(accum, accum2, posCoef, sP, -CHANNELS);
+        MacFramePairSSE<CHANNELS, 1>(accum, accum2, posCoef, sP, -CHANNELS);
+        MacFramePairSSE<CHANNELS, 2>(accum, accum2, posCoef, sP, -CHANNELS);
+        MacFramePairSSE<CHANNELS, 3>(accum, accum2, posCoef, sP, -CHANNELS);
+        sP -= 8 * CHANNELS;
+        MacFramePairSSE<CHANNELS, 0>(accum, accum2, negCoef, sN, CHANNELS);
+        MacFramePairSSE<CHANNELS, 1>(accum, accum2, negCoef, sN, CHANNELS);
+        MacFramePairSSE<CHANNELS, 2>(accum, accum2, negCoef, sN, CHANNELS);
+        MacFramePairSSE<CHANNELS, 3>(accum, accum2, negCoef, sN, CHANNELS);
+        sN += 8 * CHANNELS;
+    } while (count -= 8);
+
+    // apply the volume in the same way as the generic code, for bit-exact results.
+    int32_t accumOut[8] __attribute__ ((aligned (16)));
+    _mm_store_si128(reinterpret_cast<__m128i*>(accumOut), accum);
+    _mm_store_si128(reinterpret_cast<__m128i*>(accumOut + 4), accum2);
+    for (int i = 0; i < CHANNELS; ++i) {
+        out[i] += volumeAdjust(accumOut[i], volumeLR[0]);
+    }
+}
+
+template <int CHANNELS, int STRIDE, bool FIXED>
+static inline void ProcessSSEIntrinsic(int32_t* out,
+        int count,
+        const int16_t* coefsP,
+        const int16_t* coefsN,
+        const int16_t* sP,
+        const int16_t* sN,
+        const int32_t* volumeLR,
+        uint32_t lerpP,
+        const int16_t* coefsP1,
+        const int16_t* coefsN1)
+{
+    ALOG_ASSERT(count > 0 && (count & 7) == 0); // multiple of 8
+    if (CHANNELS > 2) {
+        ProcessSSEMultichannel<CHANNELS, FIXED>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+                lerpP, coefsP1, coefsN1);
+        return;
+    }
+
+    sP -= CHANNELS*((STRIDE>>1)-1);
+    __m128i interp = _mm_set1_epi16(static_cast<int16_t>(lerpP));
+    __m128i accum = _mm_setzero_si128();
+    __m128i accum2 = _mm_setzero_si128();
+    do {
+        ProcessSSEStep<CHANNELS, FIXED>(accum, accum2,
+                coefsP, coefsN, sP, sN, interp, coefsP1, coefsN1);
+    } while (count -= 8);
+
+    ProcessSSEAccumulate<CHANNELS>(out, accum, accum2, volumeLR);
+}
+
+template <int CHANNELS, int STRIDE, bool FIXED>
+__attribute__((target("avx2,fma")))
+static void ProcessAVX2Intrinsic(int32_t* out,
+        int count,
+        const int16_t* coefsP,
+        const int16_t* coefsN,
+        const int16_t* sP,
+        const int16_t* sN,
+        const int32_t* volumeLR,
+        uint32_t lerpP,
+        const int16_t* coefsP1,
+        const int16_t* coefsN1)
+{
+    ALOG_ASSERT(count > 0 && (count & 7) == 0); // multiple of 8
+    if (CHANNELS > 2) {
+        ProcessSSEMultichannel<CHANNELS, FIXED>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+                lerpP, coefsP1, coefsN1);
+        return;
+    }
+
+    sP -= CHANNELS*((STRIDE>>1)-1);
+    __m128i interp = _mm_set1_epi16(static_cast<int16_t>(lerpP));
+    __m256i interp256 = _mm256_set1_epi16(static_cast<int16_t>(lerpP));
+    __m256i accum256 = _mm256_setzero_si256();
+    __m256i accum2256 = _mm256_setzero_si256();
+    for (; count >= 16; count -= 16) {
+        __m256i posCoef = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(coefsP));
+        coefsP += 16;
+        __m256i negCoef = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(coefsN));
+        coefsN += 16;
+        if (!FIXED) { // interpolate, as InterpolateSSE()
+            __m256i posCoef1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(coefsP1));
+            coefsP1 += 16;
+            __m256i negCoef1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(coefsN1));
+            coefsN1 += 16;
+
+            __m256i diff = _mm256_sub_epi16(posCoef1, posCoef);
+            posCoef = _mm256_add_epi16(posCoef, _mm256_or_si256(
+                    _mm256_slli_epi16(_mm256_mulhi_epi16(diff, interp256), 1),
+                    _mm256_srli_epi16(_mm256_mullo_epi16(diff, interp256), 15)));
+            diff = _mm256_sub_epi16(negCoef, negCoef1);
+            negCoef = _mm256_add_epi16(negCoef1, _mm256_or_si256(
+                    _mm256_slli_epi16(_mm256_mulhi_epi16(diff, interp256), 1),
+                    _mm256_srli_epi16(_mm256_mullo_epi16(diff, interp256), 15)));
+        }
+        // The sample shuffles stay within 128 bit lanes, so the coefficients are permuted
+        // by 64 bit (4 coefficient) groups to line up with the samples instead.
+        switch (CHANNELS) {
+        case 1: {
+            const __m256i reverse = _mm256_setr_epi8(
+                    14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1,
+                    14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1);
+            // s-8 ... s-15 | s0 ... s-7
+            __m256i posSamp = _mm256_shuffle_epi8(_mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(sP - 8)), reverse);
+            __m256i negSamp = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sN));
+            sP -= 16;
+            sN += 16;
+            posCoef = _mm256_permute4x64_epi64(posCoef, _MM_SHUFFLE(1, 0, 3, 2));
+
+            // dot product
+            accum256 = _mm256_add_epi32(accum256, _mm256_madd_epi16(posSamp, posCoef));
+            accum256 = _mm256_add_epi32(accum256, _mm256_madd_epi16(negSamp, negCoef));
+        } break;
+        case 2: {
+            const __m256i deinterleave = _mm256_setr_epi8(
+                    0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15,
+                    0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15);
+            const __m256i deinterleaveReverse = _mm256_setr_epi8(
+                    12, 13, 8, 9, 4, 5, 0, 1, 14, 15, 10, 11, 6, 7, 2, 3,
+                    12, 13, 8, 9, 4, 5, 0, 1, 14, 15, 10, 11, 6, 7, 2, 3);
+            __m256i posSamp0 = _mm256_shuffle_epi8(_mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(sP - 16)), deinterleaveReverse);
+            __m256i posSamp1 = _mm256_shuffle_epi8(_mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(sP)), deinterleaveReverse);
+            __m256i negSamp0 = _mm256_shuffle_epi8(_mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(sN)), deinterleave);
+            __m256i negSamp1 = _mm256_shuffle_epi8(_mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(sN + 16)), deinterleave);
+            sP -= 32;
+            sN += 32;
+            // l-4 ... l-7, l-12 ... l-15 | l0 ... l-3, l-8 ... l-11
+            posCoef = _mm256_permute4x64_epi64(posCoef, _MM_SHUFFLE(2, 0, 3, 1));
+            // l0 ... l3, l8 ... l11 | l4 ... l7, l12 ... l15
+            negCoef = _mm256_permute4x64_epi64(negCoef, _MM_SHUFFLE(3, 1, 2, 0));
+
+            // dot product
+            accum256 = _mm256_add_epi32(accum256,
+                    _mm256_madd_epi16(_mm256_unpacklo_epi64(posSamp1, posSamp0), posCoef));
+            accum2256 = _mm256_add_epi32(accum2256,
+                    _mm256_madd_epi16(_mm256_unpackhi_epi64(posSamp1, posSamp0), posCoef));
+            accum256 = _mm256_add_epi32(accum256,
+                    _mm256_madd_epi16(_mm256_unpacklo_epi64(negSamp0, negSamp1), negCoef));
+            accum2256 = _mm256_add_epi32(accum2256,
+                    _mm256_madd_epi16(_mm256_unpackhi_epi64(negSamp0, negSamp1), negCoef));
+        } break;
+        }
+    }
+    __m128i accum = _mm_add_epi32(_mm256_castsi256_si128(accum256),
+            _mm256_extracti128_si256(accum256, 1));
+    __m128i accum2 = _mm_add_epi32(_mm256_castsi256_si128(accum2256),
+            _mm256_extracti128_si256(accum2256, 1));
+    if (count != 0) { // remaining 8 coefficients
+        ProcessSSEStep<CHANNELS, FIXED>(accum, accum2,
+                coefsP, coefsN, sP, sN, interp, coefsP1, coefsN1);
+    }
+
+    ProcessSSEAccumulate<CHANNELS>(out, accum, accum2, volumeLR);
+}
+
+// Interpolates 4 float coefficients as interpolate<float, float>().
+SSE_INLINE __m128 InterpolateSSE(__m128 coef0, __m128 coef1, __m128 lerp)
+{
+    return _mm_add_ps(_mm_mul_ps(lerp, _mm_sub_ps(coef1, coef0)), coef0);
+}
+
+// Accumulates the tap TAP (of 4 taps in coef) for the frame s of 4, 6 or 8 channels,
+// into accum (channels 0 to 3) and accum2 (channels 4 to 7).
+template <int CHANNELS, int TAP>
+SSE_INLINE void MacFrameSSE(__m128& accum, __m128& accum2, __m128 coef, const float* s)
+{
+    const __m128 c = _mm_shuffle_ps(coef, coef, _MM_SHUFFLE(TAP, TAP, TAP, TAP));
+    accum = _mm_add_ps(accum, _mm_mul_ps(_mm_loadu_ps(s), c));
+    switch (CHANNELS) {
+    case 6:
+        accum2 = _mm_add_ps(accum2, _mm_mul_ps(
+                _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(s + 4))), c));
+        break;
+    case 8:
+        accum2 = _mm_add_ps(accum2, _mm_mul_ps(_mm_loadu_ps(s + 4), c));
+        break;
+    }
+}
+
+// As above, for 4, 6 and 8 channels.
+template <int CHANNELS, bool FIXED>
+SSE_INLINE void ProcessSSEMultichannel(float* out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* sP,
+        const float* sN,
+        const float* volumeLR,
+        float lerpP,
+        const float* coefsP1,
+        const float* coefsN1)
+{
+    __m128 interp = _mm_set1_ps(lerpP);
+    // separate accumulators for the positive and negative side shorten the dependency chains.
+    __m128 posAccum = _mm_setzero_ps();
+    __m128 posAccum2 = _mm_setzero_ps();
+    __m128 negAccum = _mm_setzero_ps();
+    __m128 negAccum2 = _mm_setzero_ps();
+    do {
+        for (int i = 0; i < 8; i += 4) {
+            __m128 posCoef = _mm_load_ps(coefsP + i);
+            __m128 negCoef = _mm_load_ps(coefsN + i);
+            if (!FIXED) { // interpolate
+                posCoef = InterpolateSSE(posCoef, _mm_load_ps(coefsP1 + i), interp);
+                negCoef = InterpolateSSE(_mm_load_ps(coefsN1 + i), negCoef, interp);
+            }
+            MacFrameSSE<CHANNELS, 0>(posAccum, posAccum2, posCoef, sP);
+            MacFrameSSE<CHANNELS, 1>(posAccum, posAccum2, posCoef, sP - CHANNELS);
+            MacFrameSSE<CHANNELS, 2>(posAccum, posAccum2, posCoef, sP - 2 * CHANNELS);
+            MacFrameSSE<CHANNELS, 3>(posAccum, posAccum2, posCoef, sP - 3 * CHANNELS);
+            sP -= 4 * CHANNELS;
+            MacFrameSSE<CHANNELS, 0>(negAccum, negAccum2, negCoef, sN);
+            MacFrameSSE<CHANNELS, 1>(negAccum, negAccum2, negCoef, sN + CHANNELS);
+            MacFrameSSE<CHANNELS, 2>(negAccum, negAccum2, negCoef, sN + 2 * CHANNELS);
+            MacFrameSSE<CHANNELS, 3>(negAccum, negAccum2, negCoef, sN + 3 * CHANNELS);
+            sN += 4 * CHANNELS;
+        }
+        coefsP += 8;
+        coefsN += 8;
+        if (!FIXED) {
+            coefsP1 += 8;
+            coefsN1 += 8;
+        }
+    } while (count -= 8);
+
+    // multiply by volume and save; as the generic code, the left volume applies to all channels.
+    const __m128 vol = _mm_set1_ps(volumeLR[0]);
+    __m128 accum = _mm_add_ps(posAccum, negAccum);
+    _mm_storeu_ps(out, _mm_add_ps(_mm_loadu_ps(out), _mm_mul_ps(accum, vol)));
+    __m128 accum2 = _mm_add_ps(posAccum2, negAccum2);
+    switch (CHANNELS) {
+    case 6: {
+        __m128 outSamp = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(out + 4)));
+        outSamp = _mm_add_ps(outSamp, _mm_mul_ps(accum2, vol));
+        _mm_store_sd(reinterpret_cast<double*>(out + 4), _mm_castps_pd(outSamp));
+    } break;
+    case 8:
+        _mm_storeu_ps(out + 4, _mm_add_ps(_mm_loadu_ps(out + 4), _mm_mul_ps(accum2, vol)));
+        break;
+    }
+}
+
+template <int CHANNELS, int STRIDE, bool FIXED>
+static inline void ProcessSSEIntrinsic(float* out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* sP,
+        const float* sN,
+        const float* volumeLR,
+        float lerpP,
+        const float* coefsP1,
+        const float* coefsN1)
+{
+    ALOG_ASSERT(count > 0 && (count & 7) == 0); // multiple of 8
+    if (CHANNELS > 2) {
+        ProcessSSEMultichannel<CHANNELS, FIXED>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+                lerpP, coefsP1, coefsN1);
+        return;
+    }
+
+    sP -= CHANNELS*((STRIDE>>1)-1);
+    __m128 interp = _mm_set1_ps(lerpP);
+    // separate accumulators for the positive and negative side shorten the dependency chains.
+    __m128 accum = _mm_setzero_ps();
+    __m128 accum2 = _mm_setzero_ps();
+    do {
+        __m128 posCoef = _mm_load_ps(coefsP);
+        __m128 posCoef4 = _mm_load_ps(coefsP + 4);
+        coefsP += 8;
+        __m128 negCoef = _mm_load_ps(coefsN);
+        __m128 negCoef4 = _mm_load_ps(coefsN + 4);
+        coefsN += 8;
+        if (!FIXED) { // interpolate
+            __m128 posCoef1 = _mm_load_ps(coefsP1);
+            __m128 posCoef14 = _mm_load_ps(coefsP1 + 4);
+            coefsP1 += 8;
+            __m128 negCoef1 = _mm_load_ps(coefsN1);
+            __m128 negCoef14 = _mm_load_ps(coefsN1 + 4);
+            coefsN1 += 8;
+
+            posCoef = InterpolateSSE(posCoef, posCoef1, interp);
+            posCoef4 = InterpolateSSE(posCoef4, posCoef14, interp);
+            negCoef = InterpolateSSE(negCoef1, negCoef, interp);
+            negCoef4 = InterpolateSSE(negCoef14, negCoef4, interp);
+        }
+        switch (CHANNELS) {
+        case 1: {
+            // positive side samples s-3 ... s0 and s-7 ... s-4 reversed
+            __m128 posSamp = _mm_loadu_ps(sP + 4);
+            __m128 posSamp4 = _mm_loadu_ps(sP);
+            posSamp = _mm_shuffle_ps(posSamp, posSamp, _MM_SHUFFLE(0, 1, 2, 3));
+            posSamp4 = _mm_shuffle_ps(posSamp4, posSamp4, _MM_SHUFFLE(0, 1, 2, 3));
+            sP -= 8;
+
+            // dot product
+            accum = _mm_add_ps(accum, _mm_mul_ps(posSamp, posCoef));
+            accum = _mm_add_ps(accum, _mm_mul_ps(posSamp4, posCoef4));
+            accum2 = _mm_add_ps(accum2, _mm_mul_ps(_mm_loadu_ps(sN), negCoef));
+            accum2 = _mm_add_ps(accum2, _mm_mul_ps(_mm_loadu_ps(sN + 4), negCoef4));
+            sN += 8;
+        } break;
+        case 2: {
+            // the accumulators hold l, r, l, r, so each coefficient is duplicated.
+            // the positive side frames are in reverse order: s-1, s0 is multiplied by c1, c0.
+            accum = _mm_add_ps(accum, _mm_mul_ps(_mm_loadu_ps(sP + 12),
+                    _mm_shuffle_ps(posCoef, posCoef, _MM_SHUFFLE(0, 0, 1, 1))));
+            accum = _mm_add_ps(accum, _mm_mul_ps(_mm_loadu_ps(sP + 8),
+                    _mm_shuffle_ps(posCoef, posCoef, _MM_SHUFFLE(2, 2, 3, 3))));
+            accum = _mm_add_ps(accum, _mm_mul_ps(_mm_loadu_ps(sP + 4),
+                    _mm_shuffle_ps(posCoef4, posCoef4, _MM_SHUFFLE(0, 0, 1, 1))));
+            accum = _mm_add_ps(accum, _mm_mul_ps(_mm_loadu_ps(sP),
+                    _mm_shuffle_ps(posCoef4, posCoef4, _MM_SHUFFLE(2, 2, 3, 3))));
+            sP -= 16;
+            accum2 = _mm_add_ps(accum2, _mm_mul_ps(_mm_loadu_ps(sN),
+                    _mm_unpacklo_ps(negCoef, negCoef)));
+            accum2 = _mm_add_ps(accum2, _mm_mul_ps(_mm_loadu_ps(sN + 4),
+                    _mm_unpackhi_ps(negCoef, negCoef)));
+            accum2 = _mm_add_ps(accum2, _mm_mul_ps(_mm_loadu_ps(sN + 8),
+                    _mm_unpacklo_ps(negCoef4, negCoef4)));
+            accum2 = _mm_add_ps(accum2, _mm_mul_ps(_mm_loadu_ps(sN + 12),
+                    _mm_unpackhi_ps(negCoef4, negCoef4)));
+            sN += 16;
+        } break;
+        }
+    } while (count -= 8);
+
+    // combine and funnel down accumulator
+    accum = _mm_add_ps(accum, accum2);
+    accum = _mm_add_ps(accum, _mm_movehl_ps(accum, accum));
+    if (CHANNELS == 1) {
+        accum = _mm_add_ss(accum, _mm_shuffle_ps(accum, accum, _MM_SHUFFLE(1, 1, 1, 1)));
+        accum = _mm_shuffle_ps(accum, accum, _MM_SHUFFLE(0, 0, 0, 0));
+    }
+    // multiply by volume and save
+    __m128 outSamp = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(out)));
+    __m128 vLR = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(volumeLR)));
+    outSamp = _mm_add_ps(outSamp, _mm_mul_ps(accum, vLR));
+    _mm_store_sd(reinterpret_cast<double*>(out), _mm_castps_pd(outSamp));
+}
+
+template <int CHANNELS, int STRIDE, bool FIXED>
+__attribute__((target("avx2,fma")))
+static void ProcessAVX2Intrinsic(float* out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* sP,
+        const float* sN,
+        const float* volumeLR,
+        float lerpP,
+        const float* coefsP1,
+        const float* coefsN1)
+{
+    ALOG_ASSERT(count > 0 && (count & 7) == 0); // multiple of 8
+    if (CHANNELS > 2) {
+        ProcessSSEMultichannel<CHANNELS, FIXED>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+                lerpP, coefsP1, coefsN1);
+        return;
+    }
+
+    sP -= CHANNELS*((STRIDE>>1)-1);
+    __m256 interp = _mm256_set1_ps(lerpP);
+    __m256 accum = _mm256_setzero_ps();
+    __m256 accum2 = _mm256_setzero_ps();
+    do {
+        __m256 posCoef = _mm256_loadu_ps(coefsP);
+        coefsP += 8;
+        __m256 negCoef = _mm256_loadu_ps(coefsN);
+        coefsN += 8;
+        if (!FIXED) { // interpolate
+            __m256 posCoef1 = _mm256_loadu_ps(coefsP1);
+            coefsP1 += 8;
+            __m256 negCoef1 = _mm256_loadu_ps(coefsN1);
+            coefsN1 += 8;
+
+            posCoef = _mm256_fmadd_ps(interp, _mm256_sub_ps(posCoef1, posCoef), posCoef);
+            negCoef = _mm256_fmadd_ps(interp, _mm256_sub_ps(negCoef, negCoef1), negCoef1);
+        }
+        switch (CHANNELS) {
+        case 1: {
+            const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+            __m256 posSamp = _mm256_permutevar8x32_ps(_mm256_loadu_ps(sP), reverse);
+            sP -= 8;
+
+            // dot product
+            accum = _mm256_fmadd_ps(posSamp, posCoef, accum);
+            accum2 = _mm256_fmadd_ps(_mm256_loadu_ps(sN), negCoef, accum2);
+            sN += 8;
+        } break;
+        case 2: {
+            // the accumulators hold l, r, l, r, l, r, l, r, so each coefficient is duplicated.
+            const __m256i dup0123 = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+            const __m256i dup4567 = _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7);
+            const __m256i dup3210 = _mm256_setr_epi32(3, 3, 2, 2, 1, 1, 0, 0);
+            const __m256i dup7654 = _mm256_setr_epi32(7, 7, 6, 6, 5, 5, 4, 4);
+            accum = _mm256_fmadd_ps(_mm256_loadu_ps(sP + 8),
+                    _mm256_permutevar8x32_ps(posCoef, dup3210), accum);
+            accum = _mm256_fmadd_ps(_mm256_loadu_ps(sP),
+                    _mm256_permutevar8x32_ps(posCoef, dup7654), accum);
+            sP -= 16;
+            accum2 = _mm256_fmadd_ps(_mm256_loadu_ps(sN),
+                    _mm256_permutevar8x32_ps(negCoef, dup0123), accum2);
+            accum2 = _mm256_fmadd_ps(_mm256_loadu_ps(sN + 8),
+                    _mm256_permutevar8x32_ps(negCoef, dup4567), accum2);
+            sN += 16;
+        } break;
+        }
+    } while (count -= 8);
+
+    // combine and funnel down accumulator
+    accum = _mm256_add_ps(accum, accum2);
+    __m128 accum128 = _mm_add_ps(_mm256_castps256_ps128(accum), _mm256_extractf128_ps(accum, 1));
+    accum128 = _mm_add_ps(accum128, _mm_movehl_ps(accum128, accum128));
+    if (CHANNELS == 1) {
+        accum128 = _mm_add_ss(accum128,
+                _mm_shuffle_ps(accum128, accum128, _MM_SHUFFLE(1, 1, 1, 1)));
+        accum128 = _mm_shuffle_ps(accum128, accum128, _MM_SHUFFLE(0, 0, 0, 0));
+    }
+    // multiply by volume and save
+    __m128 outSamp = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(out)));
+    __m128 vLR = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(volumeLR)));
+    outSamp = _mm_fmadd_ps(accum128, vLR, outSamp);
+    _mm_store_sd(reinterpret_cast<double*>(out), _mm_castps_pd(outSamp));
+}
+
+// Selects the AVX2 or the SSSE3 variant. The branch is always predicted;
+// the AVX2 variants cannot be inlined into code compiled for the baseline.
+// Multichannel frames are processed 4 channels at a time, so they do not use AVX2.
+template <int CHANNELS, int STRIDE, bool FIXED, typename TC, typename TI, typename TO,
+        typename TINTERP>
+static inline void ProcessSSE(TO* out,
+        int count,
+        const TC* coefsP,
+        const TC* coefsN,
+        const TI* sP,
+        const TI* sN,
+        const TO* volumeLR,
+        TINTERP lerpP,
+        const TC* coefsP1,
+        const TC* coefsN1)
+{
+    if (CHANNELS <= 2 && kSseUseAvx2) {
+        ProcessAVX2Intrinsic<CHANNELS, STRIDE, FIXED>(out, count, coefsP, coefsN, sP, sN,
+                volumeLR, lerpP, coefsP1, coefsN1);
+    } else {
+        ProcessSSEIntrinsic<CHANNELS, STRIDE, FIXED>(out, count, coefsP, coefsN, sP, sN,
+                volumeLR, lerpP, coefsP1, coefsN1);
+    }
+}
+
+template <>
+inline void ProcessL<1, 16>(int32_t* const out,
+        int count,
+        const int16_t* coefsP,
+        const int16_t* coefsN,
+        const int16_t* sP,
+        const int16_t* sN,
+        const int32_t* const volumeLR)
+{
+    ProcessSSE<1, 16, true>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+            0u /*lerpP*/, (const int16_t*)NULL /*coefsP1*/, (const int16_t*)NULL /*coefsN1*/);
+}
+
+template <>
+inline void ProcessL<2, 16>(int32_t* const out,
+        int count,
+        const int16_t* coefsP,
+        const int16_t* coefsN,
+        const int16_t* sP,
+        const int16_t* sN,
+        const int32_t* const volumeLR)
+{
+    ProcessSSE<2, 16, true>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+            0u /*lerpP*/, (const int16_t*)NULL /*coefsP1*/, (const int16_t*)NULL /*coefsN1*/);
+}
+
+template <>
+inline void Process<1, 16>(int32_t* const out,
+        int count,
+        const int16_t* coefsP,
+        const int16_t* coefsN,
+        const int16_t* coefsP1,
+        const int16_t* coefsN1,
+        const int16_t* sP,
+        const int16_t* sN,
+        uint32_t lerpP,
+        const int32_t* const volumeLR)
+{
+    ProcessSSE<1, 16, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+            lerpP, coefsP1, coefsN1);
+}
+
+template <>
+inline void Process<2, 16>(int32_t* const out,
+        int count,
+        const int16_t* coefsP,
+        const int16_t* coefsN,
+        const int16_t* coefsP1,
+        const int16_t* coefsN1,
+        const int16_t* sP,
+        const int16_t* sN,
+        uint32_t lerpP,
+        const int32_t* const volumeLR)
+{
+    ProcessSSE<2, 16, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+            lerpP, coefsP1, coefsN1);
+}
+
+template <>
+inline void ProcessL<4, 16>(int32_t* const out,
+        int count,
+        const int16_t* coefsP,
+        const int16_t* coefsN,
+        const int16_t* sP,
+        const int16_t* sN,
+        const int32_t* const volumeLR)
+{
+    ProcessSSE<4, 16, true>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+            0u /*lerpP*/, (const int16_t*)NULL /*coefsP1*/, (const int16_t*)NULL /*coefsN1*/);
+}
+
+template <>
+inline void Process<4, 16>(int32_t* const out,
+        int count,
+        const int16_t* coefsP,
+        const int16_t* coefsN,
+        const int16_t* coefsP1,
+        const int16_t* coefsN1,
+        const int16_t* sP,
+        const int16_t* sN,
+        uint32_t lerpP,
+        const int32_t* const volumeLR)
+{
+    ProcessSSE<4, 16, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+            lerpP, coefsP1, coefsN1);
+}
+
+template <>
+inline void ProcessL<6, 16>(int32_t* const out,
+        int count,
+        const int16_t* coefsP,
+        const int16_t* coefsN,
+        const int16_t* sP,
+        const int16_t* sN,
+        const int32_t* const volumeLR)
+{
+    ProcessSSE<6, 16, true>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+            0u /*lerpP*/, (const int16_t*)NULL /*coefsP1*/, (const int16_t*)NULL /*coefsN1*/);
+}
+
+template <>
+inline void Process<6, 16>(int32_t* const out,
+        int count,
+        const int16_t* coefsP,
+        const int16_t* coefsN,
+        const int16_t* coefsP1,
+        const int16_t* coefsN1,
+        const int16_t* sP,
+        const int16_t* sN,
+        uint32_t lerpP,
+        const int32_t* const volumeLR)
+{
+    ProcessSSE<6, 16, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+            lerpP, coefsP1, coefsN1);
+}
+
+template <>
+inline void ProcessL<8, 16>(int32_t* const out,
+        int count,
+        const int16_t* coefsP,
+        const int16_t* coefsN,
+        const int16_t* sP,
+        const int16_t* sN,
+        const int32_t* const volumeLR)
+{
+    ProcessSSE<8, 16, true>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+            0u /*lerpP*/, (const int16_t*)NULL /*coefsP1*/, (const int16_t*)NULL /*coefsN1*/);
+}
+
+template <>
+inline void Process<8, 16>(int32_t* const out,
+        int count,
+        const int16_t* coefsP,
+        const int16_t* coefsN,
+        const int16_t* coefsP1,
+        const int16_t* coefsN1,
+        const int16_t* sP,
+        const int16_t* sN,
+        uint32_t lerpP,
+        const int32_t* const volumeLR)
+{
+    ProcessSSE<8, 16, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+            lerpP, coefsP1, coefsN1);
+}
+
+template<>
+inline void ProcessL<1, 16>(float* const out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* sP,
+        const float* sN,
+        const float* const volumeLR)
+{
+    ProcessSSE<1, 16, true>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+            0.f /*lerpP*/, (const float*)NULL /*coefsP1*/, (const float*)NULL /*coefsN1*/);
+}
+
+template<>
+inline void ProcessL<2, 16>(float* const out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* sP,
+        const float* sN,
+        const float* const volumeLR)
+{
+    ProcessSSE<2, 16, true>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+            0.f /*lerpP*/, (const float*)NULL /*coefsP1*/, (const float*)NULL /*coefsN1*/);
+}
+
+template<>
+inline void Process<1, 16>(float* const out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* coefsP1,
+        const float* coefsN1,
+        const float* sP,
+        const float* sN,
+        float lerpP,
+        const float* const volumeLR)
+{
+    ProcessSSE<1, 16, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+            lerpP, coefsP1, coefsN1);
+}
+
+template<>
+inline void Process<2, 16>(float* const out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* coefsP1,
+        const float* coefsN1,
+        const float* sP,
+        const float* sN,
+        float lerpP,
+        const float* const volumeLR)
+{
+    ProcessSSE<2, 16, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+            lerpP, coefsP1, coefsN1);
+}
+
+template<>
+inline void ProcessL<4, 16>(float* const out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* sP,
+        const float* sN,
+        const float* const volumeLR)
+{
+    ProcessSSE<4, 16, true>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+            0.f /*lerpP*/, (const float*)NULL /*coefsP1*/, (const float*)NULL /*coefsN1*/);
+}
+
+template<>
+inline void Process<4, 16>(float* const out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* coefsP1,
+        const float* coefsN1,
+        const float* sP,
+        const float* sN,
+        float lerpP,
+        const float* const volumeLR)
+{
+    ProcessSSE<4, 16, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+            lerpP, coefsP1, coefsN1);
+}
+
+template<>
+inline void ProcessL<6, 16>(float* const out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* sP,
+        const float* sN,
+        const float* const volumeLR)
+{
+    ProcessSSE<6, 16, true>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+            0.f /*lerpP*/, (const float*)NULL /*coefsP1*/, (const float*)NULL /*coefsN1*/);
+}
+
+template<>
+inline void Process<6, 16>(float* const out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* coefsP1,
+        const float* coefsN1,
+        const float* sP,
+        const float* sN,
+        float lerpP,
+        const float* const volumeLR)
+{
+    ProcessSSE<6, 16, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+            lerpP, coefsP1, coefsN1);
+}
+
+template<>
+inline void ProcessL<8, 16>(float* const out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* sP,
+        const float* sN,
+        const float* const volumeLR)
+{
+    ProcessSSE<8, 16, true>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+            0.f /*lerpP*/, (const float*)NULL /*coefsP1*/, (const float*)NULL /*coefsN1*/);
+}
+
+template<>
+inline void Process<8, 16>(float* const out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* coefsP1,
+        const float* coefsN1,
+        const float* sP,
+        const float* sN,
+        float lerpP,
+        const float* const volumeLR)
+{
+    ProcessSSE<8, 16, false>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+            lerpP, coefsP1, coefsN1);
+}
+
+#undef SSE_INLINE
+
+#endif //USE_SSE
+
+} // namespace android
+
+#endif /*ANDROID_AUDIO_RESAMPLER_FIR_PROCESS_SSE_H*/
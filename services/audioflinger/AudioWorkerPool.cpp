@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "AudioWorkerPool"
+//#define LOG_NDEBUG 0
+
+#include <stdio.h>
+#include <utils/Log.h>
+#include "AudioWorkerPool.h"
+
+namespace android {
+
+AudioWorkerPool::AudioWorkerPool(size_t numWorkers, const char *name, int priority)
+    : mExiting(false), mJob(NULL), mCookie(NULL), mCount(0), mNext(0), mPending(0),
+      mBatches(0), mLateBatches(0), mJobsByCaller(0), mJobs(0), mMaxBatchNs(0)
+{
+    for (size_t i = 0; i < numWorkers; i++) {
+        sp<Worker> worker = new Worker(this);
+        char threadName[32];
+        snprintf(threadName, sizeof(threadName), "%s %zu", name, i);
+        if (worker->run(threadName, priority) != NO_ERROR) {
+            ALOGE("could not start worker %s", threadName);
+            break;
+        }
+        mWorkers.add(worker);
+    }
+}
+
+AudioWorkerPool::~AudioWorkerPool()
+{
+    {
+        Mutex::Autolock _l(mLock);
+        mExiting = true;
+        mWorkCond.broadcast();
+    }
+    for (size_t i = 0; i < mWorkers.size(); i++) {
+        mWorkers[i]->requestExitAndWait();
+    }
+}
+
+bool AudioWorkerPool::run(job_t job, void *cookie, size_t count, nsecs_t deadlineNs)
+{
+    if (count == 0) {
+        return true;
+    }
+    const nsecs_t startNs = systemTime();
+    Mutex::Autolock _l(mLock);
+    mJob = job;
+    mCookie = cookie;
+    mCount = count;
+    mNext = 0;
+    mPending = count;
+    if (count > 1) {
+        mWorkCond.broadcast();
+    }
+    // help out, then wait for the jobs that workers have already started
+    mJobsByCaller += runJobs_l();
+    bool late = false;
+    while (mPending > 0) {
+        nsecs_t remainingNs = startNs + deadlineNs - systemTime();
+        if (late || remainingNs <= 0) {
+            late = true;
+            mDoneCond.wait(mLock);
+        } else {
+            mDoneCond.waitRelative(mLock, remainingNs);
+        }
+    }
+    mJob = NULL;
+    mCookie = NULL;
+    mCount = 0;
+    mNext = 0;
+
+    const nsecs_t batchNs = systemTime() - startNs;
+    if (batchNs > deadlineNs) {
+        late = true;
+    }
+    mBatches++;
+    mJobs += count;
+    if (late) {
+        mLateBatches++;
+    }
+    if (batchNs > mMaxBatchNs) {
+        mMaxBatchNs = batchNs;
+    }
+    return !late;
+}
+
+size_t AudioWorkerPool::runJobs_l()
+{
+    size_t jobs = 0;
+    while (mNext < mCount) {
+        const size_t index = mNext++;
+        const job_t job = mJob;
+        void * const cookie = mCookie;
+        mLock.unlock();
+        job(cookie, index);
+        mLock.lock();
+        jobs++;
+        if (--mPending == 0) {
+            mDoneCond.signal();
+        }
+    }
+    return jobs;
+}
+
+bool AudioWorkerPool::Worker::threadLoop()
+{
+    Mutex::Autolock _l(mPool->mLock);
+    while (!mPool->mExiting && mPool->mNext >= mPool->mCount) {
+        mPool->mWorkCond.wait(mPool->mLock);
+    }
+    if (mPool->mExiting) {
+        return false;
+    }
+    mPool->runJobs_l();
+    return true;
+}
+
+void AudioWorkerPool::dump(int fd, int indent)
+{
+    // copy the statistics so that a slow reader of the dump does not hold up the caller of run()
+    uint32_t batches, lateBatches, jobs, jobsByCaller;
+    nsecs_t maxBatchNs;
+    {
+        Mutex::Autolock _l(mLock);
+        batches = mBatches;
+        lateBatches = mLateBatches;
+        jobs = mJobs;
+        jobsByCaller = mJobsByCaller;
+        maxBatchNs = mMaxBatchNs;
+    }
+    dprintf(fd, "%*sWorkers: %zu, batches: %u (late %u), jobs: %u (run by caller %u), "
+            "max batch: %.3f ms\n", indent, "", mWorkers.size(), batches, lateBatches,
+            jobs, jobsByCaller, maxBatchNs * 1e-6);
+}
+
+}   // namespace android
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A pool of threads that run the independent jobs of a batch concurrently on behalf of a
+// real-time thread, for example the effect chains of several audio sessions.
+// The calling thread runs jobs too, so a batch completes even if no worker is scheduled in time.
+
+#ifndef AUDIO_WORKER_POOL_H
+#define AUDIO_WORKER_POOL_H
+
+#include <utils/RefBase.h>
+#include <utils/Thread.h>
+#include <utils/Timers.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+class AudioWorkerPool : public RefBase {
+
+public:
+    typedef void (*job_t)(void *cookie, size_t index);
+
+    // Starts 'numWorkers' threads named '<name> <n>' at the given priority.
+    AudioWorkerPool(size_t numWorkers, const char *name, int priority);
+    virtual         ~AudioWorkerPool();
+
+    // Runs job(cookie, i) for all 0 <= i < count, and returns once they have all completed.
+    // Jobs start in index order, but may complete in any order.  Only one batch runs at a time.
+    // Returns false if the batch took longer than deadlineNs, which is also counted for dump().
+    // A late batch is never abandoned, as its jobs may still be using the caller's buffers.
+    bool            run(job_t job, void *cookie, size_t count, nsecs_t deadlineNs);
+
+    size_t          numWorkers() const { return mWorkers.size(); }
+
+    void            dump(int fd, int indent);
+
+private:
+    class Worker : public Thread {
+    public:
+        explicit Worker(AudioWorkerPool *pool) : Thread(false /*canCallJava*/), mPool(pool) { }
+    private:
+        virtual bool threadLoop();
+        AudioWorkerPool * const mPool;  // the pool waits for us to exit before it goes away
+    };
+
+    // Runs jobs of the current batch until none is left to start, and returns how many it ran.
+    // Called with mLock held, which is released while a job runs.
+    size_t          runJobs_l();
+
+    Vector< sp<Worker> > mWorkers;
+
+    Mutex           mLock;          // protects all the fields below
+    Condition       mWorkCond;      // signaled when a batch starts or the pool is destroyed
+    Condition       mDoneCond;      // signaled when the last job of a batch completes
+    bool            mExiting;       // whether the workers have been asked to exit
+
+    // current batch
+    job_t           mJob;
+    void*           mCookie;
+    size_t          mCount;         // number of jobs
+    size_t          mNext;          // index of next job to start
+    size_t          mPending;       // number of jobs not yet completed
+
+    // statistics, for dump()
+    uint32_t        mBatches;       // total number of batches
+    uint32_t        mLateBatches;   // batches that exceeded their deadline
+    uint32_t        mJobsByCaller;  // jobs run by the calling thread instead of a worker
+    uint32_t        mJobs;          // total number of jobs
+    nsecs_t         mMaxBatchNs;    // longest batch
+};
+
+}   // namespace android
+
+#endif  // AUDIO_WORKER_POOL_H
@@ -67,6 +67,23 @@
 
 namespace android {
 
+// Adds float samples to float samples.
+static void accumulate_float(float *dst, const float *src, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        dst[i] += src[i];
+    }
+}
+
+// Adds 16 bit samples to float samples.
+static void accumulate_float_from_i16(float *dst, const int16_t *src, size_t count)
+{
+    static const float scale = 1.0f / (1 << 15);
+    for (size_t i = 0; i < count; i++) {
+        dst[i] += src[i] * scale;
+    }
+}
+
 // ----------------------------------------------------------------------------
 //  EffectModule implementation
 // ----------------------------------------------------------------------------
@@ -89,7 +106,9 @@ AudioFlinger::EffectModule::EffectModule(ThreadBase *thread,
       // mMaxDisableWaitCnt is set by configure() and not used before then
       // mDisableWaitCnt is set by process() and updateState() and not used before then
       mSuspended(false),
-      mAudioFlinger(thread->mAudioFlinger)
+      mAudioFlinger(thread->mAudioFlinger),
+      mInBuffer(NULL), mOutBuffer(NULL), mSupportsFloat(false),
+      mConversionBuffer(NULL), mConversionBufferFrames(0)
 {
     ALOGV("Constructor %p pinned %d", this, pinned);
     int lStatus;
@@ -124,6 +143,7 @@ AudioFlinger::EffectModule::~EffectModule()
         ALOGW("EffectModule %p destructor called with unreleased interface", this);
         release_l();
     }
+    delete[] mConversionBuffer;
 }
 
 status_t AudioFlinger::EffectModule::addHandle(EffectHandle *handle)
@@ -249,9 +269,7 @@ bool AudioFlinger::EffectModule::updateState() {
     case STARTING:
         // clear auxiliary effect input buffer for next accumulation
         if ((mDescriptor.flags & EFFECT_FLAG_TYPE_MASK) == EFFECT_FLAG_TYPE_AUXILIARY) {
-            memset(mConfig.inputCfg.buffer.raw,
-                   0,
-                   mConfig.inputCfg.buffer.frameCount*sizeof(int32_t));
+            memset(mInBuffer, 0, mConfig.inputCfg.buffer.frameCount*sizeof(int32_t));
         }
         if (start_l() == NO_ERROR) {
             mState = ACTIVE;
@@ -288,38 +306,51 @@ void AudioFlinger::EffectModule::process()
     Mutex::Autolock _l(mLock);
 
     if (mState == DESTROYED || mEffectInterface == NULL ||
-            mConfig.inputCfg.buffer.raw == NULL ||
-            mConfig.outputCfg.buffer.raw == NULL) {
+            mInBuffer == NULL || mOutBuffer == NULL) {
         return;
     }
 
+    const bool auxType =
+            (mDescriptor.flags & EFFECT_FLAG_TYPE_MASK) == EFFECT_FLAG_TYPE_AUXILIARY;
+    const size_t frameCount = mConfig.inputCfg.buffer.frameCount;
+    const size_t sampleCount = frameCount * FCC_2;  //always stereo here
+    // the effect accumulates onto the chain output <=> input buffer != output buffer,
+    // see configure()
+    const bool accumulate = mInBuffer != mOutBuffer;
+
     if (isProcessEnabled()) {
-        // do 32 bit to 16 bit conversion for auxiliary effect input buffer
-        if ((mDescriptor.flags & EFFECT_FLAG_TYPE_MASK) == EFFECT_FLAG_TYPE_AUXILIARY) {
-            ditherAndClamp(mConfig.inputCfg.buffer.s32,
-                                        mConfig.inputCfg.buffer.s32,
-                                        mConfig.inputCfg.buffer.frameCount/2);
-        }
         int ret;
-        if (isProcessImplemented()) {
+        if (isProcessImplemented() && mSupportsFloat) {
+            if (auxType) {
+                // convert the Q4.27 samples of the auxiliary effect input buffer in place
+                memcpy_to_float_from_q4_27(mInBuffer, reinterpret_cast<int32_t *>(mInBuffer),
+                                           frameCount);
+            }
+            // the engine reads and writes or accumulates the chain buffers directly
+            ret = (*mEffectInterface)->process(mEffectInterface,
+                                                   &mConfig.inputCfg.buffer,
+                                                   &mConfig.outputCfg.buffer);
+        } else if (isProcessImplemented()) {
+            if (auxType) {
+                // do 32 bit to 16 bit conversion for auxiliary effect input buffer
+                ditherAndClamp(reinterpret_cast<int32_t *>(mInBuffer),
+                               reinterpret_cast<int32_t *>(mInBuffer),
+                               frameCount/2);
+            } else {
+                memcpy_to_i16_from_float(mConversionBuffer, mInBuffer, sampleCount);
+            }
             // do the actual processing in the effect engine
             ret = (*mEffectInterface)->process(mEffectInterface,
                                                    &mConfig.inputCfg.buffer,
                                                    &mConfig.outputCfg.buffer);
+            if (accumulate) {
+                accumulate_float_from_i16(mOutBuffer, mConversionBuffer, sampleCount);
+            } else {
+                memcpy_to_float_from_i16(mOutBuffer, mConversionBuffer, sampleCount);
+            }
         } else {
-            if (mConfig.inputCfg.buffer.raw != mConfig.outputCfg.buffer.raw) {
-                size_t frameCnt = mConfig.inputCfg.buffer.frameCount * FCC_2;  //always stereo here
-                int16_t *in = mConfig.inputCfg.buffer.s16;
-                int16_t *out = mConfig.outputCfg.buffer.s16;
-
-                if (mConfig.outputCfg.accessMode == EFFECT_BUFFER_ACCESS_ACCUMULATE) {
-                    for (size_t i = 0; i < frameCnt; i++) {
-                        out[i] = clamp16((int32_t)out[i] + (int32_t)in[i]);
-                    }
-                } else {
-                    memcpy(mConfig.outputCfg.buffer.raw, mConfig.inputCfg.buffer.raw,
-                           frameCnt * sizeof(int16_t));
-                }
+            if (accumulate) {
+                accumulate_float(mOutBuffer, mInBuffer, sampleCount);
             }
             ret = -ENODATA;
         }
@@ -329,22 +360,16 @@ void AudioFlinger::EffectModule::process()
         }
 
         // clear auxiliary effect input buffer for next accumulation
-        if ((mDescriptor.flags & EFFECT_FLAG_TYPE_MASK) == EFFECT_FLAG_TYPE_AUXILIARY) {
-            memset(mConfig.inputCfg.buffer.raw, 0,
-                   mConfig.inputCfg.buffer.frameCount*sizeof(int32_t));
+        if (auxType) {
+            memset(mInBuffer, 0, frameCount*sizeof(int32_t));
         }
     } else if ((mDescriptor.flags & EFFECT_FLAG_TYPE_MASK) == EFFECT_FLAG_TYPE_INSERT &&
-                mConfig.inputCfg.buffer.raw != mConfig.outputCfg.buffer.raw) {
+                accumulate) {
         // If an insert effect is idle and input buffer is different from output buffer,
         // accumulate input onto output
         sp<EffectChain> chain = mChain.promote();
         if (chain != 0 && chain->activeTrackCnt() != 0) {
-            size_t frameCnt = mConfig.inputCfg.buffer.frameCount * FCC_2;  //always stereo here
-            int16_t *in = mConfig.inputCfg.buffer.s16;
-            int16_t *out = mConfig.outputCfg.buffer.s16;
-            for (size_t i = 0; i < frameCnt; i++) {
-                out[i] = clamp16((int32_t)out[i] + (int32_t)in[i]);
-            }
+            accumulate_float(mOutBuffer, mInBuffer, sampleCount);
         }
     }
 }
@@ -393,8 +418,6 @@ status_t AudioFlinger::EffectModule::configure()
         }
     }
 
-    mConfig.inputCfg.format = AUDIO_FORMAT_PCM_16_BIT;
-    mConfig.outputCfg.format = AUDIO_FORMAT_PCM_16_BIT;
     mConfig.inputCfg.samplingRate = thread->sampleRate();
     mConfig.outputCfg.samplingRate = mConfig.inputCfg.samplingRate;
     mConfig.inputCfg.bufferProvider.cookie = NULL;
@@ -404,6 +427,8 @@ status_t AudioFlinger::EffectModule::configure()
     mConfig.outputCfg.bufferProvider.getBuffer = NULL;
     mConfig.outputCfg.bufferProvider.releaseBuffer = NULL;
     mConfig.inputCfg.accessMode = EFFECT_BUFFER_ACCESS_READ;
+    mConfig.inputCfg.buffer.frameCount = thread->frameCount();
+    mConfig.outputCfg.buffer.frameCount = mConfig.inputCfg.buffer.frameCount;
     // Insert effect:
     // - in session AUDIO_SESSION_OUTPUT_MIX or AUDIO_SESSION_OUTPUT_STAGE,
     // always overwrites output buffer: input buffer == output buffer
@@ -413,29 +438,57 @@ status_t AudioFlinger::EffectModule::configure()
     // Auxiliary effect:
     //      accumulates in output buffer: input buffer != output buffer
     // Therefore: accumulate <=> input buffer != output buffer
-    if (mConfig.inputCfg.buffer.raw != mConfig.outputCfg.buffer.raw) {
-        mConfig.outputCfg.accessMode = EFFECT_BUFFER_ACCESS_ACCUMULATE;
+    //
+    // The chain buffers hold float samples. The engine is first offered float: it then
+    // processes the chain buffers directly and accumulates itself. An auxiliary effect input
+    // holds Q4.27 samples that process() converts to float in place.
+    // Engines refusing float are configured for 16 bit: process() converts the chain input
+    // into mConversionBuffer, the engine overwrites it in place and process() converts or
+    // accumulates it back into the chain output. An auxiliary effect then reads its mono
+    // 32 bit input buffer, which it cannot share with its stereo output.
+    mConfig.inputCfg.mask = EFFECT_CONFIG_ALL;
+    mConfig.outputCfg.mask = EFFECT_CONFIG_ALL;
+    mSupportsFloat = false;
+    if (mInBuffer != NULL && mOutBuffer != NULL) {
+        mConfig.inputCfg.format = AUDIO_FORMAT_PCM_FLOAT;
+        mConfig.outputCfg.format = AUDIO_FORMAT_PCM_FLOAT;
+        mConfig.inputCfg.buffer.raw = mInBuffer;
+        mConfig.outputCfg.buffer.raw = mOutBuffer;
+        mConfig.outputCfg.accessMode = mInBuffer != mOutBuffer ?
+                EFFECT_BUFFER_ACCESS_ACCUMULATE : EFFECT_BUFFER_ACCESS_WRITE;
+        mSupportsFloat = sendConfig() == NO_ERROR;
+    }
+    if (mSupportsFloat) {
+        delete[] mConversionBuffer;
+        mConversionBuffer = NULL;
+        mConversionBufferFrames = 0;
+        status = NO_ERROR;
     } else {
+        mConfig.inputCfg.format = AUDIO_FORMAT_PCM_16_BIT;
+        mConfig.outputCfg.format = AUDIO_FORMAT_PCM_16_BIT;
+        if (mInBuffer != NULL && mOutBuffer != NULL) {
+            if (mConversionBufferFrames != mConfig.inputCfg.buffer.frameCount) {
+                delete[] mConversionBuffer;
+                mConversionBufferFrames = mConfig.inputCfg.buffer.frameCount;
+                mConversionBuffer = new int16_t[mConversionBufferFrames * FCC_2];
+            }
+            if ((mDescriptor.flags & EFFECT_FLAG_TYPE_MASK) == EFFECT_FLAG_TYPE_AUXILIARY) {
+                mConfig.inputCfg.buffer.s16 = reinterpret_cast<int16_t *>(mInBuffer);
+            } else {
+                mConfig.inputCfg.buffer.s16 = mConversionBuffer;
+            }
+            mConfig.outputCfg.buffer.s16 = mConversionBuffer;
+        } else {
+            mConfig.inputCfg.buffer.raw = NULL;
+            mConfig.outputCfg.buffer.raw = NULL;
+        }
         mConfig.outputCfg.accessMode = EFFECT_BUFFER_ACCESS_WRITE;
+        status = sendConfig();
     }
-    mConfig.inputCfg.mask = EFFECT_CONFIG_ALL;
-    mConfig.outputCfg.mask = EFFECT_CONFIG_ALL;
-    mConfig.inputCfg.buffer.frameCount = thread->frameCount();
-    mConfig.outputCfg.buffer.frameCount = mConfig.inputCfg.buffer.frameCount;
-
-    ALOGV("configure() %p thread %p buffer %p framecount %zu",
-            this, thread.get(), mConfig.inputCfg.buffer.raw, mConfig.inputCfg.buffer.frameCount);
 
-    size = sizeof(int);
-    status = (*mEffectInterface)->command(mEffectInterface,
-                                                   EFFECT_CMD_SET_CONFIG,
-                                                   sizeof(effect_config_t),
-                                                   &mConfig,
-                                                   &size,
-                                                   &cmdStatus);
-    if (status == 0) {
-        status = cmdStatus;
-    }
+    ALOGV("configure() %p thread %p buffer %p framecount %zu format %#x",
+            this, thread.get(), mConfig.inputCfg.buffer.raw, mConfig.inputCfg.buffer.frameCount,
+            mConfig.inputCfg.format);
 
     if (status == 0 &&
             (memcmp(&mDescriptor.type, SL_IID_VISUALIZATION, sizeof(effect_uuid_t)) == 0)) {
@@ -470,6 +523,22 @@ exit:
     return status;
 }
 
+status_t AudioFlinger::EffectModule::sendConfig()
+{
+    status_t cmdStatus = 0;
+    uint32_t size = sizeof(int);
+    status_t status = (*mEffectInterface)->command(mEffectInterface,
+                                                   EFFECT_CMD_SET_CONFIG,
+                                                   sizeof(effect_config_t),
+                                                   &mConfig,
+                                                   &size,
+                                                   &cmdStatus);
+    if (status == 0) {
+        status = cmdStatus;
+    }
+    return status;
+}
+
 status_t AudioFlinger::EffectModule::init()
 {
     Mutex::Autolock _l(mLock);
@@ -738,6 +807,10 @@ status_t AudioFlinger::EffectModule::setEnabled_l(bool enabled)
                 h->setEnabled(enabled);
             }
         }
+        sp<EffectChain> chain = mChain.promote();
+        if (chain != 0) {
+            chain->invalidateProcessPlan();
+        }
     }
     return NO_ERROR;
 }
@@ -1526,8 +1599,9 @@ void AudioFlinger::EffectHandle::dumpToBuffer(char* buffer, size_t size)
 
 AudioFlinger::EffectChain::EffectChain(ThreadBase *thread,
                                         audio_session_t sessionId)
-    : mThread(thread), mSessionId(sessionId), mActiveTrackCnt(0), mTrackCnt(0), mTailBufferCount(0),
-      mOwnInBuffer(false), mVolumeCtrlIdx(-1), mLeftVolume(UINT_MAX), mRightVolume(UINT_MAX),
+    : mThread(thread), mSessionId(sessionId), mActiveTrackCnt(0), mTrackCnt(0),
+      mProcessPlanDirty(1), mTailBufferCount(0), mOwnInBuffer(false), mOwnOutBuffer(false),
+      mVolumeCtrlIdx(-1), mLeftVolume(UINT_MAX), mRightVolume(UINT_MAX),
       mNewLeftVolume(UINT_MAX), mNewRightVolume(UINT_MAX)
 {
     mStrategy = AudioSystem::getStrategyForStream(AUDIO_STREAM_MUSIC);
@@ -1541,7 +1615,10 @@ AudioFlinger::EffectChain::EffectChain(ThreadBase *thread,
 AudioFlinger::EffectChain::~EffectChain()
 {
     if (mOwnInBuffer) {
-        delete mInBuffer;
+        delete[] mInBuffer;
+    }
+    if (mOwnOutBuffer) {
+        delete[] mOutBuffer;
     }
 }
 
@@ -1601,12 +1678,11 @@ void AudioFlinger::EffectChain::clearInputBuffer()
 // Must be called with EffectChain::mLock locked
 void AudioFlinger::EffectChain::clearInputBuffer_l(sp<ThreadBase> thread)
 {
-    // TODO: This will change in the future, depending on multichannel
-    // and sample format changes for effects.
-    // Currently effects processing is only available for stereo, AUDIO_FORMAT_PCM_16_BIT
-    // (4 bytes frame size)
+    // TODO: This will change in the future, depending on multichannel effects.
+    // Currently effects processing is only available for stereo, AUDIO_FORMAT_PCM_FLOAT
+    // (8 bytes frame size)
     const size_t frameSize =
-            audio_bytes_per_sample(AUDIO_FORMAT_PCM_16_BIT) * min(FCC_2, thread->channelCount());
+            audio_bytes_per_sample(AUDIO_FORMAT_PCM_FLOAT) * min(FCC_2, thread->channelCount());
     memset(mInBuffer, 0, thread->frameCount() * frameSize);
 }
 
@@ -1645,21 +1721,52 @@ void AudioFlinger::EffectChain::process_l()
         }
     }
 
-    size_t size = mEffects.size();
+    if (android_atomic_acquire_cas(1, 0, &mProcessPlanDirty) == 0) {
+        updateProcessPlan_l();
+    }
     if (doProcess) {
-        for (size_t i = 0; i < size; i++) {
-            mEffects[i]->process();
+        for (size_t i = 0; i < mProcessPlan.size(); i++) {
+            mEffects[mProcessPlan[i]]->process();
         }
     }
+    size_t size = mEffects.size();
     bool doResetVolume = false;
     for (size_t i = 0; i < size; i++) {
+        EffectModule::effect_state state = mEffects[i]->state();
         doResetVolume = mEffects[i]->updateState() || doResetVolume;
+        if (mEffects[i]->state() != state) {
+            invalidateProcessPlan();
+        }
     }
     if (doResetVolume) {
         resetVolume_l();
     }
 }
 
+// Must be called with EffectChain::mLock locked
+void AudioFlinger::EffectChain::updateProcessPlan_l()
+{
+    mProcessPlan.clear();
+    for (size_t i = 0; i < mEffects.size(); i++) {
+        const sp<EffectModule>& effect = mEffects[i];
+        switch (effect->state()) {
+        case EffectModule::IDLE:
+            // an idle insert effect that does not process in place must still accumulate
+            // its input onto its output, see EffectModule::process()
+            if ((effect->desc().flags & EFFECT_FLAG_TYPE_MASK) != EFFECT_FLAG_TYPE_INSERT ||
+                    effect->inBuffer() == effect->outBuffer()) {
+                continue;
+            }
+            break;
+        case EffectModule::DESTROYED:
+            continue;
+        default:
+            break;
+        }
+        mProcessPlan.add(i);
+    }
+}
+
 // createEffect_l() must be called with ThreadBase::mLock held
 status_t AudioFlinger::EffectChain::createEffect_l(sp<EffectModule>& effect,
                                                    ThreadBase *thread,
@@ -1711,10 +1818,11 @@ status_t AudioFlinger::EffectChain::addEffect_ll(const sp<EffectModule>& effect)
         size_t numSamples = thread->frameCount();
         int32_t *buffer = new int32_t[numSamples];
         memset(buffer, 0, numSamples * sizeof(int32_t));
-        effect->setInBuffer((int16_t *)buffer);
+        effect->setInBuffer((float *)buffer);
         // auxiliary effects output samples to chain input buffer for further processing
         // by insert effects
         effect->setOutBuffer(mInBuffer);
+        invalidateProcessPlan();
     } else {
         // Insert effects are inserted at the end of mEffects vector as they are processed
         //  after track and auxiliary effects.
@@ -1793,6 +1901,7 @@ status_t AudioFlinger::EffectChain::addEffect_ll(const sp<EffectModule>& effect)
             effect->setOutBuffer(mInBuffer);
         }
         mEffects.insertAt(effect, idx_insert);
+        invalidateProcessPlan();
 
         ALOGV("addEffect_l() effect %p, added in chain %p at rank %zu", effect.get(), this,
                 idx_insert);
@@ -1827,7 +1936,7 @@ size_t AudioFlinger::EffectChain::removeEffect_l(const sp<EffectModule>& effect,
             }
 
             if (type == EFFECT_FLAG_TYPE_AUXILIARY) {
-                delete[] effect->inBuffer();
+                delete[] (int32_t *)effect->inBuffer();
             } else {
                 if (i == size - 1 && i != 0) {
                     mEffects[i - 1]->setOutBuffer(mOutBuffer);
@@ -1835,6 +1944,7 @@ size_t AudioFlinger::EffectChain::removeEffect_l(const sp<EffectModule>& effect,
                 }
             }
             mEffects.removeAt(i);
+            invalidateProcessPlan();
             ALOGV("removeEffect_l() effect %p, removed from chain %p at rank %zu", effect.get(),
                     this, i);
 #ifdef DOLBY_ENABLE
@@ -1975,11 +2085,12 @@ void AudioFlinger::EffectChain::dump(int fd, const Vector<String16>& args)
             result.append("\tCould not lock mutex:\n");
         }
 
-        result.append("\tIn buffer   Out buffer   Active tracks:\n");
-        snprintf(buffer, SIZE, "\t%p  %p   %d\n",
+        result.append("\tIn buffer   Out buffer   Active tracks   Processed effects:\n");
+        snprintf(buffer, SIZE, "\t%p  %p   %13d   %zu\n",
                 mInBuffer,
                 mOutBuffer,
-                mActiveTrackCnt);
+                mActiveTrackCnt,
+                mProcessPlan.size());
         result.append(buffer);
         write(fd, result.string(), result.size());
 
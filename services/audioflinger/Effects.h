@@ -85,10 +85,12 @@ public:
     bool isEnabled() const;
     bool isProcessEnabled() const;
 
-    void        setInBuffer(int16_t *buffer) { mConfig.inputCfg.buffer.s16 = buffer; }
-    int16_t     *inBuffer() { return mConfig.inputCfg.buffer.s16; }
-    void        setOutBuffer(int16_t *buffer) { mConfig.outputCfg.buffer.s16 = buffer; }
-    int16_t     *outBuffer() { return mConfig.outputCfg.buffer.s16; }
+    // Float buffers of the chain, or the 32 bit input buffer of an auxiliary effect.
+    // configure() decides which buffers the engine processes.
+    void        setInBuffer(float *buffer) { mInBuffer = buffer; }
+    float       *inBuffer() const { return mInBuffer; }
+    void        setOutBuffer(float *buffer) { mOutBuffer = buffer; }
+    float       *outBuffer() const { return mOutBuffer; }
     void        setChain(const wp<EffectChain>& chain) { mChain = chain; }
     void        setThread(const wp<ThreadBase>& thread) { mThread = thread; }
     const wp<ThreadBase>& thread() { return mThread; }
@@ -143,6 +145,7 @@ protected:
     status_t start_l();
     status_t stop_l();
     status_t remove_effect_from_hal_l();
+    status_t sendConfig();
 
 mutable Mutex               mLock;      // mutex for process, commands and handles list protection
     wp<ThreadBase>      mThread;    // parent thread
@@ -162,6 +165,13 @@ mutable Mutex               mLock;      // mutex for process, commands and handl
     bool     mSuspended;            // effect is suspended: temporarily disabled by framework
     bool     mOffloaded;            // effect is currently offloaded to the audio DSP
     wp<AudioFlinger>    mAudioFlinger;
+    float               *mInBuffer;     // chain input buffer, or auxiliary input buffer
+    float               *mOutBuffer;    // chain output buffer
+    bool                mSupportsFloat; // engine processes the float chain buffers directly
+    // 16 bit copy of the chain samples for engines without float support, processed in place
+    // by the engine: process() converts it from mInBuffer and back to mOutBuffer
+    int16_t             *mConversionBuffer;
+    size_t              mConversionBufferFrames;
 };
 
 // The EffectHandle class implements the IEffect interface. It provides resources
@@ -300,17 +310,18 @@ public:
     void setMode_l(audio_mode_t mode);
     void setAudioSource_l(audio_source_t source);
 
-    void setInBuffer(int16_t *buffer, bool ownsBuffer = false) {
+    void setInBuffer(float *buffer, bool ownsBuffer = false) {
         mInBuffer = buffer;
         mOwnInBuffer = ownsBuffer;
     }
-    int16_t *inBuffer() const {
+    float *inBuffer() const {
         return mInBuffer;
     }
-    void setOutBuffer(int16_t *buffer) {
+    void setOutBuffer(float *buffer, bool ownsBuffer = false) {
         mOutBuffer = buffer;
+        mOwnOutBuffer = ownsBuffer;
     }
-    int16_t *outBuffer() const {
+    float *outBuffer() const {
         return mOutBuffer;
     }
 
@@ -338,6 +349,10 @@ public:
 
     void clearInputBuffer();
 
+    // Called when an effect of the chain changes state outside of process_l(),
+    // so that the next process_l() recomputes which effects need processing.
+    void invalidateProcessPlan() { android_atomic_release_store(1, &mProcessPlanDirty); }
+
     // At least one non offloadable effect in the chain is enabled
     bool isNonOffloadableEnabled();
 
@@ -387,22 +402,33 @@ protected:
 
     void clearInputBuffer_l(sp<ThreadBase> thread);
 
+    void updateProcessPlan_l();
+
     void setThread(const sp<ThreadBase>& thread);
 
              wp<ThreadBase> mThread;     // parent mixer thread
     mutable  Mutex mLock;        // mutex protecting effect list
              Vector< sp<EffectModule> > mEffects; // list of effect modules
              audio_session_t mSessionId; // audio session ID
-             int16_t *mInBuffer;         // chain input buffer
-             int16_t *mOutBuffer;        // chain output buffer
+             float *mInBuffer;           // chain input buffer
+             float *mOutBuffer;          // chain output buffer
 
     // 'volatile' here means these are accessed with atomic operations instead of mutex
     volatile int32_t mActiveTrackCnt;    // number of active tracks connected
     volatile int32_t mTrackCnt;          // number of tracks connected
 
+             // Indices in mEffects of the effects that process_l() calls process() on.
+             // Idle effects that process in place are left out, as are all idle auxiliary
+             // effects, so a disabled effect costs nothing per buffer.  Recomputed by
+             // updateProcessPlan_l() when mProcessPlanDirty is set by a change to the
+             // effect list or to the state of an effect.
+             Vector<size_t> mProcessPlan;
+    volatile int32_t mProcessPlanDirty;
+
              int32_t mTailBufferCount;   // current effect tail buffer count
              int32_t mMaxTailBuffers;    // maximum effect tail buffers
              bool mOwnInBuffer;          // true if the chain owns its input buffer
+             bool mOwnOutBuffer;         // true if the chain owns its output buffer
              int mVolumeCtrlIdx;         // index of insert effect having control over volume
              uint32_t mLeftVolume;       // previous volume on left channel
              uint32_t mRightVolume;      // previous volume on right channel
@@ -48,6 +48,7 @@ void FastCaptureDumpState::dump(int fd) const
                 FastCaptureState::commandToString(mCommand), mReadSequence, mFramesRead,
                 mReadErrors, mSampleRate, mFrameCount, measuredWarmupMs, mWarmupCycles,
                 periodSec * 1e3);
+    dumpHistograms(fd, 2 /*indent*/);
 }
 
 }   // android
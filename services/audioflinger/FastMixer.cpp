@@ -419,6 +419,8 @@ void FastMixer::onWork()
             // process() is CPU-bound
             mMixer->process();
             mMixerBufferState = MIXED;
+            dumpState->mDirectFrames = mMixer->getDirectFrames();
+            dumpState->mCopiedFrames = mMixer->getCopiedFrames();
         } else if (mMixerBufferState != ZEROED) {
             mMixerBufferState = UNDEFINED;
         }
@@ -73,6 +73,8 @@ struct FastMixerDumpState : FastThreadDumpState {
     uint32_t mSampleRate;
     size_t   mFrameCount;
     uint32_t mTrackMask;        // mask of active tracks
+    int64_t  mDirectFrames;     // track frames mixed straight from the track buffers
+    int64_t  mCopiedFrames;     // track frames mixed from an intermediate conversion buffer
     FastTrackDump   mTracks[FastMixerState::kMaxFastTracks];
 };
 
@@ -63,6 +63,8 @@ FastThread::FastThread(const char *cycleMs, const char *loadUs) : Thread(false /
     /* mMeasuredWarmupTs({0, 0}), */
     mWarmupCycles(0),
     mWarmupConsecutiveInRangeCycles(0),
+    /* mLastUnderrunTs({0, 0}), */
+    mLastUnderrunValid(false),
     // mDummyLogWriter
     mLogWriter(&mDummyLogWriter),
     mTimestampStatus(INVALID_OPERATION),
@@ -79,6 +81,8 @@ FastThread::FastThread(const char *cycleMs, const char *loadUs) : Thread(false /
     mOldTs.tv_nsec = 0;
     mMeasuredWarmupTs.tv_sec = 0;
     mMeasuredWarmupTs.tv_nsec = 0;
+    mLastUnderrunTs.tv_sec = 0;
+    mLastUnderrunTs.tv_nsec = 0;
     strlcpy(mCycleMs, cycleMs, sizeof(mCycleMs));
     strlcpy(mLoadUs, loadUs, sizeof(mLoadUs));
 }
@@ -178,6 +182,7 @@ bool FastThread::threadLoop()
                 mMeasuredWarmupTs.tv_nsec = 0;
                 mWarmupCycles = 0;
                 mWarmupConsecutiveInRangeCycles = 0;
+                mLastUnderrunValid = false;
                 mSleepNs = -1;
                 mColdGen = mCurrent->mColdGen;
 #ifdef FAST_THREAD_STATISTICS
@@ -255,10 +260,16 @@ bool FastThread::threadLoop()
                         mIsWarm = true;
                         mDumpState->mMeasuredWarmupTs = mMeasuredWarmupTs;
                         mDumpState->mWarmupCycles = mWarmupCycles;
+                        const int64_t warmupNs = mMeasuredWarmupTs.tv_sec * 1000000000LL +
+                                mMeasuredWarmupTs.tv_nsec;
+                        const int32_t args[2] = {(int32_t) mWarmupCycles,
+                                warmupNs > INT32_MAX ? INT32_MAX : (int32_t) warmupNs};
+                        mLogWriter->logEvent(NBLog::EVENT_ID_WARMUP, newTs, args, 2);
                     }
                 }
                 mSleepNs = -1;
                 if (mIsWarm) {
+                    mDumpState->mCyclePeriod.sample(sec * 1000000000ULL + nsec);
                     if (sec > 0 || nsec > mUnderrunNs) {
                         ATRACE_NAME("underrun");
                         // FIXME only log occasionally
@@ -266,6 +277,15 @@ bool FastThread::threadLoop()
                                 (int) sec, nsec / 1000000L);
                         mDumpState->mUnderruns++;
                         mIgnoreNextOverrun = true;
+                        const int32_t cycleNs = sec > 0 ? INT32_MAX : (int32_t) nsec;
+                        mLogWriter->logEvent(NBLog::EVENT_ID_UNDERRUN, newTs, &cycleNs, 1);
+                        if (mLastUnderrunValid) {
+                            int64_t gapNs = (newTs.tv_sec - mLastUnderrunTs.tv_sec) * 1000000000LL +
+                                    (newTs.tv_nsec - mLastUnderrunTs.tv_nsec);
+                            mDumpState->mUnderrunGap.sample(gapNs);
+                        }
+                        mLastUnderrunTs = newTs;
+                        mLastUnderrunValid = true;
                     } else if (nsec < mOverrunNs) {
                         if (mIgnoreNextOverrun) {
                             mIgnoreNextOverrun = false;
@@ -274,6 +294,8 @@ bool FastThread::threadLoop()
                             ALOGV("overrun: time since last cycle %d.%03ld sec",
                                     (int) sec, nsec / 1000000L);
                             mDumpState->mOverruns++;
+                            const int32_t cycleNs = nsec;
+                            mLogWriter->logEvent(NBLog::EVENT_ID_OVERRUN, newTs, &cycleNs, 1);
                         }
                         // This forces a minimum cycle time. It:
                         //  - compensates for an audio HAL with jitter due to sample rate conversion
@@ -317,6 +339,7 @@ bool FastThread::threadLoop()
                             if (sec > 0 && sec < 4) {
                                 loadNs += sec * 1000000000;
                             }
+                            mDumpState->mCycleLoad.sample(loadNs);
                         } else {
                             // first time through the loop
                             mOldLoadValid = true;
@@ -81,6 +81,8 @@ protected:
     struct timespec mMeasuredWarmupTs;  // how long did it take for warmup to complete
     uint32_t        mWarmupCycles;  // counter of number of loop cycles during warmup phase
     uint32_t        mWarmupConsecutiveInRangeCycles;    // number of consecutive cycles in range
+    struct timespec mLastUnderrunTs;    // time of the most recent underrun while warm
+    bool            mLastUnderrunValid; // whether mLastUnderrunTs is valid
     NBLog::Writer   mDummyLogWriter;
     NBLog::Writer*  mLogWriter;
     status_t        mTimestampStatus;
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <stdio.h>
 #include "FastThreadDumpState.h"
 
 namespace android {
@@ -28,6 +29,9 @@ FastThreadDumpState::FastThreadDumpState() :
 {
     mMeasuredWarmupTs.tv_sec = 0;
     mMeasuredWarmupTs.tv_nsec = 0;
+    mCyclePeriod.clear();
+    mCycleLoad.clear();
+    mUnderrunGap.clear();
 #ifdef FAST_THREAD_STATISTICS
     increaseSamplingN(1);
 #endif
@@ -37,6 +41,58 @@ FastThreadDumpState::~FastThreadDumpState()
 {
 }
 
+void FastThreadDumpState::dumpHistograms(int fd, int indent) const
+{
+    dprintf(fd, "%*sHistograms since thread start (log2 buckets, upper bounds in us):\n",
+            indent, "");
+    dprintf(fd, "%*s  ", indent, "");
+    mCyclePeriod.dump(fd, "cycle_period");
+    dprintf(fd, "%*s  ", indent, "");
+    mCycleLoad.dump(fd, "cycle_load");
+    dprintf(fd, "%*s  ", indent, "");
+    mUnderrunGap.dump(fd, "underrun_gap");
+}
+
+void FastThreadHistogram::dump(int fd, const char *name) const
+{
+    // take a snapshot, as the buckets may be updated while we are reading them
+    uint32_t buckets[kBuckets];
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < kBuckets; ++i) {
+        buckets[i] = mBuckets[i];
+        total += buckets[i];
+    }
+    dprintf(fd, "%s n=%llu", name, (unsigned long long) total);
+    if (total > 0) {
+        static const struct {
+            const char *mName;
+            uint32_t    mPerMille;
+        } kPercentiles[] = {{"p50", 500}, {"p90", 900}, {"p99", 990}, {"p999", 999}};
+        for (size_t p = 0; p < sizeof(kPercentiles) / sizeof(kPercentiles[0]); ++p) {
+            // smallest bucket where the cumulative count reaches the percentile
+            uint64_t threshold = (total * kPercentiles[p].mPerMille + 999) / 1000;
+            uint64_t cumulative = 0;
+            uint32_t i = 0;
+            for (; i < kBuckets - 1; ++i) {
+                cumulative += buckets[i];
+                if (cumulative >= threshold) {
+                    break;
+                }
+            }
+            dprintf(fd, " %s<=%u", kPercentiles[p].mName, 1u << i);
+        }
+        dprintf(fd, " hist=");
+        const char *separator = "";
+        for (uint32_t i = 0; i < kBuckets; ++i) {
+            if (buckets[i] != 0) {
+                dprintf(fd, "%s%u:%u", separator, 1u << i, buckets[i]);
+                separator = ",";
+            }
+        }
+    }
+    dprintf(fd, "\n");
+}
+
 #ifdef FAST_THREAD_STATISTICS
 void FastThreadDumpState::increaseSamplingN(uint32_t samplingN)
 {
@@ -17,11 +17,36 @@
 #ifndef ANDROID_AUDIO_FAST_THREAD_DUMP_STATE_H
 #define ANDROID_AUDIO_FAST_THREAD_DUMP_STATE_H
 
+#include <string.h>
 #include "Configuration.h"
 #include "FastThreadState.h"
 
 namespace android {
 
+// A log-scale histogram of durations, cheap enough to be updated on every cycle of a fast thread.
+// Bucket 0 counts durations under 1 microsecond, bucket i > 0 counts durations in
+// [2^(i-1), 2^i) microseconds, and the last bucket also counts all longer durations.
+// Like the rest of FastThreadDumpState, it has a single writer and is read without locks.
+struct FastThreadHistogram {
+    static const uint32_t kBuckets = 32;    // last bucket starts at 2^30 us, about 18 minutes
+
+    void    clear() { memset(mBuckets, 0, sizeof(mBuckets)); }
+
+    void    sample(uint64_t ns) {
+        uint64_t us = ns / 1000;
+        uint32_t i = us == 0 ? 0 : 64 - __builtin_clzll(us);
+        mBuckets[i < kBuckets ? i : kBuckets - 1]++;
+    }
+
+    // Dumps a single line of the form
+    //   "<name> n=<count> p50<=<us> p90<=<us> p99<=<us> p999<=<us> hist=<us>:<count>,..."
+    // where each percentile is the upper bound of the bucket that contains it,
+    // and only the non-empty buckets are listed by their upper bound in microseconds.
+    void    dump(int fd, const char *name) const;
+
+    uint32_t mBuckets[kBuckets];
+};
+
 // The FastThreadDumpState keeps a cache of FastThread statistics that can be logged by dumpsys.
 // Each individual native word-sized field is accessed atomically.  But the
 // overall structure is non-atomic, that is there may be an inconsistency between fields.
@@ -38,6 +63,15 @@ struct FastThreadDumpState {
     struct timespec mMeasuredWarmupTs;  // measured warmup time
     uint32_t mWarmupCycles;     // number of loop cycles required to warmup
 
+    // Histograms collected while warm, retained for the lifetime of the thread.
+    // These are always enabled, unlike the sample arrays below.
+    FastThreadHistogram mCyclePeriod;   // wall clock time between cycles
+    FastThreadHistogram mCycleLoad;     // thread CPU time per cycle, if FAST_THREAD_STATISTICS
+    FastThreadHistogram mUnderrunGap;   // wall clock time between consecutive underruns
+
+    // Dumps the histograms above in machine-parseable form, with the given line indent
+    void    dumpHistograms(int fd, int indent) const;
+
 #ifdef FAST_THREAD_STATISTICS
     // Recently collected samples of per-cycle monotonic time, thread CPU time, and CPU frequency.
     // kSamplingN is max size of sampling frame (statistics), and must be a power of 2 <= 0x8000.
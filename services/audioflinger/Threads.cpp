@@ -1794,7 +1794,7 @@ AudioFlinger::PlaybackThread::PlaybackThread(const sp<AudioFlinger>& audioFlinge
         mMixerBufferSize(0),
         mMixerBufferFormat(AUDIO_FORMAT_INVALID),
         mMixerBufferValid(false),
-        mEffectBufferEnabled(AudioFlinger::kEnableExtendedPrecision),
+        mEffectBufferEnabled(true), // effect chains process float samples in mEffectBuffer
         mEffectBuffer(NULL),
         mEffectBufferSize(0),
         mEffectBufferFormat(AUDIO_FORMAT_INVALID),
@@ -1950,6 +1950,10 @@ void AudioFlinger::PlaybackThread::dumpInternals(int fd, const Vector<String16>&
     dprintf(fd, "  Effect buffer: %p\n", mEffectBuffer);
     dprintf(fd, "  Fast track availMask=%#x\n", mFastTrackAvailMask);
     dprintf(fd, "  Standby delay ns=%lld\n", (long long)mStandbyDelayNs);
+    if (mEffectChainPool != 0) {
+        dprintf(fd, "  Effect chain pool:\n");
+        mEffectChainPool->dump(fd, 4 /*indent*/);
+    }
     AudioStreamOut *output = mOutput;
     audio_output_flags_t flags = output != NULL ? output->flags : AUDIO_OUTPUT_FLAG_NONE;
     String8 flagsAsString = outputFlagsToString(flags);
@@ -2622,7 +2626,7 @@ void AudioFlinger::PlaybackThread::readOutputParameters_l()
     free(mEffectBuffer);
     mEffectBuffer = NULL;
     if (mEffectBufferEnabled) {
-        mEffectBufferFormat = AUDIO_FORMAT_PCM_16_BIT; // Note: Effects support 16b only
+        mEffectBufferFormat = AUDIO_FORMAT_PCM_FLOAT; // Note: effect chains support float only
         mEffectBufferSize = mNormalFrameCount * mChannelCount
                 * audio_bytes_per_sample(mEffectBufferFormat);
         (void)posix_memalign(&mEffectBuffer, 32, mEffectBufferSize);
@@ -2960,8 +2964,7 @@ void AudioFlinger::PlaybackThread::invalidateTracks(audio_stream_type_t streamTy
 status_t AudioFlinger::PlaybackThread::addEffectChain_l(const sp<EffectChain>& chain)
 {
     audio_session_t session = chain->sessionId();
-    int16_t* buffer = reinterpret_cast<int16_t*>(mEffectBufferEnabled
-            ? mEffectBuffer : mSinkBuffer);
+    float *buffer = reinterpret_cast<float *>(mEffectBuffer);
     bool ownsBuffer = false;
 
     ALOGV("addEffectChain_l() %p on thread %p for session %d", chain.get(), this, session);
@@ -2970,8 +2973,8 @@ status_t AudioFlinger::PlaybackThread::addEffectChain_l(const sp<EffectChain>& c
         // the sink buffer as input
         if (mType != DIRECT) {
             size_t numSamples = mNormalFrameCount * mChannelCount;
-            buffer = new int16_t[numSamples];
-            memset(buffer, 0, numSamples * sizeof(int16_t));
+            buffer = new float[numSamples];
+            memset(buffer, 0, numSamples * sizeof(float));
             ALOGV("addEffectChain_l() creating new input buffer %p session %d", buffer, session);
             ownsBuffer = true;
         }
@@ -3001,8 +3004,15 @@ status_t AudioFlinger::PlaybackThread::addEffectChain_l(const sp<EffectChain>& c
     }
     chain->setThread(this);
     chain->setInBuffer(buffer, ownsBuffer);
-    chain->setOutBuffer(reinterpret_cast<int16_t*>(mEffectBufferEnabled
-            ? mEffectBuffer : mSinkBuffer));
+    if (mEffectChainPool != 0 && session > AUDIO_SESSION_OUTPUT_MIX && mType != DIRECT) {
+        // see processEffectChains()
+        size_t numSamples = mNormalFrameCount * mChannelCount;
+        float *outBuffer = new float[numSamples];
+        memset(outBuffer, 0, numSamples * sizeof(float));
+        chain->setOutBuffer(outBuffer, true /*ownsBuffer*/);
+    } else {
+        chain->setOutBuffer(reinterpret_cast<float *>(mEffectBuffer));
+    }
     // Effect chain for session AUDIO_SESSION_OUTPUT_STAGE is inserted at end of effect
     // chains list in order to be processed last as it contains output stage effects.
     // Effect chain for session AUDIO_SESSION_OUTPUT_MIX is inserted before
@@ -3029,6 +3039,52 @@ status_t AudioFlinger::PlaybackThread::addEffectChain_l(const sp<EffectChain>& c
     return NO_ERROR;
 }
 
+/*static*/
+void AudioFlinger::PlaybackThread::processEffectChainJob(void *cookie, size_t index)
+{
+    const EffectChainJobs *jobs = (const EffectChainJobs *) cookie;
+    const sp<EffectChain>& chain = (*jobs->mEffectChains)[index];
+    // the last effect of the chain accumulates into the output buffer
+    memset(chain->outBuffer(), 0, jobs->mNumSamples * sizeof(float));
+    chain->process_l();
+}
+
+void AudioFlinger::PlaybackThread::processEffectChains(
+        const Vector< sp<EffectChain> >& effectChains)
+{
+    size_t i = 0;
+    if (mEffectChainPool != 0) {
+        // Session chains are first in the list, see addEffectChain_l().  Those with a private
+        // output buffer only share the thread with each other, so they can run concurrently.
+        // The global session chains then run in order on the summed output, as before.
+        float *mixBuffer = reinterpret_cast<float *>(mEffectBuffer);
+        size_t numChains = 0;
+        while (numChains < effectChains.size() &&
+                effectChains[numChains]->sessionId() > AUDIO_SESSION_OUTPUT_MIX &&
+                effectChains[numChains]->outBuffer() != mixBuffer) {
+            numChains++;
+        }
+        if (numChains > 0) {
+            EffectChainJobs jobs;
+            jobs.mEffectChains = &effectChains;
+            jobs.mNumSamples = mNormalFrameCount * mChannelCount;
+            // leave the other half of the period for global effects and the write
+            const nsecs_t deadlineNs = (nsecs_t) mNormalFrameCount * 1000000000 / mSampleRate / 2;
+            // a late batch is counted by the pool and shown by dumpsys
+            (void) mEffectChainPool->run(processEffectChainJob, &jobs, numChains, deadlineNs);
+            for (i = 0; i < numChains; i++) {
+                const float *in = effectChains[i]->outBuffer();
+                for (size_t j = 0; j < jobs.mNumSamples; j++) {
+                    mixBuffer[j] += in[j];
+                }
+            }
+        }
+    }
+    for (; i < effectChains.size(); i++) {
+        effectChains[i]->process_l();
+    }
+}
+
 size_t AudioFlinger::PlaybackThread::removeEffectChain_l(const sp<EffectChain>& chain)
 {
     audio_session_t session = chain->sessionId();
@@ -3055,7 +3111,7 @@ size_t AudioFlinger::PlaybackThread::removeEffectChain_l(const sp<EffectChain>&
             for (size_t i = 0; i < mTracks.size(); ++i) {
                 sp<Track> track = mTracks[i];
                 if (session == track->sessionId()) {
-                    track->setMainBuffer(reinterpret_cast<int16_t*>(mSinkBuffer));
+                    track->setMainBuffer(mSinkBuffer);
                     chain->decTrackCnt();
                 }
             }
@@ -3357,8 +3413,8 @@ bool AudioFlinger::PlaybackThread::threadLoop()
             // Merge mMixerBuffer data into mEffectBuffer (if any effects are valid)
             // or mSinkBuffer (if there are no effects).
             //
-            // This is done pre-effects computation; if effects change to
-            // support higher precision, this needs to move.
+            // This is done pre-effects computation; mMixerBuffer and mEffectBuffer are
+            // both float, so merging into mEffectBuffer is a plain copy.
             //
             // mMixerBufferValid is only set true by MixerThread::prepareTracks_l().
             // TODO use mSleepTimeUs == 0 as an additional condition.
@@ -3391,9 +3447,7 @@ bool AudioFlinger::PlaybackThread::threadLoop()
             // only process effects if we're going to write
             if (mSleepTimeUs == 0 && mType != OFFLOAD &&
                 !(mType == DIRECT && mIsDirectPcm)) {
-                for (size_t i = 0; i < effectChains.size(); i ++) {
-                    effectChains[i]->process_l();
-                }
+                processEffectChains(effectChains);
             }
         }
         // Process effect chains for offloaded thread even if no audio
@@ -3793,6 +3847,12 @@ AudioFlinger::MixerThread::MixerThread(const sp<AudioFlinger>& audioFlinger, Aud
             mNormalFrameCount);
     mAudioMixer = new AudioMixer(mNormalFrameCount, mSampleRate);
 
+    int32_t effectChainWorkers = property_get_int32("af.fx.chain_workers", 0);
+    if (type == MIXER && effectChainWorkers > 0) {
+        mEffectChainPool = new AudioWorkerPool(min(effectChainWorkers, kMaxEffectChainWorkers),
+                "AudioFxWorker", ANDROID_PRIORITY_URGENT_AUDIO);
+    }
+
     if (type == DUPLICATING) {
         // The Duplicating thread uses the AudioMixer and delivers data to OutputTracks
         // (downstream MixerThreads) in DuplicatingThread::threadLoop_write().
@@ -4596,8 +4656,8 @@ AudioFlinger::PlaybackThread::mixer_state AudioFlinger::MixerThread::prepareTrac
             /*
              * Select the appropriate output buffer for the track.
              *
-             * Tracks with effects go into their own effects chain buffer
-             * and from there into either mEffectBuffer or mSinkBuffer.
+             * Tracks with effects go into their own float effects chain buffer
+             * and from there into mEffectBuffer.
              *
              * Other tracks can use mMixerBuffer for higher precision
              * channel accumulation.  If this buffer is enabled
@@ -4619,14 +4679,17 @@ AudioFlinger::PlaybackThread::mixer_state AudioFlinger::MixerThread::prepareTrac
                 // TODO: override track->mainBuffer()?
                 mMixerBufferValid = true;
             } else {
+                // effect chain buffers hold float samples, see addEffectChain_l()
+                const audio_format_t mixerFormat = track->mainBuffer() != mSinkBuffer
+                        ? AUDIO_FORMAT_PCM_FLOAT : AUDIO_FORMAT_PCM_16_BIT;
                 mAudioMixer->setParameter(
                         name,
                         AudioMixer::TRACK,
-                        AudioMixer::MIXER_FORMAT, (void *)AUDIO_FORMAT_PCM_16_BIT);
+                        AudioMixer::MIXER_FORMAT, (void *)mixerFormat);
                 mAudioMixer->setParameter(
                         name,
                         AudioMixer::TRACK,
-                        AudioMixer::MAIN_BUFFER, (void *)track->mainBuffer());
+                        AudioMixer::MAIN_BUFFER, track->mainBuffer());
             }
             mAudioMixer->setParameter(
                 name,
@@ -4944,6 +5007,8 @@ void AudioFlinger::MixerThread::dumpInternals(int fd, const Vector<String16>& ar
     PlaybackThread::dumpInternals(fd, args);
     dprintf(fd, "  Thread throttle time (msecs): %u\n", mThreadThrottleTimeMs);
     dprintf(fd, "  AudioMixer tracks: 0x%08x\n", mAudioMixer->trackNames());
+    dprintf(fd, "  AudioMixer track frames: direct %lld, copied %lld\n",
+            (long long)mAudioMixer->getDirectFrames(), (long long)mAudioMixer->getCopiedFrames());
     dprintf(fd, "  Master mono: %s\n", mMasterMono ? "on" : "off");
 
     // Make a non-atomic copy of fast mixer dump state so it won't change underneath us
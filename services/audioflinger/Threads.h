@@ -531,6 +531,9 @@ public:
     // 14 tracks max per client allows for 2 misbehaving application leaving 4 available tracks.
     static const uint32_t kMaxTracksPerUid = 14;
 
+    // Maximum number of threads in the pool that processes session effect chains concurrently
+    static const int32_t kMaxEffectChainWorkers = 4;
+
     PlaybackThread(const sp<AudioFlinger>& audioFlinger, AudioStreamOut* output,
                    audio_io_handle_t id, audio_devices_t device, type_t type, bool systemReady);
     virtual             ~PlaybackThread();
@@ -718,7 +721,7 @@ protected:
     // it is required to accumulate in a different buffer before data conversion
     // to the sink buffer.
 
-    // Set to "true" to enable the Effects Buffer otherwise effects output goes to sink buffer.
+    // Always "true": effect chains process float samples in the Effects Buffer.
     bool                            mEffectBufferEnabled;
 
     // Storage, 32 byte aligned (may make this alignment a requirement later).
@@ -728,7 +731,7 @@ protected:
     // Size of mEffectsBuffer in bytes: mNormalFrameCount * #channels * sampsize.
     size_t                          mEffectBufferSize;
 
-    // The audio format of mEffectsBuffer. Set to AUDIO_FORMAT_PCM_16_BIT only.
+    // The audio format of mEffectsBuffer. Set to AUDIO_FORMAT_PCM_FLOAT only.
     audio_format_t                  mEffectBufferFormat;
 
     // An internal flag set to true by MixerThread::prepareTracks_l()
@@ -748,6 +751,22 @@ protected:
     int64_t                         mBytesWritten;
     int64_t                         mFramesWritten; // not reset on standby
     int64_t                         mSuspendedFrames; // not reset on standby
+
+    // Optional pool of threads that process the effect chains of audio sessions concurrently,
+    // only created for MIXER threads when property af.fx.chain_workers is > 0.
+    // Each session chain then writes to a private output buffer, and the buffers are summed
+    // into the effect or sink buffer in chain order, so the result does not depend on timing.
+    sp<AudioWorkerPool>             mEffectChainPool;
+
+                // Called by threadLoop() with the effect chains locked.
+                void        processEffectChains(const Vector< sp<EffectChain> >& effectChains);
+
+    // arguments of processEffectChainJob(), which runs one session effect chain
+    struct EffectChainJobs {
+        const Vector< sp<EffectChain> > *mEffectChains;
+        size_t                          mNumSamples;    // size of each private output buffer
+    };
+    static      void        processEffectChainJob(void *cookie, size_t index);
 private:
     // mMasterMute is in both PlaybackThread and in AudioFlinger.  When a
     // PlaybackThread needs to find out if master-muted, it checks it's local
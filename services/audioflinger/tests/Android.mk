@@ -27,6 +27,157 @@ LOCAL_CFLAGS := -Werror -Wall
 
 include $(BUILD_NATIVE_TEST)
 
+#
+# effect chain unit test
+#
+# Built from the audioflinger sources: libaudioflinger hides its symbols.
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+	effect_chain_tests.cpp \
+	../AudioFlinger.cpp \
+	../Threads.cpp \
+	../Tracks.cpp \
+	../AudioHwDevice.cpp \
+	../AudioStreamOut.cpp \
+	../SpdifStreamOut.cpp \
+	../Effects.cpp \
+	../AudioMixer.cpp.arm \
+	../BufferProviders.cpp \
+	../PatchPanel.cpp \
+	../StateQueue.cpp \
+	../AudioWatchdog.cpp \
+	../AudioWorkerPool.cpp \
+	../FastCapture.cpp \
+	../FastCaptureDumpState.cpp \
+	../FastCaptureState.cpp \
+	../FastMixer.cpp \
+	../FastMixerDumpState.cpp \
+	../FastMixerState.cpp \
+	../FastThread.cpp \
+	../FastThreadDumpState.cpp \
+	../FastThreadState.cpp
+
+LOCAL_C_INCLUDES := \
+	$(TOPDIR)frameworks/av/services/audiopolicy \
+	$(TOPDIR)external/sonic \
+	libcore/include \
+	$(call include-path-for, audio-effects) \
+	$(call include-path-for, audio-utils) \
+	frameworks/av/services/audioflinger
+
+LOCAL_SHARED_LIBRARIES := \
+	libaudioresampler \
+	libaudiospdif \
+	libaudioutils \
+	libcutils \
+	libutils \
+	liblog \
+	libbinder \
+	libmedia \
+	libmediautils \
+	libnbaio \
+	libhardware \
+	libhardware_legacy \
+	libeffects \
+	libpowermanager \
+	libserviceutility \
+	libsonic \
+	libmemunreachable
+
+LOCAL_STATIC_LIBRARIES := \
+	libcpustats \
+	libmedia_helper
+
+LOCAL_CFLAGS := -DSTATE_QUEUE_INSTANTIATIONS='"StateQueueInstantiations.cpp"'
+
+#QTI Resampler
+ifeq ($(call is-vendor-board-platform,QCOM), true)
+ifeq ($(strip $(AUDIO_FEATURE_ENABLED_EXTN_RESAMPLER)), true)
+LOCAL_CFLAGS += -DQTI_RESAMPLER
+endif
+endif
+#QTI Resampler
+
+ifeq ($(strip $(BOARD_USES_SRS_TRUEMEDIA)),true)
+LOCAL_SHARED_LIBRARIES += libsrsprocessing
+LOCAL_CFLAGS += -DSRS_PROCESSING
+LOCAL_C_INCLUDES += $(TARGET_OUT_HEADERS)/mm-audio/audio-effects
+endif
+
+# DOLBY_START
+ifeq ($(strip $(DOLBY_ENABLE)),true)
+    LOCAL_CFLAGS += $(dolby_cflags)
+endif
+# DOLBY_END
+
+LOCAL_CFLAGS += -Werror -Wall
+
+LOCAL_MULTILIB := $(AUDIOSERVER_MULTILIB)
+
+LOCAL_MODULE := effect_chain_tests
+LOCAL_MODULE_TAGS := tests
+
+include $(BUILD_NATIVE_TEST)
+
+#
+# audio worker pool unit test
+#
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+	worker_pool_tests.cpp \
+	../AudioWorkerPool.cpp
+
+LOCAL_C_INCLUDES := \
+	frameworks/av/services/audioflinger
+
+LOCAL_SHARED_LIBRARIES := \
+	libcutils \
+	libutils \
+	liblog
+
+LOCAL_MODULE := worker_pool_tests
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_CFLAGS := -Werror -Wall
+
+include $(BUILD_NATIVE_TEST)
+
+#
+# audio mixer unit test
+#
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+	mixer_tests.cpp \
+	../AudioMixer.cpp.arm \
+	../BufferProviders.cpp
+
+LOCAL_C_INCLUDES := \
+	$(call include-path-for, audio-effects) \
+	$(call include-path-for, audio-utils) \
+	frameworks/av/services/audioflinger \
+	external/sonic
+
+LOCAL_SHARED_LIBRARIES := \
+	libeffects \
+	libnbaio \
+	libaudioresampler \
+	libaudioutils \
+	libdl \
+	libcutils \
+	libutils \
+	liblog \
+	libsonic
+
+LOCAL_MODULE := mixer_tests
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_CFLAGS := -Werror -Wall
+
+include $(BUILD_NATIVE_TEST)
+
 #
 # audio mixer test tool
 #
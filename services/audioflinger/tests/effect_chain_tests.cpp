@@ -0,0 +1,490 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "effect_chain_tests"
+
+#include <stdio.h>
+#include <time.h>
+
+#include <gtest/gtest.h>
+#include <audio_utils/primitives.h>
+#include <utils/Log.h>
+
+#include "AudioFlinger.h"
+
+namespace android {
+
+static const uint32_t kSampleRate = 48000;
+static const size_t kFrameCount = 960;     // 20 ms
+static const size_t kSampleCount = kFrameCount * FCC_2;
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// An effect engine halving 16 bit samples, or float samples when it supports float.
+// Auxiliary engines read mono samples.
+struct FakeEffect {
+    const struct effect_interface_s *mItfe;     // must be first, see effect_handle_t
+    effect_config_t mConfig;
+    bool mSupportsFloat;
+    bool mEnabled;
+    size_t mProcessCount;
+};
+
+static int fakeEffectProcess(effect_handle_t self, audio_buffer_t *in, audio_buffer_t *out)
+{
+    FakeEffect *effect = (FakeEffect *) self;
+    const bool mono = effect->mConfig.inputCfg.channels == AUDIO_CHANNEL_OUT_MONO;
+    const bool accumulate =
+            effect->mConfig.outputCfg.accessMode == EFFECT_BUFFER_ACCESS_ACCUMULATE;
+    if (effect->mConfig.inputCfg.format == AUDIO_FORMAT_PCM_FLOAT) {
+        const float *inFloat = (const float *) in->raw;
+        float *outFloat = (float *) out->raw;
+        for (size_t i = 0; i < out->frameCount * FCC_2; i++) {
+            const float sample = (mono ? inFloat[i / 2] : inFloat[i]) / 2;
+            outFloat[i] = accumulate ? outFloat[i] + sample : sample;
+        }
+    } else {
+        for (size_t i = 0; i < out->frameCount * FCC_2; i++) {
+            const int32_t sample = (mono ? in->s16[i / 2] : in->s16[i]) / 2;
+            out->s16[i] = accumulate ? clamp16(out->s16[i] + sample) : sample;
+        }
+    }
+    effect->mProcessCount++;
+    // a disabled engine has completed its turn off sequence
+    return effect->mEnabled ? 0 : -ENODATA;
+}
+
+static int fakeEffectCommand(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
+        void *pCmdData, uint32_t *replySize, void *pReplyData)
+{
+    FakeEffect *effect = (FakeEffect *) self;
+    int status = 0;
+    if (cmdCode == EFFECT_CMD_ENABLE || cmdCode == EFFECT_CMD_DISABLE) {
+        effect->mEnabled = cmdCode == EFFECT_CMD_ENABLE;
+    } else if (cmdCode == EFFECT_CMD_SET_CONFIG) {
+        const effect_config_t *config = (const effect_config_t *) pCmdData;
+        const audio_format_t format = (audio_format_t) config->inputCfg.format;
+        if (cmdSize != sizeof(effect_config_t) ||
+                config->outputCfg.format != format ||
+                (format != AUDIO_FORMAT_PCM_16_BIT &&
+                        !(format == AUDIO_FORMAT_PCM_FLOAT && effect->mSupportsFloat))) {
+            status = -EINVAL;
+        } else {
+            effect->mConfig = *config;
+        }
+    }
+    if (replySize != NULL && *replySize >= sizeof(int) && pReplyData != NULL) {
+        *(int *) pReplyData = status;
+    }
+    return 0;
+}
+
+static int fakeEffectGetDescriptor(effect_handle_t self __unused,
+        effect_descriptor_t *pDescriptor __unused)
+{
+    return -EINVAL;
+}
+
+static const struct effect_interface_s sFakeEffectInterface = {
+    fakeEffectProcess,
+    fakeEffectCommand,
+    fakeEffectGetDescriptor,
+    NULL
+};
+
+class EffectChainTest : public ::testing::Test {
+protected:
+    typedef AudioFlinger::EffectChain EffectChain;
+    typedef AudioFlinger::EffectModule EffectModule;
+
+    // A mixer thread that never runs: it only gives its parameters to the chains.
+    class FakeThread : public AudioFlinger::ThreadBase {
+    public:
+        FakeThread()
+            : ThreadBase(0 /*audioFlinger*/, 1 /*id*/, AUDIO_DEVICE_OUT_SPEAKER,
+                         AUDIO_DEVICE_NONE, MIXER, false /*systemReady*/) {
+            mSampleRate = kSampleRate;
+            mChannelMask = AUDIO_CHANNEL_OUT_STEREO;
+            mChannelCount = FCC_2;
+            mFrameCount = kFrameCount;
+        }
+        virtual status_t initCheck() const { return NO_ERROR; }
+        virtual size_t frameCount() const { return kFrameCount; }
+        virtual bool checkForNewParameter_l(const String8& keyValuePair __unused,
+                                            status_t& status __unused) { return false; }
+        virtual String8 getParameters(const String8& keys __unused) { return String8(); }
+        virtual void ioConfigChanged(audio_io_config_event event __unused,
+                                     pid_t pid __unused) {}
+        virtual void cacheParameters_l() {}
+        virtual status_t createAudioPatch_l(const struct audio_patch *patch __unused,
+                                            audio_patch_handle_t *handle __unused) {
+            return INVALID_OPERATION;
+        }
+        virtual status_t releaseAudioPatch_l(const audio_patch_handle_t handle __unused) {
+            return INVALID_OPERATION;
+        }
+        virtual void getAudioPortConfig(struct audio_port_config *config __unused) {}
+        virtual audio_stream_t* stream() const { return NULL; }
+        virtual status_t addEffectChain_l(const sp<EffectChain>& chain __unused) {
+            return NO_ERROR;
+        }
+        virtual size_t removeEffectChain_l(const sp<EffectChain>& chain __unused) {
+            return 0;
+        }
+        virtual uint32_t hasAudioSession_l(audio_session_t sessionId __unused) const {
+            return 0;
+        }
+        virtual status_t setSyncEvent(const sp<AudioFlinger::SyncEvent>& event __unused) {
+            return INVALID_OPERATION;
+        }
+        virtual bool isValidSyncEvent(const sp<AudioFlinger::SyncEvent>& event __unused) const {
+            return false;
+        }
+        virtual status_t checkEffectCompatibility_l(const effect_descriptor_t *desc __unused,
+                                                    audio_session_t sessionId __unused) {
+            return NO_ERROR;
+        }
+    private:
+        virtual bool threadLoop() { return false; }
+    };
+
+    // A module running a FakeEffect: EffectCreate() does not know its uuid.
+    class FakeEffectModule : public EffectModule {
+    public:
+        FakeEffectModule(AudioFlinger::ThreadBase *thread, const sp<EffectChain>& chain,
+                         effect_descriptor_t *desc, int id, bool supportsFloat)
+            : EffectModule(thread, chain, desc, id, chain->sessionId(), false /*pinned*/) {
+            memset(&mEngine, 0, sizeof(mEngine));
+            mEngine.mItfe = &sFakeEffectInterface;
+            mEngine.mSupportsFloat = supportsFloat;
+            mEffectInterface = (effect_handle_t) &mEngine;
+            mStatus = init();
+            setOffloaded(false, id);
+        }
+        virtual ~FakeEffectModule() {
+            // the engine is not known to the effect factory
+            mEffectInterface = NULL;
+        }
+
+        // Same transitions as EffectModule::setEnabled_l(), without notifying the audio
+        // policy, or IDLE to stop processing at once.
+        void setState(effect_state state) {
+            Mutex::Autolock _l(mLock);
+            mState = state;
+        }
+
+        const FakeEffect& engine() const { return mEngine; }
+
+    private:
+        FakeEffect mEngine;
+    };
+
+    virtual void SetUp() {
+        mThread = new FakeThread();
+        mMixBuffer = new float[kSampleCount];
+        memset(mMixBuffer, 0, kSampleCount * sizeof(float));
+    }
+
+    virtual void TearDown() {
+        mEffects.clear();
+        mChain.clear();
+        mThread.clear();
+        delete[] mMixBuffer;
+    }
+
+    // Creates a chain on the output mix, whose effects process mMixBuffer in place, or on a
+    // track session, whose last effect accumulates onto mMixBuffer.
+    void createChain(audio_session_t sessionId) {
+        mChain = new EffectChain(mThread.get(), sessionId);
+        if (sessionId > AUDIO_SESSION_OUTPUT_MIX) {
+            float *buffer = new float[kSampleCount];
+            memset(buffer, 0, kSampleCount * sizeof(float));
+            mChain->setInBuffer(buffer, true /*ownsBuffer*/);
+            mChain->incTrackCnt();
+            mChain->incActiveTrackCnt();
+        } else {
+            mChain->setInBuffer(mMixBuffer);
+        }
+        mChain->setOutBuffer(mMixBuffer);
+    }
+
+    sp<FakeEffectModule> addEffect(uint32_t type, bool supportsFloat = false) {
+        effect_descriptor_t desc;
+        memset(&desc, 0, sizeof(desc));
+        desc.uuid.timeLow = 0xeffec7;
+        desc.uuid.clockSeq = mEffects.size();
+        desc.flags = type | EFFECT_FLAG_INSERT_ANY;
+        strlcpy(desc.name, "fake effect", sizeof(desc.name));
+        sp<FakeEffectModule> effect = new FakeEffectModule(mThread.get(), mChain, &desc,
+                mEffects.size() + 1, supportsFloat);
+        mEffects.add(effect);
+        mChain->addEffect_l(effect);
+        return effect;
+    }
+
+    void removeEffect(const sp<EffectModule>& effect) {
+        mChain->removeEffect_l(effect);
+    }
+
+    void setEnabled(const sp<FakeEffectModule>& effect, bool enabled) {
+        effect->setState(enabled ? EffectModule::STARTING : EffectModule::STOPPING);
+    }
+
+    // Stops processing the effect at once, as if its disable sequence had completed.
+    void setIdle(const sp<FakeEffectModule>& effect) {
+        effect->setState(EffectModule::IDLE);
+        mChain->invalidateProcessPlan();
+    }
+
+    void process() {
+        mChain->lock();
+        mChain->process_l();
+        mChain->unlock();
+    }
+
+    // Number of effects processed by the chain, read from its dump.
+    size_t planSize() {
+        FILE *file = tmpfile();
+        if (file == NULL) {
+            ADD_FAILURE() << "tmpfile() failed";
+            return 0;
+        }
+        mChain->dump(fileno(file), Vector<String16>());
+        rewind(file);
+        size_t size = 0;
+        char line[256];
+        while (fgets(line, sizeof(line), file) != NULL) {
+            if (strstr(line, "Processed effects:") != NULL) {
+                if (fgets(line, sizeof(line), file) == NULL ||
+                        sscanf(line, "%*p %*p %*d %zu", &size) != 1) {
+                    ADD_FAILURE() << "unexpected chain dump";
+                }
+                break;
+            }
+        }
+        fclose(file);
+        return size;
+    }
+
+    size_t processCount(size_t index) const { return mEffects[index]->engine().mProcessCount; }
+
+    audio_format_t engineFormat(size_t index) const {
+        return (audio_format_t) mEffects[index]->engine().mConfig.inputCfg.format;
+    }
+
+    float *chainInBuffer() const { return mChain->inBuffer(); }
+
+    sp<FakeThread> mThread;
+    sp<EffectChain> mChain;
+    float *mMixBuffer;
+    Vector< sp<FakeEffectModule> > mEffects;
+};
+
+// Idle effects that process in place are not in the plan: enabling adds them.
+TEST_F(EffectChainTest, plan_enable) {
+    createChain(AUDIO_SESSION_OUTPUT_MIX);
+    sp<FakeEffectModule> effect = addEffect(EFFECT_FLAG_TYPE_INSERT);
+    process();
+    EXPECT_EQ(0u, planSize());
+
+    setEnabled(effect, true);
+    process();                      // STARTING -> ACTIVE
+    process();
+    EXPECT_EQ(1u, planSize());
+    EXPECT_EQ(1u, processCount(0));
+
+    setEnabled(effect, false);
+    process();                      // STOPPING -> STOPPED: still processed
+    EXPECT_EQ(1u, planSize());
+    process();                      // STOPPED -> IDLE when the engine returns -ENODATA
+    EXPECT_EQ(1u, planSize());
+    process();
+    EXPECT_EQ(0u, planSize());
+    EXPECT_EQ(3u, processCount(0));
+}
+
+TEST_F(EffectChainTest, plan_add_remove) {
+    createChain(AUDIO_SESSION_OUTPUT_MIX);
+    sp<FakeEffectModule> first = addEffect(EFFECT_FLAG_TYPE_INSERT);
+    setEnabled(first, true);
+    process();
+    process();
+    EXPECT_EQ(1u, planSize());
+
+    // the new effect goes first and shifts the enabled one
+    sp<FakeEffectModule> second = addEffect(EFFECT_FLAG_TYPE_INSERT);
+    process();
+    EXPECT_EQ(1u, planSize());
+    EXPECT_EQ(2u, processCount(0));
+
+    setEnabled(second, true);
+    process();
+    process();
+    EXPECT_EQ(2u, planSize());
+
+    removeEffect(first);
+    process();
+    EXPECT_EQ(1u, planSize());
+    const size_t count = processCount(0);
+    process();
+    EXPECT_EQ(count, processCount(0));
+    EXPECT_EQ(3u, processCount(1));
+
+    removeEffect(second);
+    process();
+    EXPECT_EQ(0u, planSize());
+}
+
+// An idle insert effect still accumulates the input of a track session onto the output mix.
+TEST_F(EffectChainTest, plan_idle_accumulate) {
+    createChain((audio_session_t) 1);
+    addEffect(EFFECT_FLAG_TYPE_INSERT);
+    for (size_t i = 0; i < kSampleCount; i++) {
+        chainInBuffer()[i] = 0.5f;
+    }
+    process();
+    EXPECT_EQ(1u, planSize());
+    EXPECT_EQ(0u, processCount(0));
+    EXPECT_FLOAT_EQ(0.5f, mMixBuffer[0]);
+    EXPECT_FLOAT_EQ(0.5f, mMixBuffer[kSampleCount - 1]);
+}
+
+// The float chain buffers reach the 16 bit engines and come back in float.
+TEST_F(EffectChainTest, process_float) {
+    createChain((audio_session_t) 1);
+    sp<FakeEffectModule> first = addEffect(EFFECT_FLAG_TYPE_INSERT);
+    sp<FakeEffectModule> second = addEffect(EFFECT_FLAG_TYPE_INSERT);
+    setEnabled(first, true);
+    setEnabled(second, true);
+    process();
+    for (size_t i = 0; i < kSampleCount; i++) {
+        chainInBuffer()[i] = 0.5f;
+        mMixBuffer[i] = 0.25f;
+    }
+    process();
+    // the first effect processes the chain input in place, the last one accumulates
+    EXPECT_FLOAT_EQ(0.25f, chainInBuffer()[0]);
+    EXPECT_FLOAT_EQ(0.25f + 0.125f, mMixBuffer[0]);
+    EXPECT_FLOAT_EQ(0.25f + 0.125f, mMixBuffer[kSampleCount - 1]);
+}
+
+// Engines supporting float are configured for float and process the chain buffers directly:
+// samples keep their float precision and headroom.
+TEST_F(EffectChainTest, process_float_engine) {
+    createChain((audio_session_t) 1);
+    sp<FakeEffectModule> first = addEffect(EFFECT_FLAG_TYPE_INSERT, true /*supportsFloat*/);
+    sp<FakeEffectModule> second = addEffect(EFFECT_FLAG_TYPE_INSERT, false /*supportsFloat*/);
+    EXPECT_EQ(AUDIO_FORMAT_PCM_FLOAT, engineFormat(0));
+    EXPECT_EQ(AUDIO_FORMAT_PCM_16_BIT, engineFormat(1));
+    setEnabled(first, true);
+    setEnabled(second, true);
+    process();
+    for (size_t i = 0; i < kSampleCount; i++) {
+        chainInBuffer()[i] = 3.0f;
+        mMixBuffer[i] = 0.25f;
+    }
+    // the 16 bit engine processes in place first and clips, the float engine accumulates
+    process();
+    EXPECT_NEAR(0.5f, chainInBuffer()[0], 1e-4);
+    EXPECT_NEAR(0.25f + 0.25f, mMixBuffer[0], 1e-4);
+    EXPECT_NEAR(0.25f + 0.25f, mMixBuffer[kSampleCount - 1], 1e-4);
+
+    removeEffect(second);
+    for (size_t i = 0; i < kSampleCount; i++) {
+        chainInBuffer()[i] = 3.0f;
+        mMixBuffer[i] = 0.25f;
+    }
+    process();
+    EXPECT_FLOAT_EQ(0.25f + 1.5f, mMixBuffer[0]);
+    EXPECT_FLOAT_EQ(0.25f + 1.5f, mMixBuffer[kSampleCount - 1]);
+}
+
+// Auxiliary effects read the mono Q4.27 samples sent by the tracks and accumulate onto the
+// output mix, with and without float support.
+TEST_F(EffectChainTest, process_aux) {
+    createChain(AUDIO_SESSION_OUTPUT_MIX);
+    sp<FakeEffectModule> effects[] = {
+        addEffect(EFFECT_FLAG_TYPE_AUXILIARY, false /*supportsFloat*/),
+        addEffect(EFFECT_FLAG_TYPE_AUXILIARY, true /*supportsFloat*/),
+    };
+    EXPECT_EQ(AUDIO_FORMAT_PCM_16_BIT, engineFormat(0));
+    EXPECT_EQ(AUDIO_FORMAT_PCM_FLOAT, engineFormat(1));
+    for (size_t e = 0; e < 2; e++) {
+        setEnabled(effects[e], true);
+    }
+    process();
+    for (size_t e = 0; e < 2; e++) {
+        int32_t *auxBuffer = (int32_t *) effects[e]->inBuffer();
+        for (size_t i = 0; i < kFrameCount; i++) {
+            auxBuffer[i] = 1 << 26;     // 0.5 in Q4.27
+        }
+    }
+    memset(mMixBuffer, 0, kSampleCount * sizeof(float));
+    process();
+    EXPECT_FLOAT_EQ(0.25f + 0.25f, mMixBuffer[0]);
+    EXPECT_FLOAT_EQ(0.25f + 0.25f, mMixBuffer[kSampleCount - 1]);
+    // the input is cleared for the next accumulation
+    for (size_t e = 0; e < 2; e++) {
+        EXPECT_EQ(0, ((int32_t *) effects[e]->inBuffer())[0]);
+        // frees the auxiliary input buffer
+        removeEffect(effects[e]);
+    }
+}
+
+/* Benchmark
+ *
+ * Reports the cost of one process_l() on a synthetic output mix chain of insert effects,
+ * with all effects enabled and with every other effect idle, for 16 bit engines and for
+ * engines supporting float.
+ */
+TEST_F(EffectChainTest, benchmark) {
+    static const size_t kEffectCount = 8;
+    static const int kBuffers = 1000;
+
+    printf("%-8s %8s %8s %16s\n", "format", "effects", "enabled", "process_l us");
+    for (int supportsFloat = 0; supportsFloat < 2; supportsFloat++) {
+        createChain(AUDIO_SESSION_OUTPUT_MIX);
+        const size_t first = mEffects.size();
+        for (size_t i = 0; i < kEffectCount; i++) {
+            setEnabled(addEffect(EFFECT_FLAG_TYPE_INSERT, supportsFloat), true);
+        }
+        process();
+
+        for (int pass = 0; pass < 2; pass++) {
+            if (pass == 1) {
+                for (size_t i = 0; i < kEffectCount; i += 2) {
+                    setIdle(mEffects[first + i]);
+                }
+            }
+            process();
+            const size_t enabled = planSize();
+            const double start = nowSeconds();
+            for (int i = 0; i < kBuffers; i++) {
+                process();
+            }
+            const double processUs = (nowSeconds() - start) * 1e6 / kBuffers;
+            printf("%-8s %8zu %8zu %16.2f\n", supportsFloat ? "float" : "16 bit",
+                   kEffectCount, enabled, processUs);
+        }
+    }
+}
+
+} // namespace android
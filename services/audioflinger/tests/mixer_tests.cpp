@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "audioflinger_mixer_tests"
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <audio_utils/primitives.h>
+#include <gtest/gtest.h>
+#include <media/AudioBufferProvider.h>
+#include "AudioMixer.h"
+#include "test_utils.h"
+
+using namespace android;
+
+static const size_t kFrameCount = 256;
+static const uint32_t kSampleRate = 48000;
+static const size_t kCycles = 20;
+
+// Spans returned by the track buffer providers. They do not line up with the mix buffer, so
+// the mixer splits its reads as it does at the wraparound of a track buffer.
+static const int kIncr[] = { 300, 37, 211, 1, 128, 59 };
+
+struct MixParams {
+    int mNumTracks;
+    audio_channel_mask_t mChannelMask;
+    audio_format_t mTrackFormat;
+    audio_format_t mMixerFormat;
+    bool mUseSimd;
+    bool mRamp;
+    bool mResample;     // resample the first track for a while
+};
+
+struct MixResult {
+    std::vector<uint8_t> mOutput;
+    int64_t mDirectFrames;
+    int64_t mCopiedFrames;
+};
+
+// Mixes the tracks for kCycles buffers. The tracks play the same samples whatever
+// their format: PCM_FLOAT tracks get the int16 samples converted to float, as the reformat
+// path of a PCM_16 track would.
+static void mix(const MixParams& params, MixResult *result)
+{
+    const bool useSimd = AudioMixer::getUseSimd();
+    AudioMixer::setUseSimd(params.mUseSimd);
+
+    const uint32_t channels = audio_channel_count_from_out_mask(params.mChannelMask);
+    const size_t trackFrames = kFrameCount * kCycles * 2;
+    const size_t trackSamples = trackFrames * channels;
+    const size_t sampleSize = audio_bytes_per_sample(params.mTrackFormat);
+    const std::vector<int> incr(kIncr, kIncr + sizeof(kIncr) / sizeof(kIncr[0]));
+
+    AudioMixer mixer(kFrameCount, kSampleRate);
+    // the mix is stereo
+    const size_t mixSize = kFrameCount * 2 * audio_bytes_per_sample(params.mMixerFormat);
+    std::vector<uint8_t> mixBuffer(mixSize);
+    std::vector< std::vector<uint8_t> > data(params.mNumTracks);
+    std::vector<TestProvider *> providers;
+    std::vector<int> names;
+    for (int i = 0; i < params.mNumTracks; ++i) {
+        std::vector<int16_t> samples(trackSamples);
+        for (size_t j = 0; j < trackSamples; ++j) {
+            samples[j] = (int16_t)((j * 7919 + i * 104729) * 2654435761u >> 16);
+        }
+        data[i].resize(trackSamples * sampleSize);
+        if (params.mTrackFormat == AUDIO_FORMAT_PCM_FLOAT) {
+            memcpy_to_float_from_i16((float *)&data[i][0], &samples[0], trackSamples);
+        } else {
+            memcpy(&data[i][0], &samples[0], trackSamples * sampleSize);
+        }
+        TestProvider *provider = new TestProvider(&data[i][0], trackFrames,
+                channels * sampleSize, incr);
+        providers.push_back(provider);
+
+        const int name = mixer.getTrackName(params.mChannelMask, params.mTrackFormat,
+                AUDIO_SESSION_OUTPUT_MIX);
+        ASSERT_GE(name, 0);
+        names.push_back(name);
+        mixer.setBufferProvider(name, provider);
+        mixer.setParameter(name, AudioMixer::TRACK, AudioMixer::MAIN_BUFFER, &mixBuffer[0]);
+        mixer.setParameter(name, AudioMixer::TRACK, AudioMixer::MIXER_FORMAT,
+                (void *)(uintptr_t)params.mMixerFormat);
+        mixer.setParameter(name, AudioMixer::RESAMPLE, AudioMixer::SAMPLE_RATE,
+                (void *)(uintptr_t)kSampleRate);
+        float volume = 0.3f + 0.1f * i;
+        mixer.setParameter(name, AudioMixer::VOLUME, AudioMixer::VOLUME0, &volume);
+        mixer.setParameter(name, AudioMixer::VOLUME, AudioMixer::VOLUME1, &volume);
+        mixer.enable(name);
+    }
+
+    for (size_t cycle = 0; cycle < kCycles; ++cycle) {
+        if (params.mRamp && cycle % 5 == 2) {
+            for (int i = 0; i < params.mNumTracks; ++i) {
+                float volume = 0.1f * (cycle % 7) + 0.05f * i;
+                mixer.setParameter(names[i], AudioMixer::RAMP_VOLUME, AudioMixer::VOLUME0,
+                        &volume);
+                mixer.setParameter(names[i], AudioMixer::RAMP_VOLUME, AudioMixer::VOLUME1,
+                        &volume);
+            }
+        }
+        if (params.mResample && cycle == 8) {
+            mixer.setParameter(names[0], AudioMixer::RESAMPLE, AudioMixer::SAMPLE_RATE,
+                    (void *)(uintptr_t)44100);
+        }
+        if (params.mResample && cycle == 14) {
+            mixer.setParameter(names[0], AudioMixer::RESAMPLE, AudioMixer::REMOVE, NULL);
+        }
+        mixer.process();
+        result->mOutput.insert(result->mOutput.end(), mixBuffer.begin(), mixBuffer.end());
+    }
+    result->mDirectFrames = mixer.getDirectFrames();
+    result->mCopiedFrames = mixer.getCopiedFrames();
+
+    for (size_t i = 0; i < names.size(); ++i) {
+        mixer.deleteTrackName(names[i]);
+        delete providers[i];
+    }
+    AudioMixer::setUseSimd(useSimd);
+}
+
+// PCM_16 tracks mixed straight out of their buffers give the same output, bit for bit, as
+// the same samples in PCM_FLOAT, with or without the vector kernels.
+static void testDirectMix(int numTracks, audio_channel_mask_t channelMask,
+        audio_format_t mixerFormat, bool ramp, bool resample)
+{
+    MixParams params = { numTracks, channelMask, AUDIO_FORMAT_PCM_FLOAT, mixerFormat,
+            false /* useSimd */, ramp, resample };
+    MixResult reference;
+    mix(params, &reference);
+
+    params.mTrackFormat = AUDIO_FORMAT_PCM_16_BIT;
+    for (int useSimd = 0; useSimd < 2; ++useSimd) {
+        params.mUseSimd = useSimd;
+        MixResult result;
+        mix(params, &result);
+        ASSERT_EQ(reference.mOutput.size(), result.mOutput.size());
+        EXPECT_EQ(0, memcmp(&reference.mOutput[0], &result.mOutput[0], result.mOutput.size()))
+                << "channel mask " << channelMask << " simd " << useSimd;
+
+        // every track frame is counted once, and only the resampled ones are copied
+        EXPECT_EQ((int64_t)(numTracks * kCycles * kFrameCount),
+                result.mDirectFrames + result.mCopiedFrames);
+        EXPECT_EQ(resample ? (int64_t)(6 * kFrameCount) : 0, result.mCopiedFrames);
+    }
+}
+
+TEST(audioflinger_mixer, direct_stereo)
+{
+    testDirectMix(3, AUDIO_CHANNEL_OUT_STEREO, AUDIO_FORMAT_PCM_FLOAT, false, false);
+    testDirectMix(3, AUDIO_CHANNEL_OUT_STEREO, AUDIO_FORMAT_PCM_16_BIT, false, false);
+}
+
+// a single track goes through the process hook of its own
+TEST(audioflinger_mixer, direct_one_track)
+{
+    testDirectMix(1, AUDIO_CHANNEL_OUT_STEREO, AUDIO_FORMAT_PCM_FLOAT, false, false);
+    testDirectMix(1, AUDIO_CHANNEL_OUT_STEREO, AUDIO_FORMAT_PCM_FLOAT, true, false);
+}
+
+TEST(audioflinger_mixer, direct_mono_expand)
+{
+    testDirectMix(3, AUDIO_CHANNEL_OUT_MONO, AUDIO_FORMAT_PCM_FLOAT, false, false);
+    testDirectMix(3, AUDIO_CHANNEL_OUT_MONO, AUDIO_FORMAT_PCM_16_BIT, false, false);
+}
+
+TEST(audioflinger_mixer, direct_volume_ramp)
+{
+    testDirectMix(3, AUDIO_CHANNEL_OUT_STEREO, AUDIO_FORMAT_PCM_FLOAT, true, false);
+    testDirectMix(3, AUDIO_CHANNEL_OUT_MONO, AUDIO_FORMAT_PCM_FLOAT, true, false);
+}
+
+// A resampled track is reformatted, and returns to the direct path once the resampler is
+// removed.
+TEST(audioflinger_mixer, direct_after_resampler)
+{
+    testDirectMix(3, AUDIO_CHANNEL_OUT_STEREO, AUDIO_FORMAT_PCM_FLOAT, false, true);
+    testDirectMix(3, AUDIO_CHANNEL_OUT_MONO, AUDIO_FORMAT_PCM_FLOAT, true, true);
+}
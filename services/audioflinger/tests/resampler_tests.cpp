@@ -32,8 +32,14 @@
 #include <iostream>
 #include <cutils/log.h>
 #include <gtest/gtest.h>
+#include <utils/Debug.h>
 #include <media/AudioBufferProvider.h>
 #include "AudioResampler.h"
+#include "AudioResamplerDyn.h"
+#include "AudioResamplerFirOps.h"
+#include "AudioResamplerFirProcess.h"
+#include "AudioResamplerFirProcessNeon.h"
+#include "AudioResamplerFirProcessSSE.h"
 #include "test_utils.h"
 
 void resample(int channels, void *output,
@@ -412,3 +418,312 @@ TEST(audioflinger_resampler, stopbandresponse_float_multichannel) {
     }
 }
 
+/* Multichannel quality test
+ *
+ * Only the dynamic resamplers handle more than 2 channels, so other quality levels
+ * are replaced by the closest dynamic quality level for multichannel resamplers.
+ */
+TEST(audioflinger_resampler, multichannel_quality) {
+    static const struct {
+        enum android::AudioResampler::src_quality requested;
+        enum android::AudioResampler::src_quality expected;
+    } kQualityArray[] = {
+        {android::AudioResampler::LOW_QUALITY, android::AudioResampler::DYN_LOW_QUALITY},
+        {android::AudioResampler::MED_QUALITY, android::AudioResampler::DYN_LOW_QUALITY},
+        {android::AudioResampler::HIGH_QUALITY, android::AudioResampler::DYN_MED_QUALITY},
+        {android::AudioResampler::VERY_HIGH_QUALITY, android::AudioResampler::DYN_HIGH_QUALITY},
+        {android::AudioResampler::DYN_LOW_QUALITY, android::AudioResampler::DYN_LOW_QUALITY},
+        {android::AudioResampler::DYN_MED_QUALITY, android::AudioResampler::DYN_MED_QUALITY},
+        {android::AudioResampler::DYN_HIGH_QUALITY, android::AudioResampler::DYN_HIGH_QUALITY},
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(kQualityArray); ++i) {
+        android::AudioResampler* resampler = android::AudioResampler::create(
+                AUDIO_FORMAT_PCM_16_BIT, 6, 48000, kQualityArray[i].requested);
+        EXPECT_EQ(kQualityArray[i].expected, resampler->getQuality());
+        delete resampler;
+
+        // stereo is unchanged
+        resampler = android::AudioResampler::create(
+                AUDIO_FORMAT_PCM_16_BIT, 2, 48000, kQualityArray[i].requested);
+        EXPECT_EQ(kQualityArray[i].requested, resampler->getQuality());
+        delete resampler;
+    }
+}
+
+/* Filter cache test
+ *
+ * Filter banks are shared by the resamplers with the same filter design, and
+ * are kept for a while after the last resampler releases them.
+ */
+TEST(audioflinger_resampler, filtercache) {
+    typedef android::AudioResamplerFilterCache FilterCache;
+    FilterCache::Key key;
+    key.mType = FilterCache::COEF_FLOAT;
+    key.mL = 3;
+    key.mHalfNumCoefs = 5;
+    key.mStopBandAtten = 90.;
+    key.mFcr = 0.1234;
+
+    ASSERT_TRUE(FilterCache::acquire(key) == NULL);
+    void *coefs = malloc(64);
+    const void *shared = FilterCache::add(key, coefs, 64);
+    EXPECT_EQ(coefs, shared);
+    EXPECT_EQ(shared, FilterCache::acquire(key));
+    // a filter bank created concurrently for the same key is dropped.
+    EXPECT_EQ(shared, FilterCache::add(key, malloc(64), 64));
+    for (int i = 0; i < 3; ++i) {
+        FilterCache::release(shared);
+    }
+
+    // unused filter banks are kept, until more recently used ones replace them.
+    EXPECT_EQ(shared, FilterCache::acquire(key));
+    FilterCache::release(shared);
+    FilterCache::Key other = key;
+    for (int i = 0; i < 8; ++i) {
+        other.mFcr = 0.2 + i * 0.01;
+        FilterCache::release(FilterCache::add(other, malloc(64), 64));
+    }
+    EXPECT_TRUE(FilterCache::acquire(key) == NULL);
+}
+
+/* Filter kernel test
+ *
+ * The accelerated ProcessL() and Process() specializations are compared with the
+ * generic ProcessBase() on random data, for 1, 2, 4, 6 and 8 channels and all filter lengths
+ * used by the dynamic resampler. The int16_t SSE and AVX2 kernels must be bit-exact;
+ * otherwise the error must stay within the rounding of the coefficient interpolation
+ * and of the volume.
+ */
+enum fir_kernel {
+    FIR_KERNEL_GENERIC,
+    FIR_KERNEL_DEFAULT, // the specialization selected at compile time (and runtime)
+    FIR_KERNEL_SSE,
+    FIR_KERNEL_AVX2,
+};
+
+template <int CHANNELS, bool LOCKED, typename TC, typename TI, typename TO, typename TINTERP>
+void firKernel(fir_kernel kernel, TO* out, int count, const TC* coefs,
+        const TI* samples, TINTERP lerpP, const TO* volumeLR)
+{
+    // the polyphase filter bank holds coefsP, coefsP1, coefsN, coefsN1
+    const TC* coefsP = coefs;
+    const TC* coefsP1 = coefs + count;
+    const TC* coefsN = coefs + 2 * count;
+    const TC* coefsN1 = coefs + 3 * count;
+    const TI* sP = samples;
+    const TI* sN = samples + CHANNELS;
+
+    switch (kernel) {
+    case FIR_KERNEL_GENERIC:
+        if (LOCKED) {
+            android::ProcessBase<CHANNELS, 16, android::InterpNull>(out,
+                    count, coefsP, coefsN, sP, sN, lerpP, volumeLR);
+        } else {
+            android::ProcessBase<CHANNELS, 16, android::InterpCompute>(out,
+                    count, coefsP, coefsN, sP, sN, lerpP, volumeLR);
+        }
+        break;
+    case FIR_KERNEL_DEFAULT:
+        if (LOCKED) {
+            android::ProcessL<CHANNELS, 16>(out,
+                    count, coefsP, coefsN, sP, sN, volumeLR);
+        } else {
+            android::Process<CHANNELS, 16>(out,
+                    count, coefsP, coefsN, coefsP1, coefsN1, sP, sN, lerpP, volumeLR);
+        }
+        break;
+#if USE_SSE
+    case FIR_KERNEL_SSE:
+        android::ProcessSSEIntrinsic<CHANNELS, 16, LOCKED>(out,
+                count, coefsP, coefsN, sP, sN, volumeLR, lerpP, coefsP1, coefsN1);
+        break;
+    case FIR_KERNEL_AVX2:
+        android::ProcessAVX2Intrinsic<CHANNELS, 16, LOCKED>(out,
+                count, coefsP, coefsN, sP, sN, volumeLR, lerpP, coefsP1, coefsN1);
+        break;
+#endif
+    default:
+        FAIL();
+    }
+}
+
+template <typename T>
+T randomValue(T range)
+{
+    return static_cast<T>((rand() / (RAND_MAX / 2.) - 1.) * range);
+}
+
+template <int CHANNELS, bool LOCKED, typename TC, typename TI, typename TO, typename TINTERP>
+void testFirKernel(fir_kernel kernel, int count, TC coefRange, TI sampleRange,
+        TINTERP lerpP, const TO* volumeLR, double tolerance)
+{
+    TC* coefs = NULL;
+    (void)posix_memalign(reinterpret_cast<void**>(&coefs), 32, 4 * count * sizeof(TC));
+    std::vector<TI> samples((2 * count + 1) * CHANNELS);
+    for (int i = 0; i < 4 * count; ++i) {
+        coefs[i] = randomValue(coefRange);
+    }
+    for (size_t i = 0; i < samples.size(); ++i) {
+        samples[i] = randomValue(sampleRange);
+    }
+    // mono is output as stereo
+    const int outChannels = CHANNELS == 1 ? 2 : CHANNELS;
+    TO reference[8], test[8];
+    for (int i = 0; i < outChannels; ++i) {
+        reference[i] = test[i] = randomValue<TO>(1000);
+    }
+
+    // the filter is centered on the last frame of the positive half.
+    const TI* center = &samples[(count - 1) * CHANNELS];
+    firKernel<CHANNELS, LOCKED>(FIR_KERNEL_GENERIC,
+            reference, count, coefs, center, lerpP, volumeLR);
+    firKernel<CHANNELS, LOCKED>(kernel, test, count, coefs, center, lerpP, volumeLR);
+    for (int i = 0; i < outChannels; ++i) {
+        if (tolerance == 0) {
+            EXPECT_EQ(reference[i], test[i]) << "kernel " << kernel << " channels " << CHANNELS
+                    << " locked " << LOCKED << " count " << count;
+        } else {
+            EXPECT_NEAR(reference[i], test[i], tolerance) << "kernel " << kernel
+                    << " channels " << CHANNELS << " locked " << LOCKED << " count " << count;
+        }
+    }
+    free(coefs);
+}
+
+template <int CHANNELS, bool LOCKED>
+void testFirKernels(fir_kernel kernel, bool bitExact)
+{
+    static const int32_t __attribute__ ((aligned (8))) kVolumeInt[2] = {0x10000000, 0x08000000};
+    static const float __attribute__ ((aligned (8))) kVolumeFloat[2] = {1.f, 0.5f};
+    static const int kCounts[] = {8, 16, 24, 32, 40, 48};
+
+    for (size_t i = 0; i < ARRAY_SIZE(kCounts); ++i) {
+        const int count = kCounts[i];
+        for (int j = 0; j < 10; ++j) {
+            // the output is 2 * accum * volume >> 16, where volume 0x1000 is unity gain.
+            // with interpolation each coefficient may be off by one.
+            const double intTolerance = bitExact ? 0 : (LOCKED ? 0 : 2 * count * 32768 / 8) + 2;
+            const uint32_t intLerp = LOCKED ? 0 : rand() & 0x7fff;
+            testFirKernel<CHANNELS, LOCKED>(kernel, count, (int16_t)512, (int16_t)32767,
+                    intLerp, kVolumeInt, intTolerance);
+            const float floatLerp = LOCKED ? 0.f : rand() / (RAND_MAX + 1.f);
+            testFirKernel<CHANNELS, LOCKED>(kernel, count, 1.f, 1.f,
+                    floatLerp, kVolumeFloat, 1e-4);
+        }
+    }
+}
+
+TEST(audioflinger_resampler, firkernels) {
+    static const struct {
+        fir_kernel kernel;
+        bool bitExact;
+    } kKernels[] = {
+        {FIR_KERNEL_DEFAULT, USE_SSE},
+#if USE_SSE
+        {FIR_KERNEL_SSE, true},
+        {FIR_KERNEL_AVX2, true},
+#endif
+    };
+
+    srand(42);
+    for (size_t i = 0; i < ARRAY_SIZE(kKernels); ++i) {
+#if USE_SSE
+        if (kKernels[i].kernel == FIR_KERNEL_AVX2 && !android::kSseUseAvx2) {
+            printf("AVX2 not supported, skipping AVX2 kernels\n");
+            continue;
+        }
+#endif
+        testFirKernels<1, true>(kKernels[i].kernel, kKernels[i].bitExact);
+        testFirKernels<1, false>(kKernels[i].kernel, kKernels[i].bitExact);
+        testFirKernels<2, true>(kKernels[i].kernel, kKernels[i].bitExact);
+        testFirKernels<2, false>(kKernels[i].kernel, kKernels[i].bitExact);
+        testFirKernels<4, true>(kKernels[i].kernel, kKernels[i].bitExact);
+        testFirKernels<4, false>(kKernels[i].kernel, kKernels[i].bitExact);
+        testFirKernels<6, true>(kKernels[i].kernel, kKernels[i].bitExact);
+        testFirKernels<6, false>(kKernels[i].kernel, kKernels[i].bitExact);
+        testFirKernels<8, true>(kKernels[i].kernel, kKernels[i].bitExact);
+        testFirKernels<8, false>(kKernels[i].kernel, kKernels[i].bitExact);
+    }
+}
+
+/* Throughput test
+ *
+ * Reports how many times faster than real time each dynamic quality level resamples
+ * a stereo, 5.1 and 7.1 chirp, for fixed phase (48kHz to 32kHz) and interpolated phase
+ * (44.1kHz to 48kHz) conversion.
+ */
+template <typename T>
+double measureThroughput(size_t channels, unsigned inputFreq, unsigned outputFreq,
+        enum android::AudioResampler::src_quality quality)
+{
+    const double seconds = 20. / channels;
+    std::vector<int> inputIncr;
+    SignalProvider provider;
+    provider.setChirp<T>(channels, 0., inputFreq/2., inputFreq, seconds);
+    provider.setIncr(inputIncr);
+
+    // the input is consumed slightly ahead of the output, leave out the last block.
+    const size_t outputFrames = (((int64_t)provider.getNumFrames() * outputFreq) / inputFreq
+            - 1024) & ~1023;
+    std::vector<int32_t> output(outputFrames * channels);
+    std::vector<size_t> outIncr;
+    outIncr.push_back(1024);
+
+    // best of 3 runs
+    double best = 0.;
+    for (int i = 0; i < 3; ++i) {
+        android::AudioResampler* resampler = android::AudioResampler::create(
+                is_same<T, int16_t>::value ? AUDIO_FORMAT_PCM_16_BIT : AUDIO_FORMAT_PCM_FLOAT,
+                channels, outputFreq, quality);
+        resampler->setSampleRate(inputFreq);
+        resampler->setVolume(android::AudioResampler::UNITY_GAIN_FLOAT,
+                android::AudioResampler::UNITY_GAIN_FLOAT);
+        provider.reset();
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        resample(channels, &output[0], outputFrames, outIncr, &provider, resampler);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        delete resampler;
+
+        double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+        double speed = outputFrames / (double)outputFreq / elapsed;
+        if (speed > best) {
+            best = speed;
+        }
+    }
+    return best;
+}
+
+TEST(audioflinger_resampler, throughput) {
+    static const struct {
+        enum android::AudioResampler::src_quality quality;
+        const char* name;
+    } kQualityArray[] = {
+        {android::AudioResampler::DYN_LOW_QUALITY, "DYN_LOW_QUALITY"},
+        {android::AudioResampler::DYN_MED_QUALITY, "DYN_MED_QUALITY"},
+        {android::AudioResampler::DYN_HIGH_QUALITY, "DYN_HIGH_QUALITY"},
+    };
+
+    static const size_t kChannelsArray[] = {2, 6, 8};
+
+    printf("%-18s %8s %14s %14s %14s %14s\n", "times real time", "channels",
+            "int16 fixed", "int16 interp", "float fixed", "float interp");
+    for (size_t i = 0; i < ARRAY_SIZE(kQualityArray); ++i) {
+        for (size_t j = 0; j < ARRAY_SIZE(kChannelsArray); ++j) {
+            const enum android::AudioResampler::src_quality quality = kQualityArray[i].quality;
+            const size_t channels = kChannelsArray[j];
+            double int16Fixed = measureThroughput<int16_t>(channels, 48000, 32000, quality);
+            double int16Interp = measureThroughput<int16_t>(channels, 44100, 48000, quality);
+            double floatFixed = measureThroughput<float>(channels, 48000, 32000, quality);
+            double floatInterp = measureThroughput<float>(channels, 44100, 48000, quality);
+            printf("%-18s %8zu %14.1f %14.1f %14.1f %14.1f\n", kQualityArray[i].name,
+                    channels, int16Fixed, int16Interp, floatFixed, floatInterp);
+            EXPECT_GT(int16Fixed, 1.);
+            EXPECT_GT(int16Interp, 1.);
+            EXPECT_GT(floatFixed, 1.);
+            EXPECT_GT(floatInterp, 1.);
+        }
+    }
+}
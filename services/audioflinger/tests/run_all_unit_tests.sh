@@ -10,3 +10,6 @@ adb root && adb wait-for-device remount
 
 #adb shell /system/bin/resampler_tests
 adb shell /data/nativetest/resampler_tests/resampler_tests
+adb shell /data/nativetest/effect_chain_tests/effect_chain_tests
+adb shell /data/nativetest/mixer_tests/mixer_tests
+adb shell /data/nativetest/worker_pool_tests/worker_pool_tests
@@ -21,6 +21,7 @@
 #include <audio_utils/primitives.h>
 #include <audio_utils/sndfile.h>
 #include <media/AudioBufferProvider.h>
+#include <utils/Timers.h>
 #include "AudioMixer.h"
 #include "test_utils.h"
 
@@ -36,11 +37,13 @@
 using namespace android;
 
 static void usage(const char* name) {
-    fprintf(stderr, "Usage: %s [-f] [-m] [-c channels]"
+    fprintf(stderr, "Usage: %s [-f] [-m] [-x] [-b] [-c channels]"
                     " [-s sample-rate] [-o <output-file>] [-a <aux-buffer-file>] [-P csv]"
                     " (<input-file> | <command>)+\n", name);
     fprintf(stderr, "    -f    enable floating point input track by default\n");
     fprintf(stderr, "    -m    enable floating point mixer output\n");
+    fprintf(stderr, "    -x    verify vectorized mixer kernels are bit-exact with the scalar path\n");
+    fprintf(stderr, "    -b    benchmark the cache-blocked mixing engine against the generic one\n");
     fprintf(stderr, "    -c    number of mixer output channels\n");
     fprintf(stderr, "    -s    mixer sample-rate\n");
     fprintf(stderr, "    -o    <output-file> WAV file, pcm16 (or float if -m specified)\n");
@@ -90,21 +93,135 @@ const char *parseFormat(const char *s, bool *useFloat) {
     return s;
 }
 
+/* Mixes the providers into the output and aux buffers, returning the
+ * number of output frames actually produced.
+ * If elapsedNs is not NULL, it is set to the time spent in AudioMixer::process().
+ */
+static size_t mix(std::vector<SignalProvider>& providers,
+        const std::vector<audio_format_t>& formats,
+        void *outputAddr, size_t outputFrames, uint32_t outputSampleRate,
+        uint32_t outputChannels, bool useMixerFloat, void *auxAddr, bool useRamp,
+        nsecs_t *elapsedNs = NULL) {
+    const size_t outputFrameSize = outputChannels
+            * (useMixerFloat ? sizeof(float) : sizeof(int16_t));
+    const size_t auxFrameSize = sizeof(int32_t); // Q4.27 always
+    const audio_channel_mask_t outputChannelMask =
+            audio_channel_out_mask_from_count(outputChannels);
+    std::vector<int32_t> names(providers.size());
+
+    // create the mixer.
+    const size_t mixerFrameCount = 320; // typical numbers may range from 240 or 960
+    AudioMixer *mixer = new AudioMixer(mixerFrameCount, outputSampleRate);
+    audio_format_t mixerFormat = useMixerFloat
+            ? AUDIO_FORMAT_PCM_FLOAT : AUDIO_FORMAT_PCM_16_BIT;
+    float f = AudioMixer::UNITY_GAIN_FLOAT / providers.size(); // normalize volume by # tracks
+    static float f0; // zero
+
+    // set up the tracks.
+    for (size_t i = 0; i < providers.size(); ++i) {
+        //printf("track %d out of %d\n", i, providers.size());
+        providers[i].reset();
+        uint32_t channelMask = audio_channel_out_mask_from_count(providers[i].getNumChannels());
+        int32_t name = mixer->getTrackName(channelMask,
+                formats[i], AUDIO_SESSION_OUTPUT_MIX);
+        ALOG_ASSERT(name >= 0);
+        names[i] = name;
+        mixer->setBufferProvider(name, &providers[i]);
+        mixer->setParameter(name, AudioMixer::TRACK, AudioMixer::MAIN_BUFFER,
+                (void *)outputAddr);
+        mixer->setParameter(
+                name,
+                AudioMixer::TRACK,
+                AudioMixer::MIXER_FORMAT,
+                (void *)(uintptr_t)mixerFormat);
+        mixer->setParameter(
+                name,
+                AudioMixer::TRACK,
+                AudioMixer::FORMAT,
+                (void *)(uintptr_t)formats[i]);
+        mixer->setParameter(
+                name,
+                AudioMixer::TRACK,
+                AudioMixer::MIXER_CHANNEL_MASK,
+                (void *)(uintptr_t)outputChannelMask);
+        mixer->setParameter(
+                name,
+                AudioMixer::TRACK,
+                AudioMixer::CHANNEL_MASK,
+                (void *)(uintptr_t)channelMask);
+        mixer->setParameter(
+                name,
+                AudioMixer::RESAMPLE,
+                AudioMixer::SAMPLE_RATE,
+                (void *)(uintptr_t)providers[i].getSampleRate());
+        if (useRamp) {
+            mixer->setParameter(name, AudioMixer::VOLUME, AudioMixer::VOLUME0, &f0);
+            mixer->setParameter(name, AudioMixer::VOLUME, AudioMixer::VOLUME1, &f0);
+            mixer->setParameter(name, AudioMixer::RAMP_VOLUME, AudioMixer::VOLUME0, &f);
+            mixer->setParameter(name, AudioMixer::RAMP_VOLUME, AudioMixer::VOLUME1, &f);
+        } else {
+            mixer->setParameter(name, AudioMixer::VOLUME, AudioMixer::VOLUME0, &f);
+            mixer->setParameter(name, AudioMixer::VOLUME, AudioMixer::VOLUME1, &f);
+        }
+        if (auxAddr) {
+            mixer->setParameter(name, AudioMixer::TRACK, AudioMixer::AUX_BUFFER,
+                    (void *) auxAddr);
+            mixer->setParameter(name, AudioMixer::VOLUME, AudioMixer::AUXLEVEL, &f0);
+            mixer->setParameter(name, AudioMixer::RAMP_VOLUME, AudioMixer::AUXLEVEL, &f);
+        }
+        mixer->enable(name);
+    }
+
+    // pump the mixer to process data.
+    nsecs_t elapsed = 0;
+    size_t i;
+    for (i = 0; i < outputFrames - mixerFrameCount; i += mixerFrameCount) {
+        for (size_t j = 0; j < names.size(); ++j) {
+            mixer->setParameter(names[j], AudioMixer::TRACK, AudioMixer::MAIN_BUFFER,
+                    (char *) outputAddr + i * outputFrameSize);
+            if (auxAddr) {
+                mixer->setParameter(names[j], AudioMixer::TRACK, AudioMixer::AUX_BUFFER,
+                        (char *) auxAddr + i * auxFrameSize);
+            }
+        }
+        const nsecs_t start = systemTime();
+        mixer->process();
+        elapsed += systemTime() - start;
+    }
+    delete mixer;
+    if (elapsedNs != NULL) {
+        *elapsedNs = elapsed;
+    }
+    return i;
+}
+
+// Returns the number of bytes which differ between two buffers.
+static size_t countMismatches(const void *a, const void *b, size_t bytes) {
+    size_t mismatches = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        if (((const uint8_t *)a)[i] != ((const uint8_t *)b)[i]) {
+            ++mismatches;
+        }
+    }
+    return mismatches;
+}
+
 int main(int argc, char* argv[]) {
     const char* const progname = argv[0];
     bool useInputFloat = false;
     bool useMixerFloat = false;
     bool useRamp = true;
+    bool verifySimd = false;
+    bool benchmark = false;
     uint32_t outputSampleRate = 48000;
     uint32_t outputChannels = 2; // stereo for now
     std::vector<int> Pvalues;
     const char* outputFilename = NULL;
     const char* auxFilename = NULL;
-    std::vector<int32_t> names;
     std::vector<SignalProvider> providers;
     std::vector<audio_format_t> formats;
 
-    for (int ch; (ch = getopt(argc, argv, "fmc:s:o:a:P:")) != -1;) {
+    for (int ch; (ch = getopt(argc, argv, "fmxbc:s:o:a:P:")) != -1;) {
         switch (ch) {
         case 'f':
             useInputFloat = true;
@@ -112,6 +229,12 @@ int main(int argc, char* argv[]) {
         case 'm':
             useMixerFloat = true;
             break;
+        case 'x':
+            verifySimd = true;
+            break;
+        case 'b':
+            benchmark = true;
+            break;
         case 'c':
             outputChannels = atoi(optarg);
             break;
@@ -151,7 +274,6 @@ int main(int argc, char* argv[]) {
     size_t outputFrames = 0;
 
     // create providers for each track
-    names.resize(argc);
     providers.resize(argc);
     formats.resize(argc);
     for (int i = 0; i < argc; ++i) {
@@ -219,8 +341,6 @@ int main(int argc, char* argv[]) {
     const size_t outputFrameSize = outputChannels
             * (useMixerFloat ? sizeof(float) : sizeof(int16_t));
     const size_t outputSize = outputFrames * outputFrameSize;
-    const audio_channel_mask_t outputChannelMask =
-            audio_channel_out_mask_from_count(outputChannels);
     void *outputAddr = NULL;
     (void) posix_memalign(&outputAddr, 32, outputSize);
     memset(outputAddr, 0, outputSize);
@@ -234,82 +354,86 @@ int main(int argc, char* argv[]) {
         memset(auxAddr, 0, auxSize);
     }
 
-    // create the mixer.
-    const size_t mixerFrameCount = 320; // typical numbers may range from 240 or 960
-    AudioMixer *mixer = new AudioMixer(mixerFrameCount, outputSampleRate);
-    audio_format_t mixerFormat = useMixerFloat
-            ? AUDIO_FORMAT_PCM_FLOAT : AUDIO_FORMAT_PCM_16_BIT;
-    float f = AudioMixer::UNITY_GAIN_FLOAT / providers.size(); // normalize volume by # tracks
-    static float f0; // zero
-
-    // set up the tracks.
-    for (size_t i = 0; i < providers.size(); ++i) {
-        //printf("track %d out of %d\n", i, providers.size());
-        uint32_t channelMask = audio_channel_out_mask_from_count(providers[i].getNumChannels());
-        int32_t name = mixer->getTrackName(channelMask,
-                formats[i], AUDIO_SESSION_OUTPUT_MIX);
-        ALOG_ASSERT(name >= 0);
-        names[i] = name;
-        mixer->setBufferProvider(name, &providers[i]);
-        mixer->setParameter(name, AudioMixer::TRACK, AudioMixer::MAIN_BUFFER,
-                (void *)outputAddr);
-        mixer->setParameter(
-                name,
-                AudioMixer::TRACK,
-                AudioMixer::MIXER_FORMAT,
-                (void *)(uintptr_t)mixerFormat);
-        mixer->setParameter(
-                name,
-                AudioMixer::TRACK,
-                AudioMixer::FORMAT,
-                (void *)(uintptr_t)formats[i]);
-        mixer->setParameter(
-                name,
-                AudioMixer::TRACK,
-                AudioMixer::MIXER_CHANNEL_MASK,
-                (void *)(uintptr_t)outputChannelMask);
-        mixer->setParameter(
-                name,
-                AudioMixer::TRACK,
-                AudioMixer::CHANNEL_MASK,
-                (void *)(uintptr_t)channelMask);
-        mixer->setParameter(
-                name,
-                AudioMixer::RESAMPLE,
-                AudioMixer::SAMPLE_RATE,
-                (void *)(uintptr_t)providers[i].getSampleRate());
-        if (useRamp) {
-            mixer->setParameter(name, AudioMixer::VOLUME, AudioMixer::VOLUME0, &f0);
-            mixer->setParameter(name, AudioMixer::VOLUME, AudioMixer::VOLUME1, &f0);
-            mixer->setParameter(name, AudioMixer::RAMP_VOLUME, AudioMixer::VOLUME0, &f);
-            mixer->setParameter(name, AudioMixer::RAMP_VOLUME, AudioMixer::VOLUME1, &f);
-        } else {
-            mixer->setParameter(name, AudioMixer::VOLUME, AudioMixer::VOLUME0, &f);
-            mixer->setParameter(name, AudioMixer::VOLUME, AudioMixer::VOLUME1, &f);
+    if (verifySimd) {
+        // mix with the scalar kernels into a reference buffer, then compare
+        // against the (default) vectorized kernels below.
+        void *referenceAddr = NULL;
+        (void) posix_memalign(&referenceAddr, 32, outputSize);
+        memset(referenceAddr, 0, outputSize);
+        void *referenceAuxAddr = NULL;
+        if (auxAddr) {
+            (void) posix_memalign(&referenceAuxAddr, 32, auxSize);
+            memset(referenceAuxAddr, 0, auxSize);
         }
-        if (auxFilename) {
-            mixer->setParameter(name, AudioMixer::TRACK, AudioMixer::AUX_BUFFER,
-                    (void *) auxAddr);
-            mixer->setParameter(name, AudioMixer::VOLUME, AudioMixer::AUXLEVEL, &f0);
-            mixer->setParameter(name, AudioMixer::RAMP_VOLUME, AudioMixer::AUXLEVEL, &f);
+        AudioMixer::setUseSimd(false);
+        const size_t referenceFrames = mix(providers, formats, referenceAddr, outputFrames,
+                outputSampleRate, outputChannels, useMixerFloat, referenceAuxAddr, useRamp);
+        AudioMixer::setUseSimd(true);
+        if (!AudioMixer::getUseSimd()) {
+            printf("vectorized mixer kernels not available on this architecture\n");
         }
-        mixer->enable(name);
-    }
-
-    // pump the mixer to process data.
-    size_t i;
-    for (i = 0; i < outputFrames - mixerFrameCount; i += mixerFrameCount) {
-        for (size_t j = 0; j < names.size(); ++j) {
-            mixer->setParameter(names[j], AudioMixer::TRACK, AudioMixer::MAIN_BUFFER,
-                    (char *) outputAddr + i * outputFrameSize);
-            if (auxFilename) {
-                mixer->setParameter(names[j], AudioMixer::TRACK, AudioMixer::AUX_BUFFER,
-                        (char *) auxAddr + i * auxFrameSize);
+        const size_t frames = mix(providers, formats, outputAddr, outputFrames,
+                outputSampleRate, outputChannels, useMixerFloat, auxAddr, useRamp);
+        size_t mismatches = countMismatches(outputAddr, referenceAddr,
+                frames * outputFrameSize);
+        if (auxAddr && memcmp(auxAddr, referenceAuxAddr, frames * auxFrameSize) != 0) {
+            ++mismatches;
+            printf("aux buffer mismatch\n");
+        }
+        printf("bit-exactness %s: %zu frames, %zu mismatched bytes\n",
+                mismatches == 0 && frames == referenceFrames ? "PASSED" : "FAILED",
+                frames, mismatches);
+        free(referenceAddr);
+        free(referenceAuxAddr);
+        if (mismatches != 0 || frames != referenceFrames) {
+            free(outputAddr);
+            free(auxAddr);
+            return EXIT_FAILURE;
+        }
+        outputFrames = frames;
+    } else if (benchmark) {
+        // mix with the generic engine into a reference buffer, then with the
+        // cache-blocked engine, and report the time spent in the mixer for each.
+        static const int kIterations = 10;
+        void *referenceAddr = NULL;
+        (void) posix_memalign(&referenceAddr, 32, outputSize);
+        nsecs_t elapsed[2] = { 0, 0 };
+        size_t frames = 0;
+        for (int i = 0; i < kIterations; ++i) {
+            for (int blocked = 0; blocked <= 1; ++blocked) {
+                void *addr = blocked ? outputAddr : referenceAddr;
+                nsecs_t ns;
+                memset(addr, 0, outputSize);
+                if (auxAddr) {
+                    memset(auxAddr, 0, auxSize);
+                }
+                AudioMixer::setUseBlockedMix(blocked);
+                frames = mix(providers, formats, addr, outputFrames,
+                        outputSampleRate, outputChannels, useMixerFloat, auxAddr, useRamp, &ns);
+                elapsed[blocked] += ns;
             }
         }
-        mixer->process();
+        const size_t mismatches = countMismatches(outputAddr, referenceAddr,
+                frames * outputFrameSize);
+        free(referenceAddr);
+        printf("%zu tracks, %zu frames: generic %.2f ns/frame, blocked %.2f ns/frame (%.2fx)\n",
+                providers.size(), frames,
+                (double)elapsed[0] / (kIterations * frames),
+                (double)elapsed[1] / (kIterations * frames),
+                elapsed[1] > 0 ? (double)elapsed[0] / elapsed[1] : 0.);
+        if (mismatches != 0) {
+            printf("blocked output differs from generic output: %zu mismatched bytes\n",
+                    mismatches);
+            free(outputAddr);
+            free(auxAddr);
+            return EXIT_FAILURE;
+        }
+        outputFrames = frames;
+    } else {
+        // reset output frames to the data actually produced.
+        outputFrames = mix(providers, formats, outputAddr, outputFrames,
+                outputSampleRate, outputChannels, useMixerFloat, auxAddr, useRamp);
     }
-    outputFrames = i; // reset output frames to the data actually produced.
 
     // write to files
     writeFile(outputFilename, outputAddr,
@@ -321,7 +445,6 @@ int main(int argc, char* argv[]) {
         writeFile(auxFilename, auxAddr, outputSampleRate, 1, outputFrames, false);
     }
 
-    delete mixer;
     free(outputAddr);
     free(auxAddr);
     return EXIT_SUCCESS;
@@ -163,6 +163,7 @@ public:
     void reset()
     {
         mNextFrame = 0;
+        mNextIdx = 0;
     }
 
     size_t getNumFrames()
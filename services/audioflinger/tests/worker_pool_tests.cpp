@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "audioflinger_worker_pool_tests"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <atomic>
+#include <vector>
+#include <gtest/gtest.h>
+#include <utils/Log.h>
+#include "AudioWorkerPool.h"
+
+using namespace android;
+
+static const nsecs_t kDeadlineNs = 1000000000;     // never missed by the quick jobs
+static const int kPriority = 0;                     // ANDROID_PRIORITY_NORMAL
+
+struct PoolStats {
+    size_t mWorkers;
+    unsigned mBatches;
+    unsigned mLateBatches;
+    unsigned mJobs;
+    unsigned mJobsByCaller;
+};
+
+// Reads the statistics of the pool from its dump.
+static PoolStats getStats(const sp<AudioWorkerPool>& pool)
+{
+    PoolStats stats;
+    memset(&stats, 0, sizeof(stats));
+    FILE *file = tmpfile();
+    if (file == NULL) {
+        ADD_FAILURE() << "tmpfile() failed";
+        return stats;
+    }
+    pool->dump(fileno(file), 0);
+    rewind(file);
+    char line[256];
+    if (fgets(line, sizeof(line), file) == NULL ||
+            sscanf(line, "Workers: %zu, batches: %u (late %u), jobs: %u (run by caller %u)",
+                    &stats.mWorkers, &stats.mBatches, &stats.mLateBatches, &stats.mJobs,
+                    &stats.mJobsByCaller) != 5) {
+        ADD_FAILURE() << "unexpected pool dump";
+    }
+    fclose(file);
+    return stats;
+}
+
+struct CountingJobs {
+    std::vector< std::atomic<int> > mRuns;
+    std::atomic<int> mRunning;
+
+    explicit CountingJobs(size_t count) : mRuns(count), mRunning(0) {
+        for (size_t i = 0; i < count; i++) {
+            mRuns[i] = 0;
+        }
+    }
+
+    static void job(void *cookie, size_t index) {
+        CountingJobs *jobs = (CountingJobs *) cookie;
+        jobs->mRunning++;
+        jobs->mRuns[index]++;
+        jobs->mRunning--;
+    }
+};
+
+// Every job of a batch runs exactly once, and none is still running when run() returns.
+TEST(audioflinger_worker_pool, jobs_run_once)
+{
+    static const size_t kMaxJobs = 16;
+    static const int kBatches = 500;
+
+    sp<AudioWorkerPool> pool = new AudioWorkerPool(3, "worker pool test", kPriority);
+    ASSERT_EQ(3u, pool->numWorkers());
+    unsigned totalJobs = 0;
+    for (int batch = 0; batch < kBatches; batch++) {
+        const size_t count = batch % (kMaxJobs + 1);
+        CountingJobs jobs(kMaxJobs);
+        EXPECT_TRUE(pool->run(CountingJobs::job, &jobs, count, kDeadlineNs));
+        EXPECT_EQ(0, jobs.mRunning.load());
+        for (size_t i = 0; i < kMaxJobs; i++) {
+            ASSERT_EQ(i < count ? 1 : 0, jobs.mRuns[i].load())
+                    << "job " << i << " of " << count << " in batch " << batch;
+        }
+        totalJobs += count;
+    }
+
+    // empty batches return at once and are not counted
+    const PoolStats stats = getStats(pool);
+    EXPECT_EQ(3u, stats.mWorkers);
+    EXPECT_EQ((unsigned) (kBatches - (kBatches + kMaxJobs) / (kMaxJobs + 1)), stats.mBatches);
+    EXPECT_EQ(0u, stats.mLateBatches);
+    EXPECT_EQ(totalJobs, stats.mJobs);
+    EXPECT_LE(stats.mJobsByCaller, stats.mJobs);
+}
+
+static void recordThreadJob(void *cookie, size_t index)
+{
+    ((pthread_t *) cookie)[index] = pthread_self();
+}
+
+// Without workers, the caller runs the whole batch itself.
+TEST(audioflinger_worker_pool, no_workers)
+{
+    static const size_t kJobs = 5;
+
+    sp<AudioWorkerPool> pool = new AudioWorkerPool(0, "worker pool test", kPriority);
+    EXPECT_EQ(0u, pool->numWorkers());
+    pthread_t threads[kJobs];
+    memset(threads, 0, sizeof(threads));
+    EXPECT_TRUE(pool->run(recordThreadJob, threads, kJobs, kDeadlineNs));
+    for (size_t i = 0; i < kJobs; i++) {
+        EXPECT_TRUE(pthread_equal(pthread_self(), threads[i])) << "job " << i;
+    }
+
+    const PoolStats stats = getStats(pool);
+    EXPECT_EQ(1u, stats.mBatches);
+    EXPECT_EQ(kJobs, stats.mJobs);
+    EXPECT_EQ(kJobs, stats.mJobsByCaller);
+}
+
+struct SlowJobs {
+    static const useconds_t kJobUs = 20000;
+
+    std::atomic<int> mCompleted;
+
+    SlowJobs() : mCompleted(0) { }
+
+    static void job(void *cookie, size_t index __unused) {
+        usleep(kJobUs);
+        ((SlowJobs *) cookie)->mCompleted++;
+    }
+};
+
+// A batch past its deadline is reported and counted, but run() still waits for all its jobs.
+TEST(audioflinger_worker_pool, late_batch)
+{
+    static const size_t kJobs = 4;
+
+    sp<AudioWorkerPool> pool = new AudioWorkerPool(2, "worker pool test", kPriority);
+    SlowJobs jobs;
+    EXPECT_FALSE(pool->run(SlowJobs::job, &jobs, kJobs, 1000000 /* 1 ms */));
+    EXPECT_EQ((int) kJobs, jobs.mCompleted.load());
+
+    // the next batch is on time again
+    CountingJobs quickJobs(kJobs);
+    EXPECT_TRUE(pool->run(CountingJobs::job, &quickJobs, kJobs, kDeadlineNs));
+
+    const PoolStats stats = getStats(pool);
+    EXPECT_EQ(2u, stats.mBatches);
+    EXPECT_EQ(1u, stats.mLateBatches);
+    EXPECT_EQ(2 * kJobs, stats.mJobs);
+}
+
+// The destructor stops workers waiting for a batch, whether or not they have run one yet.
+TEST(audioflinger_worker_pool, destroy_idle)
+{
+    for (int pass = 0; pass < 20; pass++) {
+        sp<AudioWorkerPool> pool = new AudioWorkerPool(4, "worker pool test", kPriority);
+        if (pass % 2) {
+            CountingJobs jobs(8);
+            EXPECT_TRUE(pool->run(CountingJobs::job, &jobs, 8, kDeadlineNs));
+            usleep(1000);   // let the workers go back to waiting
+        }
+        pool.clear();
+    }
+}
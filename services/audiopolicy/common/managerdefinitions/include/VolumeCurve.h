@@ -23,6 +23,7 @@
 #include <utils/String8.h>
 #include <utils/SortedVector.h>
 #include <utils/KeyedVector.h>
+#include <utils/Vector.h>
 #include <system/audio.h>
 #include <cutils/config_utils.h>
 #include <string>
@@ -47,6 +48,8 @@ inline bool operator< (const CurvePoint &lhs, const CurvePoint &rhs)
 // A volume curve for a given use case and device category
 // It contains of list of points of this curve expressing the attenuation in Millibels for
 // a given volume index from 0 to 100
+// Once the curve is complete, buildDbTable() interpolates it at every index so that
+// volIndexToDb() is a table lookup. Adding a point discards the table.
 class VolumeCurve : public RefBase
 {
 public:
@@ -56,14 +59,28 @@ public:
     device_category getDeviceCategory() const { return mDeviceCategory; }
     audio_stream_type_t getStreamType() const { return mStreamType; }
 
-    void add(const CurvePoint &point) { mCurvePoints.add(point); }
+    void add(const CurvePoint &point)
+    {
+        mCurvePoints.add(point);
+        mDbTable.clear();
+    }
+
+    void buildDbTable();
+    bool hasDbTable() const { return !mDbTable.isEmpty(); }
 
     float volIndexToDb(int indexInUi, int volIndexMin, int volIndexMax) const;
 
     void dump(int fd) const;
 
 private:
+    float curveIndexToDb(int volIdx) const;
+    int getStepCount() const
+    {
+        return 1 + mCurvePoints[mCurvePoints.size() - 1].mIndex - mCurvePoints[0].mIndex;
+    }
+
     SortedVector<CurvePoint> mCurvePoints;
+    Vector<float> mDbTable; /**< attenuation in dB per curve index, empty until built. */
     device_category mDeviceCategory;
     audio_stream_type_t mStreamType;
 };
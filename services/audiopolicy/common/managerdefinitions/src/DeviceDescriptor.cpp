@@ -68,6 +68,10 @@ void DeviceVector::refreshTypes()
 
 ssize_t DeviceVector::indexOf(const sp<DeviceDescriptor>& item) const
 {
+    // equal devices have the same type
+    if ((mDeviceTypes & item->type()) != item->type()) {
+        return -1;
+    }
     for(size_t i = 0; i < size(); i++) {
         if (item->equals(itemAt(i))) {
             return i;
@@ -81,7 +85,7 @@ void DeviceVector::add(const DeviceVector &devices)
     for (size_t i = 0; i < devices.size(); i++) {
         sp<DeviceDescriptor> device = devices.itemAt(i);
         if (indexOf(device) < 0 && SortedVector::add(device) >= 0) {
-            refreshTypes();
+            mDeviceTypes |= device->type();
         }
     }
 }
@@ -93,7 +97,7 @@ ssize_t DeviceVector::add(const sp<DeviceDescriptor>& item)
     if (ret < 0) {
         ret = SortedVector::add(item);
         if (ret >= 0) {
-            refreshTypes();
+            mDeviceTypes |= item->type();
         }
     } else {
         ALOGW("DeviceVector::add device %08x already in", item->type());
@@ -117,6 +121,12 @@ ssize_t DeviceVector::remove(const sp<DeviceDescriptor>& item)
     return ret;
 }
 
+void DeviceVector::clear()
+{
+    SortedVector::clear();
+    mDeviceTypes = AUDIO_DEVICE_NONE;
+}
+
 audio_devices_t DeviceVector::getDevicesFromHwModule(audio_module_handle_t moduleHandle) const
 {
     audio_devices_t devices = AUDIO_DEVICE_NONE;
@@ -128,9 +138,12 @@ audio_devices_t DeviceVector::getDevicesFromHwModule(audio_module_handle_t modul
     return devices;
 }
 
-sp<DeviceDescriptor> DeviceVector::getDevice(audio_devices_t type, String8 address) const
+sp<DeviceDescriptor> DeviceVector::getDevice(audio_devices_t type, const String8 &address) const
 {
     sp<DeviceDescriptor> device;
+    if ((mDeviceTypes & type) != type) {
+        return device;
+    }
     for (size_t i = 0; i < size(); i++) {
         if (itemAt(i)->type() == type) {
             if (address == "" || itemAt(i)->mAddress == address) {
@@ -163,6 +176,9 @@ DeviceVector DeviceVector::getDevicesFromType(audio_devices_t type) const
     DeviceVector devices;
     bool isOutput = audio_is_output_devices(type);
     type &= ~AUDIO_DEVICE_BIT_IN;
+    if ((mDeviceTypes & type) == AUDIO_DEVICE_NONE) {
+        return devices;
+    }
     for (size_t i = 0; (i < size()) && (type != AUDIO_DEVICE_NONE); i++) {
         bool curIsOutput = audio_is_output_devices(itemAt(i)->mDeviceType);
         audio_devices_t curType = itemAt(i)->mDeviceType & ~AUDIO_DEVICE_BIT_IN;
@@ -177,9 +193,12 @@ DeviceVector DeviceVector::getDevicesFromType(audio_devices_t type) const
 }
 
 DeviceVector DeviceVector::getDevicesFromTypeAddr(
-        audio_devices_t type, String8 address) const
+        audio_devices_t type, const String8 &address) const
 {
     DeviceVector devices;
+    if ((mDeviceTypes & type) != type) {
+        return devices;
+    }
     for (size_t i = 0; i < size(); i++) {
         if (itemAt(i)->type() == type) {
             if (itemAt(i)->mAddress == address) {
@@ -302,11 +302,11 @@ sp<DeviceDescriptor>  HwModuleCollection::getDeviceDescriptor(const audio_device
     }
 
     for (size_t i = 0; i < size(); i++) {
-        const sp<HwModule> hwModule = itemAt(i);
+        const sp<HwModule> &hwModule = itemAt(i);
         if (hwModule->mHandle == 0) {
             continue;
         }
-        DeviceVector declaredDevices = hwModule->getDeclaredDevices();
+        const DeviceVector &declaredDevices = hwModule->getDeclaredDevices();
         DeviceVector deviceList = declaredDevices.getDevicesFromTypeAddr(device, address);
         if (!deviceList.isEmpty()) {
             return deviceList.itemAt(0);
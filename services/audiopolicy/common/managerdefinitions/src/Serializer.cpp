@@ -574,6 +574,7 @@ status_t VolumeTraits::deserialize(_xmlDoc *doc, const _xmlNode *root, PtrElemen
         }
         child = child->next;
     }
+    element->buildDbTable();
     return NO_ERROR;
 }
 
@@ -22,15 +22,38 @@
 
 namespace android {
 
+void VolumeCurve::buildDbTable()
+{
+    mDbTable.clear();
+    if (mCurvePoints.isEmpty()) {
+        return;
+    }
+    // volIndexToDb() maps the UI indices to the curve indices 0 to nbSteps
+    int nbSteps = getStepCount();
+    mDbTable.setCapacity(nbSteps + 1);
+    for (int volIdx = 0; volIdx <= nbSteps; volIdx++) {
+        mDbTable.add(curveIndexToDb(volIdx));
+    }
+}
+
 float VolumeCurve::volIndexToDb(int indexInUi, int volIndexMin, int volIndexMax) const
 {
     ALOG_ASSERT(!mCurvePoints.isEmpty(), "Invalid volume curve");
 
-    size_t nbCurvePoints = mCurvePoints.size();
     // the volume index in the UI is relative to the min and max volume indices for this stream
-    int nbSteps = 1 + mCurvePoints[nbCurvePoints - 1].mIndex - mCurvePoints[0].mIndex;
+    int nbSteps = getStepCount();
     int volIdx = (nbSteps * (indexInUi - volIndexMin)) / (volIndexMax - volIndexMin);
 
+    if (volIdx >= 0 && (size_t)volIdx < mDbTable.size()) {
+        return mDbTable[volIdx];
+    }
+    return curveIndexToDb(volIdx);
+}
+
+float VolumeCurve::curveIndexToDb(int volIdx) const
+{
+    size_t nbCurvePoints = mCurvePoints.size();
+
     // Where would this volume index been inserted in the curve point
     size_t indexInUiPosition = mCurvePoints.orderOf(CurvePoint(volIdx, 0));
     if (indexInUiPosition >= nbCurvePoints) {
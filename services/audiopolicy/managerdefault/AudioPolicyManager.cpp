@@ -678,24 +678,27 @@ sp<IOProfile> AudioPolicyManager::getProfileForDirectOutput(
         (audio_output_flags_t)((flags & kRelevantFlags) | AUDIO_OUTPUT_FLAG_DIRECT);
 
     sp<IOProfile> profile;
+    const audio_devices_t availableDevices = mAvailableOutputDevices.types();
+    const String8 emptyAddress("");
 
     for (size_t i = 0; i < mHwModules.size(); i++) {
         if (mHwModules[i]->mHandle == 0) {
             continue;
         }
         for (size_t j = 0; j < mHwModules[i]->mOutputProfiles.size(); j++) {
-            sp<IOProfile> curProfile = mHwModules[i]->mOutputProfiles[j];
-            if (!curProfile->isCompatibleProfile(device, String8(""),
+            const sp<IOProfile> &curProfile = mHwModules[i]->mOutputProfiles[j];
+            // reject profiles not corresponding to a device currently available before the
+            // full compatibility check
+            if ((availableDevices & curProfile->getSupportedDevicesType()) == 0) {
+                continue;
+            }
+            if (!curProfile->isCompatibleProfile(device, emptyAddress,
                     samplingRate, NULL /*updatedSamplingRate*/,
                     format, NULL /*updatedFormat*/,
                     channelMask, NULL /*updatedChannelMask*/,
                     flags)) {
                 continue;
             }
-            // reject profiles not corresponding to a device currently available
-            if ((mAvailableOutputDevices.types() & curProfile->getSupportedDevicesType()) == 0) {
-                continue;
-            }
             // if several profiles are compatible, give priority to one with offload capability
             if (profile != 0 && ((curProfile->getFlags() & AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD) == 0)) {
                 continue;
@@ -1079,7 +1082,7 @@ audio_io_handle_t AudioPolicyManager::selectOutput(const SortedVector<audio_io_h
     audio_format_t bestFormatForFlags = AUDIO_FORMAT_INVALID;
 
     for (size_t i = 0; i < outputs.size(); i++) {
-        sp<SwAudioOutputDescriptor> outputDesc = mOutputs.valueFor(outputs[i]);
+        const sp<SwAudioOutputDescriptor> &outputDesc = mOutputs.valueFor(outputs[i]);
         if (!outputDesc->isDuplicated()) {
             // if a valid format is specified, skip output if not compatible
             if (format != AUDIO_FORMAT_INVALID) {
@@ -3268,6 +3271,12 @@ uint32_t AudioPolicyManager::nextAudioPortGeneration()
 }
 
 AudioPolicyManager::AudioPolicyManager(AudioPolicyClientInterface *clientInterface)
+    : AudioPolicyManager(clientInterface, NULL)
+{
+}
+
+AudioPolicyManager::AudioPolicyManager(AudioPolicyClientInterface *clientInterface,
+                                       const char *configFile)
     :
 #ifdef AUDIO_POLICY_TEST
     Thread(false),
@@ -3295,13 +3304,15 @@ AudioPolicyManager::AudioPolicyManager(AudioPolicyClientInterface *clientInterfa
                              mDefaultOutputDevice, speakerDrcEnabled,
                              static_cast<VolumeCurvesCollection *>(mVolumeCurves));
     PolicySerializer serializer;
-    if (serializer.deserialize(AUDIO_POLICY_XML_CONFIG_FILE, config) != NO_ERROR) {
+    if (serializer.deserialize(configFile != NULL ? configFile : AUDIO_POLICY_XML_CONFIG_FILE,
+                               config) != NO_ERROR) {
 #else
     mVolumeCurves = new StreamDescriptorCollection();
     AudioPolicyConfig config(mHwModules, mAvailableOutputDevices, mAvailableInputDevices,
                              mDefaultOutputDevice, speakerDrcEnabled);
-    if ((ConfigParsingUtils::loadConfig(AUDIO_POLICY_VENDOR_CONFIG_FILE, config) != NO_ERROR) &&
-            (ConfigParsingUtils::loadConfig(AUDIO_POLICY_CONFIG_FILE, config) != NO_ERROR)) {
+    if (configFile != NULL ? ConfigParsingUtils::loadConfig(configFile, config) != NO_ERROR :
+            ((ConfigParsingUtils::loadConfig(AUDIO_POLICY_VENDOR_CONFIG_FILE, config) != NO_ERROR) &&
+             (ConfigParsingUtils::loadConfig(AUDIO_POLICY_CONFIG_FILE, config) != NO_ERROR))) {
 #endif
         ALOGE("could not load audio policy configuration file, setting defaults");
         config.setDefault();
@@ -4242,8 +4253,8 @@ void AudioPolicyManager::closeInput(audio_io_handle_t input)
 }
 
 SortedVector<audio_io_handle_t> AudioPolicyManager::getOutputsForDevice(
-                                                                audio_devices_t device,
-                                                                SwAudioOutputCollection openOutputs)
+                                                    audio_devices_t device,
+                                                    const SwAudioOutputCollection &openOutputs)
 {
     SortedVector<audio_io_handle_t> outputs;
 
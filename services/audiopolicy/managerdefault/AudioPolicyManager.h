@@ -103,6 +103,10 @@ class AudioPolicyManager : public AudioPolicyInterface, public AudioPolicyManage
 
 public:
                 AudioPolicyManager(AudioPolicyClientInterface *clientInterface);
+                // Loads the policy configuration from configFile instead of the system files,
+                // for tests and benchmarks.
+                AudioPolicyManager(AudioPolicyClientInterface *clientInterface,
+                                   const char *configFile);
         virtual ~AudioPolicyManager();
 
         // AudioPolicyInterface
@@ -445,7 +449,7 @@ protected:
 #endif //AUDIO_POLICY_TEST
 
         SortedVector<audio_io_handle_t> getOutputsForDevice(audio_devices_t device,
-                                                            SwAudioOutputCollection openOutputs);
+                                                    const SwAudioOutputCollection &openOutputs);
         bool vectorsEqual(SortedVector<audio_io_handle_t>& outputs1,
                                            SortedVector<audio_io_handle_t>& outputs2);
 
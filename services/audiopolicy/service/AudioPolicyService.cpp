@@ -391,6 +391,9 @@ status_t AudioPolicyService::dump(int fd, const Vector<String16>& args __unused)
         if (mTonePlaybackThread != 0) {
             mTonePlaybackThread->dump(fd);
         }
+        if (mOutputCommandThread != 0) {
+            mOutputCommandThread->dump(fd);
+        }
 
 #ifdef USE_LEGACY_AUDIO_POLICY
         if (mpAudioPolicy) {
@@ -430,11 +433,57 @@ status_t AudioPolicyService::onTransact(
 
 // -----------  AudioPolicyService::AudioCommandThread implementation ----------
 
+// names of the commands in the latency statistics, indexed by command
+static const char * const kCommandNames[] = {
+    "start tone",
+    "stop tone",
+    "set volume",
+    "set parameters",
+    "set voice volume",
+    "start output",
+    "stop output",
+    "release output",
+    "create patch",
+    "release patch",
+    "port list update",
+    "patch list update",
+    "set port config",
+    "dyn policy mix",
+    "recording config",
+};
+
+const nsecs_t AudioPolicyService::AudioCommandThread::kLatencyBucketBoundsNs[] = {
+    microseconds(100), microseconds(500), milliseconds(1), milliseconds(2), milliseconds(5),
+    milliseconds(10), milliseconds(20), milliseconds(50), milliseconds(100)
+};
+
+// Default AudioFlinger calls of the command thread
+class AudioSystemFlinger : public AudioPolicyService::AudioCommandThread::AudioFlingerInterface {
+public:
+    virtual status_t setStreamVolume(audio_stream_type_t stream, float volume,
+                                     audio_io_handle_t output) {
+        return AudioSystem::setStreamVolume(stream, volume, output);
+    }
+    virtual status_t setParameters(audio_io_handle_t ioHandle, const String8& keyValuePairs) {
+        return AudioSystem::setParameters(ioHandle, keyValuePairs);
+    }
+    virtual status_t setVoiceVolume(float volume) {
+        return AudioSystem::setVoiceVolume(volume);
+    }
+};
+
 AudioPolicyService::AudioCommandThread::AudioCommandThread(String8 name,
-                                                           const wp<AudioPolicyService>& service)
-    : Thread(false), mName(name), mService(service)
+                                                           const wp<AudioPolicyService>& service,
+                                                           const sp<AudioFlingerInterface>&
+                                                                   audioFlinger)
+    : Thread(false), mName(name), mService(service),
+      mAudioFlinger(audioFlinger != 0 ? audioFlinger :
+                                        sp<AudioFlingerInterface>(new AudioSystemFlinger()))
 {
     mpToneGenerator = NULL;
+    memset(mLatencyHistogram, 0, sizeof(mLatencyHistogram));
+    memset(mMaxLatencyNs, 0, sizeof(mMaxLatencyNs));
+    memset(mCoalescedCount, 0, sizeof(mCoalescedCount));
 }
 
 
@@ -493,21 +542,22 @@ bool AudioPolicyService::AudioCommandThread::threadLoop()
                     VolumeData *data = (VolumeData *)command->mParam.get();
                     ALOGV("AudioCommandThread() processing set volume stream %d, \
                             volume %f, output %d", data->mStream, data->mVolume, data->mIO);
-                    command->mStatus = AudioSystem::setStreamVolume(data->mStream,
-                                                                    data->mVolume,
-                                                                    data->mIO);
+                    command->mStatus = mAudioFlinger->setStreamVolume(data->mStream,
+                                                                      data->mVolume,
+                                                                      data->mIO);
                     }break;
                 case SET_PARAMETERS: {
                     ParametersData *data = (ParametersData *)command->mParam.get();
                     ALOGV("AudioCommandThread() processing set parameters string %s, io %d",
                             data->mKeyValuePairs.string(), data->mIO);
-                    command->mStatus = AudioSystem::setParameters(data->mIO, data->mKeyValuePairs);
+                    command->mStatus = mAudioFlinger->setParameters(data->mIO,
+                                                                    data->mKeyValuePairs);
                     }break;
                 case SET_VOICE_VOLUME: {
                     VoiceVolumeData *data = (VoiceVolumeData *)command->mParam.get();
                     ALOGV("AudioCommandThread() processing set voice volume volume %f",
                             data->mVolume);
-                    command->mStatus = AudioSystem::setVoiceVolume(data->mVolume);
+                    command->mStatus = mAudioFlinger->setVoiceVolume(data->mVolume);
                     }break;
                 case START_OUTPUT: {
                     StartOutputData *data = (StartOutputData *)command->mParam.get();
@@ -630,14 +680,22 @@ bool AudioPolicyService::AudioCommandThread::threadLoop()
                     Mutex::Autolock _l(command->mLock);
                     if (command->mWaitStatus) {
                         command->mWaitStatus = false;
-                        command->mCond.signal();
+                        // several callers wait for a command into which others were merged
+                        command->mCond.broadcast();
                     }
                 }
+                updateLatencyStats_l(command, systemTime());
                 waitTime = -1;
                 // release mLock before releasing strong reference on the service as
                 // AudioPolicyService destructor calls AudioCommandThread::exit() which
                 // acquires mLock.
                 mLock.unlock();
+                // the command is out of the queue: its callbacks cannot change any more
+                for (size_t i = 0; i < command->mCallbacks.size(); i++) {
+                    command->mCallbacks[i]->onCommandComplete(command->mCommand,
+                                                              command->mStatus);
+                }
+                command->mCallbacks.clear();
                 svc.clear();
                 mLock.lock();
             } else {
@@ -701,6 +759,29 @@ status_t AudioPolicyService::AudioCommandThread::dump(int fd)
         result.append("     none\n");
     }
 
+    static_assert(sizeof(kCommandNames) / sizeof(kCommandNames[0]) == NUM_COMMANDS,
+                  "kCommandNames does not match the commands");
+    result.append("- Command latency from scheduled time to completion:\n");
+    result.append("   Command            Executed Coalesced  Max ms"
+                  " <0.1ms <0.5ms   <1ms   <2ms   <5ms  <10ms  <20ms  <50ms <100ms >=100ms\n");
+    for (int i = 0; i < NUM_COMMANDS; i++) {
+        uint32_t executed = 0;
+        for (size_t j = 0; j < kNumLatencyBuckets; j++) {
+            executed += mLatencyHistogram[i][j];
+        }
+        if (executed == 0 && mCoalescedCount[i] == 0) {
+            continue;
+        }
+        snprintf(buffer, SIZE, "   %-18s %8u %9u %7.1f", kCommandNames[i], executed,
+                 mCoalescedCount[i], mMaxLatencyNs[i] / 1000000.0);
+        result.append(buffer);
+        for (size_t j = 0; j < kNumLatencyBuckets; j++) {
+            snprintf(buffer, SIZE, " %6u", mLatencyHistogram[i][j]);
+            result.append(buffer);
+        }
+        result.append("\n");
+    }
+
     write(fd, result.string(), result.size());
 
     if (locked) mLock.unlock();
@@ -775,6 +856,53 @@ status_t AudioPolicyService::AudioCommandThread::voiceVolumeCommand(float volume
     return sendCommand(command, delayMs);
 }
 
+void AudioPolicyService::AudioCommandThread::asyncVolumeCommand(audio_stream_type_t stream,
+                                                                float volume,
+                                                                audio_io_handle_t output,
+                                                                int delayMs,
+                                                                const sp<CommandCallback>& callback)
+{
+    sp<AudioCommand> command = new AudioCommand();
+    command->mCommand = SET_VOLUME;
+    sp<VolumeData> data = new VolumeData();
+    data->mStream = stream;
+    data->mVolume = volume;
+    data->mIO = output;
+    command->mParam = data;
+    ALOGV("AudioCommandThread() posting set volume stream %d, volume %f, output %d",
+            stream, volume, output);
+    postCommand(command, delayMs, callback);
+}
+
+void AudioPolicyService::AudioCommandThread::asyncParametersCommand(
+                                                            audio_io_handle_t ioHandle,
+                                                            const char *keyValuePairs,
+                                                            int delayMs,
+                                                            const sp<CommandCallback>& callback)
+{
+    sp<AudioCommand> command = new AudioCommand();
+    command->mCommand = SET_PARAMETERS;
+    sp<ParametersData> data = new ParametersData();
+    data->mIO = ioHandle;
+    data->mKeyValuePairs = String8(keyValuePairs);
+    command->mParam = data;
+    ALOGV("AudioCommandThread() posting set parameter string %s, io %d ,delay %d",
+            keyValuePairs, ioHandle, delayMs);
+    postCommand(command, delayMs, callback);
+}
+
+void AudioPolicyService::AudioCommandThread::asyncVoiceVolumeCommand(float volume, int delayMs,
+                                                            const sp<CommandCallback>& callback)
+{
+    sp<AudioCommand> command = new AudioCommand();
+    command->mCommand = SET_VOICE_VOLUME;
+    sp<VoiceVolumeData> data = new VoiceVolumeData();
+    data->mVolume = volume;
+    command->mParam = data;
+    ALOGV("AudioCommandThread() posting set voice volume volume %f", volume);
+    postCommand(command, delayMs, callback);
+}
+
 status_t AudioPolicyService::AudioCommandThread::startOutputCommand(audio_io_handle_t output,
                                                                     audio_stream_type_t stream,
                                                                     audio_session_t session)
@@ -921,20 +1049,138 @@ void AudioPolicyService::AudioCommandThread::recordingConfigurationUpdateCommand
 
 status_t AudioPolicyService::AudioCommandThread::sendCommand(sp<AudioCommand>& command, int delayMs)
 {
+    // the command executed, which is not the one sent if it was merged into a pending one
+    sp<AudioCommand> queuedCommand = command;
     {
         Mutex::Autolock _l(mLock);
-        insertCommand_l(command, delayMs);
+        insertCommand_l(queuedCommand, delayMs);
         mWaitWorkCV.signal();
     }
-    Mutex::Autolock _l(command->mLock);
-    while (command->mWaitStatus) {
-        nsecs_t timeOutNs = kAudioCommandTimeoutNs + milliseconds(delayMs);
-        if (command->mCond.waitRelative(command->mLock, timeOutNs) != NO_ERROR) {
-            command->mStatus = TIMED_OUT;
-            command->mWaitStatus = false;
+    Mutex::Autolock _l(queuedCommand->mLock);
+    const nsecs_t deadline = systemTime() + kAudioCommandTimeoutNs + milliseconds(delayMs);
+    while (queuedCommand->mWaitStatus) {
+        nsecs_t timeOutNs = deadline - systemTime();
+        if (timeOutNs <= 0 ||
+                queuedCommand->mCond.waitRelative(queuedCommand->mLock, timeOutNs) != NO_ERROR) {
+            // other callers may wait for the same command: leave it to the thread loop
+            if (queuedCommand->mWaitStatus) {
+                return TIMED_OUT;
+            }
         }
     }
-    return command->mStatus;
+    return queuedCommand->mStatus;
+}
+
+void AudioPolicyService::AudioCommandThread::postCommand(sp<AudioCommand>& command, int delayMs,
+                                                         const sp<CommandCallback>& callback)
+{
+    command->mWaitStatus = false;
+    if (callback != 0) {
+        command->mCallbacks.add(callback);
+    }
+    Mutex::Autolock _l(mLock);
+    insertCommand_l(command, delayMs);
+    mWaitWorkCV.signal();
+}
+
+// Merges a command to execute now into a pending command with the same target, so that a burst
+// of changes reaches AudioFlinger as a single call with the last value.
+// Volume commands for different streams or outputs are independent: a volume command can be
+// merged into a pending one across the volume commands queued after it. A parameters command
+// is only merged into the last pending command, and only if it sets all of its keys, as the HAL
+// may depend on the order and grouping of parameters.
+// coalesceCommand_l() must be called with mLock held
+bool AudioPolicyService::AudioCommandThread::coalesceCommand_l(sp<AudioCommand>& command)
+{
+    sp<AudioCommand> target;
+
+    switch (command->mCommand) {
+    case SET_VOLUME: {
+        VolumeData *data = (VolumeData *)command->mParam.get();
+        for (ssize_t i = mAudioCommands.size() - 1; i >= 0; i--) {
+            sp<AudioCommand> command2 = mAudioCommands[i];
+            if (command2->mCommand != SET_VOLUME || command2->mTime > command->mTime) {
+                break;
+            }
+            VolumeData *data2 = (VolumeData *)command2->mParam.get();
+            if (data2->mIO == data->mIO && data2->mStream == data->mStream) {
+                ALOGV("Merging volume %f into pending command on output %d for stream %d",
+                        data->mVolume, data->mIO, data->mStream);
+                data2->mVolume = data->mVolume;
+                target = command2;
+                break;
+            }
+        }
+    } break;
+
+    case SET_PARAMETERS: {
+        if (mAudioCommands.isEmpty()) {
+            break;
+        }
+        sp<AudioCommand> command2 = mAudioCommands.top();
+        if (command2->mCommand != SET_PARAMETERS || command2->mTime > command->mTime) {
+            break;
+        }
+        ParametersData *data = (ParametersData *)command->mParam.get();
+        ParametersData *data2 = (ParametersData *)command2->mParam.get();
+        if (data->mIO != data2->mIO) {
+            break;
+        }
+        AudioParameter param = AudioParameter(data->mKeyValuePairs);
+        AudioParameter param2 = AudioParameter(data2->mKeyValuePairs);
+        size_t k;
+        for (k = 0; k < param2.size(); k++) {
+            String8 key2;
+            String8 value2;
+            String8 value;
+            param2.getAt(k, key2, value2);
+            if (param.get(key2, value) != NO_ERROR) {
+                break;
+            }
+        }
+        if (k != param2.size()) {
+            break;
+        }
+        ALOGV("Replacing pending parameter command %s by %s",
+                data2->mKeyValuePairs.string(), data->mKeyValuePairs.string());
+        data2->mKeyValuePairs = data->mKeyValuePairs;
+        target = command2;
+    } break;
+
+    default:
+        break;
+    }
+
+    if (target == 0) {
+        return false;
+    }
+    target->mCallbacks.appendVector(command->mCallbacks);
+    if (command->mWaitStatus) {
+        Mutex::Autolock _l(target->mLock);
+        target->mWaitStatus = true;
+    }
+    mCoalescedCount[command->mCommand]++;
+    command = target;
+    return true;
+}
+
+// updateLatencyStats_l() must be called with mLock held
+void AudioPolicyService::AudioCommandThread::updateLatencyStats_l(
+                                                        const sp<AudioCommand>& command,
+                                                        nsecs_t now)
+{
+    if (command->mCommand < 0 || command->mCommand >= NUM_COMMANDS) {
+        return;
+    }
+    const nsecs_t latencyNs = now - command->mTime;
+    size_t bucket = 0;
+    while (bucket < kNumLatencyBuckets - 1 && latencyNs >= kLatencyBucketBoundsNs[bucket]) {
+        bucket++;
+    }
+    mLatencyHistogram[command->mCommand][bucket]++;
+    if (latencyNs > mMaxLatencyNs[command->mCommand]) {
+        mMaxLatencyNs[command->mCommand] = latencyNs;
+    }
 }
 
 // insertCommand_l() must be called with mLock held
@@ -944,6 +1190,12 @@ void AudioPolicyService::AudioCommandThread::insertCommand_l(sp<AudioCommand>& c
     Vector < sp<AudioCommand> > removedCommands;
     command->mTime = systemTime() + milliseconds(delayMs);
 
+    // a command to execute now replaces a pending one with the same target: the caller
+    // gets the merged command back
+    if (delayMs == 0 && coalesceCommand_l(command)) {
+        return;
+    }
+
     // acquire wake lock to make sure delayed commands are processed
     if (mAudioCommands.isEmpty()) {
         acquire_wake_lock(PARTIAL_WAKE_LOCK, mName.string());
@@ -1094,6 +1346,8 @@ void AudioPolicyService::AudioCommandThread::insertCommand_l(sp<AudioCommand>& c
         for (size_t k = i + 1; k < mAudioCommands.size(); k++) {
             if (mAudioCommands[k].get() == removedCommands[j].get()) {
                 ALOGV("suppressing command: %d", mAudioCommands[k]->mCommand);
+                // the command replacing it completes the non blocking submissions
+                command->mCallbacks.appendVector(removedCommands[j]->mCallbacks);
                 mAudioCommands.removeAt(k);
                 break;
             }
@@ -1142,8 +1396,13 @@ void AudioPolicyService::setParameters(audio_io_handle_t ioHandle,
                                        const char *keyValuePairs,
                                        int delayMs)
 {
-    mAudioCommandThread->parametersCommand(ioHandle, keyValuePairs,
-                                           delayMs);
+    // The status is not returned: only wait for immediate changes, which the policy manager
+    // may rely on when it returns.
+    if (delayMs != 0) {
+        mAudioCommandThread->asyncParametersCommand(ioHandle, keyValuePairs, delayMs);
+    } else {
+        mAudioCommandThread->parametersCommand(ioHandle, keyValuePairs);
+    }
 }
 
 int AudioPolicyService::setStreamVolume(audio_stream_type_t stream,
@@ -1151,8 +1410,12 @@ int AudioPolicyService::setStreamVolume(audio_stream_type_t stream,
                                         audio_io_handle_t output,
                                         int delayMs)
 {
-    return (int)mAudioCommandThread->volumeCommand(stream, volume,
-                                                   output, delayMs);
+    // A delayed command never returned its status: do not block binder threads to queue it.
+    if (delayMs != 0) {
+        mAudioCommandThread->asyncVolumeCommand(stream, volume, output, delayMs);
+        return NO_ERROR;
+    }
+    return (int)mAudioCommandThread->volumeCommand(stream, volume, output);
 }
 
 int AudioPolicyService::startTone(audio_policy_tone_t tone,
@@ -1178,7 +1441,9 @@ int AudioPolicyService::stopTone()
 
 int AudioPolicyService::setVoiceVolume(float volume, int delayMs)
 {
-    return (int)mAudioCommandThread->voiceVolumeCommand(volume, delayMs);
+    // The policy manager ignores the status and calls this with its lock held.
+    mAudioCommandThread->asyncVoiceVolumeCommand(volume, delayMs);
+    return NO_ERROR;
 }
 
 extern "C" {
@@ -245,6 +245,7 @@ private:
 
             status_t dumpInternals(int fd);
 
+public:
     // Thread used for tone playback and to send audio config commands to audio flinger
     // For tone playback, using a separate thread is necessary to avoid deadlock with mLock because
     // startTone() and stopTone() are normally called with mLock locked and requesting a tone start
@@ -271,10 +272,36 @@ private:
             UPDATE_AUDIOPATCH_LIST,
             SET_AUDIOPORT_CONFIG,
             DYN_POLICY_MIX_STATE_UPDATE,
-            RECORDING_CONFIGURATION_UPDATE
+            RECORDING_CONFIGURATION_UPDATE,
+            NUM_COMMANDS
+        };
+
+        // Receives the status of a command submitted without waiting for it. Called on the
+        // command thread once the command is executed, or once the command which replaced it
+        // is.
+        class CommandCallback : public virtual RefBase {
+        public:
+            virtual void onCommandComplete(int command, status_t status) = 0;
+        protected:
+            virtual ~CommandCallback() {}
+        };
+
+        // The AudioFlinger calls executing SET_VOLUME, SET_PARAMETERS and SET_VOICE_VOLUME
+        // commands, made on the command thread with its lock held. Goes through AudioSystem
+        // unless another implementation is given to the constructor.
+        class AudioFlingerInterface : public virtual RefBase {
+        public:
+            virtual status_t setStreamVolume(audio_stream_type_t stream, float volume,
+                                             audio_io_handle_t output) = 0;
+            virtual status_t setParameters(audio_io_handle_t ioHandle,
+                                           const String8& keyValuePairs) = 0;
+            virtual status_t setVoiceVolume(float volume) = 0;
+        protected:
+            virtual ~AudioFlingerInterface() {}
         };
 
-        AudioCommandThread (String8 name, const wp<AudioPolicyService>& service);
+        AudioCommandThread (String8 name, const wp<AudioPolicyService>& service,
+                            const sp<AudioFlingerInterface>& audioFlinger = NULL);
         virtual             ~AudioCommandThread();
 
                     status_t    dump(int fd);
@@ -292,6 +319,16 @@ private:
                     status_t    parametersCommand(audio_io_handle_t ioHandle,
                                             const char *keyValuePairs, int delayMs = 0);
                     status_t    voiceVolumeCommand(float volume, int delayMs = 0);
+                    // non blocking versions of volumeCommand(), parametersCommand() and
+                    // voiceVolumeCommand()
+                    void        asyncVolumeCommand(audio_stream_type_t stream, float volume,
+                                            audio_io_handle_t output, int delayMs = 0,
+                                            const sp<CommandCallback>& callback = NULL);
+                    void        asyncParametersCommand(audio_io_handle_t ioHandle,
+                                            const char *keyValuePairs, int delayMs = 0,
+                                            const sp<CommandCallback>& callback = NULL);
+                    void        asyncVoiceVolumeCommand(float volume, int delayMs = 0,
+                                            const sp<CommandCallback>& callback = NULL);
                     status_t    startOutputCommand(audio_io_handle_t output,
                                                    audio_stream_type_t stream,
                                                    audio_session_t session);
@@ -302,6 +339,9 @@ private:
                                                      audio_stream_type_t stream,
                                                      audio_session_t session);
                     status_t    sendCommand(sp<AudioCommand>& command, int delayMs = 0);
+                    // queues the command and returns without waiting for its status
+                    void        postCommand(sp<AudioCommand>& command, int delayMs = 0,
+                                            const sp<CommandCallback>& callback = NULL);
                     void        insertCommand_l(sp<AudioCommand>& command, int delayMs = 0);
                     status_t    createAudioPatchCommand(const struct audio_patch *patch,
                                                         audio_patch_handle_t *handle,
@@ -324,6 +364,14 @@ private:
     private:
         class AudioCommandData;
 
+        // upper bounds of the command latency histogram buckets, the last one is open
+        static const nsecs_t kLatencyBucketBoundsNs[];
+        static const size_t kNumLatencyBuckets = 10;
+
+        // merges the command into a pending one when possible, see insertCommand_l()
+        bool        coalesceCommand_l(sp<AudioCommand>& command);
+        void        updateLatencyStats_l(const sp<AudioCommand>& command, nsecs_t now);
+
         // descriptor for requested tone playback event
         class AudioCommand: public RefBase {
 
@@ -340,6 +388,8 @@ private:
             status_t mStatus; // command status
             bool mWaitStatus; // true if caller is waiting for status
             sp<AudioCommandData> mParam;     // command specific parameter data
+            // callbacks of the non blocking submissions this command stands for
+            Vector< sp<CommandCallback> > mCallbacks;
         };
 
         class AudioCommandData: public RefBase {
@@ -433,8 +483,14 @@ private:
         sp<AudioCommand> mLastCommand;      // last processed command (used by dump)
         String8 mName;                      // string used by wake lock fo delayed commands
         wp<AudioPolicyService> mService;
+        const sp<AudioFlingerInterface> mAudioFlinger;
+        // per command type statistics, from the scheduled time to the end of the execution
+        uint32_t mLatencyHistogram[NUM_COMMANDS][kNumLatencyBuckets];
+        nsecs_t mMaxLatencyNs[NUM_COMMANDS];
+        uint32_t mCoalescedCount[NUM_COMMANDS]; // commands merged into a pending one
     };
 
+private:
     class AudioPolicyClient : public AudioPolicyClientInterface
     {
      public:
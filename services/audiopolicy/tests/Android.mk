@@ -0,0 +1,124 @@
+LOCAL_PATH:= $(call my-dir)
+
+# The tests load synthetic XML configurations
+ifeq ($(USE_XML_AUDIO_POLICY_CONF), 1)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    audiopolicy_volume_tests.cpp
+
+LOCAL_C_INCLUDES := \
+    $(TOPDIR)frameworks/av/services/audiopolicy \
+    $(TOPDIR)frameworks/av/services/audiopolicy/common/include \
+    $(TOPDIR)frameworks/av/services/audiopolicy/engine/interface \
+    $(TOPDIR)frameworks/av/services/audiopolicy/managerdefault \
+    $(TOPDIR)frameworks/av/services/audiopolicy/utilities
+
+LOCAL_SHARED_LIBRARIES := \
+    libaudiopolicymanagerdefault \
+    libcutils \
+    libicuuc \
+    liblog \
+    libmedia \
+    libutils
+
+LOCAL_STATIC_LIBRARIES := \
+    libaudiopolicycomponents \
+    libxml2
+
+LOCAL_CFLAGS := -DUSE_XML_AUDIO_POLICY_CONF -Wall -Werror
+
+LOCAL_MULTILIB := $(AUDIOSERVER_MULTILIB)
+
+LOCAL_MODULE := audiopolicy_volume_tests
+LOCAL_MODULE_TAGS := tests
+
+include $(BUILD_NATIVE_TEST)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    audiopolicy_routing_tests.cpp
+
+LOCAL_C_INCLUDES := \
+    $(TOPDIR)frameworks/av/services/audiopolicy \
+    $(TOPDIR)frameworks/av/services/audiopolicy/common/include \
+    $(TOPDIR)frameworks/av/services/audiopolicy/engine/interface \
+    $(TOPDIR)frameworks/av/services/audiopolicy/managerdefault \
+    $(TOPDIR)frameworks/av/services/audiopolicy/utilities
+
+LOCAL_SHARED_LIBRARIES := \
+    libaudiopolicymanagerdefault \
+    libcutils \
+    libicuuc \
+    liblog \
+    libmedia \
+    libutils
+
+LOCAL_STATIC_LIBRARIES := \
+    libaudiopolicycomponents \
+    libxml2
+
+LOCAL_CFLAGS := -DUSE_XML_AUDIO_POLICY_CONF -Wall -Werror
+
+LOCAL_MULTILIB := $(AUDIOSERVER_MULTILIB)
+
+LOCAL_MODULE := audiopolicy_routing_tests
+LOCAL_MODULE_TAGS := tests
+
+include $(BUILD_NATIVE_TEST)
+
+endif #ifeq ($(USE_XML_AUDIO_POLICY_CONF), 1)
+
+# The command thread test builds the service sources: libaudiopolicyservice hides its symbols
+ifneq ($(USE_LEGACY_AUDIO_POLICY), 1)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    audiopolicy_command_tests.cpp \
+    ../service/AudioPolicyService.cpp \
+    ../service/AudioPolicyEffects.cpp \
+    ../service/AudioPolicyInterfaceImpl.cpp \
+    ../service/AudioPolicyClientImpl.cpp
+
+LOCAL_C_INCLUDES := \
+    $(TOPDIR)frameworks/av/services/audioflinger \
+    $(TOPDIR)frameworks/av/services/audiopolicy/service \
+    $(call include-path-for, audio-effects) \
+    $(call include-path-for, audio-utils) \
+    $(TOPDIR)frameworks/av/services/audiopolicy/common/include \
+    $(TOPDIR)frameworks/av/services/audiopolicy/engine/interface \
+    $(TOPDIR)frameworks/av/services/audiopolicy/utilities
+
+LOCAL_SHARED_LIBRARIES := \
+    libaudiopolicymanager \
+    libbinder \
+    libcutils \
+    libhardware \
+    libhardware_legacy \
+    liblog \
+    libmedia \
+    libserviceutility \
+    libutils
+
+LOCAL_STATIC_LIBRARIES := \
+    libmedia_helper \
+    libaudiopolicycomponents
+# DOLBY_START
+ifeq ($(strip $(DOLBY_ENABLE)),true)
+    LOCAL_CFLAGS += $(dolby_cflags)
+endif
+# DOLBY_END
+
+LOCAL_CFLAGS += -Wall -Werror
+
+LOCAL_MULTILIB := $(AUDIOSERVER_MULTILIB)
+
+LOCAL_MODULE := audiopolicy_command_tests
+LOCAL_MODULE_TAGS := tests
+
+include $(BUILD_NATIVE_TEST)
+
+endif #ifneq ($(USE_LEGACY_AUDIO_POLICY), 1)
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <AudioPolicyInterface.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+// An AudioPolicyClientInterface that opens every stream and patch it is asked for without any
+// HAL behind it, and counts the calls the benchmarks are interested in.
+class AudioPolicyTestClient : public AudioPolicyClientInterface
+{
+public:
+    AudioPolicyTestClient()
+        : mNextUniqueId(0),
+          mNextPatchHandle(AUDIO_PATCH_HANDLE_NONE),
+          mLastOutputFlags(AUDIO_OUTPUT_FLAG_NONE),
+          mStreamVolumeCount(0),
+          mPatchCount(0) {}
+    virtual ~AudioPolicyTestClient() {}
+
+    virtual audio_module_handle_t loadHwModule(const char * /*name*/)
+    {
+        return newAudioUniqueId(AUDIO_UNIQUE_ID_USE_MODULE);
+    }
+
+    virtual status_t openOutput(audio_module_handle_t /*module*/,
+                                audio_io_handle_t *output,
+                                audio_config_t * /*config*/,
+                                audio_devices_t * /*devices*/,
+                                const String8& /*address*/,
+                                uint32_t * /*latencyMs*/,
+                                audio_output_flags_t flags)
+    {
+        *output = newAudioUniqueId(AUDIO_UNIQUE_ID_USE_OUTPUT);
+        mOutputs.add(*output);
+        mLastOutputFlags = flags;
+        return NO_ERROR;
+    }
+    virtual audio_io_handle_t openDuplicateOutput(audio_io_handle_t /*output1*/,
+                                                  audio_io_handle_t /*output2*/)
+    {
+        return newAudioUniqueId(AUDIO_UNIQUE_ID_USE_OUTPUT);
+    }
+    virtual status_t closeOutput(audio_io_handle_t output)
+    {
+        for (size_t i = 0; i < mOutputs.size(); i++) {
+            if (mOutputs[i] == output) {
+                mOutputs.removeAt(i);
+                break;
+            }
+        }
+        return NO_ERROR;
+    }
+    virtual status_t suspendOutput(audio_io_handle_t /*output*/) { return NO_ERROR; }
+    virtual status_t restoreOutput(audio_io_handle_t /*output*/) { return NO_ERROR; }
+
+    virtual status_t openInput(audio_module_handle_t /*module*/,
+                               audio_io_handle_t *input,
+                               audio_config_t * /*config*/,
+                               audio_devices_t * /*device*/,
+                               const String8& /*address*/,
+                               audio_source_t /*source*/,
+                               audio_input_flags_t /*flags*/)
+    {
+        *input = newAudioUniqueId(AUDIO_UNIQUE_ID_USE_INPUT);
+        return NO_ERROR;
+    }
+    virtual status_t closeInput(audio_io_handle_t /*input*/) { return NO_ERROR; }
+
+    virtual status_t setStreamVolume(audio_stream_type_t /*stream*/, float /*volume*/,
+                                     audio_io_handle_t /*output*/, int /*delayMs*/)
+    {
+        mStreamVolumeCount++;
+        return NO_ERROR;
+    }
+    virtual status_t invalidateStream(audio_stream_type_t /*stream*/) { return NO_ERROR; }
+    virtual void setParameters(audio_io_handle_t /*ioHandle*/, const String8& /*keyValuePairs*/,
+                               int /*delayMs*/) {}
+    virtual String8 getParameters(audio_io_handle_t /*ioHandle*/, const String8& /*keys*/)
+    {
+        return String8();
+    }
+    virtual status_t startTone(audio_policy_tone_t /*tone*/, audio_stream_type_t /*stream*/)
+    {
+        return NO_ERROR;
+    }
+    virtual status_t stopTone() { return NO_ERROR; }
+    virtual status_t setVoiceVolume(float /*volume*/, int /*delayMs*/) { return NO_ERROR; }
+    virtual status_t moveEffects(audio_session_t /*session*/,
+                                 audio_io_handle_t /*srcOutput*/,
+                                 audio_io_handle_t /*dstOutput*/)
+    {
+        return NO_ERROR;
+    }
+
+    virtual status_t createAudioPatch(const struct audio_patch * /*patch*/,
+                                      audio_patch_handle_t *handle,
+                                      int /*delayMs*/)
+    {
+        *handle = ++mNextPatchHandle;
+        mPatchCount++;
+        return NO_ERROR;
+    }
+    virtual status_t releaseAudioPatch(audio_patch_handle_t /*handle*/, int /*delayMs*/)
+    {
+        return NO_ERROR;
+    }
+    virtual status_t setAudioPortConfig(const struct audio_port_config * /*config*/,
+                                        int /*delayMs*/)
+    {
+        return NO_ERROR;
+    }
+    virtual void onAudioPortListUpdate() {}
+    virtual void onAudioPatchListUpdate() {}
+
+    virtual audio_unique_id_t newAudioUniqueId(audio_unique_id_use_t use)
+    {
+        // same layout as the ids allocated by AudioFlinger::nextUniqueId()
+        return (audio_unique_id_t)((++mNextUniqueId * AUDIO_UNIQUE_ID_USE_MAX) | use);
+    }
+
+    virtual void onDynamicPolicyMixStateUpdate(String8 /*regId*/, int32_t /*state*/) {}
+    virtual void onRecordingConfigurationUpdate(int /*event*/, audio_session_t /*session*/,
+                    audio_source_t /*source*/,
+                    const struct audio_config_base * /*clientConfig*/,
+                    const struct audio_config_base * /*deviceConfig*/,
+                    audio_patch_handle_t /*patchHandle*/) {}
+
+    // outputs currently opened
+    const Vector<audio_io_handle_t>& getOutputs() const { return mOutputs; }
+    bool isOutputOpen(audio_io_handle_t output) const
+    {
+        for (size_t i = 0; i < mOutputs.size(); i++) {
+            if (mOutputs[i] == output) {
+                return true;
+            }
+        }
+        return false;
+    }
+    // flags of the last output opened
+    audio_output_flags_t getLastOutputFlags() const { return mLastOutputFlags; }
+    // setStreamVolume() and createAudioPatch() calls since the start
+    uint32_t getStreamVolumeCount() const { return mStreamVolumeCount; }
+    uint32_t getPatchCount() const { return mPatchCount; }
+
+private:
+    uint32_t mNextUniqueId;
+    audio_patch_handle_t mNextPatchHandle;
+    Vector<audio_io_handle_t> mOutputs;
+    audio_output_flags_t mLastOutputFlags;
+    uint32_t mStreamVolumeCount;
+    uint32_t mPatchCount;
+};
+
+}; // namespace android
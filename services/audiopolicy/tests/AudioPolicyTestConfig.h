@@ -0,0 +1,292 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <sstream>
+#include <string>
+
+#include <TypeConverter.h>
+#include <Volume.h>
+
+namespace android {
+
+// Builds a synthetic audio_policy_configuration.xml, so that the policy manager can be
+// benchmarked on configurations larger than the ones of the devices at hand.
+class AudioPolicyTestConfig
+{
+public:
+    AudioPolicyTestConfig() : mOutputCount(1), mExternalPortCount(0) {}
+
+    // Mix ports of the primary module, besides the primary output. They all reach the speaker
+    // and the wired headset and headphones, so they are all opened at start up.
+    void setOutputCount(size_t count) { mOutputCount = count; }
+
+    // When not 0, adds a compressed offload output to the primary module, and a2dp, usb and
+    // r_submix modules. The usb module has that many direct outputs, one per sampling rate
+    // (see usbSamplingRate()), and the r_submix module that many outputs, each with its own
+    // device address. None of their devices is attached, so their outputs are not opened at
+    // start up.
+    void setExternalPortCount(size_t count) { mExternalPortCount = count; }
+
+    static uint32_t usbSamplingRate(size_t index) { return 8000 + 1000 * index; }
+
+    std::string toXml() const
+    {
+        std::ostringstream xml;
+        xml << "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+            << "<audioPolicyConfiguration version=\"1.0\">\n"
+            << "    <globalConfiguration speaker_drc_enabled=\"false\"/>\n"
+            << "    <modules>\n";
+        writePrimaryModule(xml);
+        if (mExternalPortCount != 0) {
+            writeA2dpModule(xml);
+            writeUsbModule(xml);
+            writeRemoteSubmixModule(xml);
+        }
+        xml << "    </modules>\n";
+        writeVolumes(xml);
+        xml << "</audioPolicyConfiguration>\n";
+        return xml.str();
+    }
+
+    // Returns false if the file could not be written.
+    bool write(const char *path) const
+    {
+        FILE *file = fopen(path, "w");
+        if (file == NULL) {
+            return false;
+        }
+        const std::string xml = toXml();
+        bool written = fwrite(xml.data(), 1, xml.size(), file) == xml.size();
+        return fclose(file) == 0 && written;
+    }
+
+private:
+    static void writeProfile(std::ostringstream &xml, const char *channelMask,
+                             uint32_t samplingRate = 48000,
+                             const char *format = "AUDIO_FORMAT_PCM_16_BIT")
+    {
+        xml << "                    <profile name=\"\" format=\"" << format << "\""
+            << " samplingRates=\"" << samplingRate << "\" channelMasks=\"" << channelMask
+            << "\"/>\n";
+    }
+
+    static void writeDevicePort(std::ostringstream &xml, const std::string &tagName,
+                                const char *type, const char *role, const char *channelMask,
+                                const std::string &address = "")
+    {
+        xml << "                <devicePort tagName=\"" << tagName << "\" type=\"" << type
+            << "\" role=\"" << role << "\"";
+        if (!address.empty()) {
+            xml << " address=\"" << address << "\"";
+        }
+        xml << ">\n";
+        writeProfile(xml, channelMask);
+        xml << "                </devicePort>\n";
+    }
+
+    static void writeMixPort(std::ostringstream &xml, const std::string &name, const char *flags,
+                             uint32_t samplingRate = 48000)
+    {
+        xml << "                <mixPort name=\"" << name << "\" role=\"source\"";
+        if (flags != NULL) {
+            xml << " flags=\"" << flags << "\"";
+        }
+        xml << ">\n";
+        writeProfile(xml, "AUDIO_CHANNEL_OUT_STEREO", samplingRate);
+        xml << "                </mixPort>\n";
+    }
+
+    static void writeRoute(std::ostringstream &xml, const std::string &sink,
+                           const std::string &sources)
+    {
+        xml << "                <route type=\"mix\" sink=\"" << sink
+            << "\" sources=\"" << sources << "\"/>\n";
+    }
+
+    static std::string indexedName(const char *prefix, size_t index)
+    {
+        std::ostringstream name;
+        name << prefix << index;
+        return name.str();
+    }
+
+    static std::string outputName(size_t index) { return indexedName("output ", index); }
+
+    void writePrimaryModule(std::ostringstream &xml) const
+    {
+        xml << "        <module name=\"primary\" halVersion=\"3.0\">\n"
+            << "            <attachedDevices>\n"
+            << "                <item>Speaker</item>\n"
+            << "                <item>Built-In Mic</item>\n"
+            << "            </attachedDevices>\n"
+            << "            <defaultOutputDevice>Speaker</defaultOutputDevice>\n"
+            << "            <mixPorts>\n"
+            << "                <mixPort name=\"primary output\" role=\"source\""
+            << " flags=\"AUDIO_OUTPUT_FLAG_PRIMARY\">\n";
+        writeProfile(xml, "AUDIO_CHANNEL_OUT_STEREO");
+        xml << "                </mixPort>\n";
+        for (size_t i = 0; i < mOutputCount; i++) {
+            xml << "                <mixPort name=\"" << outputName(i) << "\" role=\"source\">\n";
+            writeProfile(xml, "AUDIO_CHANNEL_OUT_STEREO");
+            xml << "                </mixPort>\n";
+        }
+        if (mExternalPortCount != 0) {
+            xml << "                <mixPort name=\"compressed offload\" role=\"source\""
+                << " flags=\"AUDIO_OUTPUT_FLAG_DIRECT|AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD|"
+                << "AUDIO_OUTPUT_FLAG_NON_BLOCKING\">\n";
+            writeProfile(xml, "AUDIO_CHANNEL_OUT_STEREO", 44100, "AUDIO_FORMAT_MP3");
+            xml << "                </mixPort>\n";
+        }
+        xml << "                <mixPort name=\"primary input\" role=\"sink\">\n";
+        writeProfile(xml, "AUDIO_CHANNEL_IN_MONO");
+        xml << "                </mixPort>\n"
+            << "            </mixPorts>\n"
+            << "            <devicePorts>\n";
+        writeDevicePort(xml, "Earpiece", "AUDIO_DEVICE_OUT_EARPIECE", "sink",
+                        "AUDIO_CHANNEL_OUT_MONO");
+        writeDevicePort(xml, "Speaker", "AUDIO_DEVICE_OUT_SPEAKER", "sink",
+                        "AUDIO_CHANNEL_OUT_STEREO");
+        writeDevicePort(xml, "Wired Headset", "AUDIO_DEVICE_OUT_WIRED_HEADSET", "sink",
+                        "AUDIO_CHANNEL_OUT_STEREO");
+        writeDevicePort(xml, "Wired Headphones", "AUDIO_DEVICE_OUT_WIRED_HEADPHONE", "sink",
+                        "AUDIO_CHANNEL_OUT_STEREO");
+        writeDevicePort(xml, "Built-In Mic", "AUDIO_DEVICE_IN_BUILTIN_MIC", "source",
+                        "AUDIO_CHANNEL_IN_MONO");
+        xml << "            </devicePorts>\n"
+            << "            <routes>\n";
+        std::string outputs = "primary output";
+        for (size_t i = 0; i < mOutputCount; i++) {
+            outputs += "," + outputName(i);
+        }
+        if (mExternalPortCount != 0) {
+            outputs += ",compressed offload";
+        }
+        const char *sinks[] = { "Earpiece", "Speaker", "Wired Headset", "Wired Headphones" };
+        for (size_t i = 0; i < sizeof(sinks) / sizeof(sinks[0]); i++) {
+            writeRoute(xml, sinks[i], outputs);
+        }
+        xml << "                <route type=\"mix\" sink=\"primary input\""
+            << " sources=\"Built-In Mic\"/>\n"
+            << "            </routes>\n"
+            << "        </module>\n";
+    }
+
+    static void writeA2dpModule(std::ostringstream &xml)
+    {
+        xml << "        <module name=\"a2dp\" halVersion=\"2.0\">\n"
+            << "            <mixPorts>\n";
+        writeMixPort(xml, "a2dp output", NULL, 44100);
+        xml << "            </mixPorts>\n"
+            << "            <devicePorts>\n";
+        const char *sinks[][2] = {
+            { "BT A2DP Out", "AUDIO_DEVICE_OUT_BLUETOOTH_A2DP" },
+            { "BT A2DP Headphones", "AUDIO_DEVICE_OUT_BLUETOOTH_A2DP_HEADPHONES" },
+            { "BT A2DP Speaker", "AUDIO_DEVICE_OUT_BLUETOOTH_A2DP_SPEAKER" },
+        };
+        for (size_t i = 0; i < sizeof(sinks) / sizeof(sinks[0]); i++) {
+            writeDevicePort(xml, sinks[i][0], sinks[i][1], "sink", "AUDIO_CHANNEL_OUT_STEREO");
+        }
+        xml << "            </devicePorts>\n"
+            << "            <routes>\n";
+        for (size_t i = 0; i < sizeof(sinks) / sizeof(sinks[0]); i++) {
+            writeRoute(xml, sinks[i][0], "a2dp output");
+        }
+        xml << "            </routes>\n"
+            << "        </module>\n";
+    }
+
+    void writeUsbModule(std::ostringstream &xml) const
+    {
+        xml << "        <module name=\"usb\" halVersion=\"2.0\">\n"
+            << "            <mixPorts>\n";
+        writeMixPort(xml, "usb output", NULL);
+        std::string outputs = "usb output";
+        for (size_t i = 0; i < mExternalPortCount; i++) {
+            const std::string name = indexedName("usb direct ", i);
+            writeMixPort(xml, name, "AUDIO_OUTPUT_FLAG_DIRECT", usbSamplingRate(i));
+            outputs += "," + name;
+        }
+        xml << "            </mixPorts>\n"
+            << "            <devicePorts>\n";
+        writeDevicePort(xml, "USB Device Out", "AUDIO_DEVICE_OUT_USB_DEVICE", "sink",
+                        "AUDIO_CHANNEL_OUT_STEREO");
+        writeDevicePort(xml, "USB Headset Out", "AUDIO_DEVICE_OUT_USB_HEADSET", "sink",
+                        "AUDIO_CHANNEL_OUT_STEREO");
+        xml << "            </devicePorts>\n"
+            << "            <routes>\n";
+        writeRoute(xml, "USB Device Out", outputs);
+        writeRoute(xml, "USB Headset Out", outputs);
+        xml << "            </routes>\n"
+            << "        </module>\n";
+    }
+
+    void writeRemoteSubmixModule(std::ostringstream &xml) const
+    {
+        xml << "        <module name=\"r_submix\" halVersion=\"2.0\">\n"
+            << "            <mixPorts>\n";
+        for (size_t i = 0; i < mExternalPortCount; i++) {
+            writeMixPort(xml, indexedName("r_submix output ", i), NULL);
+        }
+        xml << "            </mixPorts>\n"
+            << "            <devicePorts>\n";
+        for (size_t i = 0; i < mExternalPortCount; i++) {
+            writeDevicePort(xml, indexedName("Remote Submix Out ", i),
+                            "AUDIO_DEVICE_OUT_REMOTE_SUBMIX", "sink", "AUDIO_CHANNEL_OUT_STEREO",
+                            indexedName("", i));
+        }
+        xml << "            </devicePorts>\n"
+            << "            <routes>\n";
+        for (size_t i = 0; i < mExternalPortCount; i++) {
+            writeRoute(xml, indexedName("Remote Submix Out ", i),
+                       indexedName("r_submix output ", i));
+        }
+        xml << "            </routes>\n"
+            << "        </module>\n";
+    }
+
+    // The same curve for every stream and device category, as the policy manager expects
+    // one for each of them.
+    static void writeVolumes(std::ostringstream &xml)
+    {
+        xml << "    <volumes>\n";
+        for (int i = 0; i < AUDIO_STREAM_CNT; i++) {
+            std::string stream;
+            if (!StreamTypeConverter::toString(static_cast<audio_stream_type_t>(i), stream)) {
+                continue;
+            }
+            for (int j = 0; j < DEVICE_CATEGORY_CNT; j++) {
+                std::string category;
+                DeviceCategoryConverter::toString(static_cast<device_category>(j), category);
+                xml << "        <volume stream=\"" << stream << "\" deviceCategory=\""
+                    << category << "\">\n"
+                    << "            <point>1,-5800</point>\n"
+                    << "            <point>20,-4000</point>\n"
+                    << "            <point>60,-1700</point>\n"
+                    << "            <point>100,0</point>\n"
+                    << "        </volume>\n";
+            }
+        }
+        xml << "    </volumes>\n";
+    }
+
+    size_t mOutputCount;
+    size_t mExternalPortCount;
+};
+
+}; // namespace android
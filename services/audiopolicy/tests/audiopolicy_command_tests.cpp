@@ -0,0 +1,471 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "audiopolicy_command_tests"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+#include <utils/Log.h>
+#include <utils/String8.h>
+#include <utils/threads.h>
+#include <utils/Timers.h>
+#include <utils/Vector.h>
+
+#include <AudioPolicyService.h>
+
+namespace android {
+
+static const audio_io_handle_t kOutput = 13;
+static const audio_io_handle_t kOtherOutput = 21;
+static const audio_io_handle_t kFailingOutput = 34;
+// well below the 3 second timeout of a caller
+static const nsecs_t kPromptNs = milliseconds(500);
+
+// Drives AudioCommandThread with a fake AudioFlinger. The command thread is only started once
+// the test has queued its commands, so that they can be merged.
+class AudioCommandThreadTest : public ::testing::Test {
+protected:
+    typedef AudioPolicyService::AudioCommandThread AudioCommandThread;
+
+    // a SET_VOLUME, SET_PARAMETERS or SET_VOICE_VOLUME command received by the fake AudioFlinger
+    struct Call {
+        int mCommand;
+        audio_io_handle_t mIO;
+        audio_stream_type_t mStream;
+        float mVolume;
+        String8 mKeyValuePairs;
+    };
+
+    // Records the calls, and fails the ones for kFailingOutput.
+    class FakeAudioFlinger : public AudioCommandThread::AudioFlingerInterface {
+    public:
+        Vector<Call> getCalls() {
+            Mutex::Autolock _l(mLock);
+            return mCalls;
+        }
+
+        virtual status_t setStreamVolume(audio_stream_type_t stream, float volume,
+                                         audio_io_handle_t output) {
+            Call call;
+            call.mCommand = AudioCommandThread::SET_VOLUME;
+            call.mIO = output;
+            call.mStream = stream;
+            call.mVolume = volume;
+            return addCall(call);
+        }
+
+        virtual status_t setParameters(audio_io_handle_t ioHandle,
+                                       const String8& keyValuePairs) {
+            Call call;
+            call.mCommand = AudioCommandThread::SET_PARAMETERS;
+            call.mIO = ioHandle;
+            call.mStream = AUDIO_STREAM_DEFAULT;
+            call.mVolume = 0;
+            call.mKeyValuePairs = keyValuePairs;
+            return addCall(call);
+        }
+
+        virtual status_t setVoiceVolume(float volume) {
+            Call call;
+            call.mCommand = AudioCommandThread::SET_VOICE_VOLUME;
+            call.mIO = AUDIO_IO_HANDLE_NONE;
+            call.mStream = AUDIO_STREAM_VOICE_CALL;
+            call.mVolume = volume;
+            return addCall(call);
+        }
+
+    private:
+        status_t addCall(const Call& call) {
+            Mutex::Autolock _l(mLock);
+            mCalls.add(call);
+            return call.mIO == kFailingOutput ? BAD_VALUE : NO_ERROR;
+        }
+
+        Mutex mLock;
+        Vector<Call> mCalls;
+    };
+
+    class FakeCommandThread : public AudioCommandThread {
+    public:
+        FakeCommandThread(const sp<FakeAudioFlinger>& audioFlinger)
+            : AudioCommandThread(String8("FakeCommandThread"), wp<AudioPolicyService>(),
+                                 audioFlinger) {}
+
+        // not started on first reference, see start()
+        virtual void onFirstRef() {}
+
+        void start() {
+            run("FakeCommandThread", ANDROID_PRIORITY_AUDIO);
+        }
+    };
+
+    // Collects the completions of non blocking submissions.
+    class Callback : public AudioCommandThread::CommandCallback {
+    public:
+        Callback() : mCount(0), mCommand(-1), mStatus(NO_INIT) {}
+
+        virtual void onCommandComplete(int command, status_t status) {
+            Mutex::Autolock _l(mLock);
+            mCount++;
+            mCommand = command;
+            mStatus = status;
+            mCond.broadcast();
+        }
+
+        // waits for the first completion, returns the number of completions
+        int waitForCompletion() {
+            Mutex::Autolock _l(mLock);
+            if (mCount == 0) {
+                mCond.waitRelative(mLock, kPromptNs);
+            }
+            return mCount;
+        }
+
+        int getCommand() {
+            Mutex::Autolock _l(mLock);
+            return mCommand;
+        }
+
+        status_t getStatus() {
+            Mutex::Autolock _l(mLock);
+            return mStatus;
+        }
+
+    private:
+        Mutex mLock;
+        Condition mCond;
+        int mCount;
+        int mCommand;
+        status_t mStatus;
+    };
+
+    // Sends a command and waits for its status on a thread of its own, as a binder thread of
+    // the service does.
+    class Caller : public Thread {
+    public:
+        Caller(const sp<FakeCommandThread>& commandThread, audio_stream_type_t stream,
+               float volume, audio_io_handle_t output)
+            : Thread(false /*canCallJava*/),
+              mCommandThread(commandThread), mCommand(FakeCommandThread::SET_VOLUME),
+              mIO(output), mStream(stream), mVolume(volume), mStatus(NO_INIT) {}
+
+        Caller(const sp<FakeCommandThread>& commandThread, audio_io_handle_t ioHandle,
+               const char *keyValuePairs)
+            : Thread(false /*canCallJava*/),
+              mCommandThread(commandThread), mCommand(FakeCommandThread::SET_PARAMETERS),
+              mIO(ioHandle), mStream(AUDIO_STREAM_DEFAULT), mVolume(0),
+              mKeyValuePairs(keyValuePairs), mStatus(NO_INIT) {}
+
+        status_t getStatus() const { return mStatus; }
+
+    private:
+        virtual bool threadLoop() {
+            if (mCommand == FakeCommandThread::SET_VOLUME) {
+                mStatus = mCommandThread->volumeCommand(mStream, mVolume, mIO);
+            } else {
+                mStatus = mCommandThread->parametersCommand(mIO, mKeyValuePairs.string());
+            }
+            return false;
+        }
+
+        const sp<FakeCommandThread> mCommandThread;
+        const int mCommand;
+        const audio_io_handle_t mIO;
+        const audio_stream_type_t mStream;
+        const float mVolume;
+        const String8 mKeyValuePairs;
+        status_t mStatus;
+    };
+
+    virtual void SetUp() {
+        mAudioFlinger = new FakeAudioFlinger();
+        mCommandThread = new FakeCommandThread(mAudioFlinger);
+    }
+
+    virtual void TearDown() {
+        mCommandThread->exit();
+        mCommandThread.clear();
+    }
+
+    sp<Caller> startVolumeCaller(audio_stream_type_t stream, float volume,
+                                 audio_io_handle_t output) {
+        sp<Caller> caller = new Caller(mCommandThread, stream, volume, output);
+        caller->run("VolumeCaller");
+        return caller;
+    }
+
+    sp<Caller> startParametersCaller(audio_io_handle_t ioHandle, const char *keyValuePairs) {
+        sp<Caller> caller = new Caller(mCommandThread, ioHandle, keyValuePairs);
+        caller->run("ParametersCaller");
+        return caller;
+    }
+
+    // Reads the number of pending commands and of merges in total from the thread dump.
+    void getQueueState(size_t *pending, uint32_t *coalesced) {
+        *pending = 0;
+        *coalesced = 0;
+        FILE *f = tmpfile();
+        ASSERT_TRUE(f != NULL);
+        mCommandThread->dump(fileno(f));
+        rewind(f);
+        enum { kHeader, kCommands, kLastCommand, kLatency } section = kHeader;
+        char line[256];
+        while (fgets(line, sizeof(line), f) != NULL) {
+            if (strncmp(line, "   Command Time", 15) == 0) {
+                section = kCommands;
+            } else if (strncmp(line, "  Last Command", 14) == 0) {
+                section = kLastCommand;
+            } else if (strncmp(line, "   Command  ", 12) == 0) {
+                section = kLatency;
+            } else if (section == kCommands) {
+                (*pending)++;
+            } else if (section == kLatency && strlen(line) > 21) {
+                // after the command name column
+                uint32_t executed;
+                uint32_t merged;
+                ASSERT_EQ(2, sscanf(line + 21, "%u %u", &executed, &merged));
+                *coalesced += merged;
+            }
+        }
+        fclose(f);
+    }
+
+    // Waits for the queue to hold "pending" commands after "coalesced" merges in total.
+    bool waitForQueue(size_t pending, uint32_t coalesced) {
+        for (int i = 0; i < 1000; i++) {
+            size_t queued;
+            uint32_t merged;
+            getQueueState(&queued, &merged);
+            if (queued == pending && merged == coalesced) {
+                return true;
+            }
+            usleep(1000);
+        }
+        return false;
+    }
+
+    static void expectVolumeCall(const Call& call, audio_stream_type_t stream, float volume,
+                                 audio_io_handle_t output) {
+        EXPECT_EQ(FakeCommandThread::SET_VOLUME, call.mCommand);
+        EXPECT_EQ(stream, call.mStream);
+        EXPECT_EQ(volume, call.mVolume);
+        EXPECT_EQ(output, call.mIO);
+    }
+
+    static void expectParametersCall(const Call& call, audio_io_handle_t ioHandle,
+                                     const char *keyValuePairs) {
+        EXPECT_EQ(FakeCommandThread::SET_PARAMETERS, call.mCommand);
+        EXPECT_EQ(ioHandle, call.mIO);
+        EXPECT_STREQ(keyValuePairs, call.mKeyValuePairs.string());
+    }
+
+    sp<FakeAudioFlinger> mAudioFlinger;
+    sp<FakeCommandThread> mCommandThread;
+};
+
+// Callers waiting on a merged command all get its status once the last volume is applied.
+TEST_F(AudioCommandThreadTest, volume_commands_merged) {
+    sp<Caller> first = startVolumeCaller(AUDIO_STREAM_MUSIC, 0.1f, kOutput);
+    ASSERT_TRUE(waitForQueue(1, 0));
+    sp<Caller> second = startVolumeCaller(AUDIO_STREAM_MUSIC, 0.2f, kOutput);
+    ASSERT_TRUE(waitForQueue(1, 1));
+    sp<Caller> third = startVolumeCaller(AUDIO_STREAM_MUSIC, 0.3f, kOutput);
+    ASSERT_TRUE(waitForQueue(1, 2));
+
+    // every waiter is woken up, not only one of them
+    const nsecs_t start = systemTime();
+    mCommandThread->start();
+    first->join();
+    second->join();
+    third->join();
+    EXPECT_LT(systemTime() - start, kPromptNs);
+    EXPECT_EQ(NO_ERROR, first->getStatus());
+    EXPECT_EQ(NO_ERROR, second->getStatus());
+    EXPECT_EQ(NO_ERROR, third->getStatus());
+
+    Vector<Call> calls = mAudioFlinger->getCalls();
+    ASSERT_EQ(1u, calls.size());
+    expectVolumeCall(calls[0], AUDIO_STREAM_MUSIC, 0.3f, kOutput);
+}
+
+// A volume command is merged across volume commands for other streams and outputs, but not
+// across any other command type.
+TEST_F(AudioCommandThreadTest, volume_commands_keep_order) {
+    Vector< sp<Caller> > callers;
+    callers.add(startVolumeCaller(AUDIO_STREAM_MUSIC, 0.1f, kOutput));
+    ASSERT_TRUE(waitForQueue(1, 0));
+    callers.add(startVolumeCaller(AUDIO_STREAM_RING, 0.5f, kOutput));
+    ASSERT_TRUE(waitForQueue(2, 0));
+    callers.add(startVolumeCaller(AUDIO_STREAM_MUSIC, 0.5f, kOtherOutput));
+    ASSERT_TRUE(waitForQueue(3, 0));
+    callers.add(startVolumeCaller(AUDIO_STREAM_MUSIC, 0.2f, kOutput));
+    ASSERT_TRUE(waitForQueue(3, 1));
+    callers.add(startParametersCaller(kOutput, "routing=2"));
+    ASSERT_TRUE(waitForQueue(4, 1));
+    callers.add(startVolumeCaller(AUDIO_STREAM_MUSIC, 0.3f, kOutput));
+    ASSERT_TRUE(waitForQueue(5, 1));
+
+    mCommandThread->start();
+    for (size_t i = 0; i < callers.size(); i++) {
+        callers[i]->join();
+        EXPECT_EQ(NO_ERROR, callers[i]->getStatus());
+    }
+
+    Vector<Call> calls = mAudioFlinger->getCalls();
+    ASSERT_EQ(5u, calls.size());
+    expectVolumeCall(calls[0], AUDIO_STREAM_MUSIC, 0.2f, kOutput);
+    expectVolumeCall(calls[1], AUDIO_STREAM_RING, 0.5f, kOutput);
+    expectVolumeCall(calls[2], AUDIO_STREAM_MUSIC, 0.5f, kOtherOutput);
+    expectParametersCall(calls[3], kOutput, "routing=2");
+    expectVolumeCall(calls[4], AUDIO_STREAM_MUSIC, 0.3f, kOutput);
+}
+
+// A parameters command only replaces the last pending command, for the same io, and when it
+// sets all of its keys.
+TEST_F(AudioCommandThreadTest, parameters_commands_merged) {
+    Vector< sp<Caller> > callers;
+    callers.add(startParametersCaller(kOutput, "a=1;b=2"));
+    ASSERT_TRUE(waitForQueue(1, 0));
+    callers.add(startParametersCaller(kOutput, "a=3"));
+    ASSERT_TRUE(waitForQueue(2, 0));
+    callers.add(startParametersCaller(kOutput, "a=4;b=5"));
+    ASSERT_TRUE(waitForQueue(2, 1));
+    callers.add(startParametersCaller(kOtherOutput, "a=6;b=7"));
+    ASSERT_TRUE(waitForQueue(3, 1));
+
+    mCommandThread->start();
+    for (size_t i = 0; i < callers.size(); i++) {
+        callers[i]->join();
+        EXPECT_EQ(NO_ERROR, callers[i]->getStatus());
+    }
+
+    Vector<Call> calls = mAudioFlinger->getCalls();
+    ASSERT_EQ(3u, calls.size());
+    expectParametersCall(calls[0], kOutput, "a=1;b=2");
+    expectParametersCall(calls[1], kOutput, "a=4;b=5");
+    expectParametersCall(calls[2], kOtherOutput, "a=6;b=7");
+}
+
+// A delayed volume command is suppressed by a later one for the same stream and output, which
+// takes its place in the queue.
+TEST_F(AudioCommandThreadTest, delayed_volume_command_suppressed) {
+    mCommandThread->start();
+    EXPECT_EQ(NO_ERROR, mCommandThread->volumeCommand(AUDIO_STREAM_MUSIC, 0.1f, kOutput, 200));
+    EXPECT_EQ(NO_ERROR, mCommandThread->volumeCommand(AUDIO_STREAM_MUSIC, 0.2f, kOutput));
+    EXPECT_EQ(0u, mAudioFlinger->getCalls().size());
+
+    usleep(400000);
+    Vector<Call> calls = mAudioFlinger->getCalls();
+    ASSERT_EQ(1u, calls.size());
+    expectVolumeCall(calls[0], AUDIO_STREAM_MUSIC, 0.2f, kOutput);
+}
+
+// A caller that times out does not cut short the wait of the callers merged into its command.
+TEST_F(AudioCommandThreadTest, timed_out_caller) {
+    sp<Caller> first = startVolumeCaller(AUDIO_STREAM_MUSIC, 0.1f, kOutput);
+    ASSERT_TRUE(waitForQueue(1, 0));
+    sleep(2);
+    sp<Caller> second = startVolumeCaller(AUDIO_STREAM_MUSIC, 0.2f, kOutput);
+    ASSERT_TRUE(waitForQueue(1, 1));
+
+    // the command thread is not running yet: the first caller gives up after 3 seconds
+    first->join();
+    EXPECT_EQ(TIMED_OUT, first->getStatus());
+
+    mCommandThread->start();
+    second->join();
+    EXPECT_EQ(NO_ERROR, second->getStatus());
+    ASSERT_EQ(1u, mAudioFlinger->getCalls().size());
+}
+
+// Non blocking submissions return at once, are merged like the blocking ones and complete the
+// callbacks of every submission with the status of the command executed.
+TEST_F(AudioCommandThreadTest, async_commands_complete_callbacks) {
+    sp<Callback> first = new Callback();
+    sp<Callback> second = new Callback();
+    sp<Callback> failing = new Callback();
+    sp<Callback> parameters = new Callback();
+    sp<Callback> voice = new Callback();
+    sp<Callback> lastVoice = new Callback();
+
+    // the command thread is not running: nothing waits for it
+    const nsecs_t start = systemTime();
+    mCommandThread->asyncVolumeCommand(AUDIO_STREAM_MUSIC, 0.1f, kOutput, 0, first);
+    mCommandThread->asyncVolumeCommand(AUDIO_STREAM_MUSIC, 0.2f, kOutput, 0, second);
+    mCommandThread->asyncVolumeCommand(AUDIO_STREAM_MUSIC, 0.3f, kFailingOutput, 0, failing);
+    EXPECT_LT(systemTime() - start, kPromptNs);
+    ASSERT_TRUE(waitForQueue(2, 1));
+
+    // a blocking caller merged into a non blocking submission waits for its execution
+    sp<Caller> caller = startVolumeCaller(AUDIO_STREAM_MUSIC, 0.4f, kOutput);
+    ASSERT_TRUE(waitForQueue(2, 2));
+
+    mCommandThread->asyncParametersCommand(kOutput, "routing=2", 0, parameters);
+    mCommandThread->asyncVoiceVolumeCommand(0.5f, 0, voice);
+    mCommandThread->asyncVoiceVolumeCommand(0.6f, 0, lastVoice);
+    ASSERT_TRUE(waitForQueue(5, 2));
+
+    mCommandThread->start();
+    caller->join();
+    EXPECT_EQ(NO_ERROR, caller->getStatus());
+    EXPECT_EQ(1, first->waitForCompletion());
+    EXPECT_EQ(1, second->waitForCompletion());
+    EXPECT_EQ(1, failing->waitForCompletion());
+    EXPECT_EQ(1, parameters->waitForCompletion());
+    EXPECT_EQ(1, voice->waitForCompletion());
+    EXPECT_EQ(1, lastVoice->waitForCompletion());
+    EXPECT_EQ(FakeCommandThread::SET_VOLUME, first->getCommand());
+    EXPECT_EQ(NO_ERROR, first->getStatus());
+    EXPECT_EQ(NO_ERROR, second->getStatus());
+    EXPECT_EQ(BAD_VALUE, failing->getStatus());
+    EXPECT_EQ(FakeCommandThread::SET_PARAMETERS, parameters->getCommand());
+    EXPECT_EQ(NO_ERROR, parameters->getStatus());
+    EXPECT_EQ(FakeCommandThread::SET_VOICE_VOLUME, voice->getCommand());
+    EXPECT_EQ(NO_ERROR, voice->getStatus());
+
+    // voice volume commands are not merged
+    Vector<Call> calls = mAudioFlinger->getCalls();
+    ASSERT_EQ(5u, calls.size());
+    expectVolumeCall(calls[0], AUDIO_STREAM_MUSIC, 0.4f, kOutput);
+    expectVolumeCall(calls[1], AUDIO_STREAM_MUSIC, 0.3f, kFailingOutput);
+    expectParametersCall(calls[2], kOutput, "routing=2");
+    EXPECT_EQ(FakeCommandThread::SET_VOICE_VOLUME, calls[3].mCommand);
+    EXPECT_EQ(0.5f, calls[3].mVolume);
+    EXPECT_EQ(0.6f, calls[4].mVolume);
+}
+
+// The command suppressing a delayed non blocking submission completes its callback.
+TEST_F(AudioCommandThreadTest, async_delayed_command_suppressed) {
+    sp<Callback> delayed = new Callback();
+    sp<Callback> replacing = new Callback();
+    mCommandThread->start();
+    mCommandThread->asyncParametersCommand(kOutput, "a=1", 200, delayed);
+    mCommandThread->asyncParametersCommand(kOutput, "a=2", 100, replacing);
+    EXPECT_EQ(0u, mAudioFlinger->getCalls().size());
+
+    EXPECT_EQ(1, delayed->waitForCompletion());
+    EXPECT_EQ(1, replacing->waitForCompletion());
+    EXPECT_EQ(NO_ERROR, delayed->getStatus());
+    Vector<Call> calls = mAudioFlinger->getCalls();
+    ASSERT_EQ(1u, calls.size());
+    expectParametersCall(calls[0], kOutput, "a=2");
+}
+
+}  // namespace android
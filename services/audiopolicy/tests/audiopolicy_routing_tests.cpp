@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "audiopolicy_routing_tests"
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+#include <utils/Log.h>
+
+#include <AudioPolicyManager.h>
+
+#include "AudioPolicyTestClient.h"
+#include "AudioPolicyTestConfig.h"
+
+using namespace android;
+
+static const char kUsbAddress[] = "card=1;device=0";
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool createConfigFile(char *path, size_t outputCount, size_t externalPortCount) {
+    const int fd = mkstemp(path);
+    if (fd < 0) {
+        return false;
+    }
+    close(fd);
+    AudioPolicyTestConfig config;
+    config.setOutputCount(outputCount);
+    config.setExternalPortCount(externalPortCount);
+    return config.write(path);
+}
+
+static status_t setUsbDeviceState(AudioPolicyManager *manager, audio_policy_dev_state_t state) {
+    return manager->setDeviceConnectionState(AUDIO_DEVICE_OUT_USB_DEVICE, state, kUsbAddress,
+                                             "usb");
+}
+
+static audio_io_handle_t getDirectOutput(AudioPolicyManager *manager, uint32_t samplingRate) {
+    return manager->getOutput(AUDIO_STREAM_MUSIC, samplingRate, AUDIO_FORMAT_PCM_16_BIT,
+                              AUDIO_CHANNEL_OUT_STEREO, AUDIO_OUTPUT_FLAG_DIRECT, NULL);
+}
+
+static audio_io_handle_t getMixerOutput(AudioPolicyManager *manager) {
+    return manager->getOutput(AUDIO_STREAM_MUSIC, 48000, AUDIO_FORMAT_PCM_16_BIT,
+                              AUDIO_CHANNEL_OUT_STEREO, AUDIO_OUTPUT_FLAG_NONE, NULL);
+}
+
+// Outputs are selected by flags, format and device as they were before the bit mask checks.
+TEST(AudioPolicyManagerRouting, output_selection) {
+    static const size_t kExternalPortCount = 16;
+    char path[] = "/data/local/tmp/audio_policy_test_XXXXXX";
+    ASSERT_TRUE(createConfigFile(path, 4, kExternalPortCount));
+
+    AudioPolicyTestClient client;
+    AudioPolicyManager *manager = new AudioPolicyManager(&client, path);
+    ASSERT_EQ(NO_ERROR, manager->initCheck());
+
+    // no direct PCM output reaches the speaker: a mixer output is returned
+    size_t outputCount = client.getOutputs().size();
+    audio_io_handle_t output = getDirectOutput(manager, AudioPolicyTestConfig::usbSamplingRate(0));
+    EXPECT_TRUE(client.isOutputOpen(output));
+    EXPECT_EQ(outputCount, client.getOutputs().size());
+
+    audio_offload_info_t offloadInfo = AUDIO_INFO_INITIALIZER;
+    offloadInfo.sample_rate = 44100;
+    offloadInfo.channel_mask = AUDIO_CHANNEL_OUT_STEREO;
+    offloadInfo.format = AUDIO_FORMAT_MP3;
+    offloadInfo.stream_type = AUDIO_STREAM_MUSIC;
+    output = manager->getOutput(AUDIO_STREAM_MUSIC, 44100, AUDIO_FORMAT_MP3,
+            AUDIO_CHANNEL_OUT_STEREO, AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD, &offloadInfo);
+    ASSERT_NE(AUDIO_IO_HANDLE_NONE, output);
+    EXPECT_TRUE(client.isOutputOpen(output));
+    EXPECT_NE(0, client.getLastOutputFlags() & AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD);
+    manager->releaseOutput(output, AUDIO_STREAM_MUSIC, AUDIO_SESSION_OUTPUT_MIX);
+    EXPECT_FALSE(client.isOutputOpen(output));
+
+    ASSERT_EQ(NO_ERROR, setUsbDeviceState(manager, AUDIO_POLICY_DEVICE_STATE_AVAILABLE));
+    for (size_t i = 0; i < kExternalPortCount; i++) {
+        output = getDirectOutput(manager, AudioPolicyTestConfig::usbSamplingRate(i));
+        ASSERT_NE(AUDIO_IO_HANDLE_NONE, output);
+        EXPECT_TRUE(client.isOutputOpen(output));
+        EXPECT_EQ(AUDIO_OUTPUT_FLAG_DIRECT, client.getLastOutputFlags());
+        manager->releaseOutput(output, AUDIO_STREAM_MUSIC, AUDIO_SESSION_OUTPUT_MIX);
+    }
+    // no direct profile at this rate: falls back to a mixer output
+    output = getDirectOutput(manager, 48000);
+    EXPECT_NE(AUDIO_IO_HANDLE_NONE, output);
+    EXPECT_TRUE(client.isOutputOpen(output));
+
+    output = getMixerOutput(manager);
+    ASSERT_NE(AUDIO_IO_HANDLE_NONE, output);
+    EXPECT_TRUE(client.isOutputOpen(output));
+
+    ASSERT_EQ(NO_ERROR, setUsbDeviceState(manager, AUDIO_POLICY_DEVICE_STATE_UNAVAILABLE));
+    outputCount = client.getOutputs().size();
+    output = getDirectOutput(manager, AudioPolicyTestConfig::usbSamplingRate(0));
+    EXPECT_TRUE(client.isOutputOpen(output));
+    EXPECT_EQ(outputCount, client.getOutputs().size());
+
+    delete manager;
+    unlink(path);
+}
+
+/* Benchmark
+ *
+ * Reports the latency of direct and mixer output requests, and of usb device connections, on
+ * synthetic configurations with a growing number of usb direct outputs and remote submix
+ * devices.
+ */
+TEST(AudioPolicyManagerRouting, benchmark) {
+    static const size_t kExternalPortCounts[] = { 8, 32, 128 };
+    static const int kRequests = 1000;
+    static const int kConnections = 50;
+
+    printf("%-8s %16s %16s %16s\n", "ports", "direct us", "mixer us", "connection us");
+    for (size_t c = 0; c < sizeof(kExternalPortCounts) / sizeof(kExternalPortCounts[0]); c++) {
+        const size_t portCount = kExternalPortCounts[c];
+        char path[] = "/data/local/tmp/audio_policy_test_XXXXXX";
+        ASSERT_TRUE(createConfigFile(path, 4, portCount));
+
+        AudioPolicyTestClient client;
+        AudioPolicyManager *manager = new AudioPolicyManager(&client, path);
+        ASSERT_EQ(NO_ERROR, manager->initCheck());
+        ASSERT_EQ(NO_ERROR, setUsbDeviceState(manager, AUDIO_POLICY_DEVICE_STATE_AVAILABLE));
+
+        double start = nowSeconds();
+        for (int i = 0; i < kRequests; i++) {
+            const uint32_t samplingRate = AudioPolicyTestConfig::usbSamplingRate(i % portCount);
+            audio_io_handle_t output = getDirectOutput(manager, samplingRate);
+            ASSERT_NE(AUDIO_IO_HANDLE_NONE, output);
+            manager->releaseOutput(output, AUDIO_STREAM_MUSIC, AUDIO_SESSION_OUTPUT_MIX);
+        }
+        const double directUs = (nowSeconds() - start) * 1e6 / kRequests;
+
+        start = nowSeconds();
+        for (int i = 0; i < kRequests; i++) {
+            ASSERT_NE(AUDIO_IO_HANDLE_NONE, getMixerOutput(manager));
+        }
+        const double mixerUs = (nowSeconds() - start) * 1e6 / kRequests;
+
+        start = nowSeconds();
+        for (int i = 0; i < kConnections; i++) {
+            EXPECT_EQ(NO_ERROR,
+                      setUsbDeviceState(manager, AUDIO_POLICY_DEVICE_STATE_UNAVAILABLE));
+            EXPECT_EQ(NO_ERROR,
+                      setUsbDeviceState(manager, AUDIO_POLICY_DEVICE_STATE_AVAILABLE));
+        }
+        const double connectionUs = (nowSeconds() - start) * 1e6 / (2 * kConnections);
+
+        printf("%-8zu %16.1f %16.1f %16.1f\n", portCount, directUs, mixerUs, connectionUs);
+        delete manager;
+        unlink(path);
+    }
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "audiopolicy_volume_tests"
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <utils/Log.h>
+
+#include <AudioPolicyManager.h>
+#include <VolumeCurve.h>
+
+#include "AudioPolicyTestClient.h"
+#include "AudioPolicyTestConfig.h"
+
+using namespace android;
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Curves starting at index 0 and after it, with points at the ends of the range.
+static sp<VolumeCurve> createCurve(bool startsAtZero) {
+    sp<VolumeCurve> curve = new VolumeCurve(DEVICE_CATEGORY_SPEAKER, AUDIO_STREAM_MUSIC);
+    curve->add(CurvePoint(startsAtZero ? 0 : 1, -5800));
+    curve->add(CurvePoint(20, -4000));
+    curve->add(CurvePoint(60, -1700));
+    curve->add(CurvePoint(100, 0));
+    return curve;
+}
+
+// The table returns exactly what the interpolation returns, in and out of the index range.
+TEST(VolumeCurve, table_matches_interpolation) {
+    static const int kIndexRanges[][2] = { { 0, 1 }, { 0, 7 }, { 1, 15 }, { 0, 100 }, { 3, 250 } };
+    for (int startsAtZero = 0; startsAtZero <= 1; startsAtZero++) {
+        sp<VolumeCurve> curve = createCurve(startsAtZero);
+        ASSERT_FALSE(curve->hasDbTable());
+        for (size_t r = 0; r < sizeof(kIndexRanges) / sizeof(kIndexRanges[0]); r++) {
+            const int indexMin = kIndexRanges[r][0];
+            const int indexMax = kIndexRanges[r][1];
+            std::vector<float> expected;
+            for (int index = indexMin - 1; index <= indexMax + 1; index++) {
+                expected.push_back(curve->volIndexToDb(index, indexMin, indexMax));
+            }
+            curve->buildDbTable();
+            ASSERT_TRUE(curve->hasDbTable());
+            for (int index = indexMin - 1; index <= indexMax + 1; index++) {
+                EXPECT_EQ(expected[index - indexMin + 1],
+                          curve->volIndexToDb(index, indexMin, indexMax))
+                        << "range [" << indexMin << ", " << indexMax << "] index " << index;
+            }
+            // a new point discards the table
+            curve->add(CurvePoint(101 + r, 0));
+            EXPECT_FALSE(curve->hasDbTable());
+            curve = createCurve(startsAtZero);
+        }
+    }
+}
+
+/* Benchmarks
+ *
+ * volume_curve reports the cost of volIndexToDb() with and without the table.
+ * routing_change reports the latency of connecting and disconnecting a wired headset while a
+ * synthetic configuration holds many outputs, each change setting the volume of every stream
+ * on every output.
+ */
+TEST(VolumeCurve, benchmark) {
+    static const int kIterations = 1000000;
+    sp<VolumeCurve> curve = createCurve(false);
+    float sum[2] = { 0, 0 };
+    double ns[2];
+    for (int withTable = 0; withTable <= 1; withTable++) {
+        if (withTable) {
+            curve->buildDbTable();
+        }
+        const double start = nowSeconds();
+        for (int i = 0; i < kIterations; i++) {
+            sum[withTable] += curve->volIndexToDb(i % 16, 0, 15);
+        }
+        ns[withTable] = (nowSeconds() - start) * 1e9 / kIterations;
+    }
+    EXPECT_EQ(sum[0], sum[1]);
+    printf("volIndexToDb: %.1f ns interpolated, %.1f ns from the table\n", ns[0], ns[1]);
+}
+
+TEST(AudioPolicyManagerVolume, routing_change) {
+    static const size_t kOutputCounts[] = { 4, 16, 64 };
+    static const int kChanges = 200;
+    char path[] = "/data/local/tmp/audio_policy_test_XXXXXX";
+    const int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+
+    printf("%-8s %12s %12s %16s\n", "outputs", "mean us", "max us", "volumes/change");
+    for (size_t c = 0; c < sizeof(kOutputCounts) / sizeof(kOutputCounts[0]); c++) {
+        AudioPolicyTestConfig config;
+        config.setOutputCount(kOutputCounts[c]);
+        ASSERT_TRUE(config.write(path));
+
+        AudioPolicyTestClient client;
+        AudioPolicyManager *manager = new AudioPolicyManager(&client, path);
+        ASSERT_EQ(NO_ERROR, manager->initCheck());
+        ASSERT_EQ(kOutputCounts[c] + 1, client.getOutputs().size());
+
+        for (int i = 0; i < AUDIO_STREAM_PUBLIC_CNT; i++) {
+            audio_stream_type_t stream = static_cast<audio_stream_type_t>(i);
+            manager->initStreamVolume(stream, 0, 15);
+            manager->setStreamVolumeIndex(stream, 10, AUDIO_DEVICE_OUT_DEFAULT);
+        }
+        // music playing on every output
+        for (size_t i = 0; i < client.getOutputs().size(); i++) {
+            ASSERT_EQ(NO_ERROR, manager->startOutput(client.getOutputs()[i], AUDIO_STREAM_MUSIC,
+                                                     AUDIO_SESSION_OUTPUT_MIX));
+        }
+
+        const uint32_t volumeCount = client.getStreamVolumeCount();
+        double total = 0;
+        double longest = 0;
+        for (int i = 0; i < kChanges; i++) {
+            const audio_policy_dev_state_t state = (i & 1) == 0 ?
+                    AUDIO_POLICY_DEVICE_STATE_AVAILABLE : AUDIO_POLICY_DEVICE_STATE_UNAVAILABLE;
+            const double start = nowSeconds();
+            EXPECT_EQ(NO_ERROR, manager->setDeviceConnectionState(
+                    AUDIO_DEVICE_OUT_WIRED_HEADSET, state, "", ""));
+            const double elapsed = nowSeconds() - start;
+            total += elapsed;
+            longest = elapsed > longest ? elapsed : longest;
+        }
+        printf("%-8zu %12.1f %12.1f %16u\n", client.getOutputs().size(),
+               total * 1e6 / kChanges, longest * 1e6,
+               (client.getStreamVolumeCount() - volumeCount) / kChanges);
+        delete manager;
+    }
+    unlink(path);
+}